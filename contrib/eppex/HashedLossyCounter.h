@@ -0,0 +1,287 @@
+/**
+ * HashedLossyCounter - implementation of Lossy Counting algorithm as described in:
+ * Approximate Frequency Counts over Data Streams, G.S.Manku & R.Motwani, (2002)
+ * for items serialized into byte strings.
+ *
+ * The keys are stored one after another in a single arena, the counts in an
+ * open addressing table (linear probing). Pruning rebuilds both the table and
+ * the arena from the surviving items, so memory stays bounded by the lossy
+ * counting guarantees.
+ *
+ * Used by the parallel mode of eppex: phrase pairs are partitioned by their
+ * hash among several independent counters.
+ *
+ * $Id$
+ */
+
+#ifndef HASHEDLOSSYCOUNTER_H
+#define	HASHEDLOSSYCOUNTER_H
+
+#include <stddef.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+class HashedLossyCounter {
+
+public:
+
+    // Error parameter type definition.
+    typedef double error_t;
+
+    // Support parameter type definition.
+    typedef double support_t;
+
+    // Counters type definition.
+    typedef size_t counter_t;
+
+    // Frequency counter type definition (f).
+    typedef counter_t frequency_t;
+
+    // Maximum error counter type definition (Δ).
+    typedef counter_t maximum_error_t;
+
+    /** @var Error parameter value (ε) */
+    const error_t error;
+
+    /** @var Supprort parameter value (s) */
+    const support_t support;
+
+    /** @var Width of single bucket (w) */
+    const counter_t bucketWidth; // ceil(1/error)
+
+private:
+
+    /** A slot of the open addressing table (empty if length is 0). */
+    struct slot_t {
+        size_t hash;
+        size_t offset; // of the key in the arena
+        size_t length;
+        frequency_t frequency;
+        maximum_error_t maxError;
+    };
+
+    /** @var Current epoch bucket ID (b-current) */
+    counter_t _bucketId;
+
+    /** @var Count of items read in so far (N) */
+    counter_t _count;
+
+    /** @var Number of items currently in storage */
+    size_t _size;
+
+    /** @var Open addressing table, its size is a power of 2 */
+    std::vector<slot_t> _slots;
+
+    /** @var Keys of the items */
+    std::vector<unsigned char> _arena;
+
+public:
+
+    /**
+     * Set error to 0 to disable lossy-pruning.
+     * @param _error Value from interval [0.0, 1.0).
+     * @param _support Value from interval [0.0, 1.0).
+     */
+    HashedLossyCounter(error_t _error, support_t _support):
+        error(_error), support(_support), bucketWidth(_error > 0.0 ? ceil(1/_error) : 0), _bucketId(1), _count(0), _size(0), _slots(1024) {}
+
+    /**
+     * @param key Serialized item to be added to storage.
+     * @param length Length of the serialized item (greater than 0).
+     * @param hash Hash of the serialized item.
+     */
+    void add(const unsigned char* key, size_t length, size_t hash);
+
+    /**
+     * @return Number of slots, to be visited by get().
+     */
+    size_t slots(void) const { return _slots.size(); }
+
+    /**
+     * @param slot Slot index from interval [0, slots()).
+     * @return False, if the slot is empty.
+     */
+    bool get(size_t slot, const unsigned char*& key, size_t& length, frequency_t& frequency, maximum_error_t& maxError) const;
+
+    /**
+     * Releases the stored items, keeps the count of items read in so far (N).
+     */
+    void release(void) {
+        std::vector<slot_t>(1).swap(_slots);
+        std::vector<unsigned char>().swap(_arena);
+        _size = 0;
+    }
+
+    /**
+     * @return Current bucket ID.
+     */
+    counter_t bucketId(void) const { return _bucketId; }
+
+    /**
+     * @return Number of items added to storage so far (N).
+     */
+    counter_t count(void) const { return _count; }
+
+    /**
+     * @return Number of items currently in storage.
+     */
+    size_t size(void) const { return _size; }
+
+    /**
+     * @return True, if it's prunning time right now!
+     */
+    bool aboutToPrune(void) const { return (bucketWidth != 0) && ((_count % bucketWidth) == 0); }
+
+    /**
+     * @return Hash of the serialized item (FNV-1a).
+     */
+    static size_t hash(const unsigned char* key, size_t length) {
+        unsigned long long h = 14695981039346656037ULL;
+        for ( size_t i = 0; i < length; ++i ) {
+            h = (h ^ key[i]) * 1099511628211ULL;
+        }
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+
+private:
+
+    /**
+     * @return Slot holding the key, or the empty slot where it belongs.
+     */
+    size_t find(const unsigned char* key, size_t length, size_t hash) const;
+
+    /**
+     * Moves the items into a table with given number of slots.
+     * @param pruning Drop items with frequency + maximum error <= current bucket ID?
+     */
+    void rebuild(size_t numSlots, bool pruning);
+
+    /**
+     * Prunes counts table.
+     */
+    void prune(void);
+
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/////////////////////// Hashed Lossy Counter Implementation ////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+inline size_t HashedLossyCounter::find(const unsigned char* key, size_t length, size_t hash) const {
+    const size_t mask = _slots.size() - 1;
+    size_t i = hash & mask;
+    while ( _slots[i].length != 0 ) {
+        if ( (_slots[i].hash == hash) && (_slots[i].length == length) && (memcmp(&_arena[_slots[i].offset], key, length) == 0) ) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+inline void HashedLossyCounter::add(const unsigned char* key, size_t length, size_t hash) {
+
+    size_t i = find(key, length, hash);
+
+    if ( _slots[i].length == 0 ) {
+        // Insert new item with appropriate frequency and maximum-possible-error.
+        slot_t& slot = _slots[i];
+        slot.hash = hash;
+        slot.offset = _arena.size();
+        slot.length = length;
+        slot.frequency = 1;
+        slot.maxError = _bucketId - 1;
+        _arena.insert(_arena.end(), key, key + length);
+        // Keep the load factor below 1/2.
+        if ( ++_size * 2 > _slots.size() ) {
+            rebuild(_slots.size() * 2, false);
+        }
+    }
+    else {
+        // Update frequency of existing.
+        _slots[i].frequency += 1;
+    }
+
+    // Finally increment the counter and check if the table shall be pruned.
+    ++_count;
+    if ( this->aboutToPrune() ) {
+        this->prune();
+        ++_bucketId;
+    }
+}
+
+inline bool HashedLossyCounter::get(size_t slot, const unsigned char*& key, size_t& length, frequency_t& frequency, maximum_error_t& maxError) const {
+    const slot_t& s = _slots[slot];
+    if ( s.length == 0 ) {
+        return false;
+    }
+    key = &_arena[s.offset];
+    length = s.length;
+    frequency = s.frequency;
+    maxError = s.maxError;
+    return true;
+}
+
+inline void HashedLossyCounter::rebuild(size_t numSlots, bool pruning) {
+
+    std::vector<slot_t> slots(numSlots);
+    const size_t mask = numSlots - 1;
+
+    if ( !pruning ) {
+        // Growing: the keys stay where they are.
+        for ( size_t j = 0; j < _slots.size(); ++j ) {
+            if ( _slots[j].length != 0 ) {
+                size_t i = _slots[j].hash & mask;
+                while ( slots[i].length != 0 ) i = (i + 1) & mask;
+                slots[i] = _slots[j];
+            }
+        }
+        _slots.swap(slots);
+        return;
+    }
+
+    // Pruning: the surviving keys are compacted into a new arena.
+    std::vector<unsigned char> arena;
+    arena.reserve(_arena.size() / 2);
+    _size = 0;
+
+    for ( size_t j = 0; j < _slots.size(); ++j ) {
+        const slot_t& old = _slots[j];
+        // Prune, if: maximum possible error + frequency <= ID of current bucket
+        if ( (old.length == 0) || (old.frequency + old.maxError <= _bucketId) ) {
+            continue;
+        }
+        size_t i = old.hash & mask;
+        while ( slots[i].length != 0 ) i = (i + 1) & mask;
+        slots[i] = old;
+        slots[i].offset = arena.size();
+        arena.insert(arena.end(), _arena.begin() + old.offset, _arena.begin() + old.offset + old.length);
+        ++_size;
+    }
+
+    _slots.swap(slots);
+    _arena.swap(arena);
+}
+
+inline void HashedLossyCounter::prune(void) {
+
+    size_t survivors = 0;
+    for ( size_t j = 0; j < _slots.size(); ++j ) {
+        if ( (_slots[j].length != 0) && (_slots[j].frequency + _slots[j].maxError > _bucketId) ) {
+            ++survivors;
+        }
+    }
+
+    // Smallest power of 2 keeping the load factor below 1/2.
+    size_t numSlots = 1024;
+    while ( numSlots < survivors * 2 + 2 ) {
+        numSlots *= 2;
+    }
+
+    rebuild(numSlots, true);
+}
+
+#endif	/* HASHEDLOSSYCOUNTER_H */
@@ -11,6 +11,7 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <stdlib.h>
 #include <string.h>
 
 #include "config.h"
@@ -47,6 +48,9 @@ bool compactOutputFlag = false; // Generate compact output:
 // Each phrase pair is printed only once with its frequency prepended.
 // Note that compacted output is not compatible with std phrase-extract format.
 
+int threads = 0; // Count phrase pairs in this many hash partitioned lossy counters
+// (shards), fed by as many threads.
+
 
 //// Functions.
 
@@ -59,14 +63,18 @@ void program_info(void) {
 #else
         << "std::map"
 #endif
-        << " implementation.\n"
+        << " implementation"
+#ifdef WITH_THREADS
+        << " and threads support"
+#endif
+        << ".\n"
 	;
 }
 
 void read_optional_params(int argc, char* argv[], int optionalParamsStart);
 
 void usage(const char* programName) {
-    std::cerr << std::endl << "Syntax: " << std::string(programName) << " tgt src align extract lossy-counter [lossy-counter-2 [...]] [--compact] [--sort] [orientation [ --model [wbe|phrase|hier]-[msd|mslr|mono] ]]" << std::endl;
+    std::cerr << std::endl << "Syntax: " << std::string(programName) << " tgt src align extract lossy-counter [lossy-counter-2 [...]] [--compact] [--sort] [--threads num] [orientation [ --model [wbe|phrase|hier]-[msd|mslr|mono] ]]" << std::endl;
     std::cerr << get_lossy_counting_params_format();
     exit(1);
 }
@@ -124,11 +132,23 @@ int main(int argc, char* argv[]) {
         ++paramIdx;
     }
 
+    if ( (argc > paramIdx + 1) && (strcmp(argv[paramIdx], "--threads") == 0) ) {
+        threads = atoi(argv[paramIdx + 1]);
+        if ( threads < 1 ) {
+            std::cerr << "ERROR: number of threads has to be at least 1!" << std::endl;
+            usage(argv[0]);
+        }
+        paramIdx += 2;
+    }
+
     //
     read_optional_params(argc, argv, paramIdx);
 
     std::cerr << "Starting epochal phrase table extraction with params:" << lossyCountersParams << std::endl;
     std::cerr << "Output will be " << (sortedOutput ? "sorted" : "unsorted") << "." << std::endl;
+    if ( threads > 0 ) {
+        std::cerr << "Phrase pairs will be counted in " << threads << " hash partitioned lossy counters." << std::endl;
+    }
 
     // open input files
     std::ifstream eFile(fileNameE);
@@ -151,7 +171,12 @@ int main(int argc, char* argv[]) {
     }
 
     //
-    readInput(eFile, fFile, aFile);
+    if ( threads > 0 ) {
+        readInputInParallel(eFile, fFile, aFile, threads);
+    }
+    else {
+        readInput(eFile, fFile, aFile);
+    }
 
     std::cerr << std::endl; // Leave the progress bar end on previous line.
     
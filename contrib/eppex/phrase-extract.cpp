@@ -13,9 +13,18 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <limits>
 
 #include "phrase-extract.h"
 #include "ISS.h"
+#ifndef GET_COUNTS_ONLY
+#include <map>
+#include <boost/unordered_map.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#include "../phrase-extract/SentenceBatchQueue.h"
+#endif
+#endif
 // I'm using my own version of SafeGetline (without "using namespace std;"):
 #include "SafeGetline.h"
 
@@ -49,6 +58,10 @@ void processUnsortedOutput(OutputProcessor& processor);
 
 void flushPhrasePair(OutputProcessor& processor, const indexed_phrases_pair_t& indexedPhrasePair, PhrasePairsLossyCounter::frequency_t frequency, int mode);
 
+#ifndef GET_COUNTS_ONLY
+void collectShardedOutput(LossyCounterInstance& instance, output_vector_t& output);
+#endif
+
 
 //////// Define variables declared as extern in the header /////////////////////
 bool allModelsOutputFlag = false;
@@ -285,7 +298,7 @@ bool isAligned ( SentenceAlignment &sentence, int fi, int ei )
 
 /////// Slightly modified Philipp Koehn's code :) //////////////////////////////
 
-void extract(SentenceAlignment &sentence) {
+void extract(SentenceAlignment &sentence, PhrasePairCollector *collector) {
 
     int countE = sentence.target.size();
     int countF = sentence.source.size();
@@ -389,7 +402,8 @@ void extract(SentenceAlignment &sentence) {
                                 wordNextOrient = getOrientWordModel(sentence, wordType, connectedLeftTopN, connectedRightTopN, endF, startF, endE, startE, 0, countF, -1, &lt, &ge);
                                 orientationInfo += getOrientString(wordPrevOrient, wordType) + " " + getOrientString(wordNextOrient, wordType);
                             }
-                            addPhrase(sentence, startE, endE, startF, endF, orientationInfo);
+                            if (collector) (*collector)(sentence, startE, endE, startF, endF, orientationInfo);
+                            else addPhrase(sentence, startE, endE, startF, endF, orientationInfo);
                         }
                     }
                 }
@@ -449,7 +463,8 @@ void extract(SentenceAlignment &sentence) {
                             ((hierModel)? getOrientString(hierPrevOrient, hierType) + " " + getOrientString(hierNextOrient, hierType) : "");
             }
             
-            addPhrase(sentence, startE, endE, startF, endF, orientationInfo);
+            if (collector) (*collector)(sentence, startE, endE, startF, endF, orientationInfo);
+            else addPhrase(sentence, startE, endE, startF, endF, orientationInfo);
             
         } // end of for loop through inbound phrases
 
@@ -538,6 +553,388 @@ void readInput(std::istream& eFile, std::istream& fFile, std::istream& aFile) {
 }
 
 
+#ifndef GET_COUNTS_ONLY
+
+/////// Parallel Lossy Counting ////////////////////////////////////////////////
+
+// Phrase pairs are partitioned by their hash among independent lossy counters
+// (shards). Each shard is fed under its own lock, words and orientation infos
+// are indexed under a shared lock with per-thread caches in front of it.
+
+#ifdef WITH_THREADS
+boost::mutex stringsMutex;
+boost::mutex orientationsMutex;
+std::vector<boost::mutex *> shardMutexes;
+#endif
+
+// Serialized phrase pair: source phrase length, target phrase length,
+// alignment length and orientation info index, followed by the word indices
+// and the alignment points.
+typedef std::vector<unsigned char> phrase_pair_key_t;
+
+// Every length and alignment point of a serialized phrase pair takes a byte.
+const size_t maxEncodedLength = std::numeric_limits<unsigned char>::max();
+
+void encodePhrasePair(const indexed_phrases_pair_t::phrase_t& srcPhrase, const indexed_phrases_pair_t::phrase_t& tgtPhrase, orientation_info_index_t orientationInfo, const alignment_t& alignment, phrase_pair_key_t& key) {
+    key.clear();
+    key.push_back(static_cast<unsigned char>(srcPhrase.size()));
+    key.push_back(static_cast<unsigned char>(tgtPhrase.size()));
+    key.push_back(static_cast<unsigned char>(alignment.size()));
+    key.push_back(orientationInfo);
+    const size_t wordsOffset = key.size();
+    key.resize(wordsOffset + (srcPhrase.size() + tgtPhrase.size()) * sizeof(word_index_t));
+    if ( !srcPhrase.empty() ) memcpy(&key[wordsOffset], &srcPhrase[0], srcPhrase.size() * sizeof(word_index_t));
+    if ( !tgtPhrase.empty() ) memcpy(&key[wordsOffset + srcPhrase.size() * sizeof(word_index_t)], &tgtPhrase[0], tgtPhrase.size() * sizeof(word_index_t));
+    for ( alignment_t::const_iterator iter = alignment.begin(); iter != alignment.end(); ++iter ) {
+        key.push_back(iter->first);
+        key.push_back(iter->second);
+    }
+}
+
+indexed_phrases_pair_t decodePhrasePair(const unsigned char* key) {
+    const size_t srcLength = key[0], tgtLength = key[1], alignmentLength = key[2];
+    const unsigned char* words = key + 4;
+    indexed_phrases_pair_t::phrase_t srcPhrase(srcLength), tgtPhrase(tgtLength);
+    if ( srcLength > 0 ) memcpy(&srcPhrase[0], words, srcLength * sizeof(word_index_t));
+    if ( tgtLength > 0 ) memcpy(&tgtPhrase[0], words + srcLength * sizeof(word_index_t), tgtLength * sizeof(word_index_t));
+    const unsigned char* points = words + (srcLength + tgtLength) * sizeof(word_index_t);
+    alignment_t alignment;
+    for ( size_t i = 0; i < alignmentLength; ++i ) {
+        alignment.push_back(alignment_t::value_type(points[2*i], points[2*i + 1]));
+    }
+    return indexed_phrases_pair_t(srcPhrase, tgtPhrase, key[3], alignment);
+}
+
+/**
+ * Collects the phrase pairs of a batch of sentences and adds them to the
+ * shards in one go (taking every shard lock once per batch).
+ */
+class ShardingCollector: public PhrasePairCollector {
+
+    struct pending_t {
+        size_t length; // phrase pair length (lossy counter index)
+        size_t hash;
+        size_t offset; // of the key in _keys
+        size_t keyLength;
+    };
+
+    /** @var Pending phrase pairs per shard */
+    std::vector<std::vector<pending_t> > _pending;
+
+    /** @var Keys of the pending phrase pairs */
+    std::vector<unsigned char> _keys;
+
+    /** @var Lock the shared storages? */
+    const bool _locking;
+
+    boost::unordered_map<std::string, word_index_t> _words;
+    std::map<std::string, orientation_info_index_t> _orientations;
+
+    // Reused buffers.
+    phrase_pair_key_t _key;
+    alignment_t _alignment;
+    indexed_phrases_pair_t::phrase_t _srcPhrase, _tgtPhrase;
+
+public:
+
+    ShardingCollector(size_t shards, bool locking): _pending(shards), _locking(locking) {}
+
+    void operator() (SentenceAlignment& sentence, int startE, int endE, int startF, int endF, std::string& orientationInfo);
+
+    /**
+     * Adds the pending phrase pairs to the shards.
+     */
+    void flush(void);
+
+private:
+
+    void addPending(size_t shard);
+
+    word_index_t wordIndex(const std::string& word);
+
+    orientation_info_index_t orientationIndex(const std::string& orientationInfo);
+
+};
+
+word_index_t ShardingCollector::wordIndex(const std::string& word) {
+    boost::unordered_map<std::string, word_index_t>::const_iterator iter = _words.find(word);
+    if ( iter != _words.end() ) {
+        return iter->second;
+    }
+    word_index_t index;
+#ifdef WITH_THREADS
+    if ( _locking ) {
+        boost::mutex::scoped_lock lock(stringsMutex);
+        index = strings.put(word.c_str());
+    }
+    else
+#endif
+    index = strings.put(word.c_str());
+    _words[word] = index;
+    return index;
+}
+
+orientation_info_index_t ShardingCollector::orientationIndex(const std::string& orientationInfo) {
+    std::map<std::string, orientation_info_index_t>::const_iterator iter = _orientations.find(orientationInfo);
+    if ( iter != _orientations.end() ) {
+        return iter->second;
+    }
+    orientation_info_index_t index;
+#ifdef WITH_THREADS
+    if ( _locking ) {
+        boost::mutex::scoped_lock lock(orientationsMutex);
+        index = orientations.put(orientationInfo.c_str());
+    }
+    else
+#endif
+    index = orientations.put(orientationInfo.c_str());
+    _orientations[orientationInfo] = index;
+    return index;
+}
+
+void ShardingCollector::operator() (SentenceAlignment& sentence, int startE, int endE, int startF, int endF, std::string& orientationInfo) {
+
+    // alignment
+    _alignment.clear();
+    for (int ei = startE; ei <= endE; ++ei) {
+        for (int i = 0; i < sentence.alignedToT[ei].size(); ++i) {
+            int fi = sentence.alignedToT[ei][i];
+            _alignment.push_back(alignment_t::value_type(fi-startF, ei-startE));
+        }
+    }
+
+    if ( _alignment.size() > maxEncodedLength || static_cast<size_t>(endF - startF + 1) > maxEncodedLength || static_cast<size_t>(endE - startE + 1) > maxEncodedLength ) {
+        std::cerr << "WARNING: phrase pair in sentence " << sentence.sentenceID << " has more than "
+                  << maxEncodedLength << " words or alignment points, skipped." << std::endl;
+        return;
+    }
+
+    // source phrase
+    _srcPhrase.clear();
+    for (int fi = startF; fi <= endF; ++fi) {
+        _srcPhrase.push_back(wordIndex(sentence.source[fi]));
+    }
+
+    // target phrase
+    _tgtPhrase.clear();
+    for (int ei = startE; ei <= endE; ++ei) {
+        _tgtPhrase.push_back(wordIndex(sentence.target[ei]));
+    }
+
+    encodePhrasePair(_srcPhrase, _tgtPhrase, orientationIndex(orientationInfo), _alignment, _key);
+
+    pending_t pending;
+    pending.length = std::max(_srcPhrase.size(), _tgtPhrase.size());
+    pending.hash = HashedLossyCounter::hash(&_key[0], _key.size());
+    pending.offset = _keys.size();
+    pending.keyLength = _key.size();
+    _keys.insert(_keys.end(), _key.begin(), _key.end());
+    // Fold the upper bits in to choose the shard, the lower bits choose the
+    // slot within the shard (size_t may have only 32 bits).
+    _pending[(pending.hash ^ (pending.hash >> 16)) % _pending.size()].push_back(pending);
+}
+
+void ShardingCollector::addPending(size_t shard) {
+    std::vector<pending_t>& pending = _pending[shard];
+    for ( std::vector<pending_t>::const_iterator iter = pending.begin(); iter != pending.end(); ++iter ) {
+        lossyCounters[iter->length]->shards[shard]->add(&_keys[iter->offset], iter->keyLength, iter->hash);
+    }
+    pending.clear();
+}
+
+void ShardingCollector::flush(void) {
+    for ( size_t shard = 0; shard < _pending.size(); ++shard ) {
+        if ( _pending[shard].empty() ) {
+            continue;
+        }
+#ifdef WITH_THREADS
+        // Shard locks only exist when several threads count.
+        if ( _locking ) {
+            boost::mutex::scoped_lock lock(*shardMutexes[shard]);
+            addPending(shard);
+        }
+        else
+#endif
+        addPending(shard);
+    }
+    _keys.clear();
+}
+
+/**
+ * Extracts the phrase pairs of a single sentence into the collector.
+ */
+void extractSentence(char* englishString, char* foreignString, char* alignmentString, int sentenceId, ShardingCollector& collector) {
+    SentenceAlignment sentence;
+    if (sentence.create(englishString, foreignString, alignmentString, sentenceId)) {
+        extract(sentence, &collector);
+    }
+}
+
+#ifdef WITH_THREADS
+/**
+ * Extracts phrase pairs from batches of sentences.
+ */
+class ExtractWorker {
+
+    Moses::SentenceBatchQueue& _queue;
+
+    const size_t _shards;
+
+public:
+
+    ExtractWorker(Moses::SentenceBatchQueue& queue, size_t shards): _queue(queue), _shards(shards) {}
+
+    void operator() (void) {
+        ShardingCollector collector(_shards, true);
+        std::vector<char> englishString, foreignString, alignmentString;
+        Moses::SentenceBatch* batch;
+        while ( (batch = _queue.Pop()) != NULL ) {
+            for ( size_t i = 0; i < batch->targetLines.size(); ++i ) {
+                englishString.assign(batch->targetLines[i].begin(), batch->targetLines[i].end());
+                englishString.push_back('\0');
+                foreignString.assign(batch->sourceLines[i].begin(), batch->sourceLines[i].end());
+                foreignString.push_back('\0');
+                alignmentString.assign(batch->alignmentLines[i].begin(), batch->alignmentLines[i].end());
+                alignmentString.push_back('\0');
+                extractSentence(&englishString[0], &foreignString[0], &alignmentString[0], batch->firstLineNum + i, collector);
+            }
+            collector.flush();
+            delete batch;
+        }
+    }
+
+};
+#endif
+
+void readInputInParallel(std::istream& eFile, std::istream& fFile, std::istream& aFile, int threads) {
+
+#ifndef WITH_THREADS
+    if ( threads > 1 ) {
+        std::cerr << "WARNING: compiled without threading support, counting on a single thread." << std::endl;
+        threads = 1;
+    }
+#endif
+
+    // Create shards of every lossy counter instance.
+    LossyCountersVector::value_type prev = NULL;
+    for ( size_t i = 1; i < lossyCounters.size(); ++i ) { // Intentionally skip 0.
+        if ( lossyCounters[i] != prev ) {
+            prev = lossyCounters[i];
+            for ( int shard = 0; shard < threads; ++shard ) {
+                prev->shards.push_back(new HashedLossyCounter(prev->lossyCounter.error, prev->lossyCounter.support));
+            }
+        }
+    }
+
+    // Note: moved out of the loop.
+    char englishString[LINE_MAX_LENGTH];
+    char foreignString[LINE_MAX_LENGTH];
+    char alignmentString[LINE_MAX_LENGTH];
+
+    const size_t batchSize = 1000;
+    int i = 0;
+
+#ifdef WITH_THREADS
+    if ( threads > 1 ) {
+        for ( int shard = 0; shard < threads; ++shard ) {
+            shardMutexes.push_back(new boost::mutex());
+        }
+
+        Moses::SentenceBatchQueue queue(threads * 2);
+        boost::thread_group workers;
+        for ( int t = 0; t < threads; ++t ) {
+            workers.create_thread(ExtractWorker(queue, threads));
+        }
+
+        Moses::SentenceBatch* batch = NULL;
+        while(true) {
+            // Report progress?
+            if (++i%10000 == 0) std::cerr << "." << std::flush;
+
+            SAFE_GETLINE(eFile, englishString, LINE_MAX_LENGTH, '\n', __FILE__);
+            if (eFile.eof()) break;
+            SAFE_GETLINE(fFile, foreignString, LINE_MAX_LENGTH, '\n', __FILE__);
+            SAFE_GETLINE(aFile, alignmentString, LINE_MAX_LENGTH, '\n', __FILE__);
+
+            if ( batch == NULL ) {
+                batch = new Moses::SentenceBatch();
+                batch->firstLineNum = i;
+            }
+            batch->targetLines.push_back(englishString);
+            batch->sourceLines.push_back(foreignString);
+            batch->alignmentLines.push_back(alignmentString);
+            if ( batch->targetLines.size() == batchSize ) {
+                queue.Push(batch);
+                batch = NULL;
+            }
+        }
+        if ( batch != NULL ) {
+            queue.Push(batch);
+        }
+        queue.Close();
+        workers.join_all();
+
+        for ( int shard = 0; shard < threads; ++shard ) {
+            delete shardMutexes[shard];
+        }
+        shardMutexes.clear();
+        return;
+    }
+#endif
+
+    ShardingCollector collector(threads, false);
+
+    while(true) {
+        // Report progress?
+        if (++i%10000 == 0) std::cerr << "." << std::flush;
+
+        SAFE_GETLINE(eFile, englishString, LINE_MAX_LENGTH, '\n', __FILE__);
+        if (eFile.eof()) break;
+        SAFE_GETLINE(fFile, foreignString, LINE_MAX_LENGTH, '\n', __FILE__);
+        SAFE_GETLINE(aFile, alignmentString, LINE_MAX_LENGTH, '\n', __FILE__);
+
+        extractSentence(englishString, foreignString, alignmentString, i, collector);
+        if ( i % batchSize == 0 ) {
+            collector.flush();
+        }
+    }
+    collector.flush();
+
+}
+
+/**
+ * Moves the phrase pairs passing the threshold merged over all shards of the
+ * instance to output (and releases the shards).
+ */
+void collectShardedOutput(LossyCounterInstance& instance, output_vector_t& output) {
+
+    // Every phrase pair is counted by a single shard with an error of at most
+    // ε*N_shard <= ε*N, so the merged threshold (s-ε)N keeps all phrase pairs
+    // with true frequency >= sN.
+    const double threshold = instance.threshold();
+
+    for ( size_t shard = 0; shard < instance.shards.size(); ++shard ) {
+        const HashedLossyCounter& counter = *instance.shards[shard];
+        const unsigned char* key;
+        size_t length;
+        HashedLossyCounter::frequency_t frequency;
+        HashedLossyCounter::maximum_error_t maxError;
+        for ( size_t slot = 0; slot < counter.slots(); ++slot ) {
+            if ( counter.get(slot, key, length, frequency, maxError) && (frequency >= threshold) ) {
+                output.push_back(std::make_pair(decodePhrasePair(key), frequency));
+            }
+        }
+    }
+
+    // Statistics need the counts, so only the items are released.
+    for ( size_t shard = 0; shard < instance.shards.size(); ++shard ) {
+        instance.shards[shard]->release();
+    }
+}
+
+#endif
+
+
 void processOutput(OutputProcessor& processor) {
     if ( sortedOutput ) {
         processSortedOutput(processor);
@@ -651,6 +1048,18 @@ void processSortedOutput(OutputProcessor& processor) {
     for ( size_t i = 1; i < lossyCounters.size(); ++i ) { // Intentionally skip 0.
         current = lossyCounters[i];
         if ( current != prev ) {
+#ifndef GET_COUNTS_ONLY
+            if ( !current->shards.empty() ) {
+                size_t from = output.size();
+                collectShardedOutput(*current, output);
+                for ( output_vector_t::const_iterator iter = output.begin() + from; iter != output.end(); ++iter ) {
+                    current->outputMass += iter->second;
+                    current->outputSize += 1;
+                }
+                prev = current;
+                continue;
+            }
+#endif
             PhrasePairsLossyCounter& lossyCounter = current->lossyCounter;
             for ( PhrasePairsLossyCounter::erasing_iterator phraseIter = lossyCounter.beginErase(); phraseIter != lossyCounter.endErase(); ++phraseIter ) {
                 // Store and...
@@ -694,6 +1103,20 @@ void processUnsortedOutput(OutputProcessor& processor) {
 
         if ( current != prev ) {
 
+#ifndef GET_COUNTS_ONLY
+            if ( !current->shards.empty() ) {
+                output_vector_t output;
+                collectShardedOutput(*current, output);
+                for ( output_vector_t::const_iterator iter = output.begin(); iter != output.end(); ++iter ) {
+                    flushPhrasePair(processor, iter->first, iter->second, 0);
+                    current->outputMass += iter->second;
+                    current->outputSize += 1;
+                }
+                prev = current;
+                continue;
+            }
+#endif
+
             const PhrasePairsLossyCounter& lossyCounter = current->lossyCounter;
 
             for ( PhrasePairsLossyCounter::const_iterator phraseIter = lossyCounter.begin(); phraseIter != lossyCounter.end(); ++phraseIter ) {
@@ -763,7 +1186,7 @@ void printStats(void) {
             // Increment overall stats.
             outputMass += prev->outputMass;
             outputSize += prev->outputSize;
-            N += prev->lossyCounter.count();
+            N += prev->count();
 
             // Print.
             if ( from == to ) {
@@ -778,11 +1201,11 @@ void printStats(void) {
             std::cerr
                     << std::setw(15) << prev->outputSize << " # "
                     << std::setw(15) << prev->outputMass << " # "
-                    << std::setw(15) << prev->lossyCounter.count() << " # "
-                    << std::setw(10) << std::setprecision(4) << (static_cast<double>(prev->outputMass) / static_cast<double>(prev->lossyCounter.count())) * 100 << " # "
-                    << std::setw(10) << prev->lossyCounter.threshold(true) << " # "
-                    << std::setw(10) << prev->lossyCounter.threshold() << " # "
-                    << std::setw(10) << prev->lossyCounter.maxError() << " #"
+                    << std::setw(15) << prev->count() << " # "
+                    << std::setw(10) << std::setprecision(4) << (static_cast<double>(prev->outputMass) / static_cast<double>(prev->count())) * 100 << " # "
+                    << std::setw(10) << prev->threshold(true) << " # "
+                    << std::setw(10) << prev->threshold() << " # "
+                    << std::setw(10) << prev->maxError() << " #"
                     << std::endl << hline << std::endl;
 
             from = i;
@@ -22,6 +22,7 @@
 #include "../phrase-extract/SentenceAlignment.h"
 
 #include "typedefs.h"
+#include "HashedLossyCounter.h"
 
 
 //////// Types definitions /////////////////////////////////////////////////////
@@ -56,13 +57,45 @@ struct LossyCounterInstance {
     size_t outputSize; // unique
     //
     PhrasePairsLossyCounter lossyCounter;
+    // Parallel mode: phrase pairs are partitioned by their hash among
+    // independent lossy counters (lossyCounter stays empty then).
+    std::vector<HashedLossyCounter *> shards;
 
     LossyCounterInstance(PhrasePairsLossyCounter::error_t error, PhrasePairsLossyCounter::support_t support): outputMass(0), outputSize(0), lossyCounter(error, support) {}
+
+    // Statistics merged over the shards: every phrase pair is counted by
+    // a single shard, so its error is at most ε*N_shard <= ε*N.
+
+    /**
+     * @return Number of items added so far (N).
+     */
+    size_t count(void) const {
+        if ( shards.empty() ) return lossyCounter.count();
+        size_t n = 0;
+        for ( size_t i = 0; i < shards.size(); ++i ) n += shards[i]->count();
+        return n;
+    }
+
+    /**
+     * @param positive Return sN value instead of (s-ε)N?
+     * @return Threshold (either positive or negative) value.
+     */
+    double threshold(bool positive = false) const { return positive ? lossyCounter.support * count() : (lossyCounter.support - lossyCounter.error) * count(); }
+
+    /**
+     * @return The maximum value of which estimated frequencies are less than the true frequencies.
+     */
+    double maxError(void) const { return lossyCounter.error * count(); }
 };
 
 //
 typedef std::vector<LossyCounterInstance *> LossyCountersVector;
 
+// Receives the phrase pairs found by extract().
+struct PhrasePairCollector {
+    virtual void operator() (SentenceAlignment& sentence, int startE, int endE, int startF, int endF, std::string& orientationInfo) = 0;
+};
+
 struct OutputProcessor {
     virtual void operator() (const std::string& srcPhrase, const std::string& tgtPhrase, const std::string& orientationInfo, const alignment_t& alignment, const size_t frequency, int mode) = 0;
 };
@@ -96,13 +129,14 @@ bool ge(int, int);
 bool le(int, int);
 bool lt(int, int);
 bool isAligned (SentenceAlignment &, int, int);
-void extract(SentenceAlignment &);
+void extract(SentenceAlignment &, PhrasePairCollector * = NULL);
 
 //// Modified ////
 void addPhrase(SentenceAlignment &, int, int, int, int, std::string &);
 
 //// Added ////
 void readInput(std::istream& eFile, std::istream& fFile, std::istream& aFile);
+void readInputInParallel(std::istream& eFile, std::istream& fFile, std::istream& aFile, int threads);
 void processOutput(OutputProcessor& processor);
 void printStats(void);
 
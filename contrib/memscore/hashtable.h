@@ -0,0 +1,266 @@
+// memscore - in-memory phrase scoring for Statistical Machine Translation
+// Christian Hardmeier, FBK-irst, Trento, 2010
+// $Id$
+
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "memscore.h"
+
+// Open addressing hash tables (linear probing, load factor below 1/2).
+
+inline size_t hash_bytes(const char *s, size_t len)
+{
+  unsigned long long h = 14695981039346656037ULL; // FNV-1a
+  for(size_t i = 0; i < len; i++)
+    h = (h ^ static_cast<unsigned char>(s[i])) * 1099511628211ULL;
+  return static_cast<size_t>(h ^ (h >> 29));
+}
+
+// Interns strings as consecutive integer ids starting at first_id.
+class StringIndex
+{
+private:
+  std::deque<String> strings_; // references stay valid while indexing
+  std::vector<size_t> hashes_;
+  std::vector<Count> slots_;   // position in strings_ + 1, 0 if empty
+  Count first_id_;
+
+  size_t find_slot(const String &s, size_t h) const {
+    const size_t mask = slots_.size() - 1;
+    size_t i = h & mask;
+    while(slots_[i] != 0) {
+      const Count pos = slots_[i] - 1;
+      if(hashes_[pos] == h && strings_[pos] == s)
+        break;
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  void grow() {
+    std::vector<Count> slots(slots_.size() * 2, 0);
+    const size_t mask = slots.size() - 1;
+    for(Count pos = 0; pos < strings_.size(); pos++) {
+      size_t i = hashes_[pos] & mask;
+      while(slots[i] != 0)
+        i = (i + 1) & mask;
+      slots[i] = pos + 1;
+    }
+    slots_.swap(slots);
+  }
+
+public:
+  explicit StringIndex(Count first_id = 0) : slots_(1024, 0), first_id_(first_id) {}
+
+  // returns the id of s, a new one if s was not indexed before
+  Count index(const String &s) {
+    const size_t h = hash_bytes(s.data(), s.size());
+    const size_t i = find_slot(s, h);
+    if(slots_[i] != 0)
+      return first_id_ + slots_[i] - 1;
+
+    strings_.push_back(s);
+    hashes_.push_back(h);
+    slots_[i] = strings_.size();
+    if(strings_.size() * 2 > slots_.size())
+      grow();
+    return first_id_ + strings_.size() - 1;
+  }
+
+  // returns true and the id of s if s is indexed
+  bool find(const String &s, Count &id) const {
+    const size_t i = find_slot(s, hash_bytes(s.data(), s.size()));
+    if(slots_[i] == 0)
+      return false;
+    id = first_id_ + slots_[i] - 1;
+    return true;
+  }
+
+  const String &lookup(Count id) const {
+    assert(id >= first_id_ && id - first_id_ < strings_.size());
+    return strings_[id - first_id_];
+  }
+
+  Count size() const {
+    return strings_.size();
+  }
+};
+
+struct PhrasePairHash {
+  size_t operator()(const PhrasePair &p) const {
+    unsigned long long h = (static_cast<unsigned long long>(p.first) << 32) | p.second;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+};
+
+// Map from keys to values, iterated in table order.  Inserting may move
+// the entries and invalidates all iterators.
+template<class Key, class T, class Hash>
+class OpenHashMap
+{
+public:
+  typedef Key key_type;
+  typedef T mapped_type;
+  typedef std::pair<Key,T> value_type;
+  typedef size_t size_type;
+
+private:
+  std::vector<value_type> slots_;
+  std::vector<char> used_;
+  size_type size_;
+  Hash hash_;
+
+  size_type find_slot(const Key &k) const {
+    const size_type mask = slots_.size() - 1;
+    size_type i = hash_(k) & mask;
+    while(used_[i] && !(slots_[i].first == k))
+      i = (i + 1) & mask;
+    return i;
+  }
+
+  void grow() {
+    std::vector<value_type> slots(slots_.size() * 2);
+    std::vector<char> used(slots.size(), 0);
+    const size_type mask = slots.size() - 1;
+    for(size_type j = 0; j < slots_.size(); j++) {
+      if(!used_[j])
+        continue;
+      size_type i = hash_(slots_[j].first) & mask;
+      while(used[i])
+        i = (i + 1) & mask;
+      slots[i] = slots_[j];
+      used[i] = 1;
+    }
+    slots_.swap(slots);
+    used_.swap(used);
+  }
+
+  template<class Map, class Value>
+  class iterator_base
+  {
+    friend class OpenHashMap;
+    template<class M, class V> friend class iterator_base;
+
+  private:
+    Map *map_;
+    size_type pos_;
+
+    void skip_empty() {
+      while(pos_ < map_->slots_.size() && !map_->used_[pos_])
+        pos_++;
+    }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename OpenHashMap::value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Value *pointer;
+    typedef Value &reference;
+
+    iterator_base() : map_(NULL), pos_(0) {}
+    iterator_base(Map *map, size_type pos) : map_(map), pos_(pos) {
+      skip_empty();
+    }
+
+    // the copy constructor of iterator, converts iterator to const_iterator
+    iterator_base(const iterator_base<OpenHashMap,typename OpenHashMap::value_type> &it) : map_(it.map_), pos_(it.pos_) {}
+
+    reference operator*() const {
+      return map_->slots_[pos_];
+    }
+
+    pointer operator->() const {
+      return &map_->slots_[pos_];
+    }
+
+    iterator_base &operator++() {
+      pos_++;
+      skip_empty();
+      return *this;
+    }
+
+    iterator_base operator++(int) {
+      iterator_base it(*this);
+      ++*this;
+      return it;
+    }
+
+    template<class M, class V>
+    bool operator==(const iterator_base<M,V> &it) const {
+      return pos_ == it.pos_;
+    }
+
+    template<class M, class V>
+    bool operator!=(const iterator_base<M,V> &it) const {
+      return pos_ != it.pos_;
+    }
+  };
+
+public:
+  typedef iterator_base<OpenHashMap,value_type> iterator;
+  typedef iterator_base<const OpenHashMap,const value_type> const_iterator;
+
+  OpenHashMap() : slots_(1024), used_(1024, 0), size_(0) {}
+
+  iterator begin() {
+    return iterator(this, 0);
+  }
+
+  iterator end() {
+    return iterator(this, slots_.size());
+  }
+
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator end() const {
+    return const_iterator(this, slots_.size());
+  }
+
+  iterator find(const Key &k) {
+    const size_type i = find_slot(k);
+    return used_[i] ? iterator(this, i) : end();
+  }
+
+  const_iterator find(const Key &k) const {
+    const size_type i = find_slot(k);
+    return used_[i] ? const_iterator(this, i) : end();
+  }
+
+  std::pair<iterator,bool> insert(const value_type &v) {
+    size_type i = find_slot(v.first);
+    if(used_[i])
+      return std::make_pair(iterator(this, i), false);
+
+    if((size_ + 1) * 2 > slots_.size()) {
+      grow();
+      i = find_slot(v.first);
+    }
+    slots_[i] = v;
+    used_[i] = 1;
+    size_++;
+    return std::make_pair(iterator(this, i), true);
+  }
+
+  size_type size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+};
+
+#endif
@@ -2,17 +2,200 @@
 // Christian Hardmeier, FBK-irst, Trento, 2010
 // $Id$
 
+#include <functional>
 #include <iostream>
+#include <sstream>
 #include <vector>
 
+#include "parallelsort.h"
 #include "phrasetable.h"
 #include "scorer.h"
 
+#ifdef WITH_THREADS
+#include <map>
+#include <queue>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 const char *progname;
 
 typedef PhrasePairInfo::AlignmentVector::value_type VP;
+typedef std::vector<PhraseScorer *> ScorerList;
+
+// A phrase pair and its position in the output
+struct SortEntry {
+  unsigned long long key; // source phrase rank in the high, target phrase rank in the low bits
+  PhrasePairCounts::const_iterator it;
+
+  bool operator<(const SortEntry &e) const {
+    return key < e.key;
+  }
+};
+
+typedef std::vector<SortEntry> SortedPairs;
+
+// phrase pairs scored at a time, rounded up to whole source phrases
+const size_t CHUNK_PAIRS = 10000;
+
+// Reads the bytes of "phrase ||| " one at a time, looking the words up in
+// the dictionary instead of writing the text out.
+class PhraseKeyCursor
+{
+private:
+  const PhraseText &phrase_;
+  PhraseText::size_type word_;
+  size_t pos_;
+  bool lead_; // an empty phrase still has the space before "||| "
+
+public:
+  explicit PhraseKeyCursor(const PhraseText &phrase) : phrase_(phrase), word_(0), pos_(0), lead_(phrase.size() == 0) {}
+
+  // next byte, or -1 at the end
+  int next() {
+    if(lead_) {
+      lead_ = false;
+      return ' ';
+    }
+    if(word_ < phrase_.size()) {
+      const String &w = phrase_.word(word_);
+      if(pos_ < w.size())
+        return static_cast<unsigned char>(w[pos_++]);
+      word_++;
+      pos_ = 0;
+      return ' ';
+    }
+    static const char tail[] = "||| ";
+    if(pos_ < sizeof(tail) - 1)
+      return tail[pos_++];
+    return -1;
+  }
+
+  // skips the next word and its space if both cursors start the same word
+  static void skip_common_words(PhraseKeyCursor &a, PhraseKeyCursor &b) {
+    while(!a.lead_ && !b.lead_ && a.pos_ == 0 && b.pos_ == 0 &&
+          a.word_ < a.phrase_.size() && b.word_ < b.phrase_.size() &&
+          a.phrase_[a.word_] == b.phrase_[b.word_]) {
+      a.word_++;
+      b.word_++;
+    }
+  }
+};
+
+// Compares phrases by the bytes of "phrase ||| ", like LC_ALL=C sort.
+class PhraseKeyLess
+{
+private:
+  const std::vector<const PhraseText *> &phrases_;
+
+public:
+  explicit PhraseKeyLess(const std::vector<const PhraseText *> &phrases) : phrases_(phrases) {}
+
+  bool operator()(Phrase a, Phrase b) const {
+    PhraseKeyCursor ca(*phrases_[a]), cb(*phrases_[b]);
+    for(;;) {
+      PhraseKeyCursor::skip_common_words(ca, cb);
+      int xa = ca.next();
+      int xb = cb.next();
+      if(xa != xb)
+        return xa < xb;
+      if(xa == -1)
+        return false;
+    }
+  }
+};
+
+#ifdef WITH_THREADS
+// A range of phrase pairs holding whole source phrases.
+struct ScoreChunk {
+  size_t id;
+  size_t begin;
+  size_t end;
+};
+
+// Chunks handed from the main thread to the scoring workers. The main
+// thread blocks while the queue is full.
+class ChunkQueue
+{
+private:
+  std::queue<ScoreChunk> chunks_;
+  size_t limit_;
+  bool closed_;
+  boost::mutex mutex_;
+  boost::condition_variable not_empty_;
+  boost::condition_variable not_full_;
+
+public:
+  explicit ChunkQueue(size_t limit) : limit_(limit), closed_(false) {}
+
+  void push(const ScoreChunk &chunk) {
+    boost::mutex::scoped_lock lock(mutex_);
+    while(chunks_.size() >= limit_)
+      not_full_.wait(lock);
+    chunks_.push(chunk);
+    not_empty_.notify_one();
+  }
+
+  void close() {
+    boost::mutex::scoped_lock lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+  // false once the queue is closed and empty
+  bool pop(ScoreChunk &chunk) {
+    boost::mutex::scoped_lock lock(mutex_);
+    while(chunks_.empty() && !closed_)
+      not_empty_.wait(lock);
+    if(chunks_.empty())
+      return false;
+    chunk = chunks_.front();
+    chunks_.pop();
+    not_full_.notify_one();
+    return true;
+  }
+};
+
+// Writes the scored chunks in order. A worker waits while its chunk is too
+// far ahead, so that memory use is bounded.
+class OrderedOutput
+{
+private:
+  std::ostream &out_;
+  size_t limit_;
+  size_t next_;
+  std::map<size_t, String> pending_;
+  boost::mutex mutex_;
+  boost::condition_variable written_;
+
+public:
+  OrderedOutput(std::ostream &out, size_t limit) : out_(out), limit_(limit), next_(0) {}
+
+  void write(size_t id, String &text) {
+    boost::mutex::scoped_lock lock(mutex_);
+    while(id - next_ >= limit_)
+      written_.wait(lock);
+    pending_[id].swap(text);
+    std::map<size_t, String>::iterator it;
+    while((it = pending_.find(next_)) != pending_.end()) {
+      out_ << it->second; // don't use std::endl to avoid flushing
+      pending_.erase(it);
+      next_++;
+      written_.notify_all();
+    }
+  }
+};
+#endif
 
 bool cmp_counts(const VP &a1, const VP &a2);
+void rank_phrases(PhraseTable &pt, bool source, unsigned nthreads, std::vector<Count> &rank);
+size_t group_end(const SortedPairs &pairs, size_t pos);
+void score_pairs(PhraseTable &pt, ScorerList &scorers, const SortedPairs &pairs, size_t begin, size_t end, String &out);
+#ifdef WITH_THREADS
+void score_worker(PhraseTable &pt, ScorerList &scorers, const SortedPairs &pairs, ChunkQueue &queue, OrderedOutput &output);
+void score_in_parallel(PhraseTable &pt, ScorerList &scorers, const SortedPairs &pairs, unsigned nthreads);
+#endif
 int main(int argc, const char *argv[]);
 
 bool cmp_counts(const VP &a1, const VP &a2)
@@ -20,6 +203,56 @@ bool cmp_counts(const VP &a1, const VP &a2)
   return a1.second < a2.second;
 }
 
+// Ranks the source or target phrases by the bytes of "phrase ||| ". Sorting
+// the phrase pairs by these ranks orders the output lines like LC_ALL=C sort.
+void rank_phrases(PhraseTable &pt, bool source, unsigned nthreads, std::vector<Count> &rank)
+{
+  const Count n = source ? pt.n_src_phrases() : pt.n_tgt_phrases();
+  std::vector<const PhraseText *> phrases(n);
+  std::vector<Phrase> order(n);
+  for(Phrase p = 0; p < n; p++) {
+    phrases[p] = source ? &pt.get_src_phrase(p).get_phrase() : &pt.get_tgt_phrase(p).get_phrase();
+    order[p] = p;
+  }
+
+  parallel_sort(order.begin(), order.end(), PhraseKeyLess(phrases), nthreads);
+
+  rank.resize(n);
+  for(Count r = 0; r < n; r++)
+    rank[order[r]] = r;
+}
+
+// first position from pos on that starts a new source phrase
+size_t group_end(const SortedPairs &pairs, size_t pos)
+{
+  if(pos >= pairs.size())
+    return pairs.size();
+  while(pos < pairs.size() && (pairs[pos].key >> 32) == (pairs[pos - 1].key >> 32))
+    pos++;
+  return pos;
+}
+
+void score_pairs(PhraseTable &pt, ScorerList &scorers, const SortedPairs &pairs, size_t begin, size_t end, String &out)
+{
+  std::ostringstream os;
+  for(size_t i = begin; i < end; i++) {
+    PhrasePairCounts::const_iterator it = pairs[i].it;
+    PhrasePairInfo ppi(it);
+    Phrase src = ppi.get_src();
+    Phrase tgt = ppi.get_tgt();
+    const PhrasePairInfo::AlignmentVector av = ppi.get_alignments();
+
+    PhraseAlignment alig = std::max_element(av.begin(), av.end(), cmp_counts)->first;
+
+    os << pt.get_src_phrase(src) << " ||| " << pt.get_tgt_phrase(tgt) << " ||| " << alig << " |||";
+
+    for(ScorerList::iterator s = scorers.begin(); s != scorers.end(); ++s)
+      os << ' ' << (*s)->get_score(it);
+    os << '\n';
+  }
+  out = os.str();
+}
+
 int main(int argc, const char *argv[])
 {
   progname = argv[0];
@@ -32,12 +265,23 @@ int main(int argc, const char *argv[])
   MemoryPhraseTable pt;
   PhraseScorerFactory psf(pt);
 
-  typedef std::vector<PhraseScorer *> ScorerList;
   ScorerList scorers;
+  int nthreads = 1;
 
   for(int argp = 1; argp < argc; ) {
     bool reverse;
-    if(!strcmp(argv[argp], "-s"))
+    if(!strcmp(argv[argp], "-t")) {
+      if(argp + 1 >= argc || (nthreads = atoi(argv[argp + 1])) < 1)
+        usage();
+#ifndef WITH_THREADS
+      if(nthreads > 1) {
+        std::cerr << "Threads support not compiled in, scoring on 1 thread." << std::endl;
+        nthreads = 1;
+      }
+#endif
+      argp += 2;
+      continue;
+    } else if(!strcmp(argv[argp], "-s"))
       reverse = false;
     else if(!strcmp(argv[argp], "-r"))
       reverse = true;
@@ -53,28 +297,78 @@ int main(int argc, const char *argv[])
   for(ScorerList::iterator s = scorers.begin(); s != scorers.end(); ++s)
     (*s)->score_phrases();
 
+  // The output is sorted like LC_ALL=C sort would do it.
+  std::vector<Count> src_rank, tgt_rank;
+  rank_phrases(pt, true, nthreads, src_rank);
+  rank_phrases(pt, false, nthreads, tgt_rank);
+
+  SortedPairs pairs;
+  pairs.reserve(pt.get_joint_counts().size());
   for(PhrasePairCounts::const_iterator it = pt.raw_begin(); it != pt.raw_end(); ++it) {
-    PhrasePairInfo ppi(it);
-    Phrase src = ppi.get_src();
-    Phrase tgt = ppi.get_tgt();
-    const PhrasePairInfo::AlignmentVector av = ppi.get_alignments();
+    SortEntry e;
+    e.key = (static_cast<unsigned long long>(src_rank[it->first.first]) << 32) | tgt_rank[it->first.second];
+    e.it = it;
+    pairs.push_back(e);
+  }
+  parallel_sort(pairs.begin(), pairs.end(), std::less<SortEntry>(), nthreads);
 
-    PhraseAlignment alig = std::max_element(av.begin(), av.end(), cmp_counts)->first;
+#ifdef WITH_THREADS
+  if(nthreads > 1) {
+    score_in_parallel(pt, scorers, pairs, nthreads);
+    return 0;
+  }
+#endif
+
+  String out;
+  for(size_t begin = 0; begin < pairs.size(); ) {
+    size_t end = group_end(pairs, begin + CHUNK_PAIRS);
+    score_pairs(pt, scorers, pairs, begin, end, out);
+    std::cout << out; // don't use std::endl to avoid flushing
+    begin = end;
+  }
+}
 
-    std::cout << pt.get_src_phrase(src) << " ||| " << pt.get_tgt_phrase(tgt) << " ||| " << alig << " |||";
+#ifdef WITH_THREADS
+void score_worker(PhraseTable &pt, ScorerList &scorers, const SortedPairs &pairs, ChunkQueue &queue, OrderedOutput &output)
+{
+  ScoreChunk chunk;
+  String out;
+  while(queue.pop(chunk)) {
+    score_pairs(pt, scorers, pairs, chunk.begin, chunk.end, out);
+    output.write(chunk.id, out);
+  }
+}
 
-    for(ScorerList::iterator s = scorers.begin(); s != scorers.end(); ++s)
-      std::cout << ' ' << (*s)->get_score(it);
-    std::cout << '\n'; // don't use std::endl to avoid flushing
+// The workers score chunks of whole source phrases, and their output is
+// written in the order of the chunks.
+void score_in_parallel(PhraseTable &pt, ScorerList &scorers, const SortedPairs &pairs, unsigned nthreads)
+{
+  ChunkQueue queue(2 * nthreads);
+  OrderedOutput output(std::cout, 4 * nthreads);
+
+  boost::thread_group workers;
+  for(unsigned i = 0; i < nthreads; i++)
+    workers.create_thread(boost::bind(&score_worker, boost::ref(pt), boost::ref(scorers), boost::cref(pairs),
+                                      boost::ref(queue), boost::ref(output)));
+
+  ScoreChunk chunk;
+  chunk.id = 0;
+  for(chunk.begin = 0; chunk.begin < pairs.size(); chunk.begin = chunk.end, chunk.id++) {
+    chunk.end = group_end(pairs, chunk.begin + CHUNK_PAIRS);
+    queue.push(chunk);
   }
+  queue.close();
+  workers.join_all();
 }
+#endif
 
 void usage()
 {
   std::cerr <<	"Usage: " << progname << " <scorer1> <scorer2> ..." << std::endl <<
             "       where each scorer is specified as" << std::endl <<
             "       -s <scorer> <args>         to estimate p(s|t)" << std::endl <<
-            "       -r <scorer> <args>         to estimate p(t|s)" << std::endl << std::endl;
+            "       -r <scorer> <args>         to estimate p(t|s)" << std::endl <<
+            "       -t <threads>               to score and sort on several threads" << std::endl << std::endl;
 
   std::cerr <<	"Implemented scorers:" << std::endl;
 
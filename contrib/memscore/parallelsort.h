@@ -0,0 +1,34 @@
+// memscore - in-memory phrase scoring for Statistical Machine Translation
+// Christian Hardmeier, FBK-irst, Trento, 2010
+// $Id$
+
+#ifndef PARALLELSORT_H
+#define PARALLELSORT_H
+
+#include <algorithm>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+// Merge sort whose halves are sorted on separate threads, down to
+// std::sort on each of (about) nthreads slices.
+template<class RandomIt, class Compare>
+void parallel_sort(RandomIt first, RandomIt last, Compare cmp, unsigned nthreads)
+{
+#ifdef WITH_THREADS
+  const typename std::iterator_traits<RandomIt>::difference_type MIN_SLICE = 10000;
+  if(nthreads > 1 && last - first > 2 * MIN_SLICE) {
+    RandomIt middle = first + (last - first) / 2;
+    boost::thread left(boost::bind(&parallel_sort<RandomIt,Compare>, first, middle, cmp, nthreads / 2));
+    parallel_sort(middle, last, cmp, nthreads - nthreads / 2);
+    left.join();
+    std::inplace_merge(first, middle, last, cmp);
+    return;
+  }
+#endif
+  std::sort(first, last, cmp);
+}
+
+#endif
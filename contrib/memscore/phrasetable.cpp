@@ -13,8 +13,7 @@
 
 /* PhraseText */
 
-PhraseText::DictionaryType_ PhraseText::dictionary_;
-Count PhraseText::last_id_ = 1;
+PhraseText::DictionaryType_ PhraseText::dictionary_(1);
 
 PhraseText::PhraseText(const String &s)
 {
@@ -252,15 +251,14 @@ void PhrasePairInfo::realloc_data(Count nalignments)
 
 Phrase PhraseInfoList::index_phrase(const String &s_phr)
 {
-  IDMapType_::const_iterator it = idmap_.find(s_phr);
-  if(it != idmap_.end())
-    return it->second;
+  Phrase phr = idmap_.index(s_phr);
+  if(phr < list_.size())
+    return phr;
 
   PhraseInfo *pi = phrase_info_pool_.construct(data_size_, s_phr);
 
   list_.push_back(pi);
-  idmap_[s_phr] = list_.size() - 1;
-  return idmap_[s_phr];
+  return phr;
 }
 
 DataIndex PhraseInfoList::register_data(Count size)
@@ -14,7 +14,6 @@
 #include <string>
 #include <vector>
 
-#include <boost/bimap.hpp>
 #include <boost/dynamic_bitset.hpp>
 #include <boost/iterator/transform_iterator.hpp>
 #include <boost/pool/object_pool.hpp>
@@ -24,6 +23,7 @@
 #include <boost/tuple/tuple_comparison.hpp>
 
 #include "datastorage.h"
+#include "hashtable.h"
 #include "memscore.h"
 
 class PhraseText
@@ -32,12 +32,11 @@ class PhraseText
 
 private:
   typedef boost::ptr_vector<Count,boost::view_clone_allocator> WordListType_;
-  typedef boost::bimap<String,Count> DictionaryType_;
+  typedef StringIndex DictionaryType_;
 
   WordListType_ word_list_;
 
   static DictionaryType_ dictionary_;
-  static Count last_id_;
 
   typedef const String &(*LookupFunction_)(Count id);
 
@@ -77,21 +76,11 @@ public:
   }
 
   static const String &dictionary_lookup(Count id) {
-    DictionaryType_::right_const_iterator it = dictionary_.right.find(id);
-    assert(it != dictionary_.right.end());
-    return it->second;
+    return dictionary_.lookup(id);
   }
 
   static Count index_word(const String &word) {
-    Count id;
-    DictionaryType_::left_const_iterator it = dictionary_.left.find(word);
-    if(it != dictionary_.left.end())
-      id = it->second;
-    else {
-      id = last_id_++;
-      dictionary_.insert(DictionaryType_::value_type(word, id));
-    }
-    return id;
+    return dictionary_.index(word);
   }
 };
 
@@ -182,7 +171,7 @@ inline std::ostream &operator<<(std::ostream &os, const PhraseInfo &pt)
 class PhraseInfoList
 {
 protected:
-  typedef std::map<String,Phrase> IDMapType_;
+  typedef StringIndex IDMapType_;
   typedef boost::ptr_vector<PhraseInfo,boost::view_clone_allocator> ListType_;
   //typedef std::vector<PhraseInfo *,boost::pool_allocator<PhraseInfo *> > ListType_;
   //typedef std::vector<PhraseInfo> ListType_;
@@ -316,7 +305,7 @@ public:
   }
 };
 
-typedef std::map<PhrasePair,PhrasePairData> PhrasePairCounts;
+typedef OpenHashMap<PhrasePair,PhrasePairData,PhrasePairHash> PhrasePairCounts;
 
 class PhrasePairInfo
 {
@@ -345,7 +334,8 @@ public:
   PhrasePairInfo(Count src, Count tgt, Count alignment, Count count);
 
   PhrasePairInfo(Count src, Count tgt, PhrasePairData data, bool reverse = false) : src_(src), tgt_(tgt), data_(data), reverse_(reverse) {
-    init_phase_ = false;
+    if(init_phase_) // don't write while the scorers read on several threads
+      init_phase_ = false;
   }
 
   PhrasePairInfo(const PhrasePairCounts::const_iterator &in) :
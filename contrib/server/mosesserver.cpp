@@ -15,12 +15,21 @@
 #ifdef LM_ORLM
 #  include "LanguageModelORLM.h"
 #endif
+#ifdef WITH_THREADS
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#endif
 
 using namespace Moses;
 using namespace std;
 
 typedef std::map<std::string, xmlrpc_c::value> params_t;
 
+#ifdef WITH_THREADS
+/** Translations share it, weight updates hold it exclusively */
+boost::shared_mutex weightsMutex;
+#endif
+
 /** Find out which translation system to use */
 const TranslationSystem& getTranslationSystem(params_t params)
 {
@@ -138,6 +147,59 @@ public:
   }
 };
 
+class WeightUpdater: public xmlrpc_c::method
+{
+public:
+  WeightUpdater() {
+    this->_signature = "S:S";
+    this->_help = "Sets the weights of a memory phrase table. Phrases dropped by ttable-limit when the table was loaded are not restored";
+  }
+  void
+  execute(xmlrpc_c::paramList const& paramList,
+          xmlrpc_c::value *   const  retvalP) {
+    const params_t params = paramList.getStruct(0);
+    paramList.verifyEnd(1);
+    params_t::const_iterator si = params.find("weights");
+    if (si == params.end()) {
+      throw xmlrpc_c::fault(
+        "Missing weights",
+        xmlrpc_c::fault::CODE_PARSE);
+    }
+    const vector<xmlrpc_c::value> values(xmlrpc_c::value_array(si->second).vectorValueValue());
+    vector<float> weights;
+    for (size_t i = 0; i < values.size(); ++i) {
+      weights.push_back(xmlrpc_c::value_double(values[i]));
+    }
+    size_t table = 0;
+    si = params.find("table");
+    if (si != params.end()) {
+      table = xmlrpc_c::value_int(si->second);
+    }
+
+    const TranslationSystem& system = getTranslationSystem(params);
+    if (table >= system.GetPhraseDictionaries().size()) {
+      throw xmlrpc_c::fault(
+        "No such phrase table",
+        xmlrpc_c::fault::CODE_PARSE);
+    }
+    PhraseDictionaryFeature* pdf = system.GetPhraseDictionaries()[table];
+
+    bool ret;
+    {
+#ifdef WITH_THREADS
+      boost::unique_lock<boost::shared_mutex> lock(weightsMutex);
+#endif
+      ret = pdf->SetWeights(weights);
+    }
+    if (!ret) {
+      throw xmlrpc_c::fault(
+        "Weights can only be set for memory phrase tables, one per score",
+        xmlrpc_c::fault::CODE_PARSE);
+    }
+    *retvalP = xmlrpc_c::value_string("Weights updated");
+  }
+};
+
 class Translator : public xmlrpc_c::method
 {
 public:
@@ -173,7 +235,16 @@ public:
     bool addTopts = (si != params.end());
     si = params.find("report-all-factors");
     bool reportAllFactors = (si != params.end());
+    si = params.find("latency-budget");
+    bool hasLatencyBudget = (si != params.end());
+    int latencyBudget = 0;
+    if (hasLatencyBudget) {
+      latencyBudget = xmlrpc_c::value_int(si->second);
+    }
 
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> lock(weightsMutex);
+#endif
     const StaticData &staticData = StaticData::Instance();
 
     if (addGraphInfo) {
@@ -188,6 +259,9 @@ public:
     stringstream in(source + "\n");
     sentence.Read(in,inputFactorOrder);
     Manager manager(sentence,staticData.GetSearchAlgorithm(), &system);
+    if (hasLatencyBudget) {
+      manager.GetLatencyBudget().SetBudget(latencyBudget > 0 ? latencyBudget : 0);
+    }
     manager.ProcessSentence();
     const Hypothesis* hypo = manager.GetBestHypothesis();
 
@@ -203,6 +277,9 @@ public:
       retData.insert(pair<string, xmlrpc_c::value>("align", xmlrpc_c::value_array(alignInfo)));
     }
     retData.insert(text);
+    if (manager.GetLatencyBudget().IsLimited()) {
+      retData.insert(pair<string, xmlrpc_c::value>("degraded", xmlrpc_c::value_boolean(manager.GetLatencyBudget().WasDegraded())));
+    }
 
     if(addGraphInfo) {
       insertGraphInfo(manager,retData);
@@ -357,9 +434,11 @@ int main(int argc, char** argv)
 
   xmlrpc_c::methodPtr const translator(new Translator);
   xmlrpc_c::methodPtr const updater(new Updater);
+  xmlrpc_c::methodPtr const weightUpdater(new WeightUpdater);
 
   myRegistry.addMethod("translate", translator);
   myRegistry.addMethod("updater", updater);
+  myRegistry.addMethod("setWeights", weightUpdater);
 
   xmlrpc_c::serverAbyss myAbyssServer(
     myRegistry,
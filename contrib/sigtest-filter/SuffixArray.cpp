@@ -0,0 +1,397 @@
+#include "SuffixArray.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+const char MAGIC[8] = { 'S', 'I', 'G', 'S', 'A', '0', '0', '2' };
+const SuffixArray::IdType SENTINEL = 0xFFFFFFFF;
+const SuffixArray::IdType NOT_FOUND = 0xFFFFFFFF;
+
+struct Header {
+  char magic[8];
+  unsigned long long corpusBytes;
+  unsigned long long corpusTime;
+  unsigned long long vocabSize;
+  unsigned long long vocabChars;
+  unsigned long long numTokens;
+  unsigned long long numSentences;
+  unsigned long long numSuffixes;
+};
+
+// orders token positions by the rank of the text h tokens further on
+struct RankLess {
+  RankLess(const SuffixArray::IdType* rank, size_t h) : m_rank(rank), m_h(h) {}
+  bool operator()(SuffixArray::IdType a, SuffixArray::IdType b) const {
+    return m_rank[a + m_h] < m_rank[b + m_h];
+  }
+  const SuffixArray::IdType* m_rank;
+  size_t m_h;
+};
+
+// Sorts all token positions by the suffixes starting there, by prefix
+// doubling: after the round with step h, positions are ordered by their
+// first 2h tokens, and the groups of positions sharing them are refined in
+// the next round.  Every sentinel is taken to be a distinct symbol which
+// sorts after all words, in corpus order.  So suffixes are compared up to
+// the end of their sentence, ties go to the earlier one, and duplicate
+// sentences take no more rounds than the longest sentence needs.
+void SortSuffixes(const std::vector<SuffixArray::IdType>& tokens, size_t vocabSize,
+                  std::vector<SuffixArray::IdType>& sorted)
+{
+  typedef SuffixArray::IdType IdType;
+  const size_t n = tokens.size();
+  std::vector<IdType> rank(n);
+  IdType sentinels = 0;
+  for (size_t pos = 0; pos < n; ++pos) {
+    rank[pos] = (tokens[pos] == SENTINEL) ? vocabSize + sentinels++ : tokens[pos];
+  }
+  sorted.resize(n);
+  for (size_t pos = 0; pos < n; ++pos) {
+    sorted[pos] = pos;
+  }
+  std::sort(sorted.begin(), sorted.end(), RankLess(&rank[0], 0));
+
+  // rank of a position: start of its group in the sorted order
+  std::vector<std::pair<size_t, size_t> > groups;
+  std::vector<IdType> keys(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys[i] = rank[sorted[i]];
+  }
+  for (size_t begin = 0; begin < n; ) {
+    size_t end = begin + 1;
+    while (end < n && keys[end] == keys[begin]) ++end;
+    for (size_t i = begin; i < end; ++i) rank[sorted[i]] = begin;
+    if (end - begin > 1) groups.push_back(std::make_pair(begin, end));
+    begin = end;
+  }
+
+  // a group holds no sentinel within its first h tokens, as sentinels are
+  // distinct, so the text h tokens further on is still inside the corpus
+  for (size_t h = 1; !groups.empty(); h *= 2) {
+    for (size_t g = 0; g < groups.size(); ++g) {
+      std::sort(sorted.begin() + groups[g].first, sorted.begin() + groups[g].second,
+                RankLess(&rank[0], h));
+      for (size_t i = groups[g].first; i < groups[g].second; ++i) {
+        keys[i] = rank[sorted[i] + h];
+      }
+    }
+    // ranks change only once all groups of the round are sorted
+    std::vector<std::pair<size_t, size_t> > refined;
+    for (size_t g = 0; g < groups.size(); ++g) {
+      for (size_t begin = groups[g].first; begin < groups[g].second; ) {
+        size_t end = begin + 1;
+        while (end < groups[g].second && keys[end] == keys[begin]) ++end;
+        for (size_t i = begin; i < end; ++i) rank[sorted[i]] = begin;
+        if (end - begin > 1) refined.push_back(std::make_pair(begin, end));
+        begin = end;
+      }
+    }
+    groups.swap(refined);
+  }
+}
+
+unsigned long long FileSize(const std::string& fileName)
+{
+  std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!in) {
+    std::cerr << "Can't read " << fileName << "\n";
+    exit(1);
+  }
+  in.seekg(0, std::ios::end);
+  return in.tellg();
+}
+
+// modification time of the file, 0 if it is not known
+unsigned long long FileTime(const std::string& fileName)
+{
+  struct stat st;
+  if (stat(fileName.c_str(), &st) != 0) return 0;
+  return st.st_mtime;
+}
+
+size_t Padded(size_t bytes)
+{
+  return (bytes + 7) & ~(size_t)7;
+}
+
+}
+
+SuffixArray::SuffixArray()
+  : m_vocabOffsets(0), m_vocabChars(0), m_vocabSize(0)
+  , m_tokens(0), m_sentIds(0), m_numTokens(0), m_numSentences(0)
+  , m_suffixes(0), m_numSuffixes(0)
+  , m_mapped(0), m_mappedSize(0)
+{
+}
+
+SuffixArray::~SuffixArray()
+{
+  Unmap();
+}
+
+void SuffixArray::Load(const std::string& corpusFile)
+{
+  const unsigned long long corpusBytes = FileSize(corpusFile);
+  const unsigned long long corpusTime = FileTime(corpusFile);
+  const std::string indexFile = corpusFile + ".sa";
+  if (Map(indexFile, corpusBytes, corpusTime)) {
+    std::cerr << "Loaded suffix array " << indexFile << "\n";
+    return;
+  }
+  std::cerr << "Building suffix array of " << corpusFile << "\n";
+  Build(corpusFile, corpusBytes);
+  Save(indexFile, corpusBytes, corpusTime);
+}
+
+void SuffixArray::Build(const std::string& corpusFile, unsigned long long corpusBytes)
+{
+  std::ifstream in(corpusFile.c_str());
+  if (!in) {
+    std::cerr << "Can't read " << corpusFile << "\n";
+    exit(1);
+  }
+
+  // intern the words in order of appearance first
+  std::map<std::string, IdType> vocab;
+  std::vector<std::map<std::string, IdType>::const_iterator> words;
+  std::string line;
+  std::string word;
+  m_tokenStore.reserve(corpusBytes / 4);
+  while (std::getline(in, line)) {
+    const IdType sentId = m_numSentences++;
+    for (size_t pos = 0; pos < line.size(); ) {
+      pos = line.find_first_not_of(" \t\r", pos);
+      if (pos == std::string::npos) break;
+      size_t next = line.find_first_of(" \t\r", pos);
+      if (next == std::string::npos) next = line.size();
+      word.assign(line, pos, next - pos);
+      std::map<std::string, IdType>::iterator w = vocab.lower_bound(word);
+      if (w == vocab.end() || w->first != word) {
+        w = vocab.insert(w, std::make_pair(word, (IdType) words.size()));
+        words.push_back(w);
+      }
+      m_tokenStore.push_back(w->second);
+      m_sentIdStore.push_back(sentId);
+      pos = next;
+    }
+    m_tokenStore.push_back(SENTINEL);
+    m_sentIdStore.push_back(sentId);
+    if (m_tokenStore.size() >= SENTINEL) {
+      std::cerr << "Corpus " << corpusFile << " is too large (more than 2^32 tokens)\n";
+      exit(1);
+    }
+  }
+
+  // then renumber them in string order
+  std::vector<IdType> rank(words.size());
+  m_vocabOffsetStore.reserve(vocab.size() + 1);
+  for (std::map<std::string, IdType>::const_iterator w = vocab.begin(); w != vocab.end(); ++w) {
+    rank[w->second] = m_vocabOffsetStore.size();
+    m_vocabOffsetStore.push_back(m_vocabCharStore.size());
+    m_vocabCharStore.insert(m_vocabCharStore.end(), w->first.begin(), w->first.end());
+  }
+  m_vocabOffsetStore.push_back(m_vocabCharStore.size());
+  for (std::vector<IdType>::iterator t = m_tokenStore.begin(); t != m_tokenStore.end(); ++t) {
+    if (*t != SENTINEL) *t = rank[*t];
+  }
+
+  std::vector<IdType> sorted;
+  SortSuffixes(m_tokenStore, vocab.size(), sorted);
+  m_suffixStore.reserve(m_tokenStore.size() - m_numSentences);
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    if (m_tokenStore[sorted[i]] != SENTINEL) m_suffixStore.push_back(sorted[i]);
+  }
+
+  m_vocabSize = vocab.size();
+  m_vocabOffsets = &m_vocabOffsetStore[0];
+  m_vocabChars = m_vocabCharStore.empty() ? 0 : &m_vocabCharStore[0];
+  m_numTokens = m_tokenStore.size();
+  m_tokens = m_tokenStore.empty() ? 0 : &m_tokenStore[0];
+  m_sentIds = m_sentIdStore.empty() ? 0 : &m_sentIdStore[0];
+  m_numSuffixes = m_suffixStore.size();
+  m_suffixes = m_suffixStore.empty() ? 0 : &m_suffixStore[0];
+}
+
+void SuffixArray::Save(const std::string& indexFile, unsigned long long corpusBytes,
+                       unsigned long long corpusTime) const
+{
+  Header header;
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.corpusBytes = corpusBytes;
+  header.corpusTime = corpusTime;
+  header.vocabSize = m_vocabSize;
+  header.vocabChars = m_vocabCharStore.size();
+  header.numTokens = m_numTokens;
+  header.numSentences = m_numSentences;
+  header.numSuffixes = m_numSuffixes;
+
+  std::ofstream out(indexFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "Can't write " << indexFile << ", the suffix array will be rebuilt next time\n";
+    return;
+  }
+  const char padding[8] = { 0 };
+  out.write((const char*) &header, sizeof(header));
+  out.write((const char*) m_vocabOffsets, (m_vocabSize + 1) * sizeof(unsigned long long));
+  out.write((const char*) m_tokens, m_numTokens * sizeof(IdType));
+  out.write(padding, Padded(m_numTokens * sizeof(IdType)) - m_numTokens * sizeof(IdType));
+  out.write((const char*) m_sentIds, m_numTokens * sizeof(IdType));
+  out.write(padding, Padded(m_numTokens * sizeof(IdType)) - m_numTokens * sizeof(IdType));
+  out.write((const char*) m_suffixes, m_numSuffixes * sizeof(IdType));
+  out.write(padding, Padded(m_numSuffixes * sizeof(IdType)) - m_numSuffixes * sizeof(IdType));
+  out.write(m_vocabChars, m_vocabCharStore.size());
+  out.close();
+  if (!out) {
+    std::cerr << "Can't write " << indexFile << ", the suffix array will be rebuilt next time\n";
+    remove(indexFile.c_str());
+  }
+}
+
+bool SuffixArray::Map(const std::string& indexFile, unsigned long long corpusBytes,
+                      unsigned long long corpusTime)
+{
+  const char* data = 0;
+  size_t size = 0;
+#ifdef WIN32
+  std::ifstream in(indexFile.c_str(), std::ios::in | std::ios::binary);
+  if (!in) return false;
+  in.seekg(0, std::ios::end);
+  size = in.tellg();
+  in.seekg(0, std::ios::beg);
+  m_readStore.resize(size);
+  if (size > 0) in.read(&m_readStore[0], size);
+  if (!in) return false;
+  data = size > 0 ? &m_readStore[0] : 0;
+#else
+  int fd = open(indexFile.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+  size = st.st_size;
+  void* mapped = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) return false;
+  m_mapped = mapped;
+  m_mappedSize = size;
+  data = (const char*) mapped;
+#endif
+
+  Header header;
+  if (size < sizeof(Header)) {
+    Unmap();
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  const size_t expected = sizeof(Header)
+                          + (header.vocabSize + 1) * sizeof(unsigned long long)
+                          + 2 * Padded(header.numTokens * sizeof(IdType))
+                          + Padded(header.numSuffixes * sizeof(IdType))
+                          + header.vocabChars;
+  // a corpus edited in place mostly keeps its size, but not its time
+  if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.corpusBytes != corpusBytes
+      || header.corpusTime != corpusTime || size != expected) {
+    std::cerr << "Ignoring " << indexFile << ", it was not made from this version of the corpus\n";
+    Unmap();
+    return false;
+  }
+
+  const char* p = data + sizeof(Header);
+  m_vocabSize = header.vocabSize;
+  m_vocabOffsets = (const unsigned long long*) p;
+  p += (header.vocabSize + 1) * sizeof(unsigned long long);
+  m_numTokens = header.numTokens;
+  m_tokens = (const IdType*) p;
+  p += Padded(header.numTokens * sizeof(IdType));
+  m_sentIds = (const IdType*) p;
+  p += Padded(header.numTokens * sizeof(IdType));
+  m_numSuffixes = header.numSuffixes;
+  m_suffixes = (const IdType*) p;
+  p += Padded(header.numSuffixes * sizeof(IdType));
+  m_vocabChars = p;
+  m_numSentences = header.numSentences;
+  return true;
+}
+
+void SuffixArray::Unmap()
+{
+#ifndef WIN32
+  if (m_mapped) munmap(m_mapped, m_mappedSize);
+#endif
+  m_mapped = 0;
+  m_mappedSize = 0;
+  std::vector<char>().swap(m_readStore);
+}
+
+SuffixArray::IdType SuffixArray::GetWordId(const char* word, size_t length) const
+{
+  size_t lo = 0;
+  size_t hi = m_vocabSize;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    const char* w = m_vocabChars + m_vocabOffsets[mid];
+    const size_t wlength = m_vocabOffsets[mid + 1] - m_vocabOffsets[mid];
+    int cmp = memcmp(w, word, std::min(wlength, length));
+    if (cmp == 0) cmp = (wlength < length) ? -1 : (wlength > length ? 1 : 0);
+    if (cmp == 0) return mid;
+    if (cmp < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return NOT_FOUND;
+}
+
+void SuffixArray::LocatePhrase(const std::string& phrase, size_t& begin, size_t& end) const
+{
+  begin = 0;
+  end = m_numSuffixes;
+  size_t depth = 0;
+  for (size_t pos = 0; pos < phrase.size() && begin < end; ++depth) {
+    size_t next = phrase.find(' ', pos);
+    if (next == std::string::npos) next = phrase.size();
+    const IdType id = GetWordId(phrase.data() + pos, next - pos);
+    if (id == NOT_FOUND) {
+      end = begin;
+      return;
+    }
+    pos = next + 1;
+
+    // all suffixes in [begin, end) share the first depth words,
+    // so the next token is a word or a sentinel, never past the corpus
+    size_t lower = begin;
+    size_t hi = end;
+    while (lower < hi) {
+      const size_t mid = lower + (hi - lower) / 2;
+      if (m_tokens[m_suffixes[mid] + depth] < id) lower = mid + 1;
+      else hi = mid;
+    }
+    size_t upper = lower;
+    hi = end;
+    while (upper < hi) {
+      const size_t mid = upper + (hi - upper) / 2;
+      if (m_tokens[m_suffixes[mid] + depth] <= id) upper = mid + 1;
+      else hi = mid;
+    }
+    begin = lower;
+    end = upper;
+  }
+  if (depth == 0) end = begin;
+}
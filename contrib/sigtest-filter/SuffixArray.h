@@ -0,0 +1,82 @@
+#ifndef SIGTEST_SUFFIX_ARRAY_H
+#define SIGTEST_SUFFIX_ARRAY_H
+
+#include <string>
+#include <vector>
+
+// Word level suffix array over one side of a sentence aligned corpus.
+//
+// The corpus is a plain text file with one tokenized sentence per line.
+// The index (vocabulary, token ids, sentence ids and suffixes) is built in
+// memory and saved to CORPUS.sa, so later runs on the same corpus just map
+// it in.  The index is rebuilt when the size or modification time of the
+// corpus changes.  Phrases never span sentences: every sentence is
+// terminated by a sentinel which sorts after all words.
+class SuffixArray
+{
+public:
+  typedef unsigned int IdType;
+
+  SuffixArray();
+  ~SuffixArray();
+
+  // map CORPUS.sa if it was made from this corpus, else build and save it
+  void Load(const std::string& corpusFile);
+
+  size_t GetNumSentences() const {
+    return m_numSentences;
+  }
+
+  // range [begin, end) of the suffixes starting with the phrase
+  // (words separated by single spaces), empty if it does not occur
+  void LocatePhrase(const std::string& phrase, size_t& begin, size_t& end) const;
+
+  // sentence containing the n-th suffix
+  IdType GetSentenceId(size_t suffix) const {
+    return m_sentIds[m_suffixes[suffix]];
+  }
+
+private:
+  // word id, or NOT_FOUND if the word is not in the corpus
+  IdType GetWordId(const char* word, size_t length) const;
+
+  void Build(const std::string& corpusFile, unsigned long long corpusBytes);
+  // false unless the index was made from a corpus of this size and time
+  bool Map(const std::string& indexFile, unsigned long long corpusBytes,
+           unsigned long long corpusTime);
+  void Save(const std::string& indexFile, unsigned long long corpusBytes,
+            unsigned long long corpusTime) const;
+  void Unmap();
+
+  // vocabulary, sorted so that word ids follow the string order
+  const unsigned long long* m_vocabOffsets;
+  const char* m_vocabChars;
+  size_t m_vocabSize;
+
+  // corpus as word ids, and the sentence of every token
+  const IdType* m_tokens;
+  const IdType* m_sentIds;
+  size_t m_numTokens;
+  size_t m_numSentences;
+
+  // token positions, sorted by the suffixes starting there
+  const IdType* m_suffixes;
+  size_t m_numSuffixes;
+
+  // storage of a built index
+  std::vector<unsigned long long> m_vocabOffsetStore;
+  std::vector<char> m_vocabCharStore;
+  std::vector<IdType> m_tokenStore;
+  std::vector<IdType> m_sentIdStore;
+  std::vector<IdType> m_suffixStore;
+
+  // storage of a mapped index
+  void* m_mapped;
+  size_t m_mappedSize;
+  std::vector<char> m_readStore;
+
+  SuffixArray(const SuffixArray&);
+  SuffixArray& operator=(const SuffixArray&);
+};
+
+#endif
@@ -3,13 +3,22 @@
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <cmath>
 #include <algorithm>
 
-#include "_SuffixArraySearchApplicationBase.h"
+#include "SuffixArray.h"
 
 #include <vector>
 #include <iostream>
-#include <set>
+#include <sstream>
+#include <string>
+#include <map>
+#include <queue>
+#include <fstream>
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
 
 #ifdef WIN32
 #include "WIN32_functions.h"
@@ -17,14 +26,12 @@
 #include <unistd.h>
 #endif
 
-typedef std::set<TextLenType> SentIdSet;
-typedef std::map<std::string, SentIdSet> PhraseSetMap;
-
 #undef min
 
 // constants
 const size_t MINIMUM_SIZE_TO_KEEP = 10000;     // reduce this to improve memory usage,
 // increase for speed
+const size_t CHUNK_LINES          = 10000;     // phrase table lines handed to a thread at once
 const std::string SEPARATOR       = " ||| ";
 
 const double ALPHA_PLUS_EPS  = -1000.0;        // dummy value
@@ -37,29 +44,86 @@ bool print_neglog_significance = false; // add -log(p) to phrase table?
 double sig_filter_limit = 0;            // keep phrase pairs with -log(sig) > sig_filter_limit
 //    higher = filter-more
 bool pef_filter_only = false;           // only filter based on pef
+int pfe_index = 2;                      // index of P(f|e) in the scores
+int threads = 1;                        // number of filtering threads
+
+// Sentences containing a phrase: the sorted sentence ids if the phrase is
+// rare, a bitset over all sentences if it is frequent.
+class SentenceSet
+{
+public:
+  SentenceSet() : m_size(0) {}
+
+  // sentences of the suffixes [begin, end) of sa
+  void Assign(const SuffixArray& sa, size_t begin, size_t end);
+
+  size_t Size() const {
+    return m_size;
+  }
+
+  // number of sentences in both sets
+  size_t CountCommon(const SentenceSet& other) const;
+
+  void Swap(SentenceSet& other) {
+    m_ids.swap(other.m_ids);
+    m_bits.swap(other.m_bits);
+    std::swap(m_size, other.m_size);
+  }
+
+private:
+  bool IsDense() const {
+    return !m_bits.empty();
+  }
+  bool Contains(SuffixArray::IdType id) const {
+    return (m_bits[id >> 6] >> (id & 63)) & 1;
+  }
+
+  std::vector<SuffixArray::IdType> m_ids;
+  std::vector<unsigned long long> m_bits;
+  size_t m_size;
+};
+
+typedef std::map<std::string, SentenceSet> PhraseSetMap;
+
+// phrase table lines, and what is left of them after filtering
+struct Chunk {
+  size_t id;
+  std::vector<std::string> lines;
+  std::string output;
+  size_t nremoved_sigfilter;
+  size_t nremoved_pfefilter;
+  Chunk(size_t _id) : id(_id), nremoved_sigfilter(0), nremoved_pfefilter(0) {}
+};
 
 // globals
-PhraseSetMap esets;
+PhraseSetMap esets;                     // sets of frequent e-phrases, never erased
 double p_111 = 0.0;                     // alpha
 size_t nremoved_sigfilter = 0;
 size_t nremoved_pfefilter = 0;
 
-C_SuffixArraySearchApplicationBase e_sa;
-C_SuffixArraySearchApplicationBase f_sa;
+SuffixArray e_sa;
+SuffixArray f_sa;
 int num_lines;
 
+#ifdef WITH_THREADS
+boost::mutex esets_mutex;
+#endif
+
 void usage()
 {
   std::cerr << "\nFilter phrase table using significance testing as described\n"
             << "in H. Johnson, et al. (2007) Improving Translation Quality\n"
             << "by Discarding Most of the Phrasetable. EMNLP 2007.\n"
             << "\nUsage:\n"
-            << "\n  filter-pt -e english.suf-arr -f french.suf-arr\n"
-            << "      [-c] [-p] [-l threshold] [-n num] < PHRASE-TABLE > FILTERED-PHRASE-TABLE\n\n"
+            << "\n  filter-pt -e english.txt -f french.txt\n"
+            << "      [-c] [-p] [-l threshold] [-n num] [-t threads] < PHRASE-TABLE > FILTERED-PHRASE-TABLE\n\n"
+            << "   -e, -f         tokenized sides of the training corpus, one sentence per line;\n"
+            << "                  their suffix arrays are saved to english.txt.sa and french.txt.sa\n"
             << "   [-l threshold] >0.0, a+e, or a-e: keep values that have a -log significance > this\n"
             << "   [-n num      ] 0, 1...: 0=no filtering, >0 sort by P(e|f) and keep the top num elements\n"
             << "   [-c          ] add the cooccurence counts to the phrase table\n"
-            << "   [-p          ] add -log(significance) to the phrasetable\n\n";
+            << "   [-p          ] add -log(significance) to the phrasetable\n"
+            << "   [-t threads  ] number of filtering threads\n\n";
   exit(1);
 }
 
@@ -190,11 +254,108 @@ double fisher_exact(int cfe, int ce, int cf)
   return total_p;
 }
 
+inline size_t popcount(unsigned long long x)
+{
+#ifdef __GNUC__
+  return __builtin_popcountll(x);
+#else
+  size_t c = 0;
+  for (; x; x &= x - 1) ++c;
+  return c;
+#endif
+}
+
+void SentenceSet::Assign(const SuffixArray& sa, size_t begin, size_t end)
+{
+  m_ids.clear();
+  m_bits.clear();
+  const size_t nsents = sa.GetNumSentences();
+  if ((end - begin) * 32 >= nsents && nsents > 0) {
+    // a bitset takes less room than the ids
+    m_bits.assign((nsents + 63) / 64, 0);
+    for (size_t i = begin; i != end; ++i) {
+      const SuffixArray::IdType id = sa.GetSentenceId(i);
+      m_bits[id >> 6] |= 1ULL << (id & 63);
+    }
+    m_size = 0;
+    for (size_t w = 0; w < m_bits.size(); ++w) m_size += popcount(m_bits[w]);
+  } else {
+    m_ids.reserve(end - begin);
+    for (size_t i = begin; i != end; ++i) m_ids.push_back(sa.GetSentenceId(i));
+    std::sort(m_ids.begin(), m_ids.end());
+    m_ids.erase(std::unique(m_ids.begin(), m_ids.end()), m_ids.end());
+    m_size = m_ids.size();
+  }
+}
+
+size_t SentenceSet::CountCommon(const SentenceSet& other) const
+{
+  size_t c = 0;
+  if (IsDense() && other.IsDense()) {
+    for (size_t w = 0; w < m_bits.size(); ++w) c += popcount(m_bits[w] & other.m_bits[w]);
+  } else if (IsDense() || other.IsDense()) {
+    const SentenceSet& dense = IsDense() ? *this : other;
+    const SentenceSet& sparse = IsDense() ? other : *this;
+    for (size_t i = 0; i < sparse.m_ids.size(); ++i) {
+      if (dense.Contains(sparse.m_ids[i])) ++c;
+    }
+  } else {
+    const std::vector<SuffixArray::IdType>& a = m_size < other.m_size ? m_ids : other.m_ids;
+    const std::vector<SuffixArray::IdType>& b = m_size < other.m_size ? other.m_ids : m_ids;
+    if (a.size() * 16 < b.size()) {
+      // look the few ids up in the long list
+      std::vector<SuffixArray::IdType>::const_iterator from = b.begin();
+      for (size_t i = 0; i < a.size() && from != b.end(); ++i) {
+        from = std::lower_bound(from, b.end(), a[i]);
+        if (from != b.end() && *from == a[i]) ++c;
+      }
+    } else {
+      size_t i = 0;
+      size_t j = 0;
+      while (i < a.size() && j < b.size()) {
+        if (a[i] < b[j]) ++i;
+        else if (b[j] < a[i]) ++j;
+        else {
+          ++c;
+          ++i;
+          ++j;
+        }
+      }
+    }
+  }
+  return c;
+}
+
+// sentences of an e-phrase, looked up in the cache of frequent e-phrases
+// first; rare ones are located again whenever they are needed
+const SentenceSet& get_eset(const std::string& e_phrase, SentenceSet& scratch)
+{
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(esets_mutex);
+#endif
+    PhraseSetMap::const_iterator i = esets.find(e_phrase);
+    if (i != esets.end()) return i->second;
+  }
+  size_t begin, end;
+  e_sa.LocatePhrase(e_phrase, begin, end);
+  scratch.Assign(e_sa, begin, end);
+  if (scratch.Size() < MINIMUM_SIZE_TO_KEEP) return scratch;
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(esets_mutex);
+#endif
+  SentenceSet& eset = esets[e_phrase];
+  if (eset.Size() == 0) eset.Swap(scratch);
+  return eset;
+}
+
 // input: unordered list of translation options for a single source phrase
-void compute_cooc_stats_and_filter(std::vector<PTEntry*>& options)
+void compute_cooc_stats_and_filter(std::vector<PTEntry*>& options, Chunk& chunk)
 {
+  if (options.empty()) return;
   if (pfe_filter_limit>0 && options.size() > pfe_filter_limit) {
-    nremoved_pfefilter += (options.size() - pfe_filter_limit);
+    chunk.nremoved_pfefilter += (options.size() - pfe_filter_limit);
     std::nth_element(options.begin(), options.begin()+pfe_filter_limit, options.end(), PfeComparer());
     for (std::vector<PTEntry*>::iterator i=options.begin()+pfe_filter_limit; i != options.end(); ++i)
       delete *i;
@@ -202,61 +363,191 @@ void compute_cooc_stats_and_filter(std::vector<PTEntry*>& options)
   }
   if (pef_filter_only) return;
 
-  SentIdSet fset;
-  vector<S_SimplePhraseLocationElement> locations;
-  //std::cerr << "Looking up f-phrase: " << options.front()->f_phrase << "\n";
-
-  locations = f_sa.locateExactPhraseInCorpus(options.front()->f_phrase.c_str());
-  if(locations.size()==0) {
-    cerr<<"No occurrences found!!\n";
-  }
-  for (vector<S_SimplePhraseLocationElement>::iterator i=locations.begin();
-       i != locations.end();
-       ++i) {
-    fset.insert(i->sentIdInCorpus);
+  // the f-phrase is looked up once for all of its translations
+  SentenceSet fset;
+  size_t begin, end;
+  f_sa.LocatePhrase(options.front()->f_phrase, begin, end);
+  if(begin==end) {
+    std::cerr<<"No occurrences found!!\n";
   }
-  size_t cf = fset.size();
+  fset.Assign(f_sa, begin, end);
+  size_t cf = fset.Size();
+  SentenceSet scratch;
   for (std::vector<PTEntry*>::iterator i=options.begin(); i != options.end(); ++i) {
-    const std::string& e_phrase = (*i)->e_phrase;
-    size_t cef=0;
-    SentIdSet& eset = esets[(*i)->e_phrase];
-    if (eset.empty()) {
-      //std::cerr << "Looking up e-phrase: " << e_phrase << "\n";
-      vector<S_SimplePhraseLocationElement> locations = e_sa.locateExactPhraseInCorpus(e_phrase.c_str());
-      for (vector<S_SimplePhraseLocationElement>::iterator i=locations.begin(); i!= locations.end(); ++i) {
-        TextLenType curSentId = i->sentIdInCorpus;
-        eset.insert(curSentId);
-      }
-    }
-    size_t ce=eset.size();
-    if (ce < cf) {
-      for (SentIdSet::iterator i=eset.begin(); i != eset.end(); ++i) {
-        if (fset.find(*i) != fset.end()) cef++;
-      }
-    } else {
-      for (SentIdSet::iterator i=fset.begin(); i != fset.end(); ++i) {
-        if (eset.find(*i) != eset.end()) cef++;
-      }
-    }
+    const SentenceSet& eset = get_eset((*i)->e_phrase, scratch);
+    size_t ce=eset.Size();
+    size_t cef=fset.CountCommon(eset);
     double nlp = -log(fisher_exact(cef, cf, ce));
     (*i)->set_cooc_stats(cef, cf, ce, nlp);
-    if (ce < MINIMUM_SIZE_TO_KEEP) {
-      esets.erase(e_phrase);
-    }
   }
   std::vector<PTEntry*>::iterator new_end =
     std::remove_if(options.begin(), options.end(), NlogSigThresholder(sig_filter_limit));
-  nremoved_sigfilter += (options.end() - new_end);
+  chunk.nremoved_sigfilter += (options.end() - new_end);
   options.erase(new_end,options.end());
 }
 
+void output_options(std::vector<PTEntry*>& options, std::ostream& out)
+{
+  for (std::vector<PTEntry*>::iterator i=options.begin(); i != options.end(); ++i) {
+    out << **i << "\n";
+    delete *i;
+  }
+  options.clear();
+}
+
+// filters the lines of a chunk, which hold all translations of their f-phrases
+void filter_chunk(Chunk& chunk)
+{
+  std::ostringstream out;
+  std::vector<PTEntry*> options;
+  for (std::vector<std::string>::const_iterator l=chunk.lines.begin(); l != chunk.lines.end(); ++l) {
+    PTEntry* pp = new PTEntry(*l, pfe_index);
+    if (!options.empty() && options.front()->f_phrase != pp->f_phrase) {
+      compute_cooc_stats_and_filter(options, chunk);
+      output_options(options, out);
+    }
+    options.push_back(pp);
+  }
+  compute_cooc_stats_and_filter(options, chunk);
+  output_options(options, out);
+  chunk.lines.clear();
+  chunk.output = out.str();
+}
+
+void write_chunk(Chunk* chunk)
+{
+  std::cout << chunk->output;
+  nremoved_sigfilter += chunk->nremoved_sigfilter;
+  nremoved_pfefilter += chunk->nremoved_pfefilter;
+  delete chunk;
+}
+
+#ifdef WITH_THREADS
+
+// chunks waiting for a thread
+class ChunkQueue
+{
+public:
+  ChunkQueue() : m_closed(false) {}
+
+  void Push(Chunk* chunk) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_chunks.push(chunk);
+    m_notEmpty.notify_one();
+  }
+
+  void Close() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_closed = true;
+    m_notEmpty.notify_all();
+  }
+
+  // NULL once the queue is closed and empty
+  Chunk* Pop() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_chunks.empty() && !m_closed) m_notEmpty.wait(lock);
+    if (m_chunks.empty()) return NULL;
+    Chunk* chunk = m_chunks.front();
+    m_chunks.pop();
+    return chunk;
+  }
+
+private:
+  std::queue<Chunk*> m_chunks;
+  bool m_closed;
+  boost::mutex m_mutex;
+  boost::condition_variable m_notEmpty;
+};
+
+// writes filtered chunks in the order they were read
+class OrderedOutput
+{
+public:
+  OrderedOutput(size_t limit) : m_next(0), m_limit(limit) {}
+
+  // called by the reader before a chunk is queued
+  void Reserve(size_t id) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (id >= m_next + m_limit) m_notFull.wait(lock);
+  }
+
+  void Done(size_t id, Chunk* chunk) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_pending[id] = chunk;
+    std::map<size_t, Chunk*>::iterator i;
+    while ((i = m_pending.find(m_next)) != m_pending.end()) {
+      write_chunk(i->second);
+      m_pending.erase(i);
+      ++m_next;
+    }
+    m_notFull.notify_all();
+  }
+
+private:
+  size_t m_next;
+  size_t m_limit;
+  std::map<size_t, Chunk*> m_pending;
+  boost::mutex m_mutex;
+  boost::condition_variable m_notFull;
+};
+
+class FilterWorker
+{
+public:
+  FilterWorker(ChunkQueue& queue, OrderedOutput& output) : m_queue(queue), m_output(output) {}
+
+  void operator()() {
+    Chunk* chunk;
+    while ((chunk = m_queue.Pop()) != NULL) {
+      filter_chunk(*chunk);
+      m_output.Done(chunk->id, chunk);
+    }
+  }
+
+private:
+  ChunkQueue& m_queue;
+  OrderedOutput& m_output;
+};
+
+#endif
+
+bool file_exists(const std::string& fileName)
+{
+  std::ifstream in(fileName.c_str());
+  return in.good();
+}
+
+// -e and -f used to take the prefix of a SALM index, made by IndexSA.O32.
+// Stop if they still do, rather than build a suffix array of the wrong file
+void check_not_salm_index(const char* corpus, const char* option)
+{
+  static const char* salmExtensions[] = { ".id_voc", ".sa_corpus", ".sa_offset", ".sa_suffix" };
+  const std::string name(corpus);
+  bool salm = false;
+  for (size_t i = 0; i < sizeof(salmExtensions) / sizeof(salmExtensions[0]); ++i) {
+    const std::string extension(salmExtensions[i]);
+    if (name.size() > extension.size()
+        && name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+      salm = true;
+    }
+    if (!file_exists(name) && file_exists(name + extension)) {
+      salm = true;
+    }
+  }
+  if (salm) {
+    std::cerr << "Error: " << option << " " << name << " looks like a SALM suffix array index.\n"
+              << "filter-pt no longer uses SALM.  Pass the tokenized corpus itself, one sentence\n"
+              << "per line, and its suffix array will be built and saved to CORPUS.sa\n";
+    exit(1);
+  }
+}
+
 int main(int argc, char * argv[])
 {
   int c;
   const char* efile=0;
   const char* ffile=0;
-  int pfe_index = 2;
-  while ((c = getopt(argc, argv, "cpf:e:i:n:l:")) != -1) {
+  while ((c = getopt(argc, argv, "cpf:e:i:n:l:t:")) != -1) {
     switch (c) {
     case 'e':
       efile = optarg;
@@ -292,6 +583,19 @@ int main(int argc, char * argv[])
         }
       }
       break;
+    case 't':
+      threads = atoi(optarg);
+      if (threads < 1) {
+        std::cerr << "Number of threads (-t) must be at least 1\n";
+        usage();
+      }
+#ifndef WITH_THREADS
+      if (threads > 1) {
+        std::cerr << "Threads support not compiled in, filtering on 1 thread\n";
+        threads = 1;
+      }
+#endif
+      break;
     default:
       usage();
     }
@@ -302,12 +606,14 @@ int main(int argc, char * argv[])
     usage();
   }
 
-  //load the indexed corpus with vocabulary(noVoc=false) and with offset(noOffset=false)
+  //load the suffix arrays of the corpus, building them on the first run
   if (!pef_filter_only) {
-    e_sa.loadData_forSearch(efile, false, false);
-    f_sa.loadData_forSearch(ffile, false, false);
-    size_t elines = e_sa.returnTotalSentNumber();
-    size_t flines = f_sa.returnTotalSentNumber();
+    check_not_salm_index(efile, "-e");
+    check_not_salm_index(ffile, "-f");
+    e_sa.Load(efile);
+    f_sa.Load(ffile);
+    size_t elines = e_sa.GetNumSentences();
+    size_t flines = f_sa.GetNumSentences();
     if (elines != flines) {
       std::cerr << "Number of lines in e-corpus != number of lines in f-corpus!\n";
       usage();
@@ -327,45 +633,61 @@ int main(int argc, char * argv[])
     std::cerr << "Filtering using P(e|f) only. n=" << pfe_filter_limit << std::endl;
   }
 
-  char tmpString[10000];
+#ifdef WITH_THREADS
+  ChunkQueue queue;
+  OrderedOutput ordered(2*threads);
+  boost::thread_group workers;
+  if (threads > 1) {
+    for (int t=0; t<threads; t++)
+      workers.create_thread(FilterWorker(queue, ordered));
+  }
+#endif
+
+  // chunks end between f-phrases, so that each thread sees all translations
+  std::string line;
   std::string prev = "";
-  std::vector<PTEntry*> options;
+  size_t chunk_id = 0;
+  Chunk* chunk = new Chunk(chunk_id);
   size_t pt_lines = 0;
-  while(!cin.eof()) {
-    cin.getline(tmpString,10000,'\n');
-    if(++pt_lines%10000==0) {
-      std::cerr << ".";
-      if(pt_lines%500000==0) std::cerr << "[n:"<<pt_lines<<"]\n";
+  for (bool more = true; more; ) {
+    more = (bool) std::getline(std::cin, line);
+    if (more) {
+      if(++pt_lines%10000==0) {
+        std::cerr << ".";
+        if(pt_lines%500000==0) std::cerr << "[n:"<<pt_lines<<"]\n";
+      }
+      if (line.empty()) continue;
+      std::string f_phrase = line.substr(0, line.find(SEPARATOR));
+      bool boundary = (prev != f_phrase);
+      if (boundary) prev.swap(f_phrase);
+      if (!boundary || chunk->lines.size() < CHUNK_LINES) {
+        chunk->lines.push_back(line);
+        continue;
+      }
     }
 
-    if(strlen(tmpString)>0) {
-      PTEntry* pp = new PTEntry(tmpString, pfe_index);
-      if (prev != pp->f_phrase) {
-        prev = pp->f_phrase;
-
-        if (!options.empty()) {  // always true after first line
-          compute_cooc_stats_and_filter(options);
-        }
-        for (std::vector<PTEntry*>::iterator i=options.begin(); i != options.end(); ++i) {
-          std::cout << **i << std::endl;
-          delete *i;
-        }
-        options.clear();
-        options.push_back(pp);
-
-      } else {
-        options.push_back(pp);
-      }
-      //			  for(int i=0;i<locations.size(); i++){
-      //				  cout<<"SentId="<<locations[i].sentIdInCorpus<<" Pos="<<(int)locations[i].posInSentInCorpus<<endl;
-      //			  }
+#ifdef WITH_THREADS
+    if (threads > 1) {
+      ordered.Reserve(chunk->id);
+      queue.Push(chunk);
+    } else
+#endif
+    {
+      filter_chunk(*chunk);
+      write_chunk(chunk);
+    }
+    if (more) {
+      chunk = new Chunk(++chunk_id);
+      chunk->lines.push_back(line);
     }
   }
-  compute_cooc_stats_and_filter(options);
-  for (std::vector<PTEntry*>::iterator i=options.begin(); i != options.end(); ++i) {
-    std::cout << **i << std::endl;
-    delete *i;
-  }
+
+#ifdef WITH_THREADS
+  queue.Close();
+  workers.join_all();
+#endif
+  std::cout.flush();
+
   float pfefper = (100.0*(float)nremoved_pfefilter)/(float)pt_lines;
   float sigfper = (100.0*(float)nremoved_sigfilter)/(float)pt_lines;
   std::cerr << "\n\n------------------------------------------------------\n"
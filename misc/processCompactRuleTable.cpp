@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+
+#include "InputFileStream.h"
+#include "PhraseDictionaryCompactBinary.h"
+
+using namespace Moses;
+
+void printHelp()
+{
+  std::cerr << "Usage:\n"
+            "options: \n"
+            "\t-in  string -- input rule table in the compact format, as written by compactify\n"
+            "\t-out string -- binary rule table file name, defaults to <in>.bin\n"
+            "If -in is not specified reads from stdin\n"
+            "\n"
+            "moses memory-maps the binary table with phrase table type 11\n";
+}
+
+int main(int argc, char** argv)
+{
+  std::string inFilePath;
+  std::string outFilePath;
+  if(1 >= argc) {
+    printHelp();
+    return 1;
+  }
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if("-in" == arg && i+1 < argc) {
+      ++i;
+      inFilePath = argv[i];
+    } else if("-out" == arg && i+1 < argc) {
+      ++i;
+      outFilePath = argv[i];
+    } else {
+      //somethings wrong... print help
+      printHelp();
+      return 1;
+    }
+  }
+  if(outFilePath.empty()) {
+    if(inFilePath.empty()) {
+      printHelp();
+      return 1;
+    }
+    outFilePath = inFilePath + ".bin";
+  }
+
+  bool success;
+  if(inFilePath.empty()) {
+    std::cerr << "processing stdin to " << outFilePath << "\n";
+    success = PhraseDictionaryCompactBinary::Create(std::cin, outFilePath);
+  } else {
+    std::cerr << "processing " << inFilePath << " to " << outFilePath << "\n";
+    InputFileStream file(inFilePath);
+    success = PhraseDictionaryCompactBinary::Create(file, outFilePath);
+  }
+  return (success ? 0 : 1);
+}
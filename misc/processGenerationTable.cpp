@@ -0,0 +1,54 @@
+#include <iostream>
+#include <string>
+
+#include "InputFileStream.h"
+#include "GenerationDictionary.h"
+
+using namespace Moses;
+
+void printHelp()
+{
+  std::cerr << "Usage:\n"
+            "options: \n"
+            "\t-in  string -- input generation table file name\n"
+            "\t-out string -- prefix of binary table file, written to <out>.bingen\n"
+            "If -in is not specified reads from stdin\n"
+            "The input must be sorted with LC_ALL=C sort\n"
+            "\n"
+            "moses uses the binary table if <generation-file>.bingen exists\n";
+}
+
+int main(int argc, char** argv)
+{
+  std::string inFilePath;
+  std::string outFilePath("out");
+  if(1 >= argc) {
+    printHelp();
+    return 1;
+  }
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if("-in" == arg && i+1 < argc) {
+      ++i;
+      inFilePath = argv[i];
+    } else if("-out" == arg && i+1 < argc) {
+      ++i;
+      outFilePath = argv[i];
+    } else {
+      //somethings wrong... print help
+      printHelp();
+      return 1;
+    }
+  }
+
+  bool success;
+  if(inFilePath.empty()) {
+    std::cerr << "processing stdin to " << outFilePath << ".bingen\n";
+    success = GenerationDictionary::Create(std::cin, outFilePath);
+  } else {
+    std::cerr << "processing " << inFilePath << " to " << outFilePath << ".bingen\n";
+    InputFileStream file(inFilePath);
+    success = GenerationDictionary::Create(file, outFilePath);
+  }
+  return (success ? 0 : 1);
+}
@@ -0,0 +1,68 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "InputFileStream.h"
+#include "RuleTableLoaderBinary.h"
+
+using namespace Moses;
+
+void printHelp()
+{
+  std::cerr << "Usage:\n"
+            "options: \n"
+            "\t-in  string -- input rule table in Moses or Hiero format, eg. grammar.out.0\n"
+            "\t-out string -- binary rule table file name, defaults to <in>.bin\n"
+            "If -in is not specified reads from stdin\n"
+            "\n"
+            "moses uses grammar.out.<id>.bin instead of grammar.out.<id> if it exists\n";
+}
+
+int main(int argc, char** argv)
+{
+  std::string inFilePath;
+  std::string outFilePath;
+  if(1 >= argc) {
+    printHelp();
+    return 1;
+  }
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if("-in" == arg && i+1 < argc) {
+      ++i;
+      inFilePath = argv[i];
+    } else if("-out" == arg && i+1 < argc) {
+      ++i;
+      outFilePath = argv[i];
+    } else {
+      //somethings wrong... print help
+      printHelp();
+      return 1;
+    }
+  }
+  if(outFilePath.empty()) {
+    if(inFilePath.empty()) {
+      printHelp();
+      return 1;
+    }
+    outFilePath = inFilePath + ".bin";
+  }
+
+  std::ofstream outFile(outFilePath.c_str(), std::ios::out | std::ios::binary);
+  if(!outFile.good()) {
+    std::cerr << "Error: couldn't open " << outFilePath << " for writing\n";
+    return 1;
+  }
+
+  bool success;
+  if(inFilePath.empty()) {
+    std::cerr << "processing stdin to " << outFilePath << "\n";
+    success = RuleTableLoaderBinary::Create(std::cin, outFile);
+  } else {
+    std::cerr << "processing " << inFilePath << " to " << outFilePath << "\n";
+    InputFileStream file(inFilePath);
+    success = RuleTableLoaderBinary::Create(file, outFile);
+  }
+  outFile.close();
+  return (success && outFile ? 0 : 1);
+}
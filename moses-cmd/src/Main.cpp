@@ -47,6 +47,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "hypergraph.pb.h"
 #endif
 
+#if defined(HAVE_PROTOBUF) && defined(WITH_THREADS)
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#endif
+
 using namespace std;
 using namespace Moses;
 
@@ -60,6 +66,16 @@ void fix(std::ostream& stream, size_t size)
   stream.precision(size);
 }
 
+#ifdef HAVE_PROTOBUF
+/** Writes the search graph of a sentence as a hypergraph protobuf file */
+static void WriteSearchGraphPB(const Manager *manager, long translationId, const string fileName)
+{
+  VERBOSE(2, "Writing search graph to " << fileName << endl);
+  fstream output(fileName.c_str(), ios::trunc | ios::binary | ios::out);
+  manager->SerializeSearchGraphPB(translationId, output);
+}
+#endif
+
 /** Translates a sentence.
   * - calls the search (Manager)
   * - applies the decision rule
@@ -105,6 +121,11 @@ public:
     Manager manager(*m_source,staticData.GetSearchAlgorithm(), &system);
     manager.ProcessSentence();
 
+#if defined(HAVE_PROTOBUF) && defined(WITH_THREADS)
+    // hypergraph written in the background while the decision rule is applied
+    boost::scoped_ptr<boost::thread> searchGraphPBWriter;
+#endif
+
     // output word graph
     if (m_wordGraphCollector) {
       ostringstream out;
@@ -125,9 +146,11 @@ public:
         ostringstream sfn;
         sfn << staticData.GetParam("output-search-graph-pb")[0] << '/' << m_lineNumber << ".pb" << ends;
         string fn = sfn.str();
-        VERBOSE(2, "Writing search graph to " << fn << endl);
-        fstream output(fn.c_str(), ios::trunc | ios::binary | ios::out);
-        manager.SerializeSearchGraphPB(m_lineNumber, output);
+#ifdef WITH_THREADS
+        searchGraphPBWriter.reset(new boost::thread(boost::bind(&WriteSearchGraphPB, &manager, (long) m_lineNumber, fn)));
+#else
+        WriteSearchGraphPB(&manager, m_lineNumber, fn);
+#endif
       }
 #endif
     }		
@@ -259,6 +282,13 @@ public:
       m_detailedTranslationCollector->Write(m_lineNumber,out.str());
     }
 
+#if defined(HAVE_PROTOBUF) && defined(WITH_THREADS)
+    // the search graph must not be released before it is written
+    if (searchGraphPBWriter) {
+      searchGraphPBWriter->join();
+    }
+#endif
+
     // report additional statistics
     IFVERBOSE(2) {
       PrintUserTime("Sentence Decoding Time:");
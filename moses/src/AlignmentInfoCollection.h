@@ -23,6 +23,10 @@
 
 #include <set>
 
+#ifdef WITH_THREADS
+#include <boost/thread/shared_mutex.hpp>
+#endif
+
 namespace Moses
 {
 
@@ -50,6 +54,11 @@ class AlignmentInfoCollection
   static AlignmentInfoCollection s_instance;
   AlignmentInfoSet m_collection;
   const AlignmentInfo *m_emptyAlignmentInfo;
+
+#ifdef WITH_THREADS
+  //reader-writer lock, rule tables may be loaded on several threads
+  mutable boost::shared_mutex m_accessLock;
+#endif
 };
 
 }
@@ -97,6 +97,7 @@ public:
 BackwardsEdge::BackwardsEdge(const BitmapContainer &prevBitmapContainer
                              , BitmapContainer &parent
                              , const TranslationOptionList &translations
+                             , size_t transOptLimit
                              , const SquareMatrix &futureScore,
                              const InputType& itype,
                              const TranslationSystem* system)
@@ -104,12 +105,13 @@ BackwardsEdge::BackwardsEdge(const BitmapContainer &prevBitmapContainer
   , m_prevBitmapContainer(prevBitmapContainer)
   , m_parent(parent)
   , m_translations(translations)
+  , m_numTranslations(std::min(translations.size(), transOptLimit))
   , m_futurescore(futureScore)
   , m_seenPosition()
 {
 
   // If either dimension is empty, we haven't got anything to do.
-  if(m_prevBitmapContainer.GetHypotheses().size() == 0 || m_translations.size() == 0) {
+  if(m_prevBitmapContainer.GetHypotheses().size() == 0 || m_numTranslations == 0) {
     VERBOSE(3, "Empty cube on BackwardsEdge" << std::endl);
     return;
   }
@@ -148,7 +150,7 @@ BackwardsEdge::BackwardsEdge(const BitmapContainer &prevBitmapContainer
     ++iterHypo;
   }
 
-  if (m_translations.size() > 1) {
+  if (m_numTranslations > 1) {
     CHECK(m_translations.Get(0)->GetFutureScore() >= m_translations.Get(1)->GetFutureScore());
   }
 
@@ -164,19 +166,19 @@ BackwardsEdge::BackwardsEdge(const BitmapContainer &prevBitmapContainer
 
 BackwardsEdge::~BackwardsEdge()
 {
-  m_seenPosition.clear();
-  m_hypotheses.clear();
 }
 
 
 void
 BackwardsEdge::Initialize()
 {
-  if(m_hypotheses.size() == 0 || m_translations.size() == 0) {
+  if(m_hypotheses.size() == 0 || m_numTranslations == 0) {
     m_initialized = true;
     return;
   }
 
+  m_seenPosition.resize(m_hypotheses.size() * m_numTranslations, false);
+
   Hypothesis *expanded = CreateHypothesis(*m_hypotheses[0], *m_translations.Get(0));
   m_parent.Enqueue(0, 0, expanded, this);
   SetSeenPosition(0, 0);
@@ -195,17 +197,16 @@ Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const
 bool
 BackwardsEdge::SeenPosition(const size_t x, const size_t y)
 {
-  std::set< int >::iterator iter = m_seenPosition.find((x<<16) + y);
-  return (iter != m_seenPosition.end());
+  return m_seenPosition[x * m_numTranslations + y];
 }
 
 void
 BackwardsEdge::SetSeenPosition(const size_t x, const size_t y)
 {
-  CHECK(x < (1<<17));
-  CHECK(y < (1<<17));
+  CHECK(x < m_hypotheses.size());
+  CHECK(y < m_numTranslations);
 
-  m_seenPosition.insert((x<<16) + y);
+  m_seenPosition[x * m_numTranslations + y] = true;
 }
 
 
@@ -226,7 +227,7 @@ BackwardsEdge::PushSuccessors(const size_t x, const size_t y)
 {
   Hypothesis *newHypo;
 
-  if(y + 1 < m_translations.size() && !SeenPosition(x, y + 1)) {
+  if(y + 1 < m_numTranslations && !SeenPosition(x, y + 1)) {
     SetSeenPosition(x, y + 1);
     newHypo = CreateHypothesis(*m_hypotheses[x], *m_translations.Get(y + 1));
     if(newHypo != NULL) {
@@ -254,20 +255,13 @@ BitmapContainer::BitmapContainer(const WordsBitmap &bitmap
   , m_stack(stack)
   , m_numStackInsertions(0)
 {
-  m_hypotheses = HypothesisSet();
-  m_edges = BackwardsEdgeSet();
-  m_queue = HypothesisQueue();
 }
 
 BitmapContainer::~BitmapContainer()
 {
-  // As we have created the square position objects we clean up now.
-  HypothesisQueueItem *item = NULL;
-
+  // Free the hypotheses that were expanded but never popped.
   while (!m_queue.empty()) {
-    item = m_queue.top();
-    FREEHYPO(item->GetHypothesis());
-    delete item;
+    FREEHYPO(m_queue.top().GetHypothesis());
     m_queue.pop();
   }
 
@@ -285,30 +279,22 @@ BitmapContainer::Enqueue(int hypothesis_pos
                          , Hypothesis *hypothesis
                          , BackwardsEdge *edge)
 {
-  HypothesisQueueItem *item = new HypothesisQueueItem(hypothesis_pos
-      , translation_pos
-      , hypothesis
-      , edge);
-  m_queue.push(item);
+  m_queue.push(HypothesisQueueItem(hypothesis_pos
+                                   , translation_pos
+                                   , hypothesis
+                                   , edge));
 }
 
-HypothesisQueueItem*
-BitmapContainer::Dequeue(bool keepValue)
+HypothesisQueueItem
+BitmapContainer::Dequeue()
 {
-  if (!m_queue.empty()) {
-    HypothesisQueueItem *item = m_queue.top();
-
-    if (!keepValue) {
-      m_queue.pop();
-    }
-
-    return item;
-  }
-
-  return NULL;
+  CHECK(!m_queue.empty());
+  HypothesisQueueItem item = m_queue.top();
+  m_queue.pop();
+  return item;
 }
 
-HypothesisQueueItem*
+const HypothesisQueueItem&
 BitmapContainer::Top() const
 {
   return m_queue.top();
@@ -328,7 +314,7 @@ BitmapContainer::Empty() const
 
 
 const WordsBitmap&
-BitmapContainer::GetWordsBitmap()
+BitmapContainer::GetWordsBitmap() const
 {
   return m_bitmap;
 }
@@ -374,7 +360,7 @@ BitmapContainer::AddHypothesis(Hypothesis *hypothesis)
 void
 BitmapContainer::AddBackwardsEdge(BackwardsEdge *edge)
 {
-  m_edges.insert(edge);
+  m_edges.push_back(edge);
 }
 
 void
@@ -407,25 +393,22 @@ BitmapContainer::ProcessBestHypothesis()
   }
 
   // Get the currently best hypothesis from the queue.
-  HypothesisQueueItem *item = Dequeue();
-
-  // If the priority queue is exhausted, we are done and should have exited
-  CHECK(item != NULL);
+  const HypothesisQueueItem item = Dequeue();
 
   // check we are pulling things off of priority queue in right order
   if (!Empty()) {
-    HypothesisQueueItem *check = Dequeue(true);
-    CHECK(item->GetHypothesis()->GetTotalScore() >= check->GetHypothesis()->GetTotalScore());
+    const HypothesisQueueItem &check = Top();
+    CHECK(item.GetHypothesis()->GetTotalScore() >= check.GetHypothesis()->GetTotalScore());
   }
 
   // Logging for the criminally insane
   IFVERBOSE(3) {
     //		const StaticData &staticData = StaticData::Instance();
-    item->GetHypothesis()->PrintHypothesis();
+    item.GetHypothesis()->PrintHypothesis();
   }
 
   // Add best hypothesis to hypothesis stack.
-  const bool newstackentry = m_stack.AddPrune(item->GetHypothesis());
+  const bool newstackentry = m_stack.AddPrune(item.GetHypothesis());
   if (newstackentry)
     m_numStackInsertions++;
 
@@ -434,10 +417,7 @@ BitmapContainer::ProcessBestHypothesis()
   }
 
   // Create new hypotheses for the two successors of the hypothesis just added.
-  item->GetBackwardsEdge()->PushSuccessors(item->GetHypothesisPos(), item->GetTranslationPos());
-
-  // We are done with the queue item, we delete it.
-  delete item;
+  item.GetBackwardsEdge()->PushSuccessors(item.GetHypothesisPos(), item.GetTranslationPos());
 }
 
 void
@@ -23,7 +23,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_BitmapContainer_h
 
 #include <queue>
-#include <set>
 #include <vector>
 
 #include "Hypothesis.h"
@@ -44,13 +43,15 @@ class HypothesisQueueItem;
 class QueueItemOrderer;
 
 typedef std::vector< Hypothesis* > HypothesisSet;
-typedef std::set< BackwardsEdge* > BackwardsEdgeSet;
-typedef std::priority_queue< HypothesisQueueItem*, std::vector< HypothesisQueueItem* >, QueueItemOrderer> HypothesisQueue;
+typedef std::vector< BackwardsEdge* > BackwardsEdgeSet;
+typedef std::priority_queue< HypothesisQueueItem, std::vector< HypothesisQueueItem >, QueueItemOrderer> HypothesisQueue;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Hypothesis Priority Queue Code
 ////////////////////////////////////////////////////////////////////////////////
 
+// Queue items are small and are held by value in the queue, so pushing and
+// popping them doesn't touch the heap allocator.
 class HypothesisQueueItem
 {
 private:
@@ -58,8 +59,6 @@ private:
   Hypothesis *m_hypothesis;
   BackwardsEdge *m_edge;
 
-  HypothesisQueueItem();
-
 public:
   HypothesisQueueItem(const size_t hypothesis_pos
                       , const size_t translation_pos
@@ -71,22 +70,19 @@ public:
     , m_edge(edge) {
   }
 
-  ~HypothesisQueueItem() {
-  }
-
-  int GetHypothesisPos() {
+  int GetHypothesisPos() const {
     return m_hypothesis_pos;
   }
 
-  int GetTranslationPos() {
+  int GetTranslationPos() const {
     return m_translation_pos;
   }
 
-  Hypothesis *GetHypothesis() {
+  Hypothesis *GetHypothesis() const {
     return m_hypothesis;
   }
 
-  BackwardsEdge *GetBackwardsEdge() {
+  BackwardsEdge *GetBackwardsEdge() const {
     return m_edge;
   }
 };
@@ -95,9 +91,9 @@ public:
 class QueueItemOrderer
 {
 public:
-  bool operator()(HypothesisQueueItem* itemA, HypothesisQueueItem* itemB) const {
-    float scoreA = itemA->GetHypothesis()->GetTotalScore();
-    float scoreB = itemB->GetHypothesis()->GetTotalScore();
+  bool operator()(const HypothesisQueueItem &itemA, const HypothesisQueueItem &itemB) const {
+    float scoreA = itemA.GetHypothesis()->GetTotalScore();
+    float scoreB = itemB.GetHypothesis()->GetTotalScore();
 
     return (scoreA < scoreB);
 
@@ -160,10 +156,11 @@ private:
   const BitmapContainer &m_prevBitmapContainer;
   BitmapContainer &m_parent;
   const TranslationOptionList &m_translations;
+  size_t m_numTranslations; /**< leading translations of the list used on this edge */
   const SquareMatrix &m_futurescore;
 
   std::vector< const Hypothesis* > m_hypotheses;
-  std::set< int > m_seenPosition;
+  std::vector< bool > m_seenPosition; /**< hypotheses x translations grid, row-major */
 
   // We don't want to instantiate "empty" objects.
   BackwardsEdge();
@@ -179,6 +176,7 @@ public:
   BackwardsEdge(const BitmapContainer &prevBitmapContainer
                 , BitmapContainer &parent
                 , const TranslationOptionList &translations
+                , size_t transOptLimit
                 , const SquareMatrix &futureScore,
                 const InputType& source,
                 const TranslationSystem* system);
@@ -220,12 +218,12 @@ public:
   ~BitmapContainer();
 
   void Enqueue(int hypothesis_pos, int translation_pos, Hypothesis *hypothesis, BackwardsEdge *edge);
-  HypothesisQueueItem *Dequeue(bool keepValue=false);
-  HypothesisQueueItem *Top() const;
+  HypothesisQueueItem Dequeue();
+  const HypothesisQueueItem &Top() const;
   size_t Size();
   bool Empty() const;
 
-  const WordsBitmap &GetWordsBitmap();
+  const WordsBitmap &GetWordsBitmap() const;
   const HypothesisSet &GetHypotheses() const;
   size_t GetHypothesesSize() const;
   const BackwardsEdgeSet &GetBackwardsEdges();
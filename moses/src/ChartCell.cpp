@@ -41,7 +41,7 @@ extern bool g_debug;
 ChartCell::ChartCell(size_t startPos, size_t endPos, ChartManager &manager)
   :m_coverage(startPos, endPos)
   ,m_sourceWordLabel(NULL)
-  ,m_targetLabelSet(m_coverage)
+  ,m_targetLabelSet(m_coverage, manager.GetLabelIndex())
   ,m_manager(manager)
 {
   const StaticData &staticData = StaticData::Instance();
@@ -55,30 +55,41 @@ ChartCell::ChartCell(size_t startPos, size_t endPos, ChartManager &manager)
 ChartCell::~ChartCell()
 {
   delete m_sourceWordLabel;
+  RemoveAllInColl(m_hypoColl);
 }
 
 /** Get all hypotheses in the cell that have the specified constituent label */
 const HypoList &ChartCell::GetSortedHypotheses(const Word &constituentLabel) const
 {
-  std::map<Word, ChartHypothesisCollection>::const_iterator
-  iter = m_hypoColl.find(constituentLabel);
-  CHECK(iter != m_hypoColl.end());
-  return iter->second.GetSortedHypotheses();
+  size_t labelId = m_manager.GetLabelIndex().Find(constituentLabel);
+  CHECK(labelId < m_hypoColl.size() && m_hypoColl[labelId] != NULL);
+  return m_hypoColl[labelId]->GetSortedHypotheses();
 }
 
 /** Add the given hypothesis to the cell */
 bool ChartCell::AddHypothesis(ChartHypothesis *hypo)
 {
   const Word &targetLHS = hypo->GetTargetLHS();
-  return m_hypoColl[targetLHS].AddHypothesis(hypo, m_manager);
+  size_t labelId = m_manager.GetLabelIndex().Add(targetLHS);
+  if (labelId >= m_hypoColl.size()) {
+    m_hypoColl.resize(labelId + 1, NULL);
+  }
+  if (m_hypoColl[labelId] == NULL) {
+    m_hypoColl[labelId] = new ChartHypothesisCollection();
+  }
+  return m_hypoColl[labelId]->AddHypothesis(hypo, m_manager);
 }
 
-/** Pruning */
-void ChartCell::PruneToSize()
+/** Pruning
+ * \param maxHypoStackSize stack size for each target label
+ */
+void ChartCell::PruneToSize(size_t maxHypoStackSize)
 {
-  std::map<Word, ChartHypothesisCollection>::iterator iter;
+  std::vector<ChartHypothesisCollection*>::iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    ChartHypothesisCollection &coll = iter->second;
+    if (*iter == NULL) continue;
+    ChartHypothesisCollection &coll = **iter;
+    coll.SetMaxHypoStackSize(maxHypoStackSize);
     coll.PruneToSize(m_manager);
   }
 }
@@ -87,41 +98,75 @@ void ChartCell::PruneToSize()
  *  (implementation of cube pruning)
  * \param transOptList list of applicable rules to create hypotheses for the cell
  * \param allChartCells entire chart - needed to look up underlying hypotheses
+ * \param popLimit maximum number of hypotheses to pop off the cube pruning queue
+ * \param ruleLimit number of rules at the top of the (sorted) list that are used
+ * \param keepLabels whether to build a hypothesis for each label that the
+ *                   limits would leave out of the cell
  */
 void ChartCell::ProcessSentence(const ChartTranslationOptionList &transOptList
-                                , const ChartCellCollection &allChartCells)
+                                , const ChartCellCollection &allChartCells
+                                , size_t popLimit
+                                , size_t ruleLimit
+                                , bool keepLabels)
 {
-  const StaticData &staticData = StaticData::Instance();
-
   // priority queue for applicable rules with selected hypotheses
-  RuleCubeQueue queue(m_manager);
+  RuleCubeQueue queue(m_manager, *this);
 
-  // add all trans opt into queue. using only 1st child node.
-  ChartTranslationOptionList::const_iterator iterList;
-  for (iterList = transOptList.begin(); iterList != transOptList.end(); ++iterList) 
+  // add the best trans opts into queue. using only 1st child node.
+  const size_t numTransOpt = std::min(transOptList.GetSize(), ruleLimit);
+  for (size_t i = 0; i < numTransOpt; ++i)
   {
-    const ChartTranslationOption &transOpt = **iterList;
-    RuleCube *ruleCube = new RuleCube(transOpt, allChartCells, m_manager);
+    const ChartTranslationOption &transOpt = transOptList.Get(i);
+    RuleCube *ruleCube = new RuleCube(transOpt, allChartCells, m_manager,
+                                      queue.GetItemPool());
     queue.Add(ruleCube);
   }
 
   // pluck things out of queue and add to hypo collection
-  const size_t popLimit = staticData.GetCubePruningPopLimit();
   for (size_t numPops = 0; numPops < popLimit && !queue.IsEmpty(); ++numPops) 
   {
     ChartHypothesis *hypo = queue.Pop();
-    AddHypothesis(hypo);
+    if (hypo) {
+      AddHypothesis(hypo);
+    }
+  }
+
+  // limits tightened by a latency budget may leave a label out of the cell
+  // that the cells above need to build a complete translation, so each rule
+  // whose label is still missing gets one pop of its own
+  if (keepLabels) {
+    for (size_t i = 0; i < transOptList.GetSize(); ++i) {
+      const ChartTranslationOption &transOpt = transOptList.Get(i);
+      const TargetPhrase &targetPhrase = **transOpt.GetTargetPhraseCollection().begin();
+      if (HasHypotheses(targetPhrase.GetTargetLHS())) {
+        continue;
+      }
+      RuleCubeQueue labelQueue(m_manager, *this);
+      labelQueue.Add(new RuleCube(transOpt, allChartCells, m_manager,
+                                  labelQueue.GetItemPool()));
+      ChartHypothesis *hypo = labelQueue.Pop();
+      if (hypo) {
+        AddHypothesis(hypo);
+      }
+    }
   }
 }
 
+//! whether the cell has any hypothesis with the label targetLHS
+bool ChartCell::HasHypotheses(const Word &targetLHS) const
+{
+  const size_t labelId = m_manager.GetLabelIndex().Find(targetLHS);
+  return labelId < m_hypoColl.size() && m_hypoColl[labelId] != NULL;
+}
+
 void ChartCell::SortHypotheses()
 {
   // sort each mini cells & fill up target lhs list
   CHECK(m_targetLabelSet.Empty());
-  std::map<Word, ChartHypothesisCollection>::iterator iter;
-  for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    ChartHypothesisCollection &coll = iter->second;
-    m_targetLabelSet.AddConstituent(iter->first, coll);
+  for (size_t labelId = 0; labelId < m_hypoColl.size(); ++labelId) {
+    if (m_hypoColl[labelId] == NULL) continue;
+    ChartHypothesisCollection &coll = *m_hypoColl[labelId];
+    m_targetLabelSet.AddConstituent(labelId, coll);
     coll.SortHypotheses();
   }
 }
@@ -132,9 +177,10 @@ const ChartHypothesis *ChartCell::GetBestHypothesis() const
   const ChartHypothesis *ret = NULL;
   float bestScore = -std::numeric_limits<float>::infinity();
 
-  std::map<Word, ChartHypothesisCollection>::const_iterator iter;
+  std::vector<ChartHypothesisCollection*>::const_iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    const HypoList &sortedList = iter->second.GetSortedHypotheses();
+    if (*iter == NULL) continue;
+    const HypoList &sortedList = (*iter)->GetSortedHypotheses();
     CHECK(sortedList.size() > 0);
 
     const ChartHypothesis *hypo = sortedList[0];
@@ -147,24 +193,36 @@ const ChartHypothesis *ChartCell::GetBestHypothesis() const
   return ret;
 }
 
+/** Score below which a hypothesis with the given LHS can't enter the cell */
+float ChartCell::GetThreshold(const Word &targetLHS) const
+{
+  size_t labelId = m_manager.GetLabelIndex().Find(targetLHS);
+  if (labelId >= m_hypoColl.size() || m_hypoColl[labelId] == NULL) {
+    return -std::numeric_limits<float>::infinity();
+  }
+  return m_hypoColl[labelId]->GetThreshold();
+}
+
 void ChartCell::CleanupArcList()
 {
   // only necessary if n-best calculations are enabled
   if (!m_nBestIsEnabled) return;
 
-  std::map<Word, ChartHypothesisCollection>::iterator iter;
+  std::vector<ChartHypothesisCollection*>::iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    ChartHypothesisCollection &coll = iter->second;
+    if (*iter == NULL) continue;
+    ChartHypothesisCollection &coll = **iter;
     coll.CleanupArcList();
   }
 }
 
 void ChartCell::OutputSizes(std::ostream &out) const
 {
-  std::map<Word, ChartHypothesisCollection>::const_iterator iter;
-  for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    const Word &targetLHS = iter->first;
-    const ChartHypothesisCollection &coll = iter->second;
+  const NonTerminalIndex &labelIndex = m_manager.GetLabelIndex();
+  for (size_t labelId = 0; labelId < m_hypoColl.size(); ++labelId) {
+    if (m_hypoColl[labelId] == NULL) continue;
+    const Word &targetLHS = labelIndex.GetLabel(labelId);
+    const ChartHypothesisCollection &coll = *m_hypoColl[labelId];
 
     out << targetLHS << "=" << coll.GetSize() << " ";
   }
@@ -173,9 +231,10 @@ void ChartCell::OutputSizes(std::ostream &out) const
 size_t ChartCell::GetSize() const
 {
   size_t ret = 0;
-  std::map<Word, ChartHypothesisCollection>::const_iterator iter;
+  std::vector<ChartHypothesisCollection*>::const_iterator iter;
   for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
-    const ChartHypothesisCollection &coll = iter->second;
+    if (*iter == NULL) continue;
+    const ChartHypothesisCollection &coll = **iter;
 
     ret += coll.GetSize();
   }
@@ -185,21 +244,23 @@ size_t ChartCell::GetSize() const
 
 void ChartCell::GetSearchGraph(long translationId, std::ostream &outputSearchGraphStream, const std::map<unsigned, bool> &reachable) const
 {
-  std::map<Word, ChartHypothesisCollection>::const_iterator iterOutside;
+  std::vector<ChartHypothesisCollection*>::const_iterator iterOutside;
   for (iterOutside = m_hypoColl.begin(); iterOutside != m_hypoColl.end(); ++iterOutside) {
-    const ChartHypothesisCollection &coll = iterOutside->second;
+    if (*iterOutside == NULL) continue;
+    const ChartHypothesisCollection &coll = **iterOutside;
     coll.GetSearchGraph(translationId, outputSearchGraphStream, reachable);
   }
 }
 
 std::ostream& operator<<(std::ostream &out, const ChartCell &cell)
 {
-  std::map<Word, ChartHypothesisCollection>::const_iterator iterOutside;
-  for (iterOutside = cell.m_hypoColl.begin(); iterOutside != cell.m_hypoColl.end(); ++iterOutside) {
-    const Word &targetLHS = iterOutside->first;
+  const NonTerminalIndex &labelIndex = cell.m_manager.GetLabelIndex();
+  for (size_t labelId = 0; labelId < cell.m_hypoColl.size(); ++labelId) {
+    if (cell.m_hypoColl[labelId] == NULL) continue;
+    const Word &targetLHS = labelIndex.GetLabel(labelId);
     cerr << targetLHS << ":" << endl;
 
-    const ChartHypothesisCollection &coll = iterOutside->second;
+    const ChartHypothesisCollection &coll = *cell.m_hypoColl[labelId];
     cerr << coll;
   }
 
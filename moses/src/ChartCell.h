@@ -46,7 +46,7 @@ class ChartCell
 public:
 
 protected:
-  std::map<Word, ChartHypothesisCollection> m_hypoColl;
+  std::vector<ChartHypothesisCollection*> m_hypoColl; /**< indexed by target label id, NULL if no hypos have that label */
 
   WordsRange m_coverage;
 
@@ -61,15 +61,21 @@ public:
   ~ChartCell();
 
   void ProcessSentence(const ChartTranslationOptionList &transOptList
-                       ,const ChartCellCollection &allChartCells);
+                       ,const ChartCellCollection &allChartCells
+                       ,size_t popLimit
+                       ,size_t ruleLimit
+                       ,bool keepLabels);
 
   const HypoList &GetSortedHypotheses(const Word &constituentLabel) const;
   bool AddHypothesis(ChartHypothesis *hypo);
 
   void SortHypotheses();
-  void PruneToSize();
+  void PruneToSize(size_t maxHypoStackSize);
 
   const ChartHypothesis *GetBestHypothesis() const;
+  bool HasHypotheses(const Word &targetLHS) const;
+
+  float GetThreshold(const Word &targetLHS) const;
 
   const ChartCellLabel &GetSourceWordLabel() const {
     CHECK(m_coverage.GetNumWordsCovered() == 1);
@@ -24,52 +24,68 @@
 #endif
 
 #include "ChartCellLabel.h"
+#include "NonTerminal.h"
 
-#include <set>
+#include <vector>
 
 namespace Moses
 {
 
 class ChartHypothesisCollection;
 
+/** The target-side non-terminal labels of a chart cell.  Labels are stored
+ *  in insertion order for iteration and indexed by their NonTerminalIndex id
+ *  for constant-time lookup.
+ */
 class ChartCellLabelSet
 {
  private:
-  typedef std::set<ChartCellLabel> SetType;
+  typedef std::vector<ChartCellLabel> CollType;
 
  public:
-  typedef SetType::const_iterator const_iterator;
+  typedef CollType::const_iterator const_iterator;
 
-  ChartCellLabelSet(const WordsRange &coverage) : m_coverage(coverage) {}
+  ChartCellLabelSet(const WordsRange &coverage, const NonTerminalIndex &index)
+    : m_coverage(coverage)
+    , m_index(index)
+  {}
 
-  const_iterator begin() const { return m_set.begin(); }
-  const_iterator end() const { return m_set.end(); }
+  const_iterator begin() const { return m_coll.begin(); }
+  const_iterator end() const { return m_coll.end(); }
 
-  void AddWord(const Word &w)
+  void AddConstituent(size_t labelId, const ChartHypothesisCollection &stack)
   {
-    ChartCellLabel cellLabel(m_coverage, w);
-    m_set.insert(cellLabel);
+    if (labelId >= m_labelPos.size()) {
+      m_labelPos.resize(labelId + 1, 0);
+    }
+    CHECK(m_labelPos[labelId] == 0);
+    m_coll.push_back(ChartCellLabel(m_coverage, m_index.GetLabel(labelId),
+                                    &stack));
+    m_labelPos[labelId] = m_coll.size();
   }
 
-  void AddConstituent(const Word &w, const ChartHypothesisCollection &stack)
-  {
-    ChartCellLabel cellLabel(m_coverage, w, &stack);
-    m_set.insert(cellLabel);
-  }
+  bool Empty() const { return m_coll.empty(); }
 
-  bool Empty() const { return m_set.empty(); }
+  size_t GetSize() const { return m_coll.size(); }
 
-  size_t GetSize() const { return m_set.size(); }
+  const ChartCellLabel *Find(size_t labelId) const
+  {
+    if (labelId >= m_labelPos.size() || m_labelPos[labelId] == 0) {
+      return 0;
+    }
+    return &m_coll[m_labelPos[labelId] - 1];
+  }
 
   const ChartCellLabel *Find(const Word &w) const
   {
-    SetType::const_iterator p = m_set.find(ChartCellLabel(m_coverage, w));
-    return p == m_set.end() ? 0 : &(*p);
+    return Find(m_index.Find(w));
   }
 
  private:
   const WordsRange &m_coverage;
-  SetType m_set;
+  const NonTerminalIndex &m_index;
+  CollType m_coll;
+  std::vector<size_t> m_labelPos; /**< label id -> 1 + position in m_coll, or 0 */
 };
 
 }
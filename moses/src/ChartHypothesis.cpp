@@ -29,9 +29,9 @@
 #include "Phrase.h"
 #include "StaticData.h"
 #include "DummyScoreProducers.h"
+#include "FFState.h"
 #include "LMList.h"
 #include "ChartTranslationOption.h"
-#include "FFState.h"
 
 namespace Moses
 {
@@ -48,6 +48,7 @@ ChartHypothesis::ChartHypothesis(const ChartTranslationOption &transOpt,
   ,m_transOpt(transOpt)
   ,m_currSourceWordsRange(transOpt.GetSourceWordsRange())
   ,m_ffStates(manager.GetTranslationSystem()->GetStatefulFeatureFunctions().size())
+  ,m_recombinationHash(0)
   ,m_arcList(NULL)
   ,m_winningHypo(NULL)
   ,m_manager(manager)
@@ -125,6 +126,11 @@ int ChartHypothesis::RecombineCompare(const ChartHypothesis &compare) const
   // +1 = this > compare
   // 0	= this ==compare
 
+  // states that compare equal share a signature, so differing signatures
+  // settle the order without looking at the states themselves
+  if (m_recombinationHash != compare.m_recombinationHash)
+    return (m_recombinationHash < compare.m_recombinationHash) ? -1 : 1;
+
   for (unsigned i = 0; i < m_ffStates.size(); ++i) 
 	{
     if (m_ffStates[i] == NULL || compare.m_ffStates[i] == NULL) 
@@ -168,6 +174,7 @@ void ChartHypothesis::CalcScore()
     m_manager.GetTranslationSystem()->GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i) {
 		m_ffStates[i] = ffs[i]->EvaluateChart(*this,i,&m_scoreBreakdown);
+    FFState::CombineHash(m_recombinationHash, m_ffStates[i] ? m_ffStates[i]->GetHash() : 0);
   }
 
   m_totalScore	= m_scoreBreakdown.GetWeightedScore();
@@ -56,6 +56,7 @@ protected:
 
   WordsRange					m_currSourceWordsRange;
 	std::vector<const FFState*> m_ffStates; /*! stateful feature function states */
+  uint64_t m_recombinationHash; /*! signature of the feature states, see RecombineCompare() */
   ScoreComponentCollection m_scoreBreakdown /*! detailed score break-down by components (for instance language model, word penalty, etc) */
   ,m_lmNGram
   ,m_lmPrefix;
@@ -99,6 +99,11 @@ public:
 
   void PruneToSize(ChartManager &manager);
 
+  //! change the stack size used by PruneToSize()
+  void SetMaxHypoStackSize(size_t maxHypoStackSize) {
+    m_maxHypoStackSize = maxHypoStackSize;
+  }
+
   size_t GetSize() const {
     return m_hypos.size();
   }
@@ -115,6 +120,9 @@ public:
 
   float GetBestScore() const { return m_bestScore; }
 
+  //! hypotheses scoring below this are discarded by AddHypothesis()
+  float GetThreshold() const { return m_bestScore + m_beamWidth; }
+
   void GetSearchGraph(long translationId, std::ostream &outputSearchGraphStream, const std::map<unsigned,bool> &reachable) const;
 
 };
@@ -0,0 +1,192 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "ChartKBestExtractor.h"
+
+#include "ChartHypothesis.h"
+#include "StaticData.h"
+
+namespace Moses
+{
+
+ChartKBestExtractor::DerivationPtr ChartKBestExtractor::GetKthBest(
+    const ChartHypothesis &hypo, size_t k)
+{
+  const ChartHypothesis *winner = hypo.GetWinningHypothesis();
+  if (winner == NULL) {
+    winner = &hypo;
+  }
+
+  // references into an unordered_map stay valid when it rehashes, so the
+  // recursive calls below can safely add vertices
+  Vertex &vertex = m_vertices[winner];
+  if (!vertex.initialized) {
+    Initialize(*winner, vertex);
+  }
+
+  while (vertex.kBestList.size() <= k) {
+    if (!vertex.kBestList.empty()) {
+      // neighbours of a derivation are only needed once it has been taken
+      LazyNext(*vertex.kBestList.back(), vertex);
+    }
+    if (vertex.candidates.empty()) {
+      return DerivationPtr();
+    }
+    vertex.kBestList.push_back(vertex.candidates.top());
+    vertex.candidates.pop();
+  }
+  return vertex.kBestList[k];
+}
+
+void ChartKBestExtractor::Initialize(const ChartHypothesis &winner,
+                                     Vertex &vertex)
+{
+  vertex.initialized = true;
+
+  AddBestDerivation(winner, vertex);
+
+  const ChartArcList *arcList = winner.GetArcList();
+  if (arcList) {
+    for (ChartArcList::const_iterator iter = arcList->begin();
+         iter != arcList->end(); ++iter) {
+      AddBestDerivation(**iter, vertex);
+    }
+  }
+}
+
+void ChartKBestExtractor::AddBestDerivation(const ChartHypothesis &edge,
+                                            Vertex &vertex)
+{
+  const std::vector<const ChartHypothesis*> &prevHypos = edge.GetPrevHypos();
+
+  boost::shared_ptr<Derivation> derivation(new Derivation);
+  derivation->edge = &edge;
+  derivation->subderivations.reserve(prevHypos.size());
+  derivation->backPointers.assign(prevHypos.size(), 0);
+  derivation->score = edge.GetTotalScore();
+  derivation->pure = (edge.GetWinningHypothesis() == &edge);
+
+  for (size_t i = 0; i < prevHypos.size(); ++i) {
+    DerivationPtr sub = GetKthBest(*prevHypos[i], 0);
+    CHECK(sub);
+    derivation->subderivations.push_back(sub);
+    derivation->score += sub->score - prevHypos[i]->GetTotalScore();
+    derivation->pure = derivation->pure && sub->pure;
+  }
+
+  vertex.seen.insert(DerivationKey(&edge, derivation->backPointers));
+  vertex.candidates.push(derivation);
+}
+
+void ChartKBestExtractor::LazyNext(const Derivation &derivation,
+                                   Vertex &vertex)
+{
+  for (size_t i = 0; i < derivation.subderivations.size(); ++i) {
+    DerivationKey key(derivation.edge, derivation.backPointers);
+    size_t rank = ++key.second[i];
+
+    if (vertex.seen.find(key) != vertex.seen.end()) {
+      continue;
+    }
+
+    DerivationPtr sub = GetKthBest(*derivation.edge->GetPrevHypo(i), rank);
+    if (!sub) {
+      continue;
+    }
+
+    boost::shared_ptr<Derivation> next(new Derivation(derivation));
+    next->backPointers = key.second;
+    next->score += sub->score - derivation.subderivations[i]->score;
+    next->subderivations[i] = sub;
+    next->pure = false;
+
+    vertex.seen.insert(key);
+    vertex.candidates.push(next);
+  }
+}
+
+Phrase ChartKBestExtractor::Derivation::GetOutputPhrase() const
+{
+  Phrase outPhrase(ARRAY_SIZE_INCR);
+  CreateOutputPhrase(outPhrase);
+  return outPhrase;
+}
+
+void ChartKBestExtractor::Derivation::CreateOutputPhrase(Phrase &outPhrase) const
+{
+  // exactly like same fn in hypothesis, but use sub-derivations instead of prevHypos pointer
+  const TargetPhrase &currTargetPhrase = edge->GetCurrTargetPhrase();
+  const AlignmentInfo::NonTermIndexMap &nonTermIndexMap =
+    currTargetPhrase.GetAlignmentInfo().GetNonTermIndexMap();
+
+  for (size_t pos = 0; pos < currTargetPhrase.GetSize(); ++pos) {
+    const Word &word = currTargetPhrase.GetWord(pos);
+    if (word.IsNonTerminal()) {
+      size_t nonTermInd = nonTermIndexMap[pos];
+      subderivations[nonTermInd]->CreateOutputPhrase(outPhrase);
+    } else {
+      outPhrase.AddWord(word);
+    }
+  }
+}
+
+void ChartKBestExtractor::Derivation::GetOutputFactors(
+    std::vector<const Factor*> &factors) const
+{
+  factors.clear();
+  AppendOutputFactors(factors);
+}
+
+void ChartKBestExtractor::Derivation::AppendOutputFactors(
+    std::vector<const Factor*> &factors) const
+{
+  const std::vector<FactorType> &outputFactor = StaticData::Instance().GetOutputFactorOrder();
+  const TargetPhrase &currTargetPhrase = edge->GetCurrTargetPhrase();
+  const AlignmentInfo::NonTermIndexMap &nonTermIndexMap =
+    currTargetPhrase.GetAlignmentInfo().GetNonTermIndexMap();
+
+  for (size_t pos = 0; pos < currTargetPhrase.GetSize(); ++pos) {
+    const Word &word = currTargetPhrase.GetWord(pos);
+    if (word.IsNonTerminal()) {
+      size_t nonTermInd = nonTermIndexMap[pos];
+      subderivations[nonTermInd]->AppendOutputFactors(factors);
+    } else {
+      for (size_t i = 0; i < outputFactor.size(); ++i) {
+        factors.push_back(word[outputFactor[i]]);
+      }
+    }
+  }
+}
+
+ScoreComponentCollection ChartKBestExtractor::Derivation::GetScoreBreakdown() const
+{
+  ScoreComponentCollection scoreBreakdown = edge->GetScoreBreakdown();
+  const std::vector<const ChartHypothesis*> &prevHypos = edge->GetPrevHypos();
+  for (size_t i = 0; i < subderivations.size(); ++i) {
+    if (subderivations[i]->pure) {
+      // same sub-tree as the previous hypothesis, nothing changes
+      continue;
+    }
+    scoreBreakdown.MinusEquals(prevHypos[i]->GetScoreBreakdown());
+    scoreBreakdown.PlusEquals(subderivations[i]->GetScoreBreakdown());
+  }
+  return scoreBreakdown;
+}
+
+}  // namespace Moses
@@ -0,0 +1,100 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+#include "Phrase.h"
+#include "ScoreComponentCollection.h"
+
+namespace Moses
+{
+class ChartHypothesis;
+class Factor;
+
+/** Lazy k-best extraction from the chart hypergraph, following algorithm 3
+ *  of Huang and Chiang (2005), "Better k-best parsing".
+ *
+ *  A vertex is a winning hypothesis. Its incoming hyperedges are the winning
+ *  hypothesis itself and its arcs, and the tails of each hyperedge are the
+ *  hypothesis' previous hypotheses. The k-best list of a vertex is only
+ *  extended as far as some parent asks for, and derivations share their
+ *  sub-derivations by pointer instead of copying trees.
+ */
+class ChartKBestExtractor
+{
+ public:
+  struct Derivation;
+  typedef boost::shared_ptr<const Derivation> DerivationPtr;
+
+  struct Derivation {
+    const ChartHypothesis *edge;
+    std::vector<DerivationPtr> subderivations;
+    std::vector<size_t> backPointers; //< rank of each sub-derivation in its vertex's k-best list
+    float score;
+    bool pure; //< built from winning hypotheses only, so scores are those of edge
+
+    Phrase GetOutputPhrase() const;
+    void GetOutputFactors(std::vector<const Factor*> &factors) const;
+    ScoreComponentCollection GetScoreBreakdown() const;
+
+   private:
+    void CreateOutputPhrase(Phrase &outPhrase) const;
+    void AppendOutputFactors(std::vector<const Factor*> &factors) const;
+  };
+
+  /** k-th best derivation (counting from 0) of the vertex that hypo belongs to,
+   *  or an empty pointer if the vertex has no more than k derivations
+   */
+  DerivationPtr GetKthBest(const ChartHypothesis &hypo, size_t k);
+
+ private:
+  struct DerivationOrderer {
+    bool operator()(const DerivationPtr &a, const DerivationPtr &b) const {
+      return a->score < b->score;
+    }
+  };
+
+  typedef std::pair<const ChartHypothesis*, std::vector<size_t> > DerivationKey;
+
+  struct Vertex {
+    Vertex() : initialized(false) {}
+
+    std::vector<DerivationPtr> kBestList;
+    std::priority_queue<DerivationPtr, std::vector<DerivationPtr>,
+                        DerivationOrderer> candidates;
+    boost::unordered_set<DerivationKey> seen;
+    bool initialized;
+  };
+
+  void Initialize(const ChartHypothesis &winner, Vertex &vertex);
+  void AddBestDerivation(const ChartHypothesis &edge, Vertex &vertex);
+  void LazyNext(const Derivation &derivation, Vertex &vertex);
+
+  boost::unordered_map<const ChartHypothesis*, Vertex> m_vertices;
+};
+
+}  // namespace Moses
@@ -20,11 +20,11 @@
  ***********************************************************************/
 
 #include <stdio.h>
+#include <boost/unordered_set.hpp>
 #include "ChartManager.h"
 #include "ChartCell.h"
 #include "ChartHypothesis.h"
-#include "ChartTrellisDetourQueue.h"
-#include "ChartTrellisNode.h"
+#include "ChartKBestExtractor.h"
 #include "ChartTrellisPath.h"
 #include "ChartTrellisPathList.h"
 #include "StaticData.h"
@@ -46,6 +46,7 @@ ChartManager::ChartManager(InputType const& source, const TranslationSystem* sys
   ,m_hypothesisId(0)
 {
   m_system->InitializeBeforeSentenceProcessing(source);
+  m_latencyBudget.SetBudget(StaticData::Instance().GetLatencyBudget());
   const std::vector<PhraseDictionaryFeature*> &dictionaries = m_system->GetPhraseDictionaries();
   m_ruleLookupManagers.reserve(dictionaries.size());
   for (std::vector<PhraseDictionaryFeature*>::const_iterator p = dictionaries.begin();
@@ -75,14 +76,21 @@ void ChartManager::ProcessSentence()
   VERBOSE(1,"Translating: " << m_source << endl);
 
   ResetSentenceStats(m_source);
+  m_latencyBudget.Start();
 
   VERBOSE(2,"Decoding: " << endl);
   //ChartHypothesis::ResetHypoCount();
 
+  const StaticData &staticData = StaticData::Instance();
+  size_t popLimit = staticData.GetCubePruningPopLimit();
+  size_t stackSizeLimit = staticData.GetMaxHypoStackSize();
+
   // MAIN LOOP
   size_t size = m_source.GetSize();
+  const size_t numCells = size * (size + 1) / 2;
+  size_t cellNo = 0;
   for (size_t width = 1; width <= size; ++width) {
-    for (size_t startPos = 0; startPos <= size-width; ++startPos) {
+    for (size_t startPos = 0; startPos <= size-width; ++startPos, ++cellNo) {
       size_t endPos = startPos + width - 1;
       WordsRange range(startPos, endPos);
       //TRACE_ERR(" " << range << "=");
@@ -91,13 +99,23 @@ void ChartManager::ProcessSentence()
       m_transOptColl.CreateTranslationOptionsForRange(startPos, endPos);
       //if (g_debug)
       //	cerr << m_transOptColl.GetTranslationOptionList(WordsRange(startPos, endPos));
+      const ChartTranslationOptionList &transOptList = m_transOptColl.GetTranslationOptionList(range);
+
+      // tighten pruning if decoding falls behind the latency budget
+      size_t ruleLimit = transOptList.GetSize();
+      if (m_latencyBudget.IsLimited()) {
+        const float progress = (float) cellNo / numCells;
+        popLimit = m_latencyBudget.Limit(staticData.GetCubePruningPopLimit(), progress);
+        stackSizeLimit = m_latencyBudget.Limit(staticData.GetMaxHypoStackSize(), progress);
+        ruleLimit = m_latencyBudget.Limit(ruleLimit, progress);
+      }
 
       // decode
       ChartCell &cell = m_hypoStackColl.Get(range);
 
-      cell.ProcessSentence(m_transOptColl.GetTranslationOptionList(range)
-                           ,m_hypoStackColl);
-      cell.PruneToSize();
+      cell.ProcessSentence(transOptList, m_hypoStackColl, popLimit, ruleLimit
+                           , m_latencyBudget.WasDegraded());
+      cell.PruneToSize(stackSizeLimit);
       cell.CleanupArcList();
       cell.SortHypotheses();
 
@@ -126,6 +144,11 @@ void ChartManager::ProcessSentence()
       cerr << endl;
     }
   }
+
+  if (m_latencyBudget.WasDegraded()) {
+    VERBOSE(1, "Pruning was tightened to meet the latency budget of " << m_latencyBudget.GetBudget() << " ms"
+            << (m_latencyBudget.HasExpired() ? " (budget exceeded)" : "") << endl);
+  }
 }
 
 const ChartHypothesis *ChartManager::GetBestHypothesis() const
@@ -147,7 +170,7 @@ void ChartManager::CalcNBest(size_t count, ChartTrellisPathList &ret,bool onlyDi
   if (count == 0 || size == 0)
     return;
 
-  // Build a ChartTrellisPath for the 1-best path, if any.
+  // The n-best list is read off the vertex of the 1-best hypothesis, if any.
   WordsRange range(0, size-1);
   const ChartCell &lastCell = m_hypoStackColl.Get(range);
   const ChartHypothesis *hypo = lastCell.GetBestHypothesis();
@@ -155,27 +178,14 @@ void ChartManager::CalcNBest(size_t count, ChartTrellisPathList &ret,bool onlyDi
     // no hypothesis
     return;
   }
-  boost::shared_ptr<ChartTrellisPath> basePath(new ChartTrellisPath(*hypo));
-
-  // Add it to the n-best list.
-  ret.Add(basePath);
-  if (count == 1) {
-    return;
-  }
-
-  // Record the output phrase if distinct translations are required.
-  set<Phrase> distinctHyps;
-  if (onlyDistinct) {
-    distinctHyps.insert(basePath->GetOutputPhrase());
-  }
 
-  // Set a limit on the number of detours to pop.  If the n-best list is
-  // restricted to distinct translations then this limit should be bigger
+  // Set a limit on the number of derivations to extract.  If the n-best list
+  // is restricted to distinct translations then this limit should be bigger
   // than n.  The n-best factor determines how much bigger the limit should be.
   const size_t nBestFactor = StaticData::Instance().GetNBestFactor();
   size_t popLimit;
   if (!onlyDistinct) {
-    popLimit = count-1;
+    popLimit = count;
   } else if (nBestFactor == 0) {
     // 0 = 'unlimited.'  This actually sets a large-ish limit in case too many
     // translations are identical.
@@ -184,42 +194,33 @@ void ChartManager::CalcNBest(size_t count, ChartTrellisPathList &ret,bool onlyDi
     popLimit = count * nBestFactor;
   }
 
-  // Create an empty priority queue of detour objects.  It is bounded to
-  // contain no more than popLimit items.
-  ChartTrellisDetourQueue contenders(popLimit);
+  // Derivations are only expanded as far as the k-th best of the final
+  // vertex requires, and share their sub-derivations.
+  ChartKBestExtractor extractor;
 
-  // Create a ChartTrellisDetour for each single-point deviation from basePath
-  // and add them to the queue.
-  CreateDeviantPaths(basePath, contenders);
+  // Output factors of the translations seen so far, if distinct translations
+  // are required.
+  boost::unordered_set<std::vector<const Factor*> > distinctHyps;
+  std::vector<const Factor*> outputFactors;
 
   // MAIN loop
-  for (size_t i = 0;
-       ret.GetSize() < count && !contenders.Empty() && i < popLimit;
-       ++i) {
-    // Get the best detour from the queue.
-    std::auto_ptr<const ChartTrellisDetour> detour(contenders.Pop());
-    CHECK(detour.get());
-
-    // Create a full base path from the chosen detour.
-    basePath.reset(new ChartTrellisPath(*detour));
-
-    // Generate new detours from this base path and add them to the queue of
-    // contenders.  The new detours deviate from the base path by a single
-    // replacement along the previous detour sub-path.
-    CHECK(basePath->GetDeviationPoint());
-    CreateDeviantPaths(basePath, *(basePath->GetDeviationPoint()), contenders);
+  for (size_t k = 0; ret.GetSize() < count && k < popLimit; ++k) {
+    ChartKBestExtractor::DerivationPtr derivation = extractor.GetKthBest(*hypo, k);
+    if (!derivation) {
+      // the search graph holds fewer than k+1 derivations
+      break;
+    }
 
     // If the n-best list is allowed to contain duplicate translations (at the
     // surface level) then add the new path unconditionally, otherwise check
     // whether the translation has seen before.
-    if (!onlyDistinct) {
-      ret.Add(basePath);
-    } else {
-      Phrase tgtPhrase = basePath->GetOutputPhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
-        ret.Add(basePath);
+    if (onlyDistinct) {
+      derivation->GetOutputFactors(outputFactors);
+      if (!distinctHyps.insert(outputFactors).second) {
+        continue;
       }
     }
+    ret.Add(boost::shared_ptr<const ChartTrellisPath>(new ChartTrellisPath(derivation)));
   }
 }
 
@@ -282,34 +283,4 @@ void ChartManager::FindReachableHypotheses( const ChartHypothesis *hypo, std::ma
 	}
 }
 
-void ChartManager::CreateDeviantPaths(
-    boost::shared_ptr<const ChartTrellisPath> basePath,
-    ChartTrellisDetourQueue &q)
-{
-  CreateDeviantPaths(basePath, basePath->GetFinalNode(), q);
-}
-
-void ChartManager::CreateDeviantPaths(
-    boost::shared_ptr<const ChartTrellisPath> basePath,
-    const ChartTrellisNode &substitutedNode,
-    ChartTrellisDetourQueue &queue)
-{
-  const ChartArcList *arcList = substitutedNode.GetHypothesis().GetArcList();
-  if (arcList) {
-    for (ChartArcList::const_iterator iter = arcList->begin();
-         iter != arcList->end(); ++iter) {
-      const ChartHypothesis &replacement = **iter;
-      queue.Push(new ChartTrellisDetour(basePath, substitutedNode,
-                                        replacement));
-    }
-  }
-  // recusively create deviant paths for child nodes
-  const ChartTrellisNode::NodeChildren &children = substitutedNode.GetChildren();
-  ChartTrellisNode::NodeChildren::const_iterator iter;
-  for (iter = children.begin(); iter != children.end(); ++iter) {
-    const ChartTrellisNode &child = **iter;
-    CreateDeviantPaths(basePath, child, queue);
-  }
-}
-
 } // namespace Moses
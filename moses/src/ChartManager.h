@@ -30,6 +30,8 @@
 #include "SentenceStats.h"
 #include "TranslationSystem.h"
 #include "ChartRuleLookupManager.h"
+#include "NonTerminal.h"
+#include "LatencyBudget.h"
 
 #include <boost/shared_ptr.hpp>
 
@@ -37,22 +39,14 @@ namespace Moses
 {
 
 class ChartHypothesis;
-class ChartTrellisDetourQueue;
-class ChartTrellisNode;
 class ChartTrellisPath;
 class ChartTrellisPathList;
 
 class ChartManager
 {
 private:
-  static void CreateDeviantPaths(boost::shared_ptr<const ChartTrellisPath>,
-                                 ChartTrellisDetourQueue &);
-
-  static void CreateDeviantPaths(boost::shared_ptr<const ChartTrellisPath>,
-                                 const ChartTrellisNode &,
-                                 ChartTrellisDetourQueue &);
-
   InputType const& m_source; /**< source sentence to be translated */
+  NonTerminalIndex m_labelIndex; /**< dense ids for the target labels used in this sentence */
   ChartCellCollection m_hypoStackColl;
   ChartTranslationOptionCollection m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
   std::auto_ptr<SentenceStats> m_sentenceStats;
@@ -60,6 +54,7 @@ private:
   clock_t m_start; /**< starting time, used for logging */
   std::vector<ChartRuleLookupManager*> m_ruleLookupManagers;
   unsigned m_hypothesisId; /* For handing out hypothesis ids to ChartHypothesis */
+  LatencyBudget m_latencyBudget; /**< per-sentence time limit used to tighten pruning */
 
 public:
   ChartManager(InputType const& source, const TranslationSystem* system);
@@ -90,6 +85,13 @@ public:
   }
 
   unsigned GetNextHypoId() { return m_hypothesisId++; }
+
+  NonTerminalIndex &GetLabelIndex() { return m_labelIndex; }
+  const NonTerminalIndex &GetLabelIndex() const { return m_labelIndex; }
+
+  //! time budget for this sentence, may be changed before calling ProcessSentence()
+  LatencyBudget &GetLatencyBudget() { return m_latencyBudget; }
+  const LatencyBudget &GetLatencyBudget() const { return m_latencyBudget; }
 };
 
 }
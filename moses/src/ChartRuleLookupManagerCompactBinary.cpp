@@ -0,0 +1,279 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "ChartRuleLookupManagerCompactBinary.h"
+
+#include <algorithm>
+
+#include "ChartCellCollection.h"
+#include "ChartTranslationOptionList.h"
+#include "InputType.h"
+#include "NonTerminal.h"
+#include "StaticData.h"
+#include "TargetPhraseCollection.h"
+
+namespace Moses
+{
+
+namespace
+{
+const UINT32 NoSymbol = 0xFFFFFFFF;
+}
+
+ChartRuleLookupManagerCompactBinary::ChartRuleLookupManagerCompactBinary(
+  const InputType &src,
+  const ChartCellCollection &cellColl,
+  const PhraseDictionaryCompactBinary &ruleTable)
+  : ChartRuleLookupManager(src, cellColl)
+  , m_ruleTable(ruleTable)
+{
+  size_t sourceSize = src.GetSize();
+  m_dottedRuleColls.resize(sourceSize);
+
+  const Node &rootNode = m_ruleTable.GetRootNode();
+
+  for (size_t ind = 0; ind < m_dottedRuleColls.size(); ++ind) {
+    DottedRuleCompactBinary *initDottedRule = new DottedRuleCompactBinary(rootNode);
+
+    DottedRuleCollCompactBinary *dottedRuleColl = new DottedRuleCollCompactBinary(sourceSize - ind + 1);
+    dottedRuleColl->Add(0, initDottedRule, m_ruleTable.IsLeaf(rootNode)); // init rule. stores the top node in tree
+
+    m_dottedRuleColls[ind] = dottedRuleColl;
+  }
+}
+
+ChartRuleLookupManagerCompactBinary::~ChartRuleLookupManagerCompactBinary()
+{
+  std::map<const Node*, const TargetPhraseCollection*>::const_iterator iterCache;
+  for (iterCache = m_cache.begin(); iterCache != m_cache.end(); ++iterCache) {
+    delete iterCache->second;
+  }
+  m_cache.clear();
+
+  RemoveAllInColl(m_dottedRuleColls);
+}
+
+void ChartRuleLookupManagerCompactBinary::GetChartRuleCollection(
+  const WordsRange &range,
+  bool adhereTableLimit,
+  ChartTranslationOptionList &outColl)
+{
+  size_t relEndPos = range.GetEndPos() - range.GetStartPos();
+  size_t absEndPos = range.GetEndPos();
+
+  // get list of all rules that apply to spans at same starting position
+  DottedRuleCollCompactBinary &dottedRuleCol = *m_dottedRuleColls[range.GetStartPos()];
+  const DottedRuleListCompactBinary &expandableDottedRuleList = dottedRuleCol.GetExpandableDottedRuleList();
+
+  const ChartCellLabel &sourceWordLabel = GetCellCollection().Get(WordsRange(absEndPos, absEndPos)).GetSourceWordLabel();
+
+  // vocabulary id of the source word in the last position
+  UINT32 sourceWordId = NoSymbol;
+  FindSymbol(sourceWordLabel.GetLabel(), m_ruleTable.GetInputFactors(), sourceWordId);
+
+  // loop through the rules
+  // (note that expandableDottedRuleList can be expanded as the loop runs
+  //  through calls to ExtendPartialRuleApplication())
+  for (size_t ind = 0; ind < expandableDottedRuleList.size(); ++ind) {
+    // rule we are about to extend
+    const DottedRuleCompactBinary &prevDottedRule = *expandableDottedRuleList[ind];
+    // we will now try to extend it, starting after where it ended
+    size_t startPos = prevDottedRule.IsRoot()
+                      ? range.GetStartPos()
+                      : prevDottedRule.GetWordsRange().GetEndPos() + 1;
+
+    // search for terminal symbol
+    // (if only one more word position needs to be covered)
+    if (startPos == absEndPos && sourceWordId != NoSymbol) {
+      const Node *node = m_ruleTable.GetChild(prevDottedRule.GetLastNode(), sourceWordId);
+      if (node != NULL) {
+        DottedRuleCompactBinary *dottedRule =
+          new DottedRuleCompactBinary(*node, sourceWordLabel, prevDottedRule);
+        dottedRuleCol.Add(relEndPos+1, dottedRule, m_ruleTable.IsLeaf(*node));
+      }
+    }
+
+    // search for non-terminals
+    size_t endPos, stackInd;
+
+    // span is already complete covered? nothing can be done
+    if (startPos > absEndPos)
+      continue;
+
+    else if (startPos == range.GetStartPos() && range.GetEndPos() > range.GetStartPos()) {
+      // We're at the root of the prefix tree, see ChartRuleLookupManagerMemory
+      endPos = absEndPos - 1;
+      stackInd = relEndPos;
+    } else {
+      endPos = absEndPos;
+      stackInd = relEndPos + 1;
+    }
+
+    ExtendPartialRuleApplication(prevDottedRule, startPos, endPos, stackInd,
+                                 dottedRuleCol);
+  }
+
+  // list of rules that that cover the entire span
+  const DottedRuleListCompactBinary &rules = dottedRuleCol.Get(relEndPos + 1);
+
+  // look up target sides for the rules
+  size_t rulesLimit = StaticData::Instance().GetRuleLimit();
+  DottedRuleListCompactBinary::const_iterator iterRule;
+  for (iterRule = rules.begin(); iterRule != rules.end(); ++iterRule) {
+    const DottedRuleCompactBinary &dottedRule = **iterRule;
+    const Node &node = dottedRule.GetLastNode();
+    if (node.numRules == 0) {
+      continue;
+    }
+
+    // add the fully expanded rule (with lexical target side)
+    const TargetPhraseCollection &targetPhraseCollection = GetTargetPhraseCollection(node);
+    if (!targetPhraseCollection.IsEmpty()) {
+      outColl.Add(targetPhraseCollection, dottedRule,
+                  GetCellCollection(), adhereTableLimit, rulesLimit);
+    }
+  }
+
+  outColl.CreateChartRules(rulesLimit);
+}
+
+// Given a partial rule application ending at startPos-1 and given the sets of
+// source and target non-terminals covering the span [startPos, endPos],
+// determines the full or partial rule applications that can be produced through
+// extending the current rule application by a single non-terminal.
+void ChartRuleLookupManagerCompactBinary::ExtendPartialRuleApplication(
+  const DottedRuleCompactBinary &prevDottedRule,
+  size_t startPos,
+  size_t endPos,
+  size_t stackInd,
+  DottedRuleCollCompactBinary &dottedRuleColl)
+{
+  const Node &node = prevDottedRule.GetLastNode();
+  const size_t numChildren = node.numNonTerminalEdges;
+  if (numChildren == 0) {
+    return;
+  }
+
+  // source non-terminal labels for the remainder, that occur in the table
+  const NonTerminalSet &sourceNonTerms =
+    GetSentence().GetLabelSet(startPos, endPos);
+  std::vector<UINT32> sourceIds;
+  sourceIds.reserve(sourceNonTerms.size());
+  for (NonTerminalSet::const_iterator p = sourceNonTerms.begin(); p != sourceNonTerms.end(); ++p) {
+    UINT32 id;
+    if (FindSymbol(*p, m_ruleTable.GetInputFactors(), id)) {
+      sourceIds.push_back(id);
+    }
+  }
+  if (sourceIds.empty()) {
+    return;
+  }
+
+  // target non-terminal labels for the remainder, that occur in the table
+  const ChartCellLabelSet &targetNonTerms =
+    GetCellCollection().Get(WordsRange(startPos, endPos)).GetTargetLabelSet();
+  std::vector<std::pair<UINT32, const ChartCellLabel*> > targetLabels;
+  targetLabels.reserve(targetNonTerms.GetSize());
+  for (ChartCellLabelSet::const_iterator q = targetNonTerms.begin(); q != targetNonTerms.end(); ++q) {
+    UINT32 id;
+    if (FindSymbol(q->GetLabel(), m_ruleTable.GetOutputFactors(), id)) {
+      targetLabels.push_back(std::make_pair(id, &*q));
+    }
+  }
+
+  // As in ChartRuleLookupManagerMemory, either search the node for each
+  // source-target pair, or match each child against the pairs, whichever
+  // minimises the number of lookups
+  const size_t numCombinations = sourceIds.size() * targetLabels.size();
+  if (numCombinations <= numChildren*2) {
+    for (size_t i = 0; i < sourceIds.size(); ++i) {
+      for (size_t j = 0; j < targetLabels.size(); ++j) {
+        const Node *child = m_ruleTable.GetChild(node, sourceIds[i], targetLabels[j].first);
+        if (child == NULL) {
+          continue;
+        }
+        DottedRuleCompactBinary *rule =
+          new DottedRuleCompactBinary(*child, *targetLabels[j].second, prevDottedRule);
+        dottedRuleColl.Add(stackInd, rule, m_ruleTable.IsLeaf(*child));
+      }
+    }
+  } else {
+    const PhraseDictionaryCompactBinary::NonTerminalEdge *edge = m_ruleTable.BeginNonTerminalEdges(node);
+    const PhraseDictionaryCompactBinary::NonTerminalEdge *end = m_ruleTable.EndNonTerminalEdges(node);
+    for (; edge != end; ++edge) {
+      if (std::find(sourceIds.begin(), sourceIds.end(), edge->sourceLabel) == sourceIds.end()) {
+        continue;
+      }
+      for (size_t j = 0; j < targetLabels.size(); ++j) {
+        if (targetLabels[j].first != edge->targetLabel) {
+          continue;
+        }
+        const Node &child = m_ruleTable.GetChild(*edge);
+        DottedRuleCompactBinary *rule =
+          new DottedRuleCompactBinary(child, *targetLabels[j].second, prevDottedRule);
+        dottedRuleColl.Add(stackInd, rule, m_ruleTable.IsLeaf(child));
+      }
+    }
+  }
+}
+
+bool ChartRuleLookupManagerCompactBinary::FindSymbol(
+  const Word &word, const std::vector<FactorType> &factors, UINT32 &id)
+{
+  std::map<Word, UINT32>::const_iterator iter = m_symbolIds.find(word);
+  if (iter == m_symbolIds.end()) {
+    // the text of the word as in the vocabulary of the rule table
+    std::string symbol;
+    for (size_t i = 0; i < factors.size(); ++i) {
+      const Factor *factor = word.GetFactor(factors[i]);
+      if (factor != NULL) {
+        if (!symbol.empty()) {
+          symbol += "|";
+        }
+        symbol += factor->GetString();
+      }
+    }
+    if (word.IsNonTerminal()) {
+      symbol = "[" + symbol + "]";
+    }
+
+    UINT32 symbolId;
+    if (!m_ruleTable.FindSymbol(symbol, symbolId)) {
+      symbolId = NoSymbol;
+    }
+    iter = m_symbolIds.insert(std::make_pair(word, symbolId)).first;
+  }
+  id = iter->second;
+  return id != NoSymbol;
+}
+
+const TargetPhraseCollection &ChartRuleLookupManagerCompactBinary::GetTargetPhraseCollection(
+  const Node &node)
+{
+  std::map<const Node*, const TargetPhraseCollection*>::const_iterator iterCache = m_cache.find(&node);
+  if (iterCache != m_cache.end()) {
+    return *iterCache->second;
+  }
+  const TargetPhraseCollection *targetPhraseCollection =
+    m_ruleTable.CreateTargetPhraseCollection(node, m_targetWords);
+  m_cache[&node] = targetPhraseCollection;
+  return *targetPhraseCollection;
+}
+
+}  // namespace Moses
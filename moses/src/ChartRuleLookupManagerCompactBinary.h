@@ -0,0 +1,82 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+#ifndef moses_ChartRuleLookupManagerCompactBinary_h
+#define moses_ChartRuleLookupManagerCompactBinary_h
+
+#include <map>
+#include <vector>
+
+#include "ChartRuleLookupManager.h"
+#include "DotChartCompactBinary.h"
+#include "PhraseDictionaryCompactBinary.h"
+
+namespace Moses
+{
+
+class ChartTranslationOptionList;
+class TargetPhraseCollection;
+class WordsRange;
+
+// Implementation of ChartRuleLookupManager for binary compact rule tables.
+// Follows ChartRuleLookupManagerMemory, but the prefix tree is searched by
+// vocabulary id and target phrases are decoded and cached per sentence.
+class ChartRuleLookupManagerCompactBinary : public ChartRuleLookupManager
+{
+public:
+  ChartRuleLookupManagerCompactBinary(const InputType &sentence,
+                                      const ChartCellCollection &cellColl,
+                                      const PhraseDictionaryCompactBinary &ruleTable);
+
+  ~ChartRuleLookupManagerCompactBinary();
+
+  virtual void GetChartRuleCollection(
+    const WordsRange &range,
+    bool adhereTableLimit,
+    ChartTranslationOptionList &outColl);
+
+private:
+  typedef PhraseDictionaryCompactBinary::Node Node;
+
+  void ExtendPartialRuleApplication(
+    const DottedRuleCompactBinary &prevDottedRule,
+    size_t startPos,
+    size_t endPos,
+    size_t stackInd,
+    DottedRuleCollCompactBinary &dottedRuleColl);
+
+  bool FindSymbol(const Word &word, const std::vector<FactorType> &factors, UINT32 &id);
+  const TargetPhraseCollection &GetTargetPhraseCollection(const Node &node);
+
+  std::vector<DottedRuleCollCompactBinary*> m_dottedRuleColls;
+  const PhraseDictionaryCompactBinary &m_ruleTable;
+
+  // vocabulary ids of the words of this sentence and of the chart labels,
+  // NoSymbol if not in the rule table
+  std::map<Word, UINT32> m_symbolIds;
+  // target words decoded so far
+  std::map<UINT32, Word> m_targetWords;
+  // target phrases of the rules applied so far, by prefix tree node
+  std::map<const Node*, const TargetPhraseCollection*> m_cache;
+};
+
+}  // namespace Moses
+
+#endif
@@ -22,42 +22,20 @@
 #include "ChartTrellisPath.h"
 
 #include "ChartHypothesis.h"
-#include "ChartTrellisDetour.h"
-#include "ChartTrellisDetourQueue.h"
-#include "ChartTrellisNode.h"
 
 namespace Moses
 {
 
-ChartTrellisPath::ChartTrellisPath(const ChartHypothesis &hypo)
-    : m_finalNode(new ChartTrellisNode(hypo))
-    , m_deviationPoint(NULL)
-    , m_scoreBreakdown(hypo.GetScoreBreakdown())
-    , m_totalScore(hypo.GetTotalScore())
+ChartTrellisPath::ChartTrellisPath(ChartKBestExtractor::DerivationPtr derivation)
+    : m_derivation(derivation)
+    , m_scoreBreakdown(derivation->GetScoreBreakdown())
+    , m_totalScore(m_scoreBreakdown.GetWeightedScore())
 {
 }
 
-ChartTrellisPath::ChartTrellisPath(const ChartTrellisDetour &detour)
-   : m_finalNode(new ChartTrellisNode(detour, m_deviationPoint))
-   , m_scoreBreakdown(detour.GetBasePath().m_scoreBreakdown)
-   , m_totalScore(0)
-{
-  CHECK(m_deviationPoint);
-  ScoreComponentCollection scoreChange;
-  scoreChange = detour.GetReplacementHypo().GetScoreBreakdown();
-  scoreChange.MinusEquals(detour.GetSubstitutedNode().GetHypothesis().GetScoreBreakdown());
-  m_scoreBreakdown.PlusEquals(scoreChange);
-  m_totalScore = m_scoreBreakdown.GetWeightedScore();
-}
-
-ChartTrellisPath::~ChartTrellisPath()
-{
-  delete m_finalNode;
-}
-
 Phrase ChartTrellisPath::GetOutputPhrase() const
 {
-  Phrase ret = GetFinalNode().GetOutputPhrase();
+  Phrase ret = m_derivation->GetOutputPhrase();
   return ret;
 }
 
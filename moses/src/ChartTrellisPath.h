@@ -21,30 +21,19 @@
 
 #pragma once
 
+#include "ChartKBestExtractor.h"
 #include "ScoreComponentCollection.h"
 #include "Phrase.h"
 
-#include <boost/shared_ptr.hpp>
-
 namespace Moses
 {
 
-class ChartHypothesis;
-class ChartTrellisDetour;
-class ChartTrellisDetourQueue;
-class ChartTrellisNode;
-
 class ChartTrellisPath
 {
  public:
-  ChartTrellisPath(const ChartHypothesis &hypo);
-  ChartTrellisPath(const ChartTrellisDetour &detour);
-
-  ~ChartTrellisPath();
-
-  const ChartTrellisNode &GetFinalNode() const { return *m_finalNode; }
+  ChartTrellisPath(ChartKBestExtractor::DerivationPtr derivation);
 
-  const ChartTrellisNode *GetDeviationPoint() const { return m_deviationPoint; }
+  const ChartKBestExtractor::Derivation &GetDerivation() const { return *m_derivation; }
 
   //! get score for this path throught trellis
   float GetTotalScore() const { return m_totalScore; }
@@ -60,8 +49,7 @@ class ChartTrellisPath
   ChartTrellisPath(const ChartTrellisPath &);  // Not implemented
   ChartTrellisPath &operator=(const ChartTrellisPath &);  // Not implemented
 
-  ChartTrellisNode *m_finalNode;
-  ChartTrellisNode *m_deviationPoint;
+  ChartKBestExtractor::DerivationPtr m_derivation;
   ScoreComponentCollection m_scoreBreakdown;
   float m_totalScore;
 };
@@ -0,0 +1,100 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "DotChart.h"
+#include "PhraseDictionaryCompactBinary.h"
+
+#include "Util.h"
+
+#include "util/check.hh"
+#include <algorithm>
+#include <vector>
+
+namespace Moses
+{
+
+class DottedRuleCompactBinary : public DottedRule
+{
+ public:
+  // used only to init dot stack.
+  explicit DottedRuleCompactBinary(const PhraseDictionaryCompactBinary::Node &node)
+      : DottedRule()
+      , m_node(node) {}
+
+  DottedRuleCompactBinary(const PhraseDictionaryCompactBinary::Node &node,
+                          const ChartCellLabel &cellLabel,
+                          const DottedRuleCompactBinary &prev)
+      : DottedRule(cellLabel, prev)
+      , m_node(node) {}
+
+  const PhraseDictionaryCompactBinary::Node &GetLastNode() const { return m_node; }
+
+ private:
+  // points into the mapped rule table
+  const PhraseDictionaryCompactBinary::Node &m_node;
+};
+
+typedef std::vector<const DottedRuleCompactBinary*> DottedRuleListCompactBinary;
+
+// Collection of all DottedRules over a binary compact rule table that share a
+// common start point, grouped by end point, as DottedRuleColl.
+class DottedRuleCollCompactBinary
+{
+protected:
+  typedef std::vector<DottedRuleListCompactBinary> CollType;
+  CollType m_coll;
+  DottedRuleListCompactBinary m_expandableDottedRuleList;
+
+public:
+  DottedRuleCollCompactBinary(size_t size)
+    : m_coll(size)
+  {}
+
+  ~DottedRuleCollCompactBinary() {
+    std::for_each(m_coll.begin(), m_coll.end(),
+                  RemoveAllInColl<CollType::value_type>);
+  }
+
+  const DottedRuleListCompactBinary &Get(size_t pos) const {
+    return m_coll[pos];
+  }
+  DottedRuleListCompactBinary &Get(size_t pos) {
+    return m_coll[pos];
+  }
+
+  void Add(size_t pos, const DottedRuleCompactBinary *dottedRule, bool isLeaf) {
+    CHECK(dottedRule);
+    m_coll[pos].push_back(dottedRule);
+    if (!isLeaf) {
+      m_expandableDottedRuleList.push_back(dottedRule);
+    }
+  }
+
+  const DottedRuleListCompactBinary &GetExpandableDottedRuleList() const {
+    return m_expandableDottedRuleList;
+  }
+};
+
+}
@@ -13,7 +13,9 @@ namespace Moses
 struct DistortionState_traditional : public FFState {
   WordsRange range;
   int first_gap;
-  DistortionState_traditional(const WordsRange& wr, int fg) : range(wr), first_gap(fg) {}
+  DistortionState_traditional(const WordsRange& wr, int fg) : range(wr), first_gap(fg) {
+    m_hash = range.GetEndPos();
+  }
   int Compare(const FFState& other) const {
     const DistortionState_traditional& o =
       static_cast<const DistortionState_traditional&>(other);
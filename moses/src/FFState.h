@@ -3,6 +3,7 @@
 
 #include "util/check.hh"
 #include <vector>
+#include <stdint.h>
 
 
 namespace Moses
@@ -11,8 +12,27 @@ namespace Moses
 class FFState
 {
 public:
+  FFState() : m_hash(0) {}
   virtual ~FFState();
   virtual int Compare(const FFState& other) const = 0;
+
+  /** 64-bit signature of the state, set by the feature function when the
+   * state is created. States that Compare() equal must have the same
+   * signature, so states with different signatures are known to differ
+   * without calling Compare(). States that don't set it leave it at 0,
+   * which is always correct but saves no comparisons.
+   */
+  uint64_t GetHash() const {
+    return m_hash;
+  }
+
+  //! mix hash into seed (64-bit version of boost::hash_combine)
+  static void CombineHash(uint64_t &seed, uint64_t hash) {
+    seed ^= hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+  }
+
+protected:
+  uint64_t m_hash;
 };
 
 }
@@ -1,4 +1,5 @@
 #include "FeatureFunction.h"
+#include "StaticData.h"
 
 #include "util/check.hh"
 
@@ -27,5 +28,26 @@ bool StatefulFeatureFunction::IsStateless() const
   return false;
 }
 
+bool StatefulFeatureFunction::EvaluateUpperBound(
+  const Hypothesis& /* cur_hypo */,
+  const FFState* /* prev_state */,
+  float &/* bound */) const
+{
+  return false;
+}
+
+bool StatefulFeatureFunction::HasNonNegativeWeights() const
+{
+  const StaticData &staticData = StaticData::Instance();
+  const std::vector<float> &weights = staticData.GetAllWeights();
+  const size_t begin = staticData.GetScoreIndexManager().GetBeginIndex(GetScoreBookkeepingID());
+  for (size_t i = 0; i < GetNumScoreComponents(); ++i) {
+    if (weights[begin + i] < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }
 
@@ -67,7 +67,24 @@ public:
   //! return the state associated with the empty hypothesis for a given sentence
   virtual const FFState* EmptyHypothesisState(const InputType &input) const = 0;
 
+  /**
+   * Optimistic bound on the weighted score that Evaluate() would add for
+   * cur_hypo, computed without evaluating the feature. Used by
+   * search-lazy-scoring to skip the evaluation of hypotheses that cannot
+   * survive stack pruning. Must be cheap and deterministic.
+   * Returns false (the default) if the feature cannot give a bound, in which
+   * case it is always evaluated in full.
+   */
+  virtual bool EvaluateUpperBound(
+    const Hypothesis& cur_hypo,
+    const FFState* prev_state,
+    float &bound) const;
+
   bool IsStateless() const;
+
+protected:
+  //! true if none of the weights of this feature is negative
+  bool HasNonNegativeWeights() const;
 };
 
 }
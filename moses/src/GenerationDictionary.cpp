@@ -21,6 +21,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <fstream>
 #include <string>
+#include <cstring>
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/murmur_hash.hh"
 #include "GenerationDictionary.h"
 #include "FactorCollection.h"
 #include "Word.h"
@@ -37,12 +41,91 @@ GenerationDictionary::GenerationDictionary(size_t numFeatures, ScoreIndexManager
     const std::vector<FactorType> &input,
     const std::vector<FactorType> &output)
   : Dictionary(numFeatures), DecodeFeature(input,output)
+  , m_binaryEntries(NULL)
+  , m_binaryEntriesEnd(NULL)
+  , m_binaryBuckets(NULL)
+  , m_numBinaryEntries(0)
+  , m_numBinaryBuckets(0)
+  , m_numBinaryScores(0)
+  , m_direction(Output)
 {
   scoreIndexManager.AddScoreProducer(this);
 }
 
+/* Binary generation table, all values in native byte order:
+ *   header   GenerationBinaryHeader
+ *   entries  entriesSize bytes. For each input word: uint32 length and text of
+ *            the input factors, uint32 number of output words, then for each
+ *            output word uint32 length and text of the output factors,
+ *            numScores x float
+ *   buckets  numBuckets x GenerationBinaryBucket, open addressing with linear probing
+ *            on the hash of the input factors. offset 0 marks an empty bucket
+ * Factors are joined by '|' exactly as in the text table. The buckets follow the
+ * entries so that Create() can write the entries while reading the text table.
+ */
+namespace
+{
+const char GenerationBinaryMagic[8] = {'m','o','s','e','s','g','e','n'};
+const uint32_t GenerationBinaryVersion = 2;
+
+struct GenerationBinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t numScores;
+  uint64_t numEntries;
+  uint64_t numBuckets;
+  uint64_t entriesSize;
+};
+
+struct GenerationBinaryBucket {
+  uint64_t hash;
+  uint64_t offset; // 1 + position of the entry in the entry section
+};
+
+uint64_t HashGenerationKey(const std::string &key)
+{
+  return util::MurmurHashNative(key.data(), key.size());
+}
+
+template <class T> void WriteBinary(std::ostream &out, const T &value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void WriteBinaryString(std::ostream &out, const std::string &str)
+{
+  WriteBinary(out, (uint32_t) str.size());
+  out.write(str.data(), str.size());
+}
+
+//! read a value from [data, end), throwing if the entry runs past the end of the table
+template <class T> T ReadBinary(const char *&data, const char *end, const std::string &filePath)
+{
+  UTIL_THROW_IF((size_t) (end - data) < sizeof(T), util::Exception,
+                "Binary generation table " << filePath << " is corrupt: entry runs past the end of the table");
+  T value;
+  memcpy(&value, data, sizeof(T));
+  data += sizeof(T);
+  return value;
+}
+
+//! skip length bytes of text in [data, end), throwing if they run past the end of the table
+const char *SkipBinary(const char *&data, const char *end, uint32_t length, const std::string &filePath)
+{
+  UTIL_THROW_IF((size_t) (end - data) < length, util::Exception,
+                "Binary generation table " << filePath << " is corrupt: entry runs past the end of the table");
+  const char *begin = data;
+  data += length;
+  return begin;
+}
+}
+
 bool GenerationDictionary::Load(const std::string &filePath, FactorDirection direction)
 {
+  if (FileExists(filePath + ".bingen")) {
+    return LoadBinary(filePath + ".bingen", direction);
+  }
+
   FactorCollection &factorCollection = FactorCollection::Instance();
 
   const size_t numFeatureValuesInConfig = this->GetNumScoreComponents();
@@ -110,12 +193,208 @@ bool GenerationDictionary::Load(const std::string &filePath, FactorDirection dir
   return true;
 }
 
+bool GenerationDictionary::LoadBinary(const std::string &filePath, FactorDirection direction)
+{
+  try {
+    util::scoped_fd file(util::OpenReadOrThrow(filePath.c_str()));
+    const uint64_t size = util::SizeFile(file.get());
+    if (size == util::kBadSize || size < sizeof(GenerationBinaryHeader)) {
+      UserMessage::Add(filePath + " is not a binary generation table");
+      return false;
+    }
+    // lazily mapped, only pages that are looked up are read
+    util::MapRead(util::LAZY, file.get(), 0, size, m_binaryMemory);
+  } catch (const util::Exception &e) {
+    UserMessage::Add(string("Couldn't read ") + filePath + ": " + e.what());
+    return false;
+  }
+
+  GenerationBinaryHeader header;
+  memcpy(&header, m_binaryMemory.begin(), sizeof(header));
+  if (memcmp(header.magic, GenerationBinaryMagic, sizeof(header.magic)) != 0
+      || header.version != GenerationBinaryVersion) {
+    UserMessage::Add(filePath + " is not a binary generation table, or was built by an incompatible version");
+    m_binaryMemory.reset();
+    return false;
+  }
+
+  // the sections must exactly fill the file, and the probing in FindBinaryEntry()
+  // needs a power of two number of buckets with at least one of them empty
+  const uint64_t sectionsSize = m_binaryMemory.size() - sizeof(header);
+  if (header.numBuckets == 0 || (header.numBuckets & (header.numBuckets - 1)) != 0
+      || header.numEntries >= header.numBuckets
+      || header.entriesSize > sectionsSize
+      || header.numBuckets > (sectionsSize - header.entriesSize) / sizeof(GenerationBinaryBucket)
+      || sectionsSize != header.entriesSize + header.numBuckets * sizeof(GenerationBinaryBucket)) {
+    UserMessage::Add(filePath + " is truncated or corrupt");
+    m_binaryMemory.reset();
+    return false;
+  }
+  const char *entries = m_binaryMemory.begin() + sizeof(header);
+  const char *buckets = entries + header.entriesSize;
+  uint64_t numUsedBuckets = 0;
+  for (uint64_t i = 0; i < header.numBuckets; ++i) {
+    GenerationBinaryBucket bucket;
+    memcpy(&bucket, buckets + i * sizeof(bucket), sizeof(bucket));
+    if (bucket.offset == 0) {
+      continue;
+    }
+    ++numUsedBuckets;
+    if (bucket.offset > header.entriesSize) {
+      stringstream strme;
+      strme << filePath << " is corrupt: bucket " << i << " points to offset " << bucket.offset - 1
+            << " outside of the " << header.entriesSize << " bytes of entries" << std::endl;
+      UserMessage::Add(strme.str());
+      m_binaryMemory.reset();
+      return false;
+    }
+  }
+  if (numUsedBuckets != header.numEntries) {
+    stringstream strme;
+    strme << filePath << " is corrupt: header counts " << header.numEntries
+          << " entries, but " << numUsedBuckets << " buckets are used" << std::endl;
+    UserMessage::Add(strme.str());
+    m_binaryMemory.reset();
+    return false;
+  }
+
+  if (header.numScores < GetNumScoreComponents()) {
+    stringstream strme;
+    strme << filePath << ": expected " << GetNumScoreComponents()
+          << " feature values, but found " << header.numScores << std::endl;
+    UserMessage::Add(strme.str());
+    m_binaryMemory.reset();
+    return false;
+  }
+
+  m_filePath = filePath;
+  m_direction = direction;
+  m_numBinaryScores = header.numScores;
+  m_numBinaryEntries = header.numEntries;
+  m_numBinaryBuckets = header.numBuckets;
+  m_binaryEntries = entries;
+  m_binaryEntriesEnd = buckets;
+  m_binaryBuckets = buckets;
+  return true;
+}
+
+namespace
+{
+//! output words and their scores of one input word, in text form
+typedef std::map<std::string, std::vector<float> > OutputEntries;
+
+void WriteGenerationEntry(std::ostream &out, const std::string &input, const OutputEntries &outputs, size_t numScores)
+{
+  WriteBinaryString(out, input);
+  WriteBinary(out, (uint32_t) outputs.size());
+  OutputEntries::const_iterator iterOutput;
+  for (iterOutput = outputs.begin() ; iterOutput != outputs.end() ; ++iterOutput) {
+    WriteBinaryString(out, iterOutput->first);
+    for (size_t i = 0; i < numScores; i++)
+      WriteBinary(out, iterOutput->second[i]);
+  }
+}
+}
+
+bool GenerationDictionary::Create(std::istream &inFile, const std::string &outFilePath)
+{
+  const std::string outFileName = outFilePath + ".bingen";
+  std::ofstream outFile(outFileName.c_str(), std::ios::out | std::ios::binary);
+  if (!outFile.good()) {
+    std::cerr << "Error: couldn't open " << outFileName << " for writing" << std::endl;
+    return false;
+  }
+
+  // the header is rewritten once the sizes are known
+  GenerationBinaryHeader header;
+  memset(&header, 0, sizeof(header));
+  outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  // entries are written as soon as all lines of their input word are read,
+  // only the hash and position of each input word is kept
+  std::vector<std::pair<uint64_t, uint64_t> > positions;
+  uint64_t entriesSize = 0;
+  std::string currInput;
+  OutputEntries currOutputs;
+
+  size_t numScores = 0;
+  string line;
+  size_t lineNum = 0;
+  while(getline(inFile, line)) {
+    ++lineNum;
+    vector<string> token = Tokenize( line );
+    if (token.empty()) {
+      continue;
+    }
+    if (token.size() < 3 || (numScores != 0 && token.size() - 2 != numScores)) {
+      std::cerr << "Error: malformed generation table entry at line " << lineNum << std::endl;
+      return false;
+    }
+    numScores = token.size() - 2;
+
+    if (!currOutputs.empty() && token[0] != currInput) {
+      if (token[0] < currInput) {
+        std::cerr << "Error: generation table is not sorted at line " << lineNum
+                  << ", sort it with LC_ALL=C sort first" << std::endl;
+        return false;
+      }
+      positions.push_back(std::make_pair(HashGenerationKey(currInput), entriesSize));
+      WriteGenerationEntry(outFile, currInput, currOutputs, numScores);
+      entriesSize = (uint64_t) outFile.tellp() - sizeof(header);
+      currOutputs.clear();
+    }
+    currInput = token[0];
+
+    std::vector<float> &scores = currOutputs[token[1]];
+    scores.resize(numScores);
+    for (size_t i = 0; i < numScores; i++)
+      scores[i] = Scan<float>(token[2+i]);
+  }
+  if (!currOutputs.empty()) {
+    positions.push_back(std::make_pair(HashGenerationKey(currInput), entriesSize));
+    WriteGenerationEntry(outFile, currInput, currOutputs, numScores);
+    entriesSize = (uint64_t) outFile.tellp() - sizeof(header);
+  }
+
+  // hash index with a load factor of at most 1/2
+  uint64_t numBuckets = 1;
+  while (numBuckets < 2 * positions.size())
+    numBuckets <<= 1;
+  std::vector<GenerationBinaryBucket> buckets(numBuckets, GenerationBinaryBucket());
+  for (size_t i = 0; i < positions.size(); ++i) {
+    uint64_t bucket = positions[i].first & (numBuckets - 1);
+    while (buckets[bucket].offset != 0)
+      bucket = (bucket + 1) & (numBuckets - 1);
+    buckets[bucket].hash = positions[i].first;
+    buckets[bucket].offset = positions[i].second + 1;
+  }
+  outFile.write(reinterpret_cast<const char*>(&buckets[0]), numBuckets * sizeof(GenerationBinaryBucket));
+
+  memcpy(header.magic, GenerationBinaryMagic, sizeof(header.magic));
+  header.version = GenerationBinaryVersion;
+  header.numScores = numScores;
+  header.numEntries = positions.size();
+  header.numBuckets = numBuckets;
+  header.entriesSize = entriesSize;
+  outFile.seekp(0);
+  outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  outFile.close();
+  if (!outFile) {
+    std::cerr << "Error: couldn't write " << outFileName << std::endl;
+    return false;
+  }
+  return true;
+}
+
 GenerationDictionary::~GenerationDictionary()
 {
   Collection::const_iterator iter;
   for (iter = m_collection.begin() ; iter != m_collection.end() ; ++iter) {
     delete iter->first;
   }
+  for (iter = m_binaryCache.begin() ; iter != m_binaryCache.end() ; ++iter) {
+    delete iter->first;
+  }
 }
 
 size_t GenerationDictionary::GetNumScoreComponents() const
@@ -136,6 +415,10 @@ std::string GenerationDictionary::GetScoreProducerWeightShortName(unsigned) cons
 
 const OutputWordCollection *GenerationDictionary::FindWord(const Word &word) const
 {
+  if (m_binaryMemory.get() != NULL) {
+    return FindBinaryWord(word);
+  }
+
   const OutputWordCollection *ret;
 
   Collection::const_iterator iter = m_collection.find(&word);
@@ -148,6 +431,103 @@ const OutputWordCollection *GenerationDictionary::FindWord(const Word &word) con
   return ret;
 }
 
+const OutputWordCollection *GenerationDictionary::FindBinaryWord(const Word &word) const
+{
+  {
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> read_lock(m_binaryCacheLock);
+#endif
+    Collection::const_iterator iter = m_binaryCache.find(&word);
+    if (iter != m_binaryCache.end()) {
+      return &iter->second;
+    }
+  }
+
+  // look up the input factors in the binary table
+  std::string key;
+  for (size_t i = 0 ; i < GetInput().size() ; i++) {
+    const Factor *factor = word[GetInput()[i]];
+    if (factor == NULL) {
+      return NULL;
+    }
+    if (i > 0) {
+      key += "|";
+    }
+    key += factor->GetString();
+  }
+  const char *entry = FindBinaryEntry(key);
+  if (entry == NULL) {
+    // can't find source word
+    return NULL;
+  }
+
+  // decode the output words
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  const size_t numFeatureValuesInConfig = this->GetNumScoreComponents();
+
+  OutputWordCollection outputWords;
+  const uint32_t numOutputWords = ReadBinary<uint32_t>(entry, m_binaryEntriesEnd, m_filePath);
+  for (uint32_t currOutput = 0 ; currOutput < numOutputWords ; currOutput++) {
+    const uint32_t length = ReadBinary<uint32_t>(entry, m_binaryEntriesEnd, m_filePath);
+    const char *output = SkipBinary(entry, m_binaryEntriesEnd, length, m_filePath);
+    vector<string> factorString = Tokenize( std::string(output, length), "|" );
+
+    Word outputWord;
+    for (size_t i = 0 ; i < GetOutput().size() && i < factorString.size() ; i++) {
+      FactorType factorType = GetOutput()[i];
+      const Factor *factor = factorCollection.AddFactor( m_direction, factorType, factorString[i]);
+      outputWord.SetFactor(factorType, factor);
+    }
+
+    std::vector<float> scores(numFeatureValuesInConfig, 0.0f);
+    for (size_t i = 0; i < m_numBinaryScores; i++) {
+      const float score = ReadBinary<float>(entry, m_binaryEntriesEnd, m_filePath);
+      if (i < numFeatureValuesInConfig)
+        scores[i] = FloorScore(TransformScore(score));
+    }
+    outputWords[outputWord].Assign(this, scores);
+  }
+
+  Word *inputWord = new Word();  // deleted in destructor
+  for (size_t i = 0 ; i < GetInput().size() ; i++) {
+    FactorType factorType = GetInput()[i];
+    inputWord->SetFactor(factorType, word[factorType]);
+  }
+
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_binaryCacheLock);
+#endif
+  std::pair<Collection::iterator, bool> ret = m_binaryCache.insert(std::make_pair(inputWord, outputWords));
+  if (!ret.second) {
+    // another thread got there first
+    delete inputWord;
+  }
+  return &ret.first->second;
+}
+
+/** returns the start of the output words of an input word in the binary table, or NULL */
+const char *GenerationDictionary::FindBinaryEntry(const std::string &key) const
+{
+  // bucket offsets were checked against the entry section in LoadBinary()
+  const uint64_t hash = HashGenerationKey(key);
+  GenerationBinaryBucket bucket;
+  for (uint64_t pos = hash & (m_numBinaryBuckets - 1) ; ; pos = (pos + 1) & (m_numBinaryBuckets - 1)) {
+    memcpy(&bucket, m_binaryBuckets + pos * sizeof(bucket), sizeof(bucket));
+    if (bucket.offset == 0) {
+      return NULL;
+    }
+    if (bucket.hash != hash) {
+      continue;
+    }
+    const char *entry = m_binaryEntries + bucket.offset - 1;
+    const uint32_t length = ReadBinary<uint32_t>(entry, m_binaryEntriesEnd, m_filePath);
+    const char *input = SkipBinary(entry, m_binaryEntriesEnd, length, m_filePath);
+    if (length == key.size() && memcmp(input, key.data(), length) == 0) {
+      return entry;
+    }
+  }
+}
+
 bool GenerationDictionary::ComputeValueInTranslationOption() const
 {
   return true;
@@ -25,6 +25,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <list>
 #include <map>
 #include <vector>
+#include <iostream>
+
+#ifdef WITH_THREADS
+#include <boost/thread/shared_mutex.hpp>
+#endif
+
+#include "util/mmap.hh"
 #include "ScoreComponentCollection.h"
 #include "Phrase.h"
 #include "TypeDef.h"
@@ -41,6 +48,9 @@ typedef std::map < Word , ScoreComponentCollection > OutputWordCollection;
 // 2nd = log probability (score)
 
 /** Implementation of a generation table in a trie.
+ * The table is either read completely from a text file, or memory-mapped from
+ * a binary file created by Create(). In the latter case, entries are decoded
+ * on first use and kept in a cache that is shared between threads.
  */
 class GenerationDictionary : public Dictionary, public DecodeFeature
 {
@@ -51,6 +61,22 @@ protected:
   // 2nd = target
   std::string						m_filePath;
 
+  // binary table, see Create() for the layout
+  util::scoped_memory m_binaryMemory;
+  const char *m_binaryEntries, *m_binaryEntriesEnd;
+  const char *m_binaryBuckets;
+  uint64_t m_numBinaryEntries, m_numBinaryBuckets;
+  size_t m_numBinaryScores;
+  FactorDirection m_direction;
+  mutable Collection m_binaryCache;
+#ifdef WITH_THREADS
+  mutable boost::shared_mutex m_binaryCacheLock;
+#endif
+
+  bool LoadBinary(const std::string &filePath, FactorDirection direction);
+  const OutputWordCollection *FindBinaryWord(const Word &word) const;
+  const char *FindBinaryEntry(const std::string &key) const;
+
 public:
   /** constructor.
   * \param numFeatures number of score components, as specified in ini file
@@ -67,9 +93,15 @@ public:
     return Generate;
   }
 
-  //! load data file
+  //! load data file. A binary table is used instead if filePath.bingen exists
   bool Load(const std::string &filePath, FactorDirection direction);
 
+  /** convert a text generation table to the binary format, written to outFilePath.bingen.
+   * The lines for each input word must be adjacent and in byte order, as
+   * produced by LC_ALL=C sort
+   */
+  static bool Create(std::istream &inFile, const std::string &outFilePath);
+
   size_t GetNumScoreComponents() const;
   std::string GetScoreProducerDescription(unsigned) const;
   std::string GetScoreProducerWeightShortName(unsigned) const;
@@ -78,7 +110,7 @@ public:
   * NOT the number of lines in the generation table
   */
   size_t GetSize() const {
-    return m_collection.size();
+    return (m_binaryMemory.get() == NULL) ? m_collection.size() : m_numBinaryEntries;
   }
   /** returns a bag of output words, OutputWordCollection, for a particular input word.
   *	Or NULL if the input word isn't found. The search function used is the WordComparer functor
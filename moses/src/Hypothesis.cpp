@@ -60,6 +60,7 @@ Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPh
   , m_currTargetWordsRange(0, emptyTarget.GetSize()-1)
   , m_wordDeleted(false)
   , m_ffStates(manager.GetTranslationSystem()->GetStatefulFeatureFunctions().size())
+  , m_recombinationHash(0)
   , m_arcList(NULL)
   , m_transOpt(NULL)
   , m_manager(manager)
@@ -74,6 +75,7 @@ Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPh
   const vector<const StatefulFeatureFunction*>& ffs = m_manager.GetTranslationSystem()->GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i)
     m_ffStates[i] = ffs[i]->EmptyHypothesisState(source);
+  CalcRecombinationHash();
   m_manager.GetSentenceStats().AddCreated();
 }
 
@@ -94,6 +96,7 @@ Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &tran
   ,	m_futureScore(0.0f)
   , m_scoreBreakdown				(prevHypo.m_scoreBreakdown)
   , m_ffStates(prevHypo.m_ffStates.size())
+  , m_recombinationHash(0)
   , m_arcList(NULL)
   , m_transOpt(&transOpt)
   , m_manager(prevHypo.GetManager())
@@ -236,6 +239,12 @@ int Hypothesis::RecombineCompare(const Hypothesis &compare) const
   // -1 = this < compare
   // +1 = this > compare
   // 0	= this ==compare
+
+  // hypotheses that can be recombined have the same signature, so the
+  // full comparison is only needed on a match (or a hash collision)
+  if (m_recombinationHash != compare.m_recombinationHash)
+    return (m_recombinationHash < compare.m_recombinationHash) ? -1 : 1;
+
   int comp = m_sourceCompleted.Compare(compare.m_sourceCompleted);
   if (comp != 0)
     return comp;
@@ -252,16 +261,29 @@ int Hypothesis::RecombineCompare(const Hypothesis &compare) const
   return 0;
 }
 
+/** Combine the coverage and the signatures of all feature states,
+ * to be called once the feature states are final.
+ */
+void Hypothesis::CalcRecombinationHash()
+{
+  m_recombinationHash = m_sourceCompleted.GetHash();
+  for (unsigned i = 0; i < m_ffStates.size(); ++i) {
+    FFState::CombineHash(m_recombinationHash, m_ffStates[i] ? m_ffStates[i]->GetHash() : 0);
+  }
+}
+
 void Hypothesis::ResetScore()
 {
   m_scoreBreakdown.ZeroAll();
   m_futureScore = m_totalScore = 0.0f;
+  m_gapFutureScores.clear();
 }
 
 /***
- * calculate the logarithm of our total translation score (sum up components)
+ * add the scores cached in the translation option and the scores of the
+ * stateless feature functions
  */
-void Hypothesis::CalcScore(const SquareMatrix &futureScore)
+void Hypothesis::EvaluateStateless()
 {
   // some stateless score producers cache their values in the translation
   // option: add these here
@@ -269,9 +291,6 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
   // phrase are also included here
   m_scoreBreakdown.PlusEquals(m_transOpt->GetScoreBreakdown());
 
-  const StaticData &staticData = StaticData::Instance();
-  clock_t t=0; // used to track time
-
   // compute values of stateless feature functions that were not
   // cached in the translation option-- there is no principled distinction
   const vector<const StatelessFeatureFunction*>& sfs =
@@ -279,6 +298,32 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
   for (unsigned i = 0; i < sfs.size(); ++i) {
     sfs[i]->Evaluate(m_targetPhrase, &m_scoreBreakdown);
   }
+}
+
+void Hypothesis::CalcFutureScore(const SquareMatrix &futureScore)
+{
+  // the initial hypothesis has no gap scores, so they can only be
+  // derived from the previous hypothesis' gaps after the first step
+  if (m_prevHypo != NULL && m_prevHypo->m_prevHypo != NULL) {
+    m_futureScore = futureScore.CalcFutureScore( m_prevHypo->m_gapFutureScores
+                    , m_prevHypo->m_sourceCompleted
+                    , m_currSourceWordsRange.GetStartPos()
+                    , m_currSourceWordsRange.GetEndPos()
+                    , &m_gapFutureScores );
+  } else {
+    m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted, m_gapFutureScores );
+  }
+}
+
+/***
+ * calculate the logarithm of our total translation score (sum up components)
+ */
+void Hypothesis::CalcScore(const SquareMatrix &futureScore)
+{
+  const StaticData &staticData = StaticData::Instance();
+  clock_t t=0; // used to track time
+
+  EvaluateStateless();
 
   const vector<const StatefulFeatureFunction*>& ffs =
     m_manager.GetTranslationSystem()->GetStatefulFeatureFunctions();
@@ -293,8 +338,10 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
     t = clock();  // track time excluding LM
   }
 
+  CalcRecombinationHash();
+
   // FUTURE COST
-  m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
+  CalcFutureScore(futureScore);
 
   // TOTAL
   m_totalScore = m_scoreBreakdown.InnerProduct(staticData.GetAllWeights()) + m_futureScore;
@@ -304,31 +351,44 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
   }
 }
 
-/** Calculates the expected score of extending this hypothesis with the
- * specified translation option. Includes actual costs for everything
- * except for expensive actual language model score.
- * This function is used by early discarding.
- * /param transOpt - translation option being considered
+/** Calculates an optimistic score for this hypothesis without running the
+ * expensive stateful feature functions. Features that can bound their score
+ * (see StatefulFeatureFunction::EvaluateUpperBound) contribute their bound
+ * and are left unevaluated, all others are scored in full.
+ * This function is used by search-lazy-scoring; if the hypothesis is kept,
+ * CalcRemainingScore() must be called to complete the scoring.
+ * \return upper bound on the total score of this hypothesis
  */
 float Hypothesis::CalcExpectedScore( const SquareMatrix &futureScore )
 {
   const StaticData &staticData = StaticData::Instance();
   clock_t t=0;
   IFVERBOSE(2) {
-    t = clock();  // track time excluding LM
+    t = clock();
   }
 
-  CHECK(!"Need to add code to get the distortion scores");
-  //CalcDistortionScore();
+  EvaluateStateless();
 
-  // LANGUAGE MODEL ESTIMATE (includes word penalty cost)
-  float estimatedLMScore = m_transOpt->GetFutureScore() - m_transOpt->GetScoreBreakdown().InnerProduct(staticData.GetAllWeights());
+  float bound = 0.0f;
+  const vector<const StatefulFeatureFunction*>& ffs =
+    m_manager.GetTranslationSystem()->GetStatefulFeatureFunctions();
+  m_boundedFeatures.assign(ffs.size(), false);
+  for (unsigned i = 0; i < ffs.size(); ++i) {
+    const FFState *prevState = m_prevHypo ? m_prevHypo->m_ffStates[i] : NULL;
+    float ffBound;
+    if (ffs[i]->EvaluateUpperBound(*this, prevState, ffBound)) {
+      bound += ffBound;
+      m_boundedFeatures[i] = true;
+    } else {
+      m_ffStates[i] = ffs[i]->Evaluate(*this, prevState, &m_scoreBreakdown);
+    }
+  }
 
   // FUTURE COST
-  m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
+  CalcFutureScore(futureScore);
 
   // TOTAL
-  float total = m_scoreBreakdown.InnerProduct(staticData.GetAllWeights()) + m_futureScore + estimatedLMScore;
+  float total = m_scoreBreakdown.InnerProduct(staticData.GetAllWeights()) + m_futureScore + bound;
 
   IFVERBOSE(2) {
     m_manager.GetSentenceStats().AddTimeEstimateScore( clock()-t );
@@ -336,23 +396,29 @@ float Hypothesis::CalcExpectedScore( const SquareMatrix &futureScore )
   return total;
 }
 
+/** Evaluates the stateful feature functions skipped by CalcExpectedScore()
+ * and computes the final score.
+ */
 void Hypothesis::CalcRemainingScore()
 {
   const StaticData &staticData = StaticData::Instance();
   clock_t t=0; // used to track time
 
-  // LANGUAGE MODEL COST
-  CHECK(!"Need to add code to get the LM score(s)");
-  //CalcLMScore(staticData.GetAllLM());
+  const vector<const StatefulFeatureFunction*>& ffs =
+    m_manager.GetTranslationSystem()->GetStatefulFeatureFunctions();
+  for (unsigned i = 0; i < ffs.size(); ++i) {
+    if (m_boundedFeatures[i]) {
+      const FFState *prevState = m_prevHypo ? m_prevHypo->m_ffStates[i] : NULL;
+      m_ffStates[i] = ffs[i]->Evaluate(*this, prevState, &m_scoreBreakdown);
+    }
+  }
+  m_boundedFeatures.clear();
+  CalcRecombinationHash();
 
   IFVERBOSE(2) {
     t = clock();  // track time excluding LM
   }
 
-  // WORD PENALTY
-  m_scoreBreakdown.PlusEquals(m_manager.GetTranslationSystem()->GetWordPenaltyProducer()
-                              , - (float)m_currTargetWordsRange.GetNumWordsCovered());
-
   // TOTAL
   m_totalScore = m_scoreBreakdown.InnerProduct(staticData.GetAllWeights()) + m_futureScore;
 
@@ -392,6 +458,7 @@ void Hypothesis::PrintHypothesis() const
   TRACE_ERR( "\tbase score "<< (m_prevHypo->m_totalScore - m_prevHypo->m_futureScore) <<endl);
   TRACE_ERR( "\tcovering "<<m_currSourceWordsRange.GetStartPos()<<"-"<<m_currSourceWordsRange.GetEndPos()<<": "
              << *m_sourcePhrase <<endl);
+  TRACE_ERR( "\tcoverage "<< m_sourceCompleted <<endl);
   TRACE_ERR( "\ttranslated as: "<<(Phrase&) m_targetPhrase<<endl); // <<" => translation cost "<<m_score[ScoreType::PhraseTrans];
 
   if (m_wordDeleted) TRACE_ERR( "\tword deleted"<<endl);
@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "ScoreComponentCollection.h"
 #include "InputType.h"
 #include "ObjectPool.h"
+#include "SquareMatrix.h"
 
 namespace Moses
 {
@@ -78,8 +79,11 @@ protected:
   bool							m_wordDeleted;
   float							m_totalScore;  /*! score so far */
   float							m_futureScore; /*! estimated future cost to translate rest of sentence */
+  GapFutureScores		m_gapFutureScores; /*! future cost of each untranslated gap, summing to m_futureScore */
   ScoreComponentCollection m_scoreBreakdown; /*! detailed score break-down by components (for instance language model, word penalty, etc) */
   std::vector<const FFState*> m_ffStates;
+  std::vector<bool> m_boundedFeatures; /*! stateful features only bounded by CalcExpectedScore(), left for CalcRemainingScore() */
+  uint64_t m_recombinationHash; /*! signature of coverage and feature states, see RecombineCompare() */
   const Hypothesis 	*m_winningHypo;
   ArcList 					*m_arcList; /*! all arcs that end at the same trellis point as this hypothesis */
   const TranslationOption *m_transOpt;
@@ -87,6 +91,10 @@ protected:
 
   int m_id; /*! numeric ID of this hypothesis, used for logging */
 
+  void EvaluateStateless();
+  void CalcFutureScore(const SquareMatrix &futureScore);
+  void CalcRecombinationHash();
+
   /*! used by initial seeding of the translation process */
   Hypothesis(Manager& manager, InputType const& source, const TargetPhrase &emptyTarget);
   /*! used when creating a new hypothesis using a translation option (phrase translation) */
@@ -236,6 +244,12 @@ public:
   float GetScore() const {
     return m_totalScore-m_futureScore;
   }
+  float GetFutureScore() const {
+    return m_futureScore;
+  }
+  const GapFutureScores &GetGapFutureScores() const {
+    return m_gapFutureScores;
+  }
 
 
 
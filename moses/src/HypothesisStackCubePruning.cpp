@@ -140,7 +140,28 @@ void HypothesisStackCubePruning::AddInitial(Hypothesis *hypo)
   CHECK(addRet.second);
 
   const WordsBitmap &bitmap = hypo->GetWordsBitmap();
-  m_bitmapAccessor[bitmap] = new BitmapContainer(bitmap, *this);
+  AddBitmapContainer(bitmap, *this);
+}
+
+namespace
+{
+struct BitmapContainerCoverageOrderer {
+  bool operator()(const BitmapContainer *container, const WordsBitmap &bitmap) const {
+    return container->GetWordsBitmap() < bitmap;
+  }
+};
+}
+
+BitmapContainer *HypothesisStackCubePruning::AddBitmapContainer(const WordsBitmap &bitmap, HypothesisStackCubePruning &stack)
+{
+  BitmapContainer *bmContainer = new BitmapContainer(bitmap, stack);
+  m_bitmapAccessor[bitmap] = bmContainer;
+  _BMSortedType::iterator pos = std::lower_bound(m_sortedBitmapContainers.begin()
+                                , m_sortedBitmapContainers.end()
+                                , bitmap
+                                , BitmapContainerCoverageOrderer());
+  m_sortedBitmapContainers.insert(pos, bmContainer);
+  return bmContainer;
 }
 
 void HypothesisStackCubePruning::PruneToSize(size_t newSize)
@@ -242,14 +263,14 @@ void HypothesisStackCubePruning::SetBitmapAccessor(const WordsBitmap &newBitmap
     , const WordsRange &/*range*/
     , BitmapContainer &bitmapContainer
     , const SquareMatrix &futureScore
-    , const TranslationOptionList &transOptList)
+    , const TranslationOptionList &transOptList
+    , size_t transOptLimit)
 {
   _BMType::iterator bcExists = m_bitmapAccessor.find(newBitmap);
 
   BitmapContainer *bmContainer;
   if (bcExists == m_bitmapAccessor.end()) {
-    bmContainer = new BitmapContainer(newBitmap, stack);
-    m_bitmapAccessor[newBitmap] = bmContainer;
+    bmContainer = AddBitmapContainer(newBitmap, stack);
   } else {
     bmContainer = bcExists->second;
   }
@@ -257,6 +278,7 @@ void HypothesisStackCubePruning::SetBitmapAccessor(const WordsBitmap &newBitmap
   BackwardsEdge *edge = new BackwardsEdge(bitmapContainer
                                           , *bmContainer
                                           , transOptList
+                                          , transOptLimit
                                           , futureScore,
                                           m_manager.GetSource(),
                                           m_manager.GetTranslationSystem());
@@ -293,4 +315,3 @@ HypothesisStackCubePruning::AddHypothesesToBitmapContainers()
 }
 
 }
-
@@ -23,8 +23,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_HypothesisStackCubePruning_h
 
 #include <limits>
-#include <map>
 #include <set>
+#include <vector>
+#include <boost/unordered_map.hpp>
 #include "Hypothesis.h"
 #include "BitmapContainer.h"
 #include "HypothesisStack.h"
@@ -36,7 +37,8 @@ class BitmapContainer;
 class TranslationOptionList;
 class Manager;
 
-typedef std::map<WordsBitmap, BitmapContainer*> _BMType;
+typedef boost::unordered_map<WordsBitmap, BitmapContainer*> _BMType;
+typedef std::vector<BitmapContainer*> _BMSortedType;
 
 /** Stack for instances of Hypothesis, includes functions for pruning. */
 class HypothesisStackCubePruning : public HypothesisStack
@@ -46,6 +48,7 @@ public:
 
 protected:
   _BMType m_bitmapAccessor;
+  _BMSortedType m_sortedBitmapContainers; /**< the containers of m_bitmapAccessor in coverage order */
 
   float m_bestScore; /**< score of the best hypothesis in collection */
   float m_worstScore; /**< score of the worse hypthesis in collection */
@@ -61,11 +64,15 @@ protected:
   /** destroy all instances of Hypothesis in this collection */
   void RemoveAll();
 
+  /** create the container of a new coverage, keeping the coverage order */
+  BitmapContainer *AddBitmapContainer(const WordsBitmap &bitmap, HypothesisStackCubePruning &stack);
+
 public:
   HypothesisStackCubePruning(Manager& manager);
   ~HypothesisStackCubePruning() {
     RemoveAll();
     m_bitmapAccessor.clear();
+    m_sortedBitmapContainers.clear();
   }
 
   /** adds the hypo, but only if within thresholds (beamThr, stackSize).
@@ -115,12 +122,19 @@ public:
     return m_bitmapAccessor;
   }
 
+  /** bitmap containers ordered by coverage bitmap, so that the search
+   * does not depend on the hash order */
+  const _BMSortedType& GetSortedBitmapContainers() const {
+    return m_sortedBitmapContainers;
+  }
+
   void SetBitmapAccessor(const WordsBitmap &newBitmap
                          , HypothesisStackCubePruning &stack
                          , const WordsRange &range
                          , BitmapContainer &bitmapContainer
                          , const SquareMatrix &futureScore
-                         , const TranslationOptionList &transOptList);
+                         , const TranslationOptionList &transOptList
+                         , size_t transOptLimit);
 
   /** pruning, if too large.
    * Pruning algorithm: find a threshold and delete all hypothesis below it.
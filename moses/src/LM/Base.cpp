@@ -57,6 +57,18 @@ float LanguageModel::GetWeight() const {
   return StaticData::Instance().GetAllWeights()[lmIndex];
 }
 
+/* Evaluate() only adds the log probabilities of the words whose context
+ * reaches outside the target phrase (OOVs are counted in the translation
+ * option), so with non-negative weights the score it adds is at most 0.
+ */
+bool LanguageModel::EvaluateUpperBound(const Hypothesis& /* cur_hypo */,
+                                       const FFState* /* prev_state */,
+                                       float &bound) const {
+  if (!HasNonNegativeWeights()) return false;
+  bound = 0;
+  return true;
+}
+
 float LanguageModel::GetOOVWeight() const {
   if (!m_enableOOVFeature) return 0;
   size_t lmIndex = StaticData::Instance().GetScoreIndexManager().
@@ -70,6 +70,9 @@ public:
 
   virtual const FFState* EmptyHypothesisState(const InputType &input) const = 0;
 
+  //! see FeatureFunction.h
+  bool EvaluateUpperBound(const Hypothesis& cur_hypo, const FFState* prev_state, float &bound) const;
+
   /* whether this LM can be used on a particular phrase.
    * Should return false if phrase size = 0 or factor types required don't exists
    */
@@ -57,10 +57,10 @@ LMResult LanguageModelDMapLM::GetValueGivenState(
   DMapLMState& cast_state = static_cast<DMapLMState&>(state);
   LMResult result;
   size_t succeeding_order;
-  size_t target_order = std::min((size_t)cast_state.m_last_succeeding_order + 1,
+  size_t target_order = std::min((size_t)cast_state.GetLastSucceedingOrder() + 1,
                                  GetNGramOrder());
   result.score = GetValue(contextFactor, target_order, &succeeding_order);
-  cast_state.m_last_succeeding_order = succeeding_order;
+  cast_state.SetLastSucceedingOrder(succeeding_order);
   return result;
 }
 
@@ -73,7 +73,7 @@ LMResult LanguageModelDMapLM::GetValueForgotState(
   size_t succeeding_order;
   size_t target_order = GetNGramOrder();
   result.score = GetValue(contextFactor, target_order, &succeeding_order);
-  cast_state.m_last_succeeding_order = succeeding_order;
+  cast_state.SetLastSucceedingOrder(succeeding_order);
   return result;
 }
 
@@ -99,26 +99,26 @@ float LanguageModelDMapLM::GetValue(
 
 const FFState* LanguageModelDMapLM::GetNullContextState() const {
     DMapLMState* state = new DMapLMState();
-    state->m_last_succeeding_order = GetNGramOrder();
+    state->SetLastSucceedingOrder(GetNGramOrder());
     return state;
 }
 
 FFState* LanguageModelDMapLM::GetNewSentenceState() const {
     DMapLMState* state = new DMapLMState();
-    state->m_last_succeeding_order = GetNGramOrder();
+    state->SetLastSucceedingOrder(GetNGramOrder());
     return state;
 }
 
 const FFState* LanguageModelDMapLM::GetBeginSentenceState() const {
     DMapLMState* state = new DMapLMState();
-    state->m_last_succeeding_order = GetNGramOrder();
+    state->SetLastSucceedingOrder(GetNGramOrder());
     return state;
 }
 
 FFState* LanguageModelDMapLM::NewState(const FFState* state) const {
     DMapLMState* new_state = new DMapLMState();
     const DMapLMState* cast_state = static_cast<const DMapLMState*>(state);
-    new_state->m_last_succeeding_order = cast_state->m_last_succeeding_order;
+    new_state->SetLastSucceedingOrder(cast_state->GetLastSucceedingOrder());
     return new_state;
 }
 
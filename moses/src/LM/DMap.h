@@ -25,6 +25,14 @@ public:
         else
             return 0;
     }
+    uint8_t GetLastSucceedingOrder() const {
+        return m_last_succeeding_order;
+    }
+    void SetLastSucceedingOrder(uint8_t order) {
+        m_last_succeeding_order = order;
+        m_hash = order;
+    }
+private:
     uint8_t m_last_succeeding_order;
 };
 
@@ -332,6 +332,18 @@ public:
   void Set(float prefixScore, FFState *rightState) {
     m_prefixScore = prefixScore;
     m_lmRightContext = rightState;
+
+    // signature over the parts that Compare() looks at. Words are compared
+    // factor by factor skipping missing factors, so only the prefix length
+    // is hashed and the words themselves are left to Compare()
+    m_hash = 0;
+    if (m_hypo.GetCurrSourceRange().GetStartPos() > 0) {
+      m_hash = m_contextPrefix.GetSize();
+    }
+    size_t inputSize = m_hypo.GetManager().GetSource().GetSize();
+    if (m_lmRightContext && m_hypo.GetCurrSourceRange().GetEndPos() < inputSize - 1) {
+      CombineHash(m_hash, m_lmRightContext->GetHash());
+    }
   }
 
   float GetPrefixScore() const { return m_prefixScore; }
@@ -48,6 +48,10 @@ namespace {
 
 struct KenLMState : public FFState {
   lm::ngram::State state;
+  //! to be called once state is final
+  void ComputeHash() {
+    m_hash = hash_value(state);
+  }
   int Compare(const FFState &o) const {
     const KenLMState &other = static_cast<const KenLMState &>(o);
     if (state.length < other.state.length) return -1;
@@ -78,6 +82,7 @@ template <class Model> class LanguageModelKen : public LanguageModel {
     const FFState *EmptyHypothesisState(const InputType &/*input*/) const {
       KenLMState *ret = new KenLMState();
       ret->state = m_ngram->BeginSentenceState();
+      ret->ComputeHash();
       return ret;
     }
 
@@ -217,6 +222,7 @@ template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothes
   
   if (!hypo.GetCurrTargetLength()) {
     ret->state = in_state;
+    ret->ComputeHash();
     return ret.release();
   }
 
@@ -250,6 +256,7 @@ template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothes
     // Short enough phrase that we can just reuse the state.  
     ret->state = *state0;
   }
+  ret->ComputeHash();
 
   score = TransformLMScore(score);
 
@@ -272,6 +279,9 @@ class LanguageModelChartStateKenLM : public FFState {
     const lm::ngram::ChartState &GetChartState() const { return m_state; }
     lm::ngram::ChartState &GetChartState() { return m_state; }
 
+    //! to be called once the rule has been scored
+    void ComputeHash() { m_hash = hash_value(m_state); }
+
     int Compare(const FFState& o) const
     {
       const LanguageModelChartStateKenLM &other = static_cast<const LanguageModelChartStateKenLM&>(o);
@@ -318,6 +328,7 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateChart(const Cha
   }
 
   accumulator->Assign(this, ruleScore.Finish());
+  newState->ComputeHash();
   return newState;
 }
 
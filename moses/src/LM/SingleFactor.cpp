@@ -51,6 +51,11 @@ struct PointerState : public FFState {
   const void* lmstate;
   PointerState(const void* lms) {
     lmstate = lms;
+    UpdateHash();
+  }
+  //! to be called whenever lmstate changes
+  void UpdateHash() {
+    m_hash = reinterpret_cast<uintptr_t>(lmstate);
   }
   int Compare(const FFState& o) const {
     const PointerState& other = static_cast<const PointerState&>(o);
@@ -85,7 +90,10 @@ FFState *LanguageModelPointerState::NewState(const FFState *from) const
 
 LMResult LanguageModelPointerState::GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState &outState) const
 {
-  return GetValue(contextFactor, &static_cast<PointerState&>(outState).lmstate);
+  PointerState &state = static_cast<PointerState&>(outState);
+  LMResult ret = GetValue(contextFactor, &state.lmstate);
+  state.UpdateHash();
+  return ret;
 }
 
 }
@@ -0,0 +1,88 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2012 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "LatencyBudget.h"
+
+#include <sys/time.h>
+
+namespace Moses
+{
+
+namespace
+{
+double GetWallClockMilliseconds()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+}
+
+LatencyBudget::LatencyBudget()
+  : m_budget(0)
+  , m_start(GetWallClockMilliseconds())
+  , m_degraded(false)
+  , m_expired(false)
+{
+}
+
+void LatencyBudget::Start()
+{
+  m_start = GetWallClockMilliseconds();
+  m_degraded = false;
+  m_expired = false;
+}
+
+double LatencyBudget::GetElapsed() const
+{
+  return GetWallClockMilliseconds() - m_start;
+}
+
+size_t LatencyBudget::Limit(size_t limit, float progress)
+{
+  if (!IsLimited() || limit <= 1) {
+    return limit;
+  }
+
+  const double usedTime = GetElapsed() / m_budget;
+  if (usedTime >= 1.0) {
+    m_expired = true;
+    m_degraded = true;
+    return 1;
+  }
+
+  // on schedule if the fraction of time left is at least the fraction of
+  // work left; otherwise scale down by how far behind we are
+  const double remainingWork = 1.0 - progress;
+  const double remainingTime = 1.0 - usedTime;
+  if (remainingWork <= 0.0 || remainingTime >= remainingWork) {
+    return limit;
+  }
+
+  size_t ret = static_cast<size_t>(limit * (remainingTime / remainingWork));
+  if (ret < 1) {
+    ret = 1;
+  }
+  if (ret < limit) {
+    m_degraded = true;
+  }
+  return ret;
+}
+
+}
@@ -0,0 +1,80 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2012 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+namespace Moses
+{
+
+/** Wall-clock time budget for translating a single sentence.
+ *
+ * The search algorithms report how far they have got through the sentence
+ * and ask the budget to scale their pruning limits (stack size, cube pruning
+ * pop limit, number of translation options per span).  While the search is
+ * on schedule the limits are returned unchanged.  When it falls behind they
+ * are shrunk in proportion to the remaining time, and once the budget has
+ * run out they drop to 1, so that the search still finishes quickly with a
+ * complete translation instead of being cut off.
+ */
+class LatencyBudget
+{
+public:
+  LatencyBudget();
+
+  //! set the budget in milliseconds, 0 means no limit
+  void SetBudget(size_t milliseconds) {
+    m_budget = milliseconds;
+  }
+  size_t GetBudget() const {
+    return m_budget;
+  }
+  bool IsLimited() const {
+    return m_budget > 0;
+  }
+
+  //! start the clock (also resets the degradation flags)
+  void Start();
+
+  //! milliseconds since Start()
+  double GetElapsed() const;
+
+  /** Return the limit to use in place of limit, given that a fraction
+   *  progress (0-1) of the search has been completed. Never returns
+   *  less than 1 unless limit itself is 0. */
+  size_t Limit(size_t limit, float progress);
+
+  //! whether any limit had to be reduced to stay within the budget
+  bool WasDegraded() const {
+    return m_degraded;
+  }
+  //! whether the budget ran out before the search finished
+  bool HasExpired() const {
+    return m_expired;
+  }
+
+private:
+  size_t m_budget; /**< in milliseconds, 0 = no limit */
+  double m_start; /**< wall-clock time at Start(), in milliseconds */
+  bool m_degraded;
+  bool m_expired;
+};
+
+}
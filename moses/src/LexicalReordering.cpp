@@ -90,5 +90,19 @@ const FFState* LexicalReordering::EmptyHypothesisState(const InputType &input) c
   return m_configuration.CreateLexicalReorderingState(input);
 }
 
+/** Reordering scores are log probabilities (or 0 if the phrase pair has no
+ * entry), so with non-negative weights the score is at most 0.
+ */
+bool LexicalReordering::EvaluateUpperBound(const Hypothesis& /* cur_hypo */,
+                                           const FFState* /* prev_state */,
+                                           float &bound) const
+{
+  if (!HasNonNegativeWeights()) {
+    return false;
+  }
+  bound = 0;
+  return true;
+}
+
 }
 
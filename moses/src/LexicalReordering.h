@@ -49,6 +49,10 @@ public:
 
   virtual const FFState* EmptyHypothesisState(const InputType &input) const;
 
+  virtual bool EvaluateUpperBound(const Hypothesis& cur_hypo,
+                                  const FFState* prev_state,
+                                  float &bound) const;
+
   virtual std::string GetScoreProducerDescription(unsigned) const {
     return "LexicalReordering_" + m_modelTypeString;
   }
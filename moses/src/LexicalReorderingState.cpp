@@ -1,6 +1,7 @@
 
 #include <vector>
 #include <string>
+#include <boost/functional/hash.hpp>
 #include "util/check.hh"
 
 #include "FFState.h"
@@ -168,13 +169,45 @@ int LexicalReorderingState::ComparePrevScores(const Scores *other) const
   return 0;
 }
 
+uint64_t LexicalReorderingState::HashPrevScores() const
+{
+  // The pointers are NULL if a phrase pair isn't found in the reordering table.
+  if (m_prevScore == NULL)
+    return 0;
+
+  uint64_t seed = 1;
+  const Scores &my = *m_prevScore;
+  for(size_t i = m_offset; i < m_offset + m_configuration.GetNumberOfTypes(); i++)
+    CombineHash(seed, boost::hash_value(my[i]));
+  return seed;
+}
+
+uint64_t LexicalReorderingState::HashRange(const WordsRange &range)
+{
+  uint64_t seed = range.GetStartPos();
+  CombineHash(seed, range.GetEndPos());
+  return seed;
+}
+
 PhraseBasedReorderingState::PhraseBasedReorderingState(const PhraseBasedReorderingState *prev, const TranslationOption &topt)
-  : LexicalReorderingState(prev, topt), m_prevRange(topt.GetSourceWordsRange()), m_first(false) {}
+  : LexicalReorderingState(prev, topt), m_prevRange(topt.GetSourceWordsRange()), m_first(false)
+{
+  m_hash = HashRange(m_prevRange);
+  if (m_direction == LexicalReorderingConfiguration::Forward) {
+    CombineHash(m_hash, HashPrevScores());
+  }
+}
 
 
 PhraseBasedReorderingState::PhraseBasedReorderingState(const LexicalReorderingConfiguration &config,
     LexicalReorderingConfiguration::Direction dir, size_t offset)
-  : LexicalReorderingState(config, dir, offset), m_prevRange(NOT_FOUND,NOT_FOUND), m_first(true) {}
+  : LexicalReorderingState(config, dir, offset), m_prevRange(NOT_FOUND,NOT_FOUND), m_first(true)
+{
+  m_hash = HashRange(m_prevRange);
+  if (m_direction == LexicalReorderingConfiguration::Forward) {
+    CombineHash(m_hash, HashPrevScores());
+  }
+}
 
 
 int PhraseBasedReorderingState::Compare(const FFState& o) const
@@ -308,7 +341,10 @@ HierarchicalReorderingBackwardState::HierarchicalReorderingBackwardState(const H
   : LexicalReorderingState(prev, topt),  m_reoStack(reoStack) {}
 
 HierarchicalReorderingBackwardState::HierarchicalReorderingBackwardState(const LexicalReorderingConfiguration &config, size_t offset)
-  : LexicalReorderingState(config, LexicalReorderingConfiguration::Backward, offset) {}
+  : LexicalReorderingState(config, LexicalReorderingConfiguration::Backward, offset)
+{
+  m_hash = m_reoStack.GetHash();
+}
 
 
 int HierarchicalReorderingBackwardState::Compare(const FFState& o) const
@@ -325,6 +361,7 @@ LexicalReorderingState* HierarchicalReorderingBackwardState::Expand(const Transl
   const LexicalReorderingConfiguration::ModelType modelType = m_configuration.GetModelType();
 
   int reoDistance = nextState->m_reoStack.ShiftReduce(topt.GetSourceWordsRange());
+  nextState->m_hash = nextState->m_reoStack.GetHash();
 
   if (modelType == LexicalReorderingConfiguration::MSD) {
     reoType = GetOrientationTypeMSD(reoDistance);
@@ -385,13 +422,19 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingBackwardState::GetO
 //HierarchicalReorderingForwardState
 
 HierarchicalReorderingForwardState::HierarchicalReorderingForwardState(const LexicalReorderingConfiguration &config, size_t size, size_t offset)
-  : LexicalReorderingState(config, LexicalReorderingConfiguration::Forward, offset), m_first(true), m_prevRange(NOT_FOUND,NOT_FOUND), m_coverage(size) {}
+  : LexicalReorderingState(config, LexicalReorderingConfiguration::Forward, offset), m_first(true), m_prevRange(NOT_FOUND,NOT_FOUND), m_coverage(size)
+{
+  m_hash = HashRange(m_prevRange);
+  CombineHash(m_hash, HashPrevScores());
+}
 
 HierarchicalReorderingForwardState::HierarchicalReorderingForwardState(const HierarchicalReorderingForwardState *prev, const TranslationOption &topt)
   : LexicalReorderingState(prev, topt), m_first(false), m_prevRange(topt.GetSourceWordsRange()), m_coverage(prev->m_coverage)
 {
   const WordsRange currWordsRange = topt.GetSourceWordsRange();
   m_coverage.SetValue(currWordsRange.GetStartPos(), currWordsRange.GetEndPos(), true);
+  m_hash = HashRange(m_prevRange);
+  CombineHash(m_hash, HashPrevScores());
 }
 
 int HierarchicalReorderingForwardState::Compare(const FFState& o) const
@@ -449,7 +492,7 @@ LexicalReorderingState* HierarchicalReorderingForwardState::Expand(const Transla
   return new HierarchicalReorderingForwardState(this, topt);
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSD(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSD(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -461,7 +504,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return D;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSLR(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSLR(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -475,7 +518,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return DL;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMonotonic(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMonotonic(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -484,7 +527,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return NM;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeLeftRight(WordsRange currRange, WordsBitmap /* coverage */) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeLeftRight(WordsRange currRange, const WordsBitmap &/* coverage */) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos()) {
     return R;
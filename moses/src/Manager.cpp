@@ -28,12 +28,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <queue>
+#include <boost/unordered_set.hpp>
 #include "Manager.h"
 #include "TypeDef.h"
 #include "Util.h"
 #include "TargetPhrase.h"
 #include "TrellisPath.h"
 #include "TrellisPathCollection.h"
+#include "TrellisDetour.h"
 #include "TranslationOption.h"
 #include "LexicalReordering.h"
 #include "LMList.h"
@@ -43,6 +46,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "config.h"
 #endif
 #ifdef HAVE_PROTOBUF
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/wire_format_lite.h>
 #include "hypergraph.pb.h"
 #include "rule.pb.h"
 #endif
@@ -61,6 +67,7 @@ Manager::Manager(InputType const& source, SearchAlgorithm searchAlgorithm, const
   ,m_source(source)
 {
   m_system->InitializeBeforeSentenceProcessing(source);
+  m_latencyBudget.SetBudget(StaticData::Instance().GetLatencyBudget());
 }
 
 Manager::~Manager()
@@ -85,6 +92,7 @@ void Manager::ProcessSentence()
 {
   // reset statistics
   ResetSentenceStats(m_source);
+  m_latencyBudget.Start();
 
   // collect translation options for this sentence
   m_system->InitializeBeforeSentenceProcessing(m_source);
@@ -101,6 +109,17 @@ void Manager::ProcessSentence()
 
   // search for best translation with the specified algorithm
   m_search->ProcessSentence();
+  if (m_latencyBudget.WasDegraded()) {
+    VERBOSE(1, "Pruning was tightened to meet the latency budget of " << m_latencyBudget.GetBudget() << " ms"
+            << (m_latencyBudget.HasExpired() ? " (budget exceeded)" : "") << endl);
+
+    // the tightened limits may have pruned away every complete translation,
+    // in which case complete the best partial one in a single left-to-right pass
+    if (m_search->GetBestHypothesis() == NULL) {
+      VERBOSE(1, "No complete translation was found, completing the best partial translation monotonically" << endl);
+      m_search->CompleteMonotonically(*m_transOptColl);
+    }
+  }
   VERBOSE(1, "Search took " << ((clock()-m_start)/(float)CLOCKS_PER_SEC) << " seconds" << endl);
 }
 
@@ -194,8 +213,10 @@ void Manager::printThisHypothesis(long translationId, const Hypothesis* hypo, co
 /**
  * After decoding, the hypotheses in the stacks and additional arcs
  * form a search graph that can be mined for n-best lists.
- * The heavy lifting is done in the TrellisPath and TrellisPathCollection
- * this function controls this for one sentence.
+ * Paths are enumerated lazily, best first: a priority queue holds
+ * TrellisDetour objects, each a single deviation from an already
+ * extracted path. Arcs are sorted by score, so only the best deviation
+ * at each edge is queued and its next sibling follows once it is popped.
  *
  * \param count the number of n-best translations to produce
  * \param ret holds the n-best list that was calculated
@@ -212,50 +233,73 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct) co
   if (sortedPureHypo.size() == 0)
     return;
 
-  TrellisPathCollection contenders;
+  priority_queue<TrellisDetour> contenders;
+  SortedArcCache sortedArcs;
 
-  set<Phrase> distinctHyps;
+  // paths that were popped but not returned. Queued detours may still refer to them
+  vector<TrellisPath*> discarded;
 
-  // add all pure paths
-  vector<const Hypothesis*>::const_iterator iterBestHypo;
-  for (iterBestHypo = sortedPureHypo.begin()
-                      ; iterBestHypo != sortedPureHypo.end()
-       ; ++iterBestHypo) {
-    contenders.Add(new TrellisPath(*iterBestHypo));
-  }
+  boost::unordered_set<vector<const Factor*> > distinctHyps;
+  vector<const Factor*> surfaceFactors;
+
+  // pure paths are queued one at a time, in score order
+  contenders.push(TrellisDetour(NULL, 0, sortedPureHypo, 0));
 
   // factor defines stopping point for distinct n-best list if too many candidates identical
   size_t nBestFactor = StaticData::Instance().GetNBestFactor();
   if (nBestFactor < 1) nBestFactor = 1000; // 0 = unlimited
 
   // MAIN loop
-  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
+  for (size_t iteration = 0 ; ret.GetSize() < count && !contenders.empty() && (iteration < count * nBestFactor) ; iteration++) {
     // get next best from list of contenders
-    TrellisPath *path = contenders.pop();
-    CHECK(path);
+    const TrellisDetour detour = contenders.top();
+    contenders.pop();
+    if (detour.HasNextSibling()) {
+      contenders.push(detour.GetNextSibling());
+    }
+
+    TrellisPath *path = detour.CreatePath();
+
     // create deviations from current best
-    path->CreateDeviantPaths(contenders);
+    const vector<const Hypothesis*> &edges = path->GetEdges();
+    const size_t firstEdge = (path->m_prevEdgeChanged == NOT_FOUND) ? 0 : path->m_prevEdgeChanged + 1;
+    for (size_t currEdge = firstEdge ; currEdge < edges.size() ; currEdge++) {
+      const vector<const Hypothesis*> *arcs = GetSortedArcs(*edges[currEdge], sortedArcs);
+      if (arcs) {
+        contenders.push(TrellisDetour(path, currEdge, *arcs, 0));
+      }
+    }
+
     if(onlyDistinct) {
-      Phrase tgtPhrase = path->GetSurfacePhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
+      path->GetSurfaceFactors(surfaceFactors);
+      if (distinctHyps.insert(surfaceFactors).second) {
         ret.Add(path);
       } else {
-        delete path;
-        path = NULL;
+        discarded.push_back(path);
       }
     } else {
       ret.Add(path);
     }
+  }
 
+  RemoveAllInColl(discarded);
+}
 
-    if(onlyDistinct) {
-      const size_t nBestFactor = StaticData::Instance().GetNBestFactor();
-      if (nBestFactor > 0)
-        contenders.Prune(count * nBestFactor);
-    } else {
-      contenders.Prune(count);
-    }
+/** arcs of hypo, best first. Sorted once per sentence and kept in cache.
+ *  Returns NULL if hypo has no arcs
+ */
+const vector<const Hypothesis*> *Manager::GetSortedArcs(const Hypothesis &hypo, SortedArcCache &cache) const
+{
+  const ArcList *arcList = hypo.GetArcList();
+  if (arcList == NULL || arcList->empty())
+    return NULL;
+
+  SortedArcCache::iterator iter = cache.find(&hypo);
+  if (iter == cache.end()) {
+    iter = cache.insert(make_pair(&hypo, vector<const Hypothesis*>(arcList->begin(), arcList->end()))).first;
+    sort(iter->second.begin(), iter->second.end(), CompareHypothesisTotalScore());
   }
+  return &iter->second;
 }
 
 struct SGNReverseCompare {
@@ -545,17 +589,17 @@ void Manager::GetWordGraph(long translationId, std::ostream &outputWordGraphStre
   } // for (iterStack
 }
 
-void Manager::GetSearchGraph(vector<SearchGraphNode>& searchGraph) const
+/** best forward path (towards the final stack) of each connected hypothesis.
+ *  forward holds the id of the next hypothesis on that path, -1 for hypotheses on the final stack
+ */
+void Manager::GetForwardScores(
+  const std::vector<bool> &connected,
+  std::vector<int> &forward,
+  std::vector<double> &forwardScore) const
 {
-  std::map < int, bool > connected;
-  std::map < int, int > forward;
-  std::map < int, double > forwardScore;
-
-  // *** find connected hypotheses ***
-  std::vector< const Hypothesis *> connectedList;
-  GetConnectedGraph(&connected, &connectedList);
-
-  // ** compute best forward path for each hypothesis *** //
+  forward.assign(m_hypoId, 0);
+  forwardScore.assign(m_hypoId, 0.0);
+  std::vector<bool> scored(m_hypoId, false);
 
   // forward cost of hypotheses on final stack is 0
   const std::vector < HypothesisStack* > &hypoStackColl = m_search->GetHypothesisStacks();
@@ -565,6 +609,7 @@ void Manager::GetSearchGraph(vector<SearchGraphNode>& searchGraph) const
     const Hypothesis *hypo = *iterHypo;
     forwardScore[ hypo->GetId() ] = 0.0f;
     forward[ hypo->GetId() ] = -1;
+    scored[ hypo->GetId() ] = true;
   }
 
   // compete for best forward score of previous hypothesis
@@ -574,15 +619,15 @@ void Manager::GetSearchGraph(vector<SearchGraphNode>& searchGraph) const
     HypothesisStack::const_iterator iterHypo;
     for (iterHypo = stack.begin() ; iterHypo != stack.end() ; ++iterHypo) {
       const Hypothesis *hypo = *iterHypo;
-      if (connected.find( hypo->GetId() ) != connected.end()) {
+      if (connected[ hypo->GetId() ]) {
         // make a play for previous hypothesis
         const Hypothesis *prevHypo = hypo->GetPrevHypo();
         double fscore = forwardScore[ hypo->GetId() ] +
                         hypo->GetScore() - prevHypo->GetScore();
-        if (forwardScore.find( prevHypo->GetId() ) == forwardScore.end()
-            || forwardScore.find( prevHypo->GetId() )->second < fscore) {
+        if (!scored[ prevHypo->GetId() ] || forwardScore[ prevHypo->GetId() ] < fscore) {
           forwardScore[ prevHypo->GetId() ] = fscore;
           forward[ prevHypo->GetId() ] = hypo->GetId();
+          scored[ prevHypo->GetId() ] = true;
         }
         // all arcs also make a play
         const ArcList *arcList = hypo->GetArcList();
@@ -594,42 +639,77 @@ void Manager::GetSearchGraph(vector<SearchGraphNode>& searchGraph) const
             const Hypothesis *loserPrevHypo = loserHypo->GetPrevHypo();
             double fscore = forwardScore[ hypo->GetId() ] +
                             loserHypo->GetScore() - loserPrevHypo->GetScore();
-            if (forwardScore.find( loserPrevHypo->GetId() ) == forwardScore.end()
-                || forwardScore.find( loserPrevHypo->GetId() )->second < fscore) {
+            if (!scored[ loserPrevHypo->GetId() ] || forwardScore[ loserPrevHypo->GetId() ] < fscore) {
               forwardScore[ loserPrevHypo->GetId() ] = fscore;
               forward[ loserPrevHypo->GetId() ] = loserHypo->GetId();
+              scored[ loserPrevHypo->GetId() ] = true;
             }
           } // end for arc list
         } // end if arc list empty
       } // end if hypo connected
     } // end for hypo
   } // end for stack
+}
+
+/** calls consumer with each node of the search graph in turn,
+ *  so that the graph can be written out without holding all of it in memory
+ */
+template <class Consumer>
+void Manager::ForEachSearchGraphNode(Consumer &consumer) const
+{
+  // *** find connected hypotheses ***
+  std::vector<bool> connected;
+  std::vector< const Hypothesis *> connectedList;
+  GetConnectedGraph(&connected, &connectedList);
+
+  // ** compute best forward path for each hypothesis *** //
+  std::vector<int> forward;
+  std::vector<double> forwardScore;
+  GetForwardScores(connected, forward, forwardScore);
 
   // *** output all connected hypotheses *** //
 
   connected[ 0 ] = true;
+  const std::vector < HypothesisStack* > &hypoStackColl = m_search->GetHypothesisStacks();
+  std::vector < HypothesisStack* >::const_iterator iterStack;
   for (iterStack = hypoStackColl.begin() ; iterStack != hypoStackColl.end() ; ++iterStack) {
     const HypothesisStack &stack = **iterStack;
     HypothesisStack::const_iterator iterHypo;
     for (iterHypo = stack.begin() ; iterHypo != stack.end() ; ++iterHypo) {
       const Hypothesis *hypo = *iterHypo;
-      if (connected.find( hypo->GetId() ) != connected.end()) {
-        searchGraph.push_back(SearchGraphNode(hypo,NULL,forward[hypo->GetId()],
-                                              forwardScore[hypo->GetId()]));
+      if (connected[ hypo->GetId() ]) {
+        consumer(SearchGraphNode(hypo,NULL,forward[hypo->GetId()],
+                                 forwardScore[hypo->GetId()]));
 
         const ArcList *arcList = hypo->GetArcList();
         if (arcList != NULL) {
           ArcList::const_iterator iterArcList;
           for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
             const Hypothesis *loserHypo = *iterArcList;
-            searchGraph.push_back(SearchGraphNode(loserHypo,hypo,
-                                                  forward[hypo->GetId()], forwardScore[hypo->GetId()]));
+            consumer(SearchGraphNode(loserHypo,hypo,
+                                     forward[hypo->GetId()], forwardScore[hypo->GetId()]));
           }
         } // end if arcList empty
       } // end if connected
     } // end for iterHypo
   } // end for iterStack
+}
 
+namespace
+{
+struct SearchGraphNodeCollector {
+  std::vector<SearchGraphNode> &m_searchGraph;
+  SearchGraphNodeCollector(std::vector<SearchGraphNode> &searchGraph) : m_searchGraph(searchGraph) {}
+  void operator()(const SearchGraphNode &searchNode) {
+    m_searchGraph.push_back(searchNode);
+  }
+};
+}
+
+void Manager::GetSearchGraph(vector<SearchGraphNode>& searchGraph) const
+{
+  SearchGraphNodeCollector collector(searchGraph);
+  ForEachSearchGraphNode(collector);
 }
 
 void OutputSearchNode(long translationId, std::ostream &outputSearchGraphStream,
@@ -702,11 +782,13 @@ void OutputSearchNode(long translationId, std::ostream &outputSearchGraphStream,
 }
 
 void Manager::GetConnectedGraph(
-  std::map< int, bool >* pConnected,
+  std::vector<bool>* pConnected,
   std::vector< const Hypothesis* >* pConnectedList) const
 {
-  std::map < int, bool >& connected = *pConnected;
+  std::vector<bool>& connected = *pConnected;
   std::vector< const Hypothesis *>& connectedList = *pConnectedList;
+  // one bit per hypothesis, indexed by id
+  connected.assign(m_hypoId, false);
 
   // start with the ones in the final stack
   const std::vector < HypothesisStack* > &hypoStackColl = m_search->GetHypothesisStacks();
@@ -724,7 +806,7 @@ void Manager::GetConnectedGraph(
     // add back pointer
     const Hypothesis *prevHypo = hypo->GetPrevHypo();
     if (prevHypo && prevHypo->GetId() > 0 // don't add empty hypothesis
-        && connected.find( prevHypo->GetId() ) == connected.end()) { // don't add already added
+        && !connected[ prevHypo->GetId() ]) { // don't add already added
       connected[ prevHypo->GetId() ] = true;
       connectedList.push_back( prevHypo );
     }
@@ -735,7 +817,7 @@ void Manager::GetConnectedGraph(
       ArcList::const_iterator iterArcList;
       for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
         const Hypothesis *loserHypo = *iterArcList;
-        if (connected.find( loserHypo->GetId() ) == connected.end()) { // don't add already added
+        if (!connected[ loserHypo->GetId() ]) { // don't add already added
           connected[ loserHypo->GetId() ] = true;
           connectedList.push_back( loserHypo );
         }
@@ -806,44 +888,60 @@ void SerializeEdgeInfo(const Hypothesis* hypo, hgmert::Hypergraph_Edge* edge)
     edge->add_feature_values((scores[i] - pscores[i]) * -1.0);
 }
 
-hgmert::Hypergraph_Node* GetHGNode(
+/** index of the hypergraph node of a hypothesis. Nodes are written to the stream when first seen */
+int GetHGNode(
   const Hypothesis* hypo,
-  std::map< int, int>* i2hgnode,
-  hgmert::Hypergraph* hg,
-  int* hgNodeIdx)
+  std::vector<int>* i2hgnode,
+  int* numHGNodes,
+  google::protobuf::io::CodedOutputStream* output)
 {
-  hgmert::Hypergraph_Node* hgnode;
-  std::map < int, int >::iterator idxi = i2hgnode->find(hypo->GetId());
-  if (idxi == i2hgnode->end()) {
-    *hgNodeIdx = ((*i2hgnode)[hypo->GetId()] = hg->nodes_size());
-    hgnode = hg->add_nodes();
-  } else {
-    *hgNodeIdx = idxi->second;
-    hgnode = hg->mutable_nodes(*hgNodeIdx);
+  int &hgNodeIdx = (*i2hgnode)[hypo->GetId()];
+  if (hgNodeIdx < 0) {
+    hgNodeIdx = (*numHGNodes)++;
+    google::protobuf::internal::WireFormatLite::WriteMessage(
+      hgmert::Hypergraph::kNodesFieldNumber, hgmert::Hypergraph_Node(), output);
   }
-  return hgnode;
+  return hgNodeIdx;
+}
+
+void WriteHGEdge(const hgmert::Hypergraph_Edge &edge, google::protobuf::io::CodedOutputStream* output)
+{
+  google::protobuf::internal::WireFormatLite::WriteMessage(
+    hgmert::Hypergraph::kEdgesFieldNumber, edge, output);
 }
 
+/** Nodes and edges are repeated fields, which protobuf parsers concatenate in
+ *  the order they appear on the wire. Each one is therefore written as soon
+ *  as it is known, instead of building the whole Hypergraph message first.
+ */
 void Manager::SerializeSearchGraphPB(
   long translationId,
   std::ostream& outputStream) const
 {
   using namespace hgmert;
-  std::map < int, bool > connected;
-  std::map < int, int > i2hgnode;
+  using google::protobuf::internal::WireFormatLite;
+  std::vector<bool> connected;
   std::vector< const Hypothesis *> connectedList;
   GetConnectedGraph(&connected, &connectedList);
   connected[ 0 ] = true;
+
+  google::protobuf::io::OstreamOutputStream rawOutput(&outputStream);
+  google::protobuf::io::CodedOutputStream output(&rawOutput);
+
+  // scalar fields and feature names first
   Hypergraph hg;
   hg.set_is_sorted(false);
   int num_feats = (*m_search->GetHypothesisStacks().back()->begin())->GetScoreBreakdown().size();
   hg.set_num_features(num_feats);
   StaticData::Instance().GetScoreIndexManager().SerializeFeatureNamesToPB(&hg);
-  Hypergraph_Node* goal = hg.add_nodes();  // idx=0 goal node must have idx 0
-  Hypergraph_Node* source = hg.add_nodes();  // idx=1
-  i2hgnode[-1] = 1; // source node
+  hg.SerializeToCodedStream(&output);
+
+  // hypergraph node of each hypothesis, -1 = not written yet
+  std::vector<int> i2hgnode(m_hypoId, -1);
+  WireFormatLite::WriteMessage(Hypergraph::kNodesFieldNumber, Hypergraph_Node(), &output);  // idx=0 goal node must have idx 0
+  WireFormatLite::WriteMessage(Hypergraph::kNodesFieldNumber, Hypergraph_Node(), &output);  // idx=1 source node
+  int numHGNodes = 2;
   const std::vector < HypothesisStack* > &hypoStackColl = m_search->GetHypothesisStacks();
-  const HypothesisStack &finalStack = *hypoStackColl.back();
   for (std::vector < HypothesisStack* >::const_iterator iterStack = hypoStackColl.begin();
        iterStack != hypoStackColl.end() ; ++iterStack) {
     const HypothesisStack &stack = **iterStack;
@@ -852,23 +950,24 @@ void Manager::SerializeSearchGraphPB(
     for (iterHypo = stack.begin() ; iterHypo != stack.end() ; ++iterHypo) {
       const Hypothesis *hypo = *iterHypo;
       bool is_goal = hypo->GetWordsBitmap().IsComplete();
-      if (connected.find( hypo->GetId() ) != connected.end()) {
-        int headNodeIdx;
-        Hypergraph_Node* headNode = GetHGNode(hypo, &i2hgnode, &hg, &headNodeIdx);
+      if (connected[ hypo->GetId() ]) {
+        int headNodeIdx = GetHGNode(hypo, &i2hgnode, &numHGNodes, &output);
         if (is_goal) {
-          Hypergraph_Edge* ge = hg.add_edges();
-          ge->set_head_node(0);  // goal
-          ge->add_tail_nodes(headNodeIdx);
-          ge->mutable_rule()->add_trg_words("[X,1]");
+          Hypergraph_Edge ge;
+          ge.set_head_node(0);  // goal
+          ge.add_tail_nodes(headNodeIdx);
+          ge.mutable_rule()->add_trg_words("[X,1]");
+          WriteHGEdge(ge, &output);
         }
-        Hypergraph_Edge* edge = hg.add_edges();
-        SerializeEdgeInfo(hypo, edge);
-        edge->set_head_node(headNodeIdx);
+        Hypergraph_Edge edge;
+        SerializeEdgeInfo(hypo, &edge);
+        edge.set_head_node(headNodeIdx);
         const Hypothesis* prev = hypo->GetPrevHypo();
         int tailNodeIdx = 1; // source
         if (prev)
-          tailNodeIdx = i2hgnode.find(prev->GetId())->second;
-        edge->add_tail_nodes(tailNodeIdx);
+          tailNodeIdx = i2hgnode[prev->GetId()];
+        edge.add_tail_nodes(tailNodeIdx);
+        WriteHGEdge(edge, &output);
 
         const ArcList *arcList = hypo->GetArcList();
         if (arcList != NULL) {
@@ -876,27 +975,38 @@ void Manager::SerializeSearchGraphPB(
           for (iterArcList = arcList->begin() ; iterArcList != arcList->end() ; ++iterArcList) {
             const Hypothesis *loserHypo = *iterArcList;
             CHECK(connected[loserHypo->GetId()]);
-            Hypergraph_Edge* edge = hg.add_edges();
-            SerializeEdgeInfo(loserHypo, edge);
-            edge->set_head_node(headNodeIdx);
-            tailNodeIdx = i2hgnode.find(loserHypo->GetPrevHypo()->GetId())->second;
-            edge->add_tail_nodes(tailNodeIdx);
+            Hypergraph_Edge edge;
+            SerializeEdgeInfo(loserHypo, &edge);
+            edge.set_head_node(headNodeIdx);
+            tailNodeIdx = i2hgnode[loserHypo->GetPrevHypo()->GetId()];
+            edge.add_tail_nodes(tailNodeIdx);
+            WriteHGEdge(edge, &output);
           }
         } // end if arcList empty
       } // end if connected
     } // end for iterHypo
   } // end for iterStack
-  hg.SerializeToOstream(&outputStream);
 }
 #endif
 
-void Manager::OutputSearchGraph(long translationId, std::ostream &outputSearchGraphStream) const
+namespace
 {
-  vector<SearchGraphNode> searchGraph;
-  GetSearchGraph(searchGraph);
-  for (size_t i = 0; i < searchGraph.size(); ++i) {
-    OutputSearchNode(translationId,outputSearchGraphStream,searchGraph[i]);
+struct SearchGraphNodeWriter {
+  long m_translationId;
+  std::ostream &m_outputSearchGraphStream;
+  SearchGraphNodeWriter(long translationId, std::ostream &outputSearchGraphStream)
+    : m_translationId(translationId), m_outputSearchGraphStream(outputSearchGraphStream) {}
+  void operator()(const SearchGraphNode &searchNode) {
+    OutputSearchNode(m_translationId, m_outputSearchGraphStream, searchNode);
   }
+};
+}
+
+void Manager::OutputSearchGraph(long translationId, std::ostream &outputSearchGraphStream) const
+{
+  // write each node as it is found
+  SearchGraphNodeWriter writer(translationId, outputSearchGraphStream);
+  ForEachSearchGraphNode(writer);
 }
 
 void Manager::GetForwardBackwardSearchGraph(std::map< int, bool >* pConnected,
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <vector>
 #include <list>
+#include <map>
 #include <ctime>
 #include "InputType.h"
 #include "Hypothesis.h"
@@ -35,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "WordsBitmap.h"
 #include "Search.h"
 #include "SearchCubePruning.h"
+#include "LatencyBudget.h"
 #if HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -108,10 +110,20 @@ protected:
   size_t interrupted_flag;
   std::auto_ptr<SentenceStats> m_sentenceStats;
   int m_hypoId; //used to number the hypos as they are created.
+  LatencyBudget m_latencyBudget; /**< per-sentence time limit used to tighten pruning */
 
   void GetConnectedGraph(
-    std::map< int, bool >* pConnected,
+    std::vector<bool>* pConnected,
     std::vector< const Hypothesis* >* pConnectedList) const;
+  void GetForwardScores(
+    const std::vector<bool> &connected,
+    std::vector<int> &forward,
+    std::vector<double> &forwardScore) const;
+  template <class Consumer>
+  void ForEachSearchGraphNode(Consumer &consumer) const;
+  //! arcs of each hypothesis sorted best first, built on demand by CalcNBest()
+  typedef std::map<const Hypothesis*, std::vector<const Hypothesis*> > SortedArcCache;
+  const std::vector<const Hypothesis*> *GetSortedArcs(const Hypothesis &hypo, SortedArcCache &cache) const;
   void GetWinnerConnectedGraph(
     std::map< int, bool >* pConnected,
     std::vector< const Hypothesis* >* pConnectedList) const;
@@ -153,6 +165,17 @@ public:
   void ResetSentenceStats(const InputType& source);
   SentenceStats& GetSentenceStats() const;
 
+  /***
+   * time budget for this sentence. Defaults to the latency-budget parameter,
+   * may be changed before calling ProcessSentence()
+   */
+  LatencyBudget &GetLatencyBudget() {
+    return m_latencyBudget;
+  }
+  const LatencyBudget &GetLatencyBudget() const {
+    return m_latencyBudget;
+  }
+
   /***
    *For Lattice MBR
   */
@@ -23,9 +23,11 @@
 #include "Word.h"
 
 #include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/unordered_set.hpp>
 
 #include <set>
+#include <vector>
 
 namespace Moses
 {
@@ -55,4 +57,45 @@ typedef boost::unordered_set<Word,
         NonTerminalHasher,
         NonTerminalEqualityPred> NonTerminalSet;
 
+/** Assigns small, dense ids to non-terminal labels in order of first use so
+ *  that per-cell structures can be indexed by label instead of searched.
+ *  One of these is owned by each ChartManager, so no locking is needed.
+ */
+class NonTerminalIndex
+{
+public:
+  //! returns the id of label, assigning a new one if label hasn't been seen
+  size_t Add(const Word &label) {
+    std::pair<MapType::iterator, bool> ret =
+      m_map.insert(MapType::value_type(label, m_labels.size()));
+    if (ret.second) {
+      // keys of an unordered_map aren't moved by a rehash
+      m_labels.push_back(&ret.first->first);
+    }
+    return ret.first->second;
+  }
+
+  //! returns the id of label or NOT_FOUND
+  size_t Find(const Word &label) const {
+    MapType::const_iterator p = m_map.find(label);
+    return p == m_map.end() ? NOT_FOUND : p->second;
+  }
+
+  const Word &GetLabel(size_t id) const {
+    return *m_labels[id];
+  }
+
+  size_t GetSize() const {
+    return m_labels.size();
+  }
+
+private:
+  typedef boost::unordered_map<Word, size_t,
+          NonTerminalHasher,
+          NonTerminalEqualityPred> MapType;
+
+  MapType m_map;
+  std::vector<const Word*> m_labels;
+};
+
 }  // namespace Moses
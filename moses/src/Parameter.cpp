@@ -83,6 +83,8 @@ Parameter::Parameter()
   AddParam("ttable-file", "location and properties of the translation tables");
   AddParam("ttable-limit", "ttl", "maximum number of translation table entries per input phrase");
   AddParam("translation-option-threshold", "tot", "threshold for translation options relative to best for input phrase");
+  AddParam("translation-option-threads", "number of threads used to collect the translation options of each sentence (default 1)");
+  AddParam("per-sentence-grammar-prefetch", "number of upcoming per-sentence grammars to load on background threads (default 0)");
   AddParam("early-discarding-threshold", "edt", "threshold for constructing hypotheses based on estimate cost");
   AddParam("verbose", "v", "verbosity level of the logging");
   AddParam("weight-d", "d", "weight(s) for distortion (reordering components)");
@@ -116,10 +118,12 @@ Parameter::Parameter()
   AddParam("lattice-hypo-set", "to use lattice as hypo set during lattice MBR");
   AddParam("clean-lm-cache", "clean language model caches after N translations (default N=1)");
   AddParam("use-persistent-cache", "cache translation options across sentences (default true)");
-  AddParam("persistent-cache-size", "maximum size of cache for translation options (default 10,000 input phrases)");
+  AddParam("persistent-cache-size", "maximum size of cache for translation options (default 10,000 input phrases, or no limit if persistent-cache-memory is set)");
+  AddParam("persistent-cache-memory", "maximum memory used by the cache for translation options, in megabytes (default: no limit)");
   AddParam("recover-input-path", "r", "(conf net/word lattice only) - recover input path corresponding to the best translation");
   AddParam("output-word-graph", "owg", "Output stack info as word graph. Takes filename, 0=only hypos in stack, 1=stack + nbest hypos");
   AddParam("time-out", "seconds after which is interrupted (-1=no time-out, default is -1)");
+  AddParam("latency-budget", "milliseconds allowed per sentence; pruning is tightened progressively to stay within it (default 0 = no limit)");
   AddParam("output-search-graph", "osg", "Output connected hypotheses of search into specified filename");
   AddParam("output-search-graph-extended", "osgx", "Output connected hypotheses of search into specified filename, in extended format");
   AddParam("unpruned-search-graph", "usg", "When outputting chart search graph, do not exclude dead ends. Note: stack pruning may have eliminated some hypotheses");
@@ -129,6 +133,8 @@ Parameter::Parameter()
   AddParam("cube-pruning-pop-limit", "cbp", "How many hypotheses should be popped for each stack. (default = 1000)");
   AddParam("cube-pruning-diversity", "cbd", "How many hypotheses should be created for each coverage. (default = 0)");
   AddParam("cube-pruning-lazy-scoring", "cbls", "Don't fully score a hypothesis until it is popped");
+  AddParam("search-lazy-scoring", "sls", "Skip the evaluation of stateful features (LM, lexical reordering) for hypotheses whose optimistic score cannot reach their stack (normal search only)");
+  AddParam("cube-pruning-early-discarding", "cbed", "With lazy scoring, don't fully score a popped hypothesis if its estimated score is outside the beam of its stack");
   AddParam("search-algorithm", "Which search algorithm to use. 0=normal stack, 1=cube pruning, 2=cube growing. (default = 0)");
   AddParam("constraint", "Location of the file with target sentences to produce constraining the search");
   AddParam("use-alignment-info", "Use word-to-word alignment: actually it is only used to output the word-to-word alignment. Word-to-word alignments are taken from the phrase table if any. Default is false.");
@@ -21,11 +21,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include "PhraseDictionary.h"
+#include "PhraseDictionaryMemory.h"
 #include "PhraseDictionaryTreeAdaptor.h"
 #include "PhraseDictionarySCFG.h"
 #include "PhraseDictionaryOnDisk.h"
 #include "PhraseDictionaryHiero.h"
 #include "PhraseDictionaryALSuffixArray.h"
+#include "PhraseDictionaryCompactBinary.h"
 #ifndef WIN32
 #include "PhraseDictionaryDynSuffixArray.h"
 #endif
@@ -69,7 +71,8 @@ PhraseDictionaryFeature::PhraseDictionaryFeature
 {
   const StaticData& staticData = StaticData::Instance();
   const_cast<ScoreIndexManager&>(staticData.GetScoreIndexManager()).AddScoreProducer(this);
-  if (implementation == Memory || implementation == SCFG || implementation == SuffixArray) {
+  if (implementation == Memory || implementation == SCFG || implementation == SuffixArray
+      || implementation == ALSuffixArray || implementation == CompactBinary) {
     m_useThreadSafePhraseDictionary = true;
   } else {
     m_useThreadSafePhraseDictionary = false;
@@ -165,6 +168,19 @@ PhraseDictionary* PhraseDictionaryFeature::LoadPhraseTable(const TranslationSyst
                          , system->GetWordPenaltyProducer());
     CHECK(ret);
     return pdm;
+  } else if (m_implementation == CompactBinary) {
+    // memory-mapped rule table
+    VERBOSE(2,"using binary compact rule tables" << std::endl);
+    PhraseDictionaryCompactBinary* pdcb = new PhraseDictionaryCompactBinary(m_numScoreComponent,this);
+    bool ret = pdcb->Load(GetInput()
+                          , GetOutput()
+                          , m_filePath
+                          , m_weight
+                          , m_tableLimit
+                          , system->GetLanguageModels()
+                          , system->GetWordPenaltyProducer());
+    CHECK(ret);
+    return pdcb;
   } else if (m_implementation == OnDisk) {
 
     PhraseDictionaryOnDisk* pdta = new PhraseDictionaryOnDisk(m_numScoreComponent, this);
@@ -247,6 +263,24 @@ const PhraseDictionary* PhraseDictionaryFeature::GetDictionary() const
   return dict;
 }
 
+bool PhraseDictionaryFeature::SetWeights(const std::vector<float> &weight)
+{
+  // other implementations keep scores weighted at load time in tables or caches
+  if (m_implementation != Memory || weight.size() != m_weight.size()) {
+    return false;
+  }
+
+  m_weight = weight;
+  const_cast<StaticData&>(StaticData::Instance()).SetWeightsForScoreProducer(this, weight);
+  if (m_threadSafePhraseDictionary.get()) {
+    PhraseDictionaryMemory *pdm = static_cast<PhraseDictionaryMemory*>(m_threadSafePhraseDictionary.get());
+    pdm->SetWeights(weight);
+  }
+  // cached translation options were scored with the old weights
+  StaticData::Instance().ClearTransOptionCache();
+  return true;
+}
+
 
 
 PhraseDictionaryFeature::~PhraseDictionaryFeature()
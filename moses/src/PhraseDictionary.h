@@ -127,6 +127,15 @@ public:
   //Get the dictionary. Be sure to initialise it first.
   const PhraseDictionary* GetDictionary() const;
 
+  //! change the translation model weights, re-weighting a loaded memory phrase table.
+  //! Returns false if the table can't be re-weighted. Not to be called while sentences are decoded
+  bool SetWeights(const std::vector<float> &weight);
+
+  //Whether a single dictionary instance is shared between threads
+  bool IsThreadSafe() const {
+    return m_useThreadSafePhraseDictionary;
+  }
+
 private:
   /** Load the appropriate phrase table */
   PhraseDictionary* LoadPhraseTable(const TranslationSystem* system);
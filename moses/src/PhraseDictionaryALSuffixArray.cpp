@@ -9,15 +9,55 @@
 #include <iostream>
 #include "PhraseDictionaryALSuffixArray.h"
 #include "InputType.h"
-#include "InputFileStream.h"
-#include "RuleTableLoader.h"
-#include "RuleTableLoaderFactory.h"
+#include "StaticData.h"
 #include "TypeDef.h"
+#include "UserMessage.h"
+#include "Util.h"
 
 using namespace std;
 
 namespace Moses 
 {
+
+#ifdef WITH_THREADS
+/** Loads the grammar of one sentence on a prefetch thread */
+class GrammarPrefetchTask : public Task
+{
+public:
+  GrammarPrefetchTask(PhraseDictionaryALSuffixArray &dictionary, long translationId)
+    : m_dictionary(dictionary), m_translationId(translationId) {}
+
+  void Run() {
+    m_dictionary.SetPrefetchedGrammar(m_translationId, m_dictionary.LoadGrammar(m_translationId));
+  }
+
+private:
+  PhraseDictionaryALSuffixArray &m_dictionary;
+  long m_translationId;
+};
+#endif
+
+PhraseDictionaryALSuffixArray::PhraseDictionaryALSuffixArray(size_t numScoreComponent, PhraseDictionaryFeature* feature)
+  : PhraseDictionarySCFG(numScoreComponent,feature)
+#ifdef WITH_THREADS
+  , m_prefetchCount(0)
+  , m_prefetchedUpTo(-1)
+#endif
+{
+}
+
+PhraseDictionaryALSuffixArray::~PhraseDictionaryALSuffixArray()
+{
+#ifdef WITH_THREADS
+  if (m_prefetchPool.get()) {
+    m_prefetchPool->Stop(true);
+  }
+  std::map<long, PrefetchedGrammar>::iterator iter;
+  for (iter = m_prefetched.begin(); iter != m_prefetched.end(); ++iter) {
+    delete iter->second.grammar;
+  }
+#endif
+}
   
 bool PhraseDictionaryALSuffixArray::Load(const std::vector<FactorType> &input
                                  , const std::vector<FactorType> &output
@@ -36,29 +76,121 @@ bool PhraseDictionaryALSuffixArray::Load(const std::vector<FactorType> &input
   m_languageModels = &languageModels;
   m_wpProducer = wpProducer;
   m_weight = &weight;
+
+#ifdef WITH_THREADS
+  m_prefetchCount = StaticData::Instance().GetPerSentenceGrammarPrefetch();
+  if (m_prefetchCount > 0) {
+    m_prefetchPool.reset(new ThreadPool(m_prefetchCount));
+  }
+#endif
   
   return true;
 }
 
+PhraseDictionarySCFG *PhraseDictionaryALSuffixArray::LoadGrammar(long translationId) const
+{
+  string grammarFile = m_filePath + "/grammar.out." + SPrint(translationId);
+  if (FileExists(grammarFile + ".bin")) {
+    grammarFile += ".bin";
+  } else if (!FileExists(grammarFile)) {
+    return NULL;
+  }
+
+  std::auto_ptr<PhraseDictionarySCFG> grammar(new PhraseDictionarySCFG(m_numScoreComponent, m_feature));
+  bool ret = grammar->Load(*m_input, *m_output, grammarFile, *m_weight, m_tableLimit,
+                           *m_languageModels, m_wpProducer);
+  CHECK(ret);
+  return grammar.release();
+}
+
 void PhraseDictionaryALSuffixArray::InitializeForInput(InputType const& source)
 {
-  // clear out rules for previous sentence
-  m_collection.Clear();
-  
   // populate with rules for this sentence
   long translationId = source.GetTranslationId();
-  
-  string grammarFile = m_filePath + "/grammar.out." + SPrint(translationId);
-  
-  // data from file
-  InputFileStream inFile(grammarFile);
 
-  std::auto_ptr<RuleTableLoader> loader =
-  RuleTableLoaderFactory::Create(grammarFile);
-  bool ret = loader->Load(*m_input, *m_output, inFile, *m_weight, m_tableLimit,
-                          *m_languageModels, m_wpProducer, *this);
-  
-  CHECK(ret);
+  PhraseDictionarySCFG *grammar;
+#ifdef WITH_THREADS
+  if (m_prefetchPool.get()) {
+    grammar = TakePrefetchedGrammar(translationId);
+  } else
+#endif
+  {
+    grammar = LoadGrammar(translationId);
+  }
+
+  if (grammar == NULL) {
+    UserMessage::Add("No grammar file for sentence " + SPrint(translationId) + " in " + m_filePath);
+    CHECK(false);
+  }
+
+  // replaces rules for previous sentence
+  m_sentenceGrammar.reset(grammar);
+}
+
+ChartRuleLookupManager *PhraseDictionaryALSuffixArray::CreateRuleLookupManager(
+  const InputType &sentence,
+  const ChartCellCollection &cellCollection)
+{
+  CHECK(m_sentenceGrammar.get());
+  return m_sentenceGrammar->CreateRuleLookupManager(sentence, cellCollection);
+}
+
+#ifdef WITH_THREADS
+PhraseDictionarySCFG *PhraseDictionaryALSuffixArray::TakePrefetchedGrammar(long translationId)
+{
+  boost::unique_lock<boost::mutex> lock(m_prefetchMutex);
+
+  // sentences are started in order by ThreadCount() decoding threads, so at most
+  // ThreadCount() - 1 earlier sentences can still ask for their grammar. Grammars
+  // further back that nobody is waiting for will not be asked for; ones still
+  // loading are deleted when they arrive
+  const long staleId = translationId + 1 - (long) std::max(StaticData::Instance().ThreadCount(), 1);
+  std::map<long, PrefetchedGrammar>::iterator iterStale = m_prefetched.begin();
+  while (iterStale != m_prefetched.end() && iterStale->first < staleId) {
+    if (iterStale->second.requested) {
+      ++iterStale;
+    } else {
+      delete iterStale->second.grammar;
+      m_prefetched.erase(iterStale++);
+    }
+  }
+
+  // schedule this sentence, unless it already is, and the ones after it
+  const long lastId = translationId + (long) m_prefetchCount;
+  for (long id = translationId; id <= lastId; ++id) {
+    if (id > m_prefetchedUpTo
+        || (id == translationId && m_prefetched.find(id) == m_prefetched.end())) {
+      m_prefetched[id];
+      m_prefetchPool->Submit(new GrammarPrefetchTask(*this, id));
+    }
+  }
+  m_prefetchedUpTo = std::max(m_prefetchedUpTo, lastId);
+
+  std::map<long, PrefetchedGrammar>::iterator iter = m_prefetched.find(translationId);
+  iter->second.requested = true;
+  while (!iter->second.loaded) {
+    m_prefetchLoaded.wait(lock);
+  }
+  PhraseDictionarySCFG *grammar = iter->second.grammar;
+  m_prefetched.erase(iter);
+  return grammar;
+}
+
+void PhraseDictionaryALSuffixArray::SetPrefetchedGrammar(long translationId, PhraseDictionarySCFG *grammar)
+{
+  {
+    boost::unique_lock<boost::mutex> lock(m_prefetchMutex);
+    std::map<long, PrefetchedGrammar>::iterator iter = m_prefetched.find(translationId);
+    if (iter == m_prefetched.end()) {
+      // evicted by TakePrefetchedGrammar() while loading
+      delete grammar;
+      return;
+    }
+    iter->second.grammar = grammar;
+    iter->second.loaded = true;
+  }
+  m_prefetchLoaded.notify_all();
 }
+#endif
 
 }
@@ -9,15 +9,35 @@
 #ifndef moses_PhraseDictionaryALSuffixArray_h
 #define moses_PhraseDictionaryALSuffixArray_h
 
+#include <map>
+#include <memory>
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include "ThreadPool.h"
+#endif
+
 #include "PhraseDictionarySCFG.h"
 
 namespace Moses {
   
+/** Rule table made of one grammar file per sentence, grammar.out.<id> or its
+ *  binary version grammar.out.<id>.bin, in the directory given as file path.
+ *  A single instance is shared by all decoding threads: each thread decodes
+ *  with its own sentence grammar. If per-sentence-grammar-prefetch is set,
+ *  the grammars of the next sentences are loaded on background threads while
+ *  the current sentence is decoded.
+ */
 class PhraseDictionaryALSuffixArray : public PhraseDictionarySCFG
 {
+#ifdef WITH_THREADS
+  friend class GrammarPrefetchTask;
+#endif
+
 public:
-  PhraseDictionaryALSuffixArray(size_t numScoreComponent, PhraseDictionaryFeature* feature)
-  : PhraseDictionarySCFG(numScoreComponent,feature) {}
+  PhraseDictionaryALSuffixArray(size_t numScoreComponent, PhraseDictionaryFeature* feature);
+  ~PhraseDictionaryALSuffixArray();
 
   bool Load(const std::vector<FactorType> &input
             , const std::vector<FactorType> &output
@@ -29,12 +49,42 @@ public:
 
   void InitializeForInput(InputType const& source);
 
+  ChartRuleLookupManager *CreateRuleLookupManager(
+    const InputType &,
+    const ChartCellCollection &);
+
 protected:
+  //! rules of one sentence, or NULL if there is no grammar file for it
+  PhraseDictionarySCFG *LoadGrammar(long translationId) const;
+
   const std::vector<FactorType> *m_input, *m_output;
   const LMList *m_languageModels;
   const WordPenaltyProducer *m_wpProducer;
   const std::vector<float> *m_weight;
-  
+
+#ifdef WITH_THREADS
+  PhraseDictionarySCFG *TakePrefetchedGrammar(long translationId);
+  void SetPrefetchedGrammar(long translationId, PhraseDictionarySCFG *grammar);
+
+  struct PrefetchedGrammar {
+    PrefetchedGrammar() : loaded(false), requested(false), grammar(NULL) {}
+    bool loaded;
+    bool requested; //! a decoding thread is waiting for it, so it must not be evicted
+    PhraseDictionarySCFG *grammar;
+  };
+
+  //! grammar of the sentence this thread is decoding
+  boost::thread_specific_ptr<PhraseDictionarySCFG> m_sentenceGrammar;
+
+  size_t m_prefetchCount;
+  std::auto_ptr<ThreadPool> m_prefetchPool;
+  std::map<long, PrefetchedGrammar> m_prefetched; //! scheduled grammars that have not been taken yet
+  long m_prefetchedUpTo; //! highest translation id scheduled so far
+  boost::mutex m_prefetchMutex;
+  boost::condition_variable m_prefetchLoaded;
+#else
+  std::auto_ptr<PhraseDictionarySCFG> m_sentenceGrammar;
+#endif
 };
   
 
@@ -0,0 +1,748 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "PhraseDictionaryCompactBinary.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "ChartRuleLookupManagerCompactBinary.h"
+#include "LMList.h"
+#include "StaticData.h"
+#include "TargetPhrase.h"
+#include "TargetPhraseCollection.h"
+#include "UserMessage.h"
+#include "Util.h"
+
+namespace Moses
+{
+
+/* Layout of the binary compact rule table, all numbers in native byte order.
+ * Every section is padded to a multiple of 8 bytes.
+ *   header              CompactBinaryHeader
+ *   vocab offsets       (vocabSize + 1) x uint64 into the vocab text
+ *   sorted vocab        vocabSize x uint32, ids in order of their text
+ *   vocab text          vocabChars x char.  Non-terminal labels keep their
+ *                       brackets, e.g. "[NP]"
+ *   phrase offsets      (numTargetPhrases + 1) x uint64 into the symbols
+ *   phrase symbols      numTargetSymbols x uint32, LHS followed by the RHS
+ *   alignment offsets   (numAlignments + 1) x uint64 into the points
+ *   alignment points    numAlignmentPoints x (uint32 source, uint32 target)
+ *   rules               numRules x Rule, grouped by prefix tree node
+ *   scores              numRules x numScores x float, as in the text table
+ *   nodes               numNodes x Node, the root first
+ *   terminal edges      numTerminalEdges x TerminalEdge
+ *   non-terminal edges  numNonTerminalEdges x NonTerminalEdge
+ * As in PhraseDictionarySCFG, the prefix tree is keyed by the source RHS,
+ * with each non-terminal keyed by its source label and the label of the
+ * aligned target non-terminal.  The source LHS is not stored.
+ */
+namespace
+{
+const char CompactBinaryMagic[8] = {'m','o','s','e','s','r','t','c'};
+const uint32_t CompactBinaryVersion = 1;
+
+// second label of the prefix tree key of a terminal
+const UINT32 NoLabel = 0xFFFFFFFF;
+
+struct CompactBinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t numScores;
+  uint64_t vocabSize;
+  uint64_t vocabChars;
+  uint64_t numTargetPhrases;
+  uint64_t numTargetSymbols;
+  uint64_t numAlignments;
+  uint64_t numAlignmentPoints;
+  uint64_t numRules;
+  uint64_t numNodes;
+  uint64_t numTerminalEdges;
+  uint64_t numNonTerminalEdges;
+};
+
+uint64_t PaddedSize(uint64_t size)
+{
+  return (size + 7) & ~((uint64_t) 7);
+}
+
+template <class T> void WriteSection(std::ostream &out, const std::vector<T> &section)
+{
+  const uint64_t size = section.size() * sizeof(T);
+  if (size > 0) {
+    out.write(reinterpret_cast<const char*>(&section[0]), size);
+  }
+  const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  out.write(padding, PaddedSize(size) - size);
+}
+
+template <class T> const T *MapSection(const char *&data, const char *end, uint64_t count)
+{
+  if (count > (uint64_t) (end - data) / sizeof(T)) {
+    return NULL;
+  }
+  const uint64_t size = PaddedSize(count * sizeof(T));
+  if ((uint64_t) (end - data) < size) {
+    return NULL;
+  }
+  const T *section = reinterpret_cast<const T*>(data);
+  data += size;
+  return section;
+}
+
+// offsets of count items must start at 0, grow by at least minLength per item
+// and end at the size of the section they point into
+bool ValidOffsets(const UINT64 *offsets, uint64_t count, uint64_t sectionSize, uint64_t minLength)
+{
+  if (offsets[0] != 0 || offsets[count] != sectionSize) {
+    return false;
+  }
+  for (uint64_t i = 0; i < count; ++i) {
+    if (offsets[i+1] < offsets[i] || offsets[i+1] - offsets[i] < minLength) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ValidIds(const UINT32 *ids, uint64_t count, uint64_t limit)
+{
+  for (uint64_t i = 0; i < count; ++i) {
+    if (ids[i] >= limit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// [first, first + num) must lie within a section of size items
+bool ValidRange(uint64_t first, uint64_t num, uint64_t size)
+{
+  return first <= size && num <= size - first;
+}
+
+template <class Edge> bool ValidEdges(const Edge *edges, uint64_t count, uint64_t numNodes)
+{
+  for (uint64_t i = 0; i < count; ++i) {
+    if (edges[i].child >= numNodes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsNonTerminal(const std::string &symbol)
+{
+  return symbol.size() >= 2 && symbol[0] == '[' && symbol[symbol.size()-1] == ']';
+}
+
+int CompareSymbol(const std::string &symbol, const char *text, uint64_t length)
+{
+  return symbol.compare(0, std::string::npos, text, length);
+}
+
+bool TerminalEdgeLess(const PhraseDictionaryCompactBinary::TerminalEdge &edge, UINT32 symbol)
+{
+  return edge.symbol < symbol;
+}
+
+bool NonTerminalEdgeLess(const PhraseDictionaryCompactBinary::NonTerminalEdge &edge,
+                         const std::pair<UINT32, UINT32> &labels)
+{
+  return std::make_pair(edge.sourceLabel, edge.targetLabel) < labels;
+}
+
+typedef std::pair<UINT32, UINT32> KeyEdge;
+
+// Orders rules by their prefix tree keys.
+struct KeyOrder {
+  KeyOrder(const std::vector<uint64_t> &offsets, const std::vector<KeyEdge> &keys)
+    : m_offsets(offsets), m_keys(keys) {}
+
+  bool operator()(uint64_t a, uint64_t b) const {
+    return std::lexicographical_compare(
+             m_keys.begin() + m_offsets[a], m_keys.begin() + m_offsets[a+1],
+             m_keys.begin() + m_offsets[b], m_keys.begin() + m_offsets[b+1]);
+  }
+
+  const std::vector<uint64_t> &m_offsets;
+  const std::vector<KeyEdge> &m_keys;
+};
+
+// Lays out the prefix tree of rules that have been sorted by their keys.
+struct PrefixTreeBuilder {
+  PrefixTreeBuilder(const std::vector<uint64_t> &keyOffsets,
+                    const std::vector<KeyEdge> &keys,
+                    const std::vector<uint64_t> &order)
+    : m_keyOffsets(keyOffsets), m_keys(keys), m_order(order) {}
+
+  size_t KeyLength(size_t pos) const {
+    return m_keyOffsets[m_order[pos]+1] - m_keyOffsets[m_order[pos]];
+  }
+  const KeyEdge &GetKeyEdge(size_t pos, size_t depth) const {
+    return m_keys[m_keyOffsets[m_order[pos]] + depth];
+  }
+
+  // node covers the rules at positions [begin, end) of the sorted order,
+  // whose keys share their first depth edges
+  void Build(UINT32 node, size_t begin, size_t end, size_t depth) {
+    size_t pos = begin;
+    while (pos < end && KeyLength(pos) == depth) {
+      ++pos;
+    }
+    m_nodes[node].firstRule = begin;
+    m_nodes[node].numRules = pos - begin;
+    m_nodes[node].firstTerminalEdge = m_terminalEdges.size();
+    m_nodes[node].firstNonTerminalEdge = m_nonTerminalEdges.size();
+
+    // add all edges of this node before any edge of its children, so that
+    // they are stored contiguously
+    std::vector<std::pair<size_t, size_t> > childRanges;
+    std::vector<UINT32> children;
+    while (pos < end) {
+      const KeyEdge &edge = GetKeyEdge(pos, depth);
+      size_t next = pos + 1;
+      while (next < end && GetKeyEdge(next, depth) == edge) {
+        ++next;
+      }
+
+      const UINT32 child = m_nodes.size();
+      m_nodes.push_back(PhraseDictionaryCompactBinary::Node());
+      if (edge.second == NoLabel) {
+        PhraseDictionaryCompactBinary::TerminalEdge terminalEdge;
+        terminalEdge.symbol = edge.first;
+        terminalEdge.child = child;
+        m_terminalEdges.push_back(terminalEdge);
+      } else {
+        PhraseDictionaryCompactBinary::NonTerminalEdge nonTerminalEdge;
+        nonTerminalEdge.sourceLabel = edge.first;
+        nonTerminalEdge.targetLabel = edge.second;
+        nonTerminalEdge.child = child;
+        m_nonTerminalEdges.push_back(nonTerminalEdge);
+      }
+      children.push_back(child);
+      childRanges.push_back(std::make_pair(pos, next));
+      pos = next;
+    }
+    m_nodes[node].numTerminalEdges = m_terminalEdges.size() - m_nodes[node].firstTerminalEdge;
+    m_nodes[node].numNonTerminalEdges = m_nonTerminalEdges.size() - m_nodes[node].firstNonTerminalEdge;
+    m_nodes[node].padding = 0;
+
+    for (size_t i = 0; i < children.size(); ++i) {
+      Build(children[i], childRanges[i].first, childRanges[i].second, depth + 1);
+    }
+  }
+
+  const std::vector<uint64_t> &m_keyOffsets;
+  const std::vector<KeyEdge> &m_keys;
+  const std::vector<uint64_t> &m_order;
+  std::vector<PhraseDictionaryCompactBinary::Node> m_nodes;
+  std::vector<PhraseDictionaryCompactBinary::TerminalEdge> m_terminalEdges;
+  std::vector<PhraseDictionaryCompactBinary::NonTerminalEdge> m_nonTerminalEdges;
+};
+
+// Orders vocabulary ids by their text.
+struct VocabOrder {
+  VocabOrder(const std::vector<std::string> &vocab) : m_vocab(vocab) {}
+  bool operator()(UINT32 a, UINT32 b) const {
+    return m_vocab[a] < m_vocab[b];
+  }
+  const std::vector<std::string> &m_vocab;
+};
+
+// Reads the count line of a section of the compact text format.
+bool ReadCount(std::istream &inStream, uint64_t &count)
+{
+  std::string line;
+  if (!std::getline(inStream, line)) {
+    return false;
+  }
+  count = Scan<uint64_t>(line);
+  return true;
+}
+}
+
+PhraseDictionaryCompactBinary::PhraseDictionaryCompactBinary(
+  size_t numScoreComponents, const PhraseDictionaryFeature* feature)
+  : PhraseDictionary(numScoreComponents, feature)
+  , m_languageModels(NULL)
+  , m_wpProducer(NULL)
+  , m_numScores(0)
+  , m_vocabSize(0)
+{
+}
+
+bool PhraseDictionaryCompactBinary::Load(const std::vector<FactorType> &input
+    , const std::vector<FactorType> &output
+    , const std::string &filePath
+    , const std::vector<float> &weight
+    , size_t tableLimit
+    , const LMList &languageModels
+    , const WordPenaltyProducer* wpProducer)
+{
+  try {
+    util::scoped_fd file(util::OpenReadOrThrow(filePath.c_str()));
+    const uint64_t size = util::SizeFile(file.get());
+    if (size == util::kBadSize || size < sizeof(CompactBinaryHeader)) {
+      UserMessage::Add(filePath + " is not a binary compact rule table");
+      return false;
+    }
+    // lazily mapped, only the pages of rules that are looked up are read
+    util::MapRead(util::LAZY, file.get(), 0, size, m_memory);
+  } catch (const util::Exception &e) {
+    UserMessage::Add(std::string("Couldn't read ") + filePath + ": " + e.what());
+    return false;
+  }
+
+  CompactBinaryHeader header;
+  memcpy(&header, m_memory.begin(), sizeof(header));
+  if (memcmp(header.magic, CompactBinaryMagic, sizeof(header.magic)) != 0
+      || header.version != CompactBinaryVersion) {
+    UserMessage::Add(filePath + " is not a binary compact rule table, or was built by an incompatible version");
+    m_memory.reset();
+    return false;
+  }
+
+  if (header.numScores != weight.size()) {
+    std::stringstream msg;
+    msg << "Size of scoreVector != number (" << header.numScores << "!="
+        << weight.size() << ") of score components in " << filePath;
+    UserMessage::Add(msg.str());
+    m_memory.reset();
+    return false;
+  }
+
+  // no count can exceed the file size, which keeps the section sizes below from overflowing
+  const uint64_t size = m_memory.size();
+  if (header.vocabSize > size || header.vocabChars > size || header.numTargetPhrases > size
+      || header.numTargetSymbols > size || header.numAlignments > size
+      || header.numAlignmentPoints > size || header.numRules > size
+      || (header.numScores > 0 && header.numRules > size / header.numScores)
+      || header.numNodes > size || header.numTerminalEdges > size || header.numNonTerminalEdges > size) {
+    UserMessage::Add(filePath + " is truncated or corrupt");
+    m_memory.reset();
+    return false;
+  }
+
+  const char *data = static_cast<const char*>(m_memory.begin()) + sizeof(header);
+  const char *end = static_cast<const char*>(m_memory.begin()) + size;
+  m_vocabOffsets = MapSection<UINT64>(data, end, header.vocabSize + 1);
+  m_sortedVocab = m_vocabOffsets ? MapSection<UINT32>(data, end, header.vocabSize) : NULL;
+  m_vocabChars = m_sortedVocab ? MapSection<char>(data, end, header.vocabChars) : NULL;
+  m_targetPhraseOffsets = m_vocabChars ? MapSection<UINT64>(data, end, header.numTargetPhrases + 1) : NULL;
+  m_targetSymbols = m_targetPhraseOffsets ? MapSection<UINT32>(data, end, header.numTargetSymbols) : NULL;
+  m_alignmentOffsets = m_targetSymbols ? MapSection<UINT64>(data, end, header.numAlignments + 1) : NULL;
+  m_alignmentPoints = m_alignmentOffsets ? MapSection<UINT32>(data, end, 2 * header.numAlignmentPoints) : NULL;
+  m_rules = m_alignmentPoints ? MapSection<Rule>(data, end, header.numRules) : NULL;
+  m_scores = m_rules ? MapSection<float>(data, end, header.numRules * header.numScores) : NULL;
+  m_nodes = m_scores ? MapSection<Node>(data, end, header.numNodes) : NULL;
+  m_terminalEdges = m_nodes ? MapSection<TerminalEdge>(data, end, header.numTerminalEdges) : NULL;
+  m_nonTerminalEdges = m_terminalEdges ? MapSection<NonTerminalEdge>(data, end, header.numNonTerminalEdges) : NULL;
+  if (m_nonTerminalEdges == NULL || data != end || header.numNodes == 0) {
+    UserMessage::Add(filePath + " is truncated or corrupt");
+    m_memory.reset();
+    return false;
+  }
+
+  // every offset and id is checked once here, so that lookups can trust them
+  const char *corruptSection = NULL;
+  if (!ValidOffsets(m_vocabOffsets, header.vocabSize, header.vocabChars, 0)) {
+    corruptSection = "vocabulary offsets";
+  } else if (!ValidIds(m_sortedVocab, header.vocabSize, header.vocabSize)) {
+    corruptSection = "sorted vocabulary ids";
+  } else if (!ValidOffsets(m_targetPhraseOffsets, header.numTargetPhrases, header.numTargetSymbols, 1)) {
+    corruptSection = "target phrase offsets";
+  } else if (!ValidIds(m_targetSymbols, header.numTargetSymbols, header.vocabSize)) {
+    corruptSection = "target phrase symbols";
+  } else if (!ValidOffsets(m_alignmentOffsets, header.numAlignments, header.numAlignmentPoints, 0)) {
+    corruptSection = "alignment offsets";
+  } else if (!ValidEdges(m_terminalEdges, header.numTerminalEdges, header.numNodes)) {
+    corruptSection = "terminal edges";
+  } else if (!ValidEdges(m_nonTerminalEdges, header.numNonTerminalEdges, header.numNodes)) {
+    corruptSection = "non-terminal edges";
+  }
+  for (uint64_t i = 0; corruptSection == NULL && i < header.numRules; ++i) {
+    if (m_rules[i].targetPhrase >= header.numTargetPhrases || m_rules[i].alignment >= header.numAlignments) {
+      corruptSection = "rules";
+    }
+  }
+  for (uint64_t i = 0; corruptSection == NULL && i < header.numNodes; ++i) {
+    const Node &node = m_nodes[i];
+    if (!ValidRange(node.firstRule, node.numRules, header.numRules)
+        || !ValidRange(node.firstTerminalEdge, node.numTerminalEdges, header.numTerminalEdges)
+        || !ValidRange(node.firstNonTerminalEdge, node.numNonTerminalEdges, header.numNonTerminalEdges)) {
+      corruptSection = "prefix tree nodes";
+    }
+  }
+  if (corruptSection != NULL) {
+    UserMessage::Add(filePath + " is corrupt: " + corruptSection + " hold an offset or id out of range");
+    m_memory.reset();
+    return false;
+  }
+
+  m_filePath = filePath;
+  m_inputFactors = input;
+  m_outputFactors = output;
+  m_weight = weight;
+  m_tableLimit = tableLimit;
+  m_languageModels = &languageModels;
+  m_wpProducer = wpProducer;
+  m_numScores = header.numScores;
+  m_vocabSize = header.vocabSize;
+  return true;
+}
+
+const PhraseDictionaryCompactBinary::Node *PhraseDictionaryCompactBinary::GetChild(
+  const Node &node, UINT32 symbol) const
+{
+  const TerminalEdge *begin = m_terminalEdges + node.firstTerminalEdge;
+  const TerminalEdge *end = begin + node.numTerminalEdges;
+  const TerminalEdge *edge = std::lower_bound(begin, end, symbol, TerminalEdgeLess);
+  if (edge == end || edge->symbol != symbol) {
+    return NULL;
+  }
+  return &m_nodes[edge->child];
+}
+
+const PhraseDictionaryCompactBinary::Node *PhraseDictionaryCompactBinary::GetChild(
+  const Node &node, UINT32 sourceLabel, UINT32 targetLabel) const
+{
+  const NonTerminalEdge *begin = BeginNonTerminalEdges(node);
+  const NonTerminalEdge *end = EndNonTerminalEdges(node);
+  const NonTerminalEdge *edge = std::lower_bound(
+                                  begin, end, std::make_pair(sourceLabel, targetLabel), NonTerminalEdgeLess);
+  if (edge == end || edge->sourceLabel != sourceLabel || edge->targetLabel != targetLabel) {
+    return NULL;
+  }
+  return &m_nodes[edge->child];
+}
+
+bool PhraseDictionaryCompactBinary::FindSymbol(const std::string &symbol, UINT32 &id) const
+{
+  // binary search over the ids in order of their text
+  UINT64 lower = 0, upper = m_vocabSize;
+  while (lower < upper) {
+    const UINT64 middle = lower + (upper - lower) / 2;
+    const UINT32 candidate = m_sortedVocab[middle];
+    const int cmp = CompareSymbol(symbol, m_vocabChars + m_vocabOffsets[candidate],
+                                  m_vocabOffsets[candidate+1] - m_vocabOffsets[candidate]);
+    if (cmp == 0) {
+      id = candidate;
+      return true;
+    } else if (cmp < 0) {
+      upper = middle;
+    } else {
+      lower = middle + 1;
+    }
+  }
+  return false;
+}
+
+std::string PhraseDictionaryCompactBinary::GetSymbol(UINT32 id) const
+{
+  return std::string(m_vocabChars + m_vocabOffsets[id],
+                     m_vocabOffsets[id+1] - m_vocabOffsets[id]);
+}
+
+const Word &PhraseDictionaryCompactBinary::GetTargetWord(
+  UINT32 id, std::map<UINT32, Word> &wordCache) const
+{
+  std::map<UINT32, Word>::iterator iter = wordCache.find(id);
+  if (iter != wordCache.end()) {
+    return iter->second;
+  }
+  Word &word = wordCache[id];
+  std::string symbol = GetSymbol(id);
+  const bool isNonTerm = IsNonTerminal(symbol);
+  if (isNonTerm) {
+    symbol = symbol.substr(1, symbol.size()-2);
+  }
+  word.CreateFromString(Output, m_outputFactors, symbol, isNonTerm);
+  return word;
+}
+
+TargetPhraseCollection *PhraseDictionaryCompactBinary::CreateTargetPhraseCollection(
+  const Node &node, std::map<UINT32, Word> &wordCache) const
+{
+  TargetPhraseCollection *coll = new TargetPhraseCollection();
+  Scores scoreVector(m_numScores);
+  std::set<std::pair<size_t, size_t> > alignmentInfo;
+  for (UINT64 i = node.firstRule; i < node.firstRule + node.numRules; ++i) {
+    const Rule &rule = m_rules[i];
+
+    // the first symbol is the LHS
+    const UINT64 symbolsBegin = m_targetPhraseOffsets[rule.targetPhrase];
+    const UINT64 symbolsEnd = m_targetPhraseOffsets[rule.targetPhrase+1];
+    Phrase targetPhrasePhrase(symbolsEnd - symbolsBegin - 1);
+    for (UINT64 j = symbolsBegin + 1; j < symbolsEnd; ++j) {
+      targetPhrasePhrase.AddWord(GetTargetWord(m_targetSymbols[j], wordCache));
+    }
+
+    alignmentInfo.clear();
+    for (UINT64 j = m_alignmentOffsets[rule.alignment]; j < m_alignmentOffsets[rule.alignment+1]; ++j) {
+      alignmentInfo.insert(std::make_pair(m_alignmentPoints[2*j], m_alignmentPoints[2*j+1]));
+    }
+
+    for (size_t j = 0; j < m_numScores; ++j) {
+      scoreVector[j] = FloorScore(TransformScore(m_scores[i * m_numScores + j]));
+    }
+
+    TargetPhrase *targetPhrase = new TargetPhrase(targetPhrasePhrase);
+    targetPhrase->SetAlignmentInfo(alignmentInfo);
+    targetPhrase->SetTargetLHS(GetTargetWord(m_targetSymbols[symbolsBegin], wordCache));
+    targetPhrase->SetScoreChart(GetFeature(), scoreVector, m_weight,
+                                *m_languageModels, m_wpProducer);
+    coll->Add(targetPhrase);
+  }
+
+  coll->Sort(true, m_tableLimit);
+  return coll;
+}
+
+ChartRuleLookupManager *PhraseDictionaryCompactBinary::CreateRuleLookupManager(
+  const InputType &sentence,
+  const ChartCellCollection &cellCollection)
+{
+  return new ChartRuleLookupManagerCompactBinary(sentence, cellCollection, *this);
+}
+
+bool PhraseDictionaryCompactBinary::Create(std::istream &inStream, const std::string &outFilePath)
+{
+  std::string line;
+  std::vector<std::string> tokens;
+
+  // Read and check version number.
+  std::getline(inStream, line);
+  if (line != "1") {
+    std::cerr << "Error: unexpected compact rule table format: " << line << std::endl;
+    return false;
+  }
+
+  // Vocabulary.
+  uint64_t vocabSize;
+  if (!ReadCount(inStream, vocabSize)) {
+    std::cerr << "Error: missing vocabulary section" << std::endl;
+    return false;
+  }
+  std::vector<std::string> vocab(vocabSize);
+  std::vector<bool> isNonTerm(vocabSize);
+  for (uint64_t i = 0; i < vocabSize; ++i) {
+    std::getline(inStream, vocab[i]);
+    isNonTerm[i] = IsNonTerminal(vocab[i]);
+  }
+
+  // Source phrases, whose LHS is not needed.
+  uint64_t numSourcePhrases;
+  if (!ReadCount(inStream, numSourcePhrases)) {
+    std::cerr << "Error: missing source phrase section" << std::endl;
+    return false;
+  }
+  std::vector<uint64_t> sourceOffsets(1, 0);
+  std::vector<UINT32> sourceSymbols;
+  for (uint64_t i = 0; i < numSourcePhrases; ++i) {
+    std::getline(inStream, line);
+    tokens.clear();
+    Tokenize(tokens, line);
+    for (size_t j = 1; j < tokens.size(); ++j) {
+      sourceSymbols.push_back(std::atoi(tokens[j].c_str()));
+    }
+    sourceOffsets.push_back(sourceSymbols.size());
+  }
+
+  // Target phrases, LHS first.
+  uint64_t numTargetPhrases;
+  if (!ReadCount(inStream, numTargetPhrases)) {
+    std::cerr << "Error: missing target phrase section" << std::endl;
+    return false;
+  }
+  std::vector<uint64_t> targetOffsets(1, 0);
+  std::vector<UINT32> targetSymbols;
+  for (uint64_t i = 0; i < numTargetPhrases; ++i) {
+    std::getline(inStream, line);
+    tokens.clear();
+    Tokenize(tokens, line);
+    for (size_t j = 0; j < tokens.size(); ++j) {
+      targetSymbols.push_back(std::atoi(tokens[j].c_str()));
+    }
+    targetOffsets.push_back(targetSymbols.size());
+  }
+
+  // Alignment sets.
+  uint64_t numAlignments;
+  if (!ReadCount(inStream, numAlignments)) {
+    std::cerr << "Error: missing alignment section" << std::endl;
+    return false;
+  }
+  std::vector<uint64_t> alignmentOffsets(1, 0);
+  std::vector<UINT32> alignmentPoints;
+  std::vector<size_t> points;
+  for (uint64_t i = 0; i < numAlignments; ++i) {
+    std::getline(inStream, line);
+    tokens.clear();
+    Tokenize(tokens, line);
+    for (size_t j = 0; j < tokens.size(); ++j) {
+      points.clear();
+      Tokenize<size_t>(points, tokens[j], "-");
+      if (points.size() != 2) {
+        std::cerr << "Error: malformed alignment point " << tokens[j] << std::endl;
+        return false;
+      }
+      alignmentPoints.push_back(points[0]);
+      alignmentPoints.push_back(points[1]);
+    }
+    alignmentOffsets.push_back(alignmentPoints.size() / 2);
+  }
+
+  // Rules, with the prefix tree key of each.
+  uint64_t numRules;
+  if (!ReadCount(inStream, numRules)) {
+    std::cerr << "Error: missing rule section" << std::endl;
+    return false;
+  }
+  size_t numScores = 0;
+  std::vector<Rule> rules(numRules);
+  std::vector<float> scores;
+  std::vector<uint64_t> keyOffsets(1, 0);
+  std::vector<KeyEdge> keys;
+  for (uint64_t i = 0; i < numRules; ++i) {
+    std::getline(inStream, line);
+    tokens.clear();
+    Tokenize(tokens, line);
+    const size_t colon = std::find(tokens.begin(), tokens.end(), ":") - tokens.begin();
+    if (colon < 3 || (i > 0 && colon - 3 != numScores)) {
+      std::cerr << "Error: malformed rule " << i << ": " << line << std::endl;
+      return false;
+    }
+    numScores = colon - 3;
+
+    const uint64_t sourceId = std::atoi(tokens[0].c_str());
+    rules[i].targetPhrase = std::atoi(tokens[1].c_str());
+    rules[i].alignment = std::atoi(tokens[2].c_str());
+    if (sourceId >= numSourcePhrases || rules[i].targetPhrase >= numTargetPhrases
+        || rules[i].alignment >= numAlignments) {
+      std::cerr << "Error: unknown phrase or alignment in rule " << i << ": " << line << std::endl;
+      return false;
+    }
+    for (size_t j = 0; j < numScores; ++j) {
+      scores.push_back(Scan<float>(tokens[3+j]));
+    }
+
+    // Key each non-terminal by its label and the aligned target label.
+    const uint64_t targetBegin = targetOffsets[rules[i].targetPhrase] + 1;
+    const uint64_t targetSize = targetOffsets[rules[i].targetPhrase+1] - targetBegin;
+    for (uint64_t pos = sourceOffsets[sourceId]; pos < sourceOffsets[sourceId+1]; ++pos) {
+      const UINT32 symbol = sourceSymbols[pos];
+      if (!isNonTerm[symbol]) {
+        keys.push_back(KeyEdge(symbol, NoLabel));
+        continue;
+      }
+      const UINT32 sourcePos = pos - sourceOffsets[sourceId];
+      uint64_t point = alignmentOffsets[rules[i].alignment];
+      while (point < alignmentOffsets[rules[i].alignment+1] && alignmentPoints[2*point] != sourcePos) {
+        ++point;
+      }
+      if (point == alignmentOffsets[rules[i].alignment+1] || alignmentPoints[2*point+1] >= targetSize) {
+        std::cerr << "Error: unaligned non-terminal in rule " << i << ": " << line << std::endl;
+        return false;
+      }
+      keys.push_back(KeyEdge(symbol, targetSymbols[targetBegin + alignmentPoints[2*point+1]]));
+    }
+    keyOffsets.push_back(keys.size());
+  }
+
+  // Group the rules by prefix tree node.
+  std::vector<uint64_t> order(numRules);
+  for (uint64_t i = 0; i < numRules; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), KeyOrder(keyOffsets, keys));
+
+  PrefixTreeBuilder builder(keyOffsets, keys, order);
+  builder.m_nodes.push_back(Node());
+  builder.Build(0, 0, numRules, 0);
+
+  std::vector<Rule> sortedRules(numRules);
+  std::vector<float> sortedScores(scores.size());
+  for (uint64_t i = 0; i < numRules; ++i) {
+    sortedRules[i] = rules[order[i]];
+    std::copy(scores.begin() + order[i] * numScores, scores.begin() + (order[i] + 1) * numScores,
+              sortedScores.begin() + i * numScores);
+  }
+
+  // Vocabulary text, and ids in order of their text for FindSymbol().
+  std::vector<uint64_t> vocabOffsets(1, 0);
+  std::vector<char> vocabChars;
+  for (uint64_t i = 0; i < vocabSize; ++i) {
+    vocabChars.insert(vocabChars.end(), vocab[i].begin(), vocab[i].end());
+    vocabOffsets.push_back(vocabChars.size());
+  }
+  std::vector<UINT32> sortedVocab(vocabSize);
+  for (uint64_t i = 0; i < vocabSize; ++i) {
+    sortedVocab[i] = i;
+  }
+  std::sort(sortedVocab.begin(), sortedVocab.end(), VocabOrder(vocab));
+
+  CompactBinaryHeader header;
+  memcpy(header.magic, CompactBinaryMagic, sizeof(header.magic));
+  header.version = CompactBinaryVersion;
+  header.numScores = numScores;
+  header.vocabSize = vocabSize;
+  header.vocabChars = vocabChars.size();
+  header.numTargetPhrases = numTargetPhrases;
+  header.numTargetSymbols = targetSymbols.size();
+  header.numAlignments = numAlignments;
+  header.numAlignmentPoints = alignmentPoints.size() / 2;
+  header.numRules = numRules;
+  header.numNodes = builder.m_nodes.size();
+  header.numTerminalEdges = builder.m_terminalEdges.size();
+  header.numNonTerminalEdges = builder.m_nonTerminalEdges.size();
+
+  std::ofstream outFile(outFilePath.c_str(), std::ios::out | std::ios::binary);
+  if (!outFile.good()) {
+    std::cerr << "Error: couldn't open " << outFilePath << " for writing" << std::endl;
+    return false;
+  }
+  outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  WriteSection(outFile, vocabOffsets);
+  WriteSection(outFile, sortedVocab);
+  WriteSection(outFile, vocabChars);
+  WriteSection(outFile, targetOffsets);
+  WriteSection(outFile, targetSymbols);
+  WriteSection(outFile, alignmentOffsets);
+  WriteSection(outFile, alignmentPoints);
+  WriteSection(outFile, sortedRules);
+  WriteSection(outFile, sortedScores);
+  WriteSection(outFile, builder.m_nodes);
+  WriteSection(outFile, builder.m_terminalEdges);
+  WriteSection(outFile, builder.m_nonTerminalEdges);
+  outFile.close();
+  if (!outFile) {
+    std::cerr << "Error: couldn't write " << outFilePath << std::endl;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace Moses
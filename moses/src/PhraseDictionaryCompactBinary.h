@@ -0,0 +1,171 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "util/mmap.hh"
+#include "PhraseDictionary.h"
+#include "TypeDef.h"
+#include "Word.h"
+
+namespace Moses
+{
+
+class LMList;
+class WordPenaltyProducer;
+
+/** Rule table in the binary successor of the compact format, see Create().
+ * The file is memory-mapped and its prefix tree is searched in place, so
+ * loading only has to check the offsets of each section.  Target phrases are
+ * only decoded when a rule is applicable to a sentence, by the
+ * ChartRuleLookupManager.
+ */
+class PhraseDictionaryCompactBinary : public PhraseDictionary
+{
+ public:
+  // A node of the source prefix tree.  The rules, terminal children and
+  // non-terminal children of a node are each stored contiguously.
+  struct Node {
+    UINT64 firstRule;
+    UINT64 firstTerminalEdge;
+    UINT64 firstNonTerminalEdge;
+    UINT32 numRules;
+    UINT32 numTerminalEdges;
+    UINT32 numNonTerminalEdges;
+    UINT32 padding;
+  };
+
+  // sorted by symbol
+  struct TerminalEdge {
+    UINT32 symbol;
+    UINT32 child;
+  };
+
+  // sorted by source label, then target label
+  struct NonTerminalEdge {
+    UINT32 sourceLabel;
+    UINT32 targetLabel;
+    UINT32 child;
+  };
+
+  struct Rule {
+    UINT32 targetPhrase;
+    UINT32 alignment;
+  };
+
+  PhraseDictionaryCompactBinary(size_t numScoreComponents,
+                                const PhraseDictionaryFeature* feature);
+
+  bool Load(const std::vector<FactorType> &input
+            , const std::vector<FactorType> &output
+            , const std::string &filePath
+            , const std::vector<float> &weight
+            , size_t tableLimit
+            , const LMList &languageModels
+            , const WordPenaltyProducer* wpProducer);
+
+  //! convert a rule table in the compact text format to the binary format
+  static bool Create(std::istream &inStream, const std::string &outFilePath);
+
+  const std::string &GetFilePath() const { return m_filePath; }
+
+  const Node &GetRootNode() const { return m_nodes[0]; }
+  bool IsLeaf(const Node &node) const {
+    return node.numTerminalEdges == 0 && node.numNonTerminalEdges == 0;
+  }
+  const NonTerminalEdge *BeginNonTerminalEdges(const Node &node) const {
+    return m_nonTerminalEdges + node.firstNonTerminalEdge;
+  }
+  const NonTerminalEdge *EndNonTerminalEdges(const Node &node) const {
+    return BeginNonTerminalEdges(node) + node.numNonTerminalEdges;
+  }
+  const Node &GetChild(const NonTerminalEdge &edge) const {
+    return m_nodes[edge.child];
+  }
+
+  //! child of node for a terminal symbol, or NULL
+  const Node *GetChild(const Node &node, UINT32 symbol) const;
+  //! child of node for a pair of non-terminal labels, or NULL
+  const Node *GetChild(const Node &node, UINT32 sourceLabel, UINT32 targetLabel) const;
+
+  //! vocabulary id of a symbol, non-terminal labels in brackets
+  bool FindSymbol(const std::string &symbol, UINT32 &id) const;
+  std::string GetSymbol(UINT32 id) const;
+
+  /** create the scored target phrases of the rules at node.  Target words
+   * decoded so far are kept in wordCache.
+   */
+  TargetPhraseCollection *CreateTargetPhraseCollection(
+    const Node &node, std::map<UINT32, Word> &wordCache) const;
+
+  // Required by PhraseDictionary.
+  const TargetPhraseCollection *GetTargetPhraseCollection(const Phrase &) const
+  {
+    CHECK(false);
+    return NULL;
+  }
+
+  void InitializeForInput(const InputType&) {
+    // Nothing to do: sentence-specific state is stored in ChartRuleLookupManager
+  }
+
+  void CleanUp() {
+    // Nothing to do: sentence-specific state is stored in ChartRuleLookupManager
+  }
+
+  ChartRuleLookupManager *CreateRuleLookupManager(
+    const InputType &,
+    const ChartCellCollection &);
+
+  const std::vector<FactorType> &GetInputFactors() const { return m_inputFactors; }
+  const std::vector<FactorType> &GetOutputFactors() const { return m_outputFactors; }
+
+ private:
+  const Word &GetTargetWord(UINT32 id, std::map<UINT32, Word> &wordCache) const;
+
+  util::scoped_memory m_memory;
+  std::string m_filePath;
+  std::vector<FactorType> m_inputFactors, m_outputFactors;
+  std::vector<float> m_weight;
+  const LMList *m_languageModels;
+  const WordPenaltyProducer *m_wpProducer;
+  size_t m_numScores;
+
+  // sections of the mapped file
+  UINT64 m_vocabSize;
+  const UINT64 *m_vocabOffsets;
+  const UINT32 *m_sortedVocab;
+  const char *m_vocabChars;
+  const UINT64 *m_targetPhraseOffsets;
+  const UINT32 *m_targetSymbols;
+  const UINT64 *m_alignmentOffsets;
+  const UINT32 *m_alignmentPoints;
+  const Rule *m_rules;
+  const float *m_scores;
+  const Node *m_nodes;
+  const TerminalEdge *m_terminalEdges;
+  const NonTerminalEdge *m_nonTerminalEdges;
+};
+
+}  // namespace Moses
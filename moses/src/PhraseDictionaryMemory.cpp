@@ -195,6 +195,15 @@ const TargetPhraseCollection *PhraseDictionaryMemory::GetTargetPhraseCollection(
   return currNode->GetTargetPhraseCollection();
 }
 
+void PhraseDictionaryMemory::SetWeights(const std::vector<float> &weightT)
+{
+  m_collection.SetWeights(GetFeature(), weightT);
+
+  // future scores have changed, re-sort each target phrase collection.
+  // Phrases pruned by the table limit while loading can't come back
+  m_collection.Sort(m_tableLimit);
+}
+
 PhraseDictionaryMemory::~PhraseDictionaryMemory()
 {
 }
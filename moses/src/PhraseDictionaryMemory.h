@@ -57,6 +57,11 @@ public:
 
   const TargetPhraseCollection *GetTargetPhraseCollection(const Phrase &source) const;
 
+  /** change the translation model weights of all loaded phrases. Not to be called while sentences are decoded.
+   *  Only the phrases kept by the table limit at load time are re-ranked: the ones it
+   *  pruned under the old weights are gone, even if they would rank high under the new ones */
+  void SetWeights(const std::vector<float> &weightT);
+
   // for mert
   virtual void InitializeForInput(InputType const&) {
     /* Don't do anything source specific here as this object is shared between threads.*/
@@ -43,6 +43,18 @@ void PhraseDictionaryNode::Sort(size_t tableLimit)
     m_targetPhraseCollection->NthElement(tableLimit);
 }
 
+void PhraseDictionaryNode::SetWeights(const ScoreProducer* translationScoreProducer, const std::vector<float> &weightT)
+{
+  // recursively re-weight
+  NodeMap::iterator iter;
+  for (iter = m_map.begin() ; iter != m_map.end() ; ++iter) {
+    iter->second.SetWeights(translationScoreProducer, weightT);
+  }
+
+  if (m_targetPhraseCollection != NULL)
+    m_targetPhraseCollection->SetWeights(translationScoreProducer, weightT);
+}
+
 PhraseDictionaryNode *PhraseDictionaryNode::GetOrCreateChild(const Word &word)
 {
   NodeMap::iterator iter = m_map.find(word);
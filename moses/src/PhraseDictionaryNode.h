@@ -56,6 +56,7 @@ public:
   ~PhraseDictionaryNode();
 
   void Sort(size_t tableLimit);
+  void SetWeights(const ScoreProducer* translationScoreProducer, const std::vector<float> &weightT);
   PhraseDictionaryNode *GetOrCreateChild(const Word &word);
   const PhraseDictionaryNode *GetChild(const Word &word) const;
   const TargetPhraseCollection *GetTargetPhraseCollection() const {
@@ -37,7 +37,7 @@ class PhraseDictionarySCFG : public PhraseDictionary
 
  public:
   PhraseDictionarySCFG(size_t numScoreComponents,
-                       PhraseDictionaryFeature* feature)
+                       const PhraseDictionaryFeature* feature)
       : PhraseDictionary(numScoreComponents, feature) {}
 
   virtual ~PhraseDictionarySCFG();
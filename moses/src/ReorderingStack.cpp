@@ -5,6 +5,7 @@
 */
 
 #include "ReorderingStack.h"
+#include "FFState.h"
 #include <vector>
 
 namespace Moses
@@ -20,6 +21,16 @@ int ReorderingStack::Compare(const ReorderingStack& o)  const
   return 0;
 }
 
+uint64_t ReorderingStack::GetHash() const
+{
+  uint64_t seed = m_stack.size();
+  for (std::vector<WordsRange>::const_iterator iter = m_stack.begin(); iter != m_stack.end(); ++iter) {
+    FFState::CombineHash(seed, iter->GetStartPos());
+    FFState::CombineHash(seed, iter->GetEndPos());
+  }
+  return seed;
+}
+
 // Method to push (shift element into the stack and reduce if reqd)
 int ReorderingStack::ShiftReduce(WordsRange input_span)
 {
@@ -8,6 +8,7 @@
 
 //#include <string>
 #include <vector>
+#include <stdint.h>
 //#include "Factor.h"
 //#include "Phrase.h"
 //#include "TypeDef.h"
@@ -28,6 +29,8 @@ private:
 public:
 
   int Compare(const ReorderingStack& o) const;
+  //! hash over the spans on the stack, consistent with Compare()
+  uint64_t GetHash() const;
   int ShiftReduce(WordsRange input_span);
 
 private:
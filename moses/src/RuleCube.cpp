@@ -37,10 +37,13 @@ namespace Moses
 // initialise the RuleCube by creating the top-left corner item
 RuleCube::RuleCube(const ChartTranslationOption &transOpt,
                    const ChartCellCollection &allChartCells,
-                   ChartManager &manager)
+                   ChartManager &manager,
+                   RuleCubeItemPool &itemPool)
   : m_transOpt(transOpt)
+  , m_itemPool(itemPool)
 {
-  RuleCubeItem *item = new RuleCubeItem(transOpt, allChartCells);
+  RuleCubeItem *item = new (m_itemPool.getPtr()) RuleCubeItem(transOpt,
+                                                              allChartCells);
   m_covered.insert(item);
   if (StaticData::Instance().GetCubePruningLazyScoring()) {
     item->EstimateScore();
@@ -50,9 +53,9 @@ RuleCube::RuleCube(const ChartTranslationOption &transOpt,
   m_queue.push(item);
 }
 
+// the items themselves belong to m_itemPool
 RuleCube::~RuleCube()
 {
-  RemoveAllInColl(m_covered);
 }
 
 RuleCubeItem *RuleCube::Pop(ChartManager &manager)
@@ -85,10 +88,11 @@ void RuleCube::CreateNeighbors(const RuleCubeItem &item, ChartManager &manager)
 void RuleCube::CreateNeighbor(const RuleCubeItem &item, int dimensionIndex,
                               ChartManager &manager)
 {
-  RuleCubeItem *newItem = new RuleCubeItem(item, dimensionIndex);
+  RuleCubeItem *newItem = new (m_itemPool.getPtr()) RuleCubeItem(item,
+                                                                 dimensionIndex);
   std::pair<ItemSet::iterator, bool> result = m_covered.insert(newItem);
   if (!result.second) {
-    delete newItem;  // already seen it
+    m_itemPool.freeObject(newItem);  // already seen it
   } else {
     if (StaticData::Instance().GetCubePruningLazyScoring()) {
       newItem->EstimateScore();
@@ -25,6 +25,7 @@
 #include "config.h"
 #endif
 
+#include "ObjectPool.h"
 #include "RuleCubeItem.h"
 
 #include <boost/functional/hash.hpp>
@@ -84,11 +85,15 @@ class RuleCubeItemEqualityPred
   }
 };
 
+// Items are allocated from a pool owned by the RuleCubeQueue of the cell
+// being processed and are all released together when the cell is finished.
+typedef ObjectPool<RuleCubeItem> RuleCubeItemPool;
+
 class RuleCube
 {
  public:
   RuleCube(const ChartTranslationOption &, const ChartCellCollection &,
-           ChartManager &);
+           ChartManager &, RuleCubeItemPool &);
 
   ~RuleCube();
 
@@ -128,6 +133,7 @@ class RuleCube
   void CreateNeighbor(const RuleCubeItem &, int, ChartManager &);
 
   const ChartTranslationOption &m_transOpt;
+  RuleCubeItemPool &m_itemPool;
   ItemSet m_covered;
   Queue m_queue;
 };
@@ -21,12 +21,23 @@
 
 #include "RuleCubeQueue.h"
 
+#include "ChartCell.h"
+#include "ChartManager.h"
 #include "RuleCubeItem.h"
 #include "StaticData.h"
+#include "TargetPhrase.h"
 
 namespace Moses
 {
 
+RuleCubeQueue::RuleCubeQueue(ChartManager &manager, const ChartCell &cell)
+  : m_manager(manager)
+  , m_cell(cell)
+  , m_itemPool("RuleCubeItem",
+               StaticData::Instance().GetCubePruningPopLimit() + 1)
+{
+}
+
 RuleCubeQueue::~RuleCubeQueue()
 {
   while (!m_queue.empty()) {
@@ -50,10 +61,22 @@ ChartHypothesis *RuleCubeQueue::Pop()
   // pop the most promising item from the cube and get the corresponding
   // hypothesis
   RuleCubeItem *item = cube->Pop(m_manager);
-  if (StaticData::Instance().GetCubePruningLazyScoring()) {
-    item->CreateHypothesis(cube->GetTranslationOption(), m_manager);
+  ChartHypothesis *hypo = NULL;
+  const StaticData &staticData = StaticData::Instance();
+  if (!staticData.GetCubePruningLazyScoring()) {
+    hypo = item->ReleaseHypothesis();
+  } else {
+    const TargetPhrase *targetPhrase =
+      item->GetTranslationDimension().GetTargetPhrase();
+    if (staticData.GetCubePruningEarlyDiscarding() &&
+        item->GetScore() < m_cell.GetThreshold(targetPhrase->GetTargetLHS())) {
+      // the stateful features are never evaluated for this item
+      m_manager.GetSentenceStats().AddEarlyDiscarded();
+    } else {
+      item->CreateHypothesis(cube->GetTranslationOption(), m_manager);
+      hypo = item->ReleaseHypothesis();
+    }
   }
-  ChartHypothesis *hypo = item->ReleaseHypothesis();
 
   // if the cube contains more items then push it back onto the queue
   if (!cube->IsEmpty()) {
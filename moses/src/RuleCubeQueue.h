@@ -33,6 +33,7 @@
 namespace Moses
 {
 
+class ChartCell;
 class ChartManager;
 
 // Define an ordering between RuleCube based on their best item scores.  This
@@ -48,19 +49,26 @@ class RuleCubeOrderer
 class RuleCubeQueue
 {
  public:
-  RuleCubeQueue(ChartManager &manager) : m_manager(manager) {}
+  RuleCubeQueue(ChartManager &, const ChartCell &);
   ~RuleCubeQueue();
 
   void Add(RuleCube *);
+
+  // Returns NULL if early discarding is enabled and the popped item's
+  // estimated score puts it outside the beam.
   ChartHypothesis *Pop();
   bool IsEmpty() const { return m_queue.empty(); }
 
+  RuleCubeItemPool &GetItemPool() { return m_itemPool; }
+
  private:
   typedef std::priority_queue<RuleCube*, std::vector<RuleCube*>,
                               RuleCubeOrderer > Queue;
 
   Queue m_queue;
   ChartManager &m_manager;
+  const ChartCell &m_cell;
+  RuleCubeItemPool m_itemPool;
 };
 
 }
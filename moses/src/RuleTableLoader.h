@@ -53,6 +53,14 @@ class RuleTableLoader
     ruleTable.SortAndPrune();
   }
 
+  // Sort and prune to tableLimit, which need not be the limit stored in
+  // ruleTable.
+  void SortAndPrune(PhraseDictionarySCFG &ruleTable, size_t tableLimit) {
+    if (tableLimit) {
+      ruleTable.m_collection.Sort(tableLimit);
+    }
+  }
+
   // Provide access to PhraseDictionarySCFG's private
   // GetOrCreateTargetPhraseCollection function.
   TargetPhraseCollection &GetOrCreateTargetPhraseCollection(
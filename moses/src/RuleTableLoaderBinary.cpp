@@ -0,0 +1,433 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "RuleTableLoaderBinary.h"
+
+#include "AlignmentInfoCollection.h"
+#include "LMList.h"
+#include "PhraseDictionarySCFG.h"
+#include "RuleTableLoaderStandard.h"
+#include "StaticData.h"
+#include "UserMessage.h"
+#include "Util.h"
+#include "Word.h"
+
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <stdint.h>
+
+namespace Moses
+{
+
+/* Layout of the binary rule table, all numbers in native byte order:
+ *   header   RuleTableBinaryHeader
+ *   vocab    vocabSize x (uint32 length, text).  Non-terminal labels keep
+ *            their brackets, e.g. "[NP]"
+ *   rules    numRules x (uint32 source LHS, uint32 source size, source ids,
+ *                        uint32 target LHS, uint32 target size, target ids,
+ *                        uint32 alignment size, alignment points as pairs
+ *                        of uint32, numScores x float)
+ * Scores are stored as found in a Moses format table, ie. Hiero scores have
+ * already been converted.  An empty source side is stored as LHS
+ * EmptySideId and size 0, whether it is used is decided when loading.
+ */
+namespace
+{
+const char RuleTableBinaryMagic[8] = {'m','o','s','e','s','r','t','b'};
+const uint32_t RuleTableBinaryVersion = 2;
+const uint32_t EmptySideId = 0xFFFFFFFF;
+
+struct RuleTableBinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t numScores;
+  uint32_t vocabSize;
+  uint32_t numRules;
+};
+
+template <class T> void AppendBinary(std::string &out, const T &value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+bool IsNonTerminal(const std::string &symbol)
+{
+  return symbol.size() >= 2 && symbol[0] == '[' && symbol[symbol.size()-1] == ']';
+}
+
+uint32_t GetVocabId(const std::string &symbol,
+                    std::map<std::string, uint32_t> &ids,
+                    std::vector<std::string> &vocab)
+{
+  std::pair<std::map<std::string, uint32_t>::iterator, bool> ret =
+    ids.insert(std::make_pair(symbol, (uint32_t) vocab.size()));
+  if (ret.second) {
+    vocab.push_back(symbol);
+  }
+  return ret.first->second;
+}
+
+// Append LHS, size and symbol ids of one side of a Moses format rule.  A
+// non-terminal [S][T] is stored as its source label [S] or target label [T].
+bool AppendSymbols(const std::string &phraseString, bool isSource,
+                   std::map<std::string, uint32_t> &ids,
+                   std::vector<std::string> &vocab, std::string &out)
+{
+  std::vector<std::string> tokens;
+  Tokenize(tokens, phraseString);
+  if (tokens.empty() || !IsNonTerminal(tokens.back())) {
+    return false;
+  }
+
+  AppendBinary(out, GetVocabId(tokens.back(), ids, vocab));
+  AppendBinary(out, (uint32_t) (tokens.size() - 1));
+  for (size_t i = 0; i < tokens.size() - 1; ++i) {
+    std::string symbol = tokens[i];
+    if (IsNonTerminal(symbol)) {
+      size_t nextPos = symbol.find("[", 1);
+      if (nextPos == std::string::npos) {
+        return false;
+      }
+      symbol = isSource ? symbol.substr(0, nextPos) : symbol.substr(nextPos);
+    }
+    AppendBinary(out, GetVocabId(symbol, ids, vocab));
+  }
+  return true;
+}
+
+// Sequential reader over the loaded file.  Reading past the end yields zeros
+// and clears IsGood().
+class BinaryReader
+{
+ public:
+  BinaryReader(const std::string &data)
+    : m_pos(data.data()), m_end(data.data() + data.size()), m_good(true) {}
+
+  template <class T> T Read() {
+    T value = T();
+    if ((size_t) (m_end - m_pos) < sizeof(T)) {
+      m_good = false;
+      m_pos = m_end;
+    } else {
+      memcpy(&value, m_pos, sizeof(T));
+      m_pos += sizeof(T);
+    }
+    return value;
+  }
+
+  std::string ReadString() {
+    const uint32_t length = Read<uint32_t>();
+    if ((size_t) (m_end - m_pos) < length) {
+      m_good = false;
+      m_pos = m_end;
+      return std::string();
+    }
+    std::string ret(m_pos, length);
+    m_pos += length;
+    return ret;
+  }
+
+  bool IsGood() const { return m_good; }
+
+ private:
+  const char *m_pos, *m_end;
+  bool m_good;
+};
+
+// Words for one side of the rules, created from the vocabulary on first use.
+class BinaryVocabulary
+{
+ public:
+  BinaryVocabulary(const std::vector<std::string> &symbols,
+                   FactorDirection direction,
+                   const std::vector<FactorType> &factorOrder)
+    : m_symbols(symbols)
+    , m_direction(direction)
+    , m_factorOrder(factorOrder)
+    , m_words(symbols.size())
+    , m_created(symbols.size(), false) {}
+
+  // NULL if id is not in the vocabulary
+  const Word *Get(uint32_t id) {
+    if (id >= m_words.size()) {
+      return NULL;
+    }
+    if (!m_created[id]) {
+      const std::string &symbol = m_symbols[id];
+      if (IsNonTerminal(symbol)) {
+        m_words[id].CreateFromString(m_direction, m_factorOrder, symbol.substr(1, symbol.size() - 2), true);
+      } else {
+        m_words[id].CreateFromString(m_direction, m_factorOrder, symbol, false);
+      }
+      m_created[id] = true;
+    }
+    return &m_words[id];
+  }
+
+ private:
+  const std::vector<std::string> &m_symbols;
+  FactorDirection m_direction;
+  const std::vector<FactorType> &m_factorOrder;
+  std::vector<Word> m_words;
+  std::vector<bool> m_created;
+};
+
+// Read LHS and symbols of one side of a rule into phrase.  lhs is not set
+// if the side is empty.
+bool ReadSymbols(BinaryReader &reader, BinaryVocabulary &vocab,
+                 Phrase &phrase, Word &lhs, bool &isEmpty)
+{
+  const uint32_t lhsId = reader.Read<uint32_t>();
+  const uint32_t size = reader.Read<uint32_t>();
+  isEmpty = (lhsId == EmptySideId);
+  if (isEmpty) {
+    return size == 0 && reader.IsGood();
+  }
+  const Word *lhsWord = vocab.Get(lhsId);
+  if (lhsWord == NULL || !lhsWord->IsNonTerminal()) {
+    return false;
+  }
+  lhs = *lhsWord;
+  for (uint32_t i = 0; i < size; ++i) {
+    const Word *word = vocab.Get(reader.Read<uint32_t>());
+    if (word == NULL) {
+      return false;
+    }
+    phrase.AddWord(*word);
+  }
+  return reader.IsGood();
+}
+}
+
+bool RuleTableLoaderBinary::IsBinary(const std::string &header)
+{
+  return header.size() >= sizeof(RuleTableBinaryMagic)
+      && memcmp(header.data(), RuleTableBinaryMagic, sizeof(RuleTableBinaryMagic)) == 0;
+}
+
+bool RuleTableLoaderBinary::Load(const std::vector<FactorType> &input,
+                                 const std::vector<FactorType> &output,
+                                 std::istream &inStream,
+                                 const std::vector<float> &weight,
+                                 size_t tableLimit,
+                                 const LMList &languageModels,
+                                 const WordPenaltyProducer* wpProducer,
+                                 PhraseDictionarySCFG &ruleTable)
+{
+  PrintUserTime("Start loading binary rule table");
+
+  const StaticData &staticData = StaticData::Instance();
+
+  const std::string data((std::istreambuf_iterator<char>(inStream)),
+                         std::istreambuf_iterator<char>());
+  BinaryReader reader(data);
+
+  // Read and check header.
+  RuleTableBinaryHeader header = reader.Read<RuleTableBinaryHeader>();
+  if (!reader.IsGood() || !IsBinary(data)
+      || header.version < 1 || header.version > RuleTableBinaryVersion) {
+    std::stringstream msg;
+    msg << "Unexpected binary rule table format: " << ruleTable.GetFilePath();
+    UserMessage::Add(msg.str());
+    return false;
+  }
+  const size_t numScoreComponents =
+      ruleTable.GetFeature()->GetNumScoreComponents();
+  if (header.numRules > 0 && header.numScores != numScoreComponents) {
+    std::stringstream msg;
+    msg << "Size of scoreVector != number (" << header.numScores << "!="
+        << numScoreComponents << ") of score components in "
+        << ruleTable.GetFilePath();
+    UserMessage::Add(msg.str());
+    return false;
+  }
+
+  // Load vocabulary.
+  std::vector<std::string> symbols(header.vocabSize);
+  for (uint32_t i = 0; i < header.vocabSize; ++i) {
+    symbols[i] = reader.ReadString();
+  }
+  BinaryVocabulary sourceVocab(symbols, Input, input);
+  BinaryVocabulary targetVocab(symbols, Output, output);
+
+  // Read rules and add to table.
+  std::vector<float> scoreVector(numScoreComponents);
+  std::set<std::pair<size_t,size_t> > alignmentInfo;
+  for (uint32_t i = 0; i < header.numRules; ++i) {
+    Word sourceLHS, targetLHS;
+    Phrase sourcePhrase(0);
+    std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(Output));
+    bool isSourceEmpty, isTargetEmpty;
+    if (!ReadSymbols(reader, sourceVocab, sourcePhrase, sourceLHS, isSourceEmpty)
+        || !ReadSymbols(reader, targetVocab, *targetPhrase, targetLHS, isTargetEmpty)
+        || isTargetEmpty) {
+      std::stringstream msg;
+      msg << "Corrupt binary rule table " << ruleTable.GetFilePath()
+          << " at rule " << i;
+      UserMessage::Add(msg.str());
+      return false;
+    }
+
+    alignmentInfo.clear();
+    const uint32_t alignmentSize = reader.Read<uint32_t>();
+    for (uint32_t j = 0; j < alignmentSize && reader.IsGood(); ++j) {
+      const uint32_t sourcePos = reader.Read<uint32_t>();
+      const uint32_t targetPos = reader.Read<uint32_t>();
+      alignmentInfo.insert(std::pair<size_t,size_t>(sourcePos, targetPos));
+    }
+
+    for (size_t j = 0; j < numScoreComponents; ++j) {
+      scoreVector[j] = FloorScore(TransformScore(reader.Read<float>()));
+    }
+
+    if (!reader.IsGood()) {
+      std::stringstream msg;
+      msg << "Truncated binary rule table " << ruleTable.GetFilePath();
+      UserMessage::Add(msg.str());
+      return false;
+    }
+
+    if (isSourceEmpty) {
+      if (!staticData.IsWordDeletionEnabled()) {
+        TRACE_ERR( ruleTable.GetFilePath() << ":" << i << ": pt entry contains empty source, skipping\n");
+        continue;
+      }
+      sourceLHS = staticData.GetInputDefaultNonTerminal();
+    }
+
+    targetPhrase->SetAlignmentInfo(AlignmentInfoCollection::Instance().Add(alignmentInfo));
+    targetPhrase->SetTargetLHS(targetLHS);
+    targetPhrase->SetScoreChart(ruleTable.GetFeature(), scoreVector, weight,
+                                languageModels, wpProducer);
+
+    TargetPhraseCollection &coll = GetOrCreateTargetPhraseCollection(
+        ruleTable, sourcePhrase, *targetPhrase, sourceLHS);
+    coll.Add(targetPhrase.release());
+  }
+
+  // Sort and prune each target phrase collection.
+  SortAndPrune(ruleTable, tableLimit);
+
+  return true;
+}
+
+bool RuleTableLoaderBinary::Create(std::istream &inStream,
+                                   std::ostream &outStream)
+{
+  std::map<std::string, uint32_t> ids;
+  std::vector<std::string> vocab;
+  std::string rules;
+  uint32_t numRules = 0;
+  size_t numScores = 0;
+  bool isHiero = false;
+
+  std::string lineOrig;
+  size_t lineNum = 0;
+  while (getline(inStream, lineOrig)) {
+    ++lineNum;
+    if (lineNum == 1) {
+      // same test as RuleTableLoaderFactory
+      std::vector<std::string> tokens;
+      Tokenize(tokens, lineOrig);
+      isHiero = (tokens.size() >= 2 && tokens[0] == "[X]" && tokens[1] == "|||");
+    }
+
+    std::auto_ptr<std::string> reformatted;
+    if (isHiero) {
+      reformatted.reset(ReformatHieroRule(lineOrig));
+    }
+    const std::string &line = isHiero ? *reformatted : lineOrig;
+
+    std::vector<std::string> tokens;
+    TokenizeMultiCharSeparator(tokens, line, "|||");
+    if (tokens.size() != 4 && tokens.size() != 5) {
+      std::cerr << "Syntax error on line " << lineNum << std::endl;
+      return false;
+    }
+
+    // rules with an empty source side are kept, the decoder uses them only
+    // if word deletion is enabled
+    const bool isSourceEmpty =
+        (tokens[0].find_first_not_of(" \t", 0) == std::string::npos);
+
+    std::vector<float> scoreVector;
+    Tokenize<float>(scoreVector, tokens[2]);
+    if (numRules == 0) {
+      numScores = scoreVector.size();
+    } else if (scoreVector.size() != numScores) {
+      std::cerr << "Size of scoreVector != number (" << scoreVector.size() << "!="
+                << numScores << ") of score components on line " << lineNum << std::endl;
+      return false;
+    }
+
+    if (isSourceEmpty) {
+      AppendBinary(rules, EmptySideId);
+      AppendBinary(rules, (uint32_t) 0);
+    } else if (!AppendSymbols(tokens[0], true, ids, vocab, rules)) {
+      std::cerr << "Malformed phrase on line " << lineNum << std::endl;
+      return false;
+    }
+    if (!AppendSymbols(tokens[1], false, ids, vocab, rules)) {
+      std::cerr << "Malformed phrase on line " << lineNum << std::endl;
+      return false;
+    }
+
+    std::vector<std::string> alignPoints;
+    Tokenize(alignPoints, tokens[3]);
+    AppendBinary(rules, (uint32_t) alignPoints.size());
+    for (size_t i = 0; i < alignPoints.size(); ++i) {
+      std::vector<size_t> points;
+      Tokenize<size_t>(points, alignPoints[i], "-");
+      if (points.size() != 2) {
+        std::cerr << "Malformed alignment on line " << lineNum << std::endl;
+        return false;
+      }
+      AppendBinary(rules, (uint32_t) points[0]);
+      AppendBinary(rules, (uint32_t) points[1]);
+    }
+
+    for (size_t i = 0; i < numScores; ++i) {
+      AppendBinary(rules, scoreVector[i]);
+    }
+    ++numRules;
+  }
+
+  RuleTableBinaryHeader header;
+  memcpy(header.magic, RuleTableBinaryMagic, sizeof(header.magic));
+  header.version = RuleTableBinaryVersion;
+  header.numScores = numScores;
+  header.vocabSize = vocab.size();
+  header.numRules = numRules;
+
+  std::string out;
+  AppendBinary(out, header);
+  for (size_t i = 0; i < vocab.size(); ++i) {
+    AppendBinary(out, (uint32_t) vocab[i].size());
+    out.append(vocab[i]);
+  }
+  outStream.write(out.data(), out.size());
+  outStream.write(rules.data(), rules.size());
+  return outStream.good();
+}
+
+}  // namespace Moses
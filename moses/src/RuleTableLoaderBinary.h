@@ -0,0 +1,62 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include "RuleTableLoader.h"
+#include "TypeDef.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Moses
+{
+
+class LMList;
+class PhraseDictionarySCFG;
+class WordPenaltyProducer;
+
+/** Loads a rule table from the binary format written by Create().  The
+ *  format is meant for the many small per-sentence grammars read by
+ *  PhraseDictionaryALSuffixArray: symbols are stored once in a vocabulary
+ *  and rules refer to them by id, so loading does no tokenizing or number
+ *  parsing and each symbol is interned only once.
+ */
+class RuleTableLoaderBinary : public RuleTableLoader
+{
+ public:
+  bool Load(const std::vector<FactorType> &input,
+            const std::vector<FactorType> &output,
+            std::istream &inStream,
+            const std::vector<float> &weight,
+            size_t tableLimit,
+            const LMList &languageModels,
+            const WordPenaltyProducer* wpProducer,
+            PhraseDictionarySCFG &);
+
+  //! whether a file starting with header is in the binary format
+  static bool IsBinary(const std::string &header);
+
+  //! convert a rule table in Moses or Hiero text format to the binary format
+  static bool Create(std::istream &inStream, std::ostream &outStream);
+};
+
+}  // namespace Moses
@@ -20,6 +20,7 @@
 #include "RuleTableLoaderFactory.h"
 
 #include "InputFileStream.h"
+#include "RuleTableLoaderBinary.h"
 #include "RuleTableLoaderCompact.h"
 #include "RuleTableLoaderHiero.h"
 #include "RuleTableLoaderStandard.h"
@@ -39,6 +40,9 @@ std::auto_ptr<RuleTableLoader> RuleTableLoaderFactory::Create(
   InputFileStream input(path);
   std::string line;
   std::getline(input, line);
+  if (RuleTableLoaderBinary::IsBinary(line)) {
+    return std::auto_ptr<RuleTableLoader>(new RuleTableLoaderBinary());
+  }
   std::vector<std::string> tokens;
   Tokenize(tokens, line);
   if (tokens.size() == 1) {
@@ -21,6 +21,8 @@
 
 #include "RuleTableLoader.h"
 
+#include <string>
+
 namespace Moses
 {
 
@@ -30,6 +32,10 @@ enum FormatType
   ,HieroFormat
 };
 
+// Rewrite a Hiero format rule as a Moses format rule.  The caller is
+// responsible for deleting the returned string.
+std::string *ReformatHieroRule(const std::string &lineOrig);
+
 class RuleTableLoaderStandard : public RuleTableLoader
 {
 protected:
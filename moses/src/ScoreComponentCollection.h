@@ -180,6 +180,11 @@ public:
     return res;
   }
 
+  //! index of the first score associated with a certain ScoreProducer
+  size_t GetBeginIndex(const ScoreProducer* sp) const {
+    return m_sim->GetBeginIndex(sp->GetScoreBookkeepingID());
+  }
+
   //! if a ScoreProducer produces a single score (for example, a language model score)
   //! this will return it.  If not, this method will throw
   float GetScoreForProducer(const ScoreProducer* sp) const {
@@ -1,12 +1,30 @@
 
+#include <algorithm>
+#include <utility>
 #include "Manager.h"
 #include "SearchCubePruning.h"
 #include "SearchNormal.h"
 #include "UserMessage.h"
+#include "Hypothesis.h"
+#include "HypothesisStack.h"
+#include "StaticData.h"
+#include "TranslationOptionCollection.h"
 
 namespace Moses
 {
 
+namespace
+{
+typedef std::pair<float, const TranslationOption*> MonotoneCandidate;
+
+//! orders the options considered by Search::CompleteMonotonically(), best estimate first
+struct MonotoneCandidateOrderer {
+  bool operator()(const MonotoneCandidate &a, const MonotoneCandidate &b) const {
+    return a.first > b.first;
+  }
+};
+}
+
 
 Search *Search::CreateSearch(Manager& manager, const InputType &source,
                              SearchAlgorithm searchAlgorithm, const TranslationOptionCollection &transOptColl)
@@ -26,6 +44,95 @@ Search *Search::CreateSearch(Manager& manager, const InputType &source,
 
 }
 
+Search::~Search()
+{
+  // the stacks of the subclass, which hold hypotheses extending these, are gone by now
+  std::vector<Hypothesis*>::iterator iter;
+  for (iter = m_monotoneHypotheses.begin() ; iter != m_monotoneHypotheses.end() ; ++iter) {
+    FREEHYPO(*iter);
+  }
+}
+
+bool Search::CompleteMonotonically(const TranslationOptionCollection &transOptColl)
+{
+  const std::vector < HypothesisStack* > &hypoStackColl = GetHypothesisStacks();
+
+  // start from the most advanced partial translation, or from scratch if
+  // that one can't be completed
+  std::vector < HypothesisStack* >::const_reverse_iterator iterStack = hypoStackColl.rbegin();
+  while (iterStack != hypoStackColl.rend() && (*iterStack)->GetBestHypothesis() == NULL) {
+    ++iterStack;
+  }
+  if (iterStack == hypoStackColl.rend()) {
+    return false;
+  }
+  Hypothesis *complete = CompleteMonotonically(*(*iterStack)->GetBestHypothesis(), transOptColl);
+  if (complete == NULL && *iterStack != hypoStackColl.front() && hypoStackColl.front()->GetBestHypothesis() != NULL) {
+    complete = CompleteMonotonically(*hypoStackColl.front()->GetBestHypothesis(), transOptColl);
+  }
+  if (complete == NULL) {
+    return false;
+  }
+  hypoStackColl.back()->AddPrune(complete);
+  return true;
 }
 
+Hypothesis *Search::CompleteMonotonically(const Hypothesis &hypo, const TranslationOptionCollection &transOptColl)
+{
+  const SquareMatrix &futureScore = transOptColl.GetFutureScore();
+  const size_t maxPhraseLength = StaticData::Instance().GetMaxPhraseLength();
+  const size_t numMonotone = m_monotoneHypotheses.size();
+
+  const Hypothesis *prevHypo = &hypo;
+  size_t startPos = hypo.GetWordsBitmap().GetFirstGapPos();
+  while (startPos != NOT_FOUND) {
+    const size_t gapEnd = prevHypo->GetWordsBitmap().GetEdgeToTheRightOf(startPos);
 
+    // rank the options at the start of the first gap by their own estimate
+    // and that of what they leave of the gap
+    std::vector<MonotoneCandidate> candidates;
+    for (size_t endPos = startPos ; endPos <= gapEnd && endPos - startPos < maxPhraseLength ; ++endPos) {
+      const float restScore = (endPos < gapEnd) ? futureScore.GetScore(endPos + 1, gapEnd) : 0.0f;
+      const TranslationOptionList &transOptList = transOptColl.GetTranslationOptionList(WordsRange(startPos, endPos));
+      TranslationOptionList::const_iterator iterTransOpt;
+      for (iterTransOpt = transOptList.begin() ; iterTransOpt != transOptList.end() ; ++iterTransOpt) {
+        candidates.push_back(MonotoneCandidate((*iterTransOpt)->GetFutureScore() + restScore, *iterTransOpt));
+      }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), MonotoneCandidateOrderer());
+
+    // take the best one that the constraint allows
+    Hypothesis *newHypo = NULL;
+    std::vector<MonotoneCandidate>::const_iterator iterCandidate;
+    for (iterCandidate = candidates.begin() ; newHypo == NULL && iterCandidate != candidates.end() ; ++iterCandidate) {
+      newHypo = prevHypo->CreateNext(*iterCandidate->second, m_constraint);
+    }
+    if (newHypo == NULL) {
+      // stuck, drop what was built for this attempt
+      while (m_monotoneHypotheses.size() > numMonotone) {
+        FREEHYPO(m_monotoneHypotheses.back());
+        m_monotoneHypotheses.pop_back();
+      }
+      return NULL;
+    }
+    newHypo->CalcScore(futureScore);
+    IFVERBOSE(3) {
+      newHypo->PrintHypothesis();
+    }
+
+    m_monotoneHypotheses.push_back(newHypo);
+    prevHypo = newHypo;
+    startPos = newHypo->GetWordsBitmap().GetFirstGapPos();
+  }
+
+  if (m_monotoneHypotheses.size() == numMonotone) {
+    // nothing was left to translate
+    return NULL;
+  }
+  // the complete hypothesis goes to the last stack instead
+  Hypothesis *complete = m_monotoneHypotheses.back();
+  m_monotoneHypotheses.pop_back();
+  return complete;
+}
+
+}
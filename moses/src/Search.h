@@ -21,8 +21,13 @@ public:
   virtual const Hypothesis *GetBestHypothesis() const = 0;
   virtual void ProcessSentence() = 0;
   Search(Manager& manager) : m_manager(manager) {}
-  virtual ~Search()
-  {}
+  virtual ~Search();
+
+  /** Complete the best partial translation by translating its gaps left to
+   *  right, taking the option with the best estimate at each step, and add
+   *  it to the last stack.  A bounded fallback for when pruning left no
+   *  complete translation.  Returns false if no option fits. */
+  bool CompleteMonotonically(const TranslationOptionCollection &transOptColl);
 
   // Factory
   static Search *CreateSearch(Manager& manager, const InputType &source, SearchAlgorithm searchAlgorithm,
@@ -32,6 +37,9 @@ protected:
 
   const Phrase *m_constraint;
   Manager& m_manager;
+  std::vector<Hypothesis*> m_monotoneHypotheses; /**< partial hypotheses built by CompleteMonotonically(), in no stack */
+
+  Hypothesis *CompleteMonotonically(const Hypothesis &hypo, const TranslationOptionCollection &transOptColl);
 
 };
 
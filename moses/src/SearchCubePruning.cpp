@@ -5,6 +5,8 @@
 #include "InputType.h"
 #include "TranslationOptionCollection.h"
 
+#include <limits>
+
 using namespace std;
 
 namespace Moses
@@ -24,8 +26,8 @@ public:
     }
 
     // Compare the top hypothesis of each bitmap container using the TotalScore, which includes future cost
-    const float scoreA = A->Top()->GetHypothesis()->GetTotalScore();
-    const float scoreB = B->Top()->GetHypothesis()->GetTotalScore();
+    const float scoreA = A->Top().GetHypothesis()->GetTotalScore();
+    const float scoreB = B->Top().GetHypothesis()->GetTotalScore();
 
     if (scoreA < scoreB) {
       return true;
@@ -44,6 +46,7 @@ SearchCubePruning::SearchCubePruning(Manager& manager, const InputType &source,
   ,m_initialTargetPhrase(source.m_initialTargetPhrase)
   ,m_start(clock())
   ,m_transOptColl(transOptColl)
+  ,m_transOptLimit(0)
 {
   const StaticData &staticData = StaticData::Instance();
 
@@ -75,6 +78,12 @@ void SearchCubePruning::ProcessSentence()
 {
   const StaticData &staticData = StaticData::Instance();
 
+  // nominal number of translation options per span, tightened per stack if
+  // decoding falls behind the latency budget
+  const size_t maxTransOpt = (staticData.GetMaxNoTransOptPerCoverage() > 0)
+                             ? staticData.GetMaxNoTransOptPerCoverage() : std::numeric_limits<size_t>::max();
+  m_transOptLimit = maxTransOpt;
+
   // initial seed hypothesis: nothing translated, no words produced
   Hypothesis *hypo = Hypothesis::Create(m_manager,m_source, m_initialTargetPhrase);
 
@@ -90,6 +99,11 @@ void SearchCubePruning::ProcessSentence()
   const size_t Diversity = StaticData::Instance().GetCubePruningDiversity();
   VERBOSE(3,"Cube Pruning diversity is " << Diversity << std::endl)
 
+  // pop limit and stack size are tightened per stack if decoding falls behind the latency budget
+  LatencyBudget &latencyBudget = m_manager.GetLatencyBudget();
+  size_t popLimit = PopLimit;
+  size_t stackSizeLimit = staticData.GetMaxHypoStackSize();
+
   // go through each stack
   size_t stackNo = 1;
   std::vector < HypothesisStack* >::iterator iterStack;
@@ -102,22 +116,29 @@ void SearchCubePruning::ProcessSentence()
     }
     HypothesisStackCubePruning &sourceHypoColl = *static_cast<HypothesisStackCubePruning*>(*iterStack);
 
+    if (latencyBudget.IsLimited()) {
+      const float progress = (float) stackNo / m_hypoStackColl.size();
+      popLimit = latencyBudget.Limit(PopLimit, progress);
+      stackSizeLimit = latencyBudget.Limit(staticData.GetMaxHypoStackSize(), progress);
+      m_transOptLimit = latencyBudget.Limit(maxTransOpt, progress);
+    }
+
     // priority queue which has a single entry for each bitmap container, sorted by score of top hyp
     std::priority_queue< BitmapContainer*, std::vector< BitmapContainer* >, BitmapContainerOrderer> BCQueue;
 
-    _BMType::const_iterator bmIter;
-    const _BMType &accessor = sourceHypoColl.GetBitmapAccessor();
+    _BMSortedType::const_iterator bmIter;
+    const _BMSortedType &accessor = sourceHypoColl.GetSortedBitmapContainers();
 
     for(bmIter = accessor.begin(); bmIter != accessor.end(); ++bmIter) {
-      bmIter->second->InitializeEdges();
-      BCQueue.push(bmIter->second);
+      (*bmIter)->InitializeEdges();
+      BCQueue.push(*bmIter);
 
       // old algorithm
       // bmIter->second->EnsureMinStackHyps(PopLimit);
     }
 
     // main search loop, pop k best hyps
-    for (size_t numpops = 1; numpops <= PopLimit && !BCQueue.empty(); numpops++) {
+    for (size_t numpops = 1; numpops <= popLimit && !BCQueue.empty(); numpops++) {
       BitmapContainer *bc = BCQueue.top();
       BCQueue.pop();
       bc->ProcessBestHypothesis();
@@ -129,14 +150,14 @@ void SearchCubePruning::ProcessSentence()
     //    NOTE: diversity doesn't ensure they aren't pruned at some later point
     if (Diversity > 0) {
       for(bmIter = accessor.begin(); bmIter != accessor.end(); ++bmIter) {
-        bmIter->second->EnsureMinStackHyps(Diversity);
+        (*bmIter)->EnsureMinStackHyps(Diversity);
       }
     }
 
     // the stack is pruned before processing (lazy pruning):
     VERBOSE(3,"processing hypothesis from next stack");
     // VERBOSE("processing next stack at ");
-    sourceHypoColl.PruneToSize(staticData.GetMaxHypoStackSize());
+    sourceHypoColl.PruneToSize(stackSizeLimit);
     VERBOSE(3,std::endl);
     sourceHypoColl.CleanupArcList();
 
@@ -156,15 +177,15 @@ void SearchCubePruning::ProcessSentence()
 
 void SearchCubePruning::CreateForwardTodos(HypothesisStackCubePruning &stack)
 {
-  const _BMType &bitmapAccessor = stack.GetBitmapAccessor();
-  _BMType::const_iterator iterAccessor;
+  const _BMSortedType &bitmapAccessor = stack.GetSortedBitmapContainers();
+  _BMSortedType::const_iterator iterAccessor;
   size_t size = m_source.GetSize();
 
   stack.AddHypothesesToBitmapContainers();
 
   for (iterAccessor = bitmapAccessor.begin() ; iterAccessor != bitmapAccessor.end() ; ++iterAccessor) {
-    const WordsBitmap &bitmap = iterAccessor->first;
-    BitmapContainer &bitmapContainer = *iterAccessor->second;
+    BitmapContainer &bitmapContainer = **iterAccessor;
+    const WordsBitmap &bitmap = bitmapContainer.GetWordsBitmap();
 
     if (bitmapContainer.GetHypothesesSize() == 0) {
       // no hypothese to expand. don't bother doing it
@@ -216,7 +237,7 @@ void SearchCubePruning::CreateForwardTodos(const WordsBitmap &bitmap, const Word
 
   if (transOptList.size() > 0) {
     HypothesisStackCubePruning &newStack = *static_cast<HypothesisStackCubePruning*>(m_hypoStackColl[numCovered]);
-    newStack.SetBitmapAccessor(newBitmap, newStack, range, bitmapContainer, futureScore, transOptList);
+    newStack.SetBitmapAccessor(newBitmap, newStack, range, bitmapContainer, futureScore, transOptList, m_transOptLimit);
   }
 }
 
@@ -291,11 +312,11 @@ void SearchCubePruning::OutputHypoStackSize()
 void SearchCubePruning::PrintBitmapContainerGraph()
 {
   HypothesisStackCubePruning &lastStack = *static_cast<HypothesisStackCubePruning*>(m_hypoStackColl.back());
-  const _BMType &bitmapAccessor = lastStack.GetBitmapAccessor();
+  const _BMSortedType &bitmapAccessor = lastStack.GetSortedBitmapContainers();
 
-  _BMType::const_iterator iterAccessor;
+  _BMSortedType::const_iterator iterAccessor;
   for (iterAccessor = bitmapAccessor.begin(); iterAccessor != bitmapAccessor.end(); ++iterAccessor) {
-    cerr << iterAccessor->first << endl;
+    cerr << (*iterAccessor)->GetWordsBitmap() << endl;
     //BitmapContainer &container = *iterAccessor->second;
   }
 
@@ -20,6 +20,7 @@ protected:
   TargetPhrase m_initialTargetPhrase; /**< used to seed 1st hypo */
   clock_t m_start; /**< used to track time spend on translation */
   const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
+  size_t m_transOptLimit; /**< max translation options used per span, lowered when running out of latency budget */
 
   //! go thru all bitmaps in 1 stack & create backpointers to bitmaps in the stack
   void CreateForwardTodos(HypothesisStackCubePruning &stack);
@@ -2,6 +2,9 @@
 #include "Timer.h"
 #include "SearchNormal.h"
 
+#include <algorithm>
+#include <limits>
+
 using namespace std;
 
 namespace Moses
@@ -20,6 +23,7 @@ SearchNormal::SearchNormal(Manager& manager, const InputType &source, const Tran
   ,m_start(clock())
   ,interrupted_flag(0)
   ,m_transOptColl(transOptColl)
+  ,m_transOptLimit(0)
 {
   VERBOSE(1, "Translating: " << m_source << endl);
   const StaticData &staticData = StaticData::Instance();
@@ -59,8 +63,16 @@ void SearchNormal::ProcessSentence()
 {
   const StaticData &staticData = StaticData::Instance();
   SentenceStats &stats = m_manager.GetSentenceStats();
+  LatencyBudget &latencyBudget = m_manager.GetLatencyBudget();
   clock_t t=0; // used to track time for steps
 
+  // nominal limits, tightened per stack if decoding falls behind the latency budget
+  const size_t maxHypoStackSize = staticData.GetMaxHypoStackSize();
+  const size_t maxTransOpt = (staticData.GetMaxNoTransOptPerCoverage() > 0)
+                             ? staticData.GetMaxNoTransOptPerCoverage() : std::numeric_limits<size_t>::max();
+  size_t stackSizeLimit = maxHypoStackSize;
+  m_transOptLimit = maxTransOpt;
+
   // initial seed hypothesis: nothing translated, no words produced
   Hypothesis *hypo = Hypothesis::Create(m_manager,m_source, m_initialTargetPhrase);
   m_hypoStackColl[0]->AddPrune(hypo);
@@ -77,12 +89,18 @@ void SearchNormal::ProcessSentence()
     }
     HypothesisStackNormal &sourceHypoColl = *static_cast<HypothesisStackNormal*>(*iterStack);
 
+    if (latencyBudget.IsLimited()) {
+      const float progress = (float) (iterStack - m_hypoStackColl.begin()) / m_hypoStackColl.size();
+      stackSizeLimit = latencyBudget.Limit(maxHypoStackSize, progress);
+      m_transOptLimit = latencyBudget.Limit(maxTransOpt, progress);
+    }
+
     // the stack is pruned before processing (lazy pruning):
     VERBOSE(3,"processing hypothesis from next stack");
     IFVERBOSE(2) {
       t = clock();
     }
-    sourceHypoColl.PruneToSize(staticData.GetMaxHypoStackSize());
+    sourceHypoColl.PruneToSize(stackSizeLimit);
     VERBOSE(3,std::endl);
     sourceHypoColl.CleanupArcList();
     IFVERBOSE(2) {
@@ -105,6 +123,9 @@ void SearchNormal::ProcessSentence()
   }
 
   // some more logging
+  if (staticData.GetSearchLazyScoring()) {
+    VERBOSE(1, "Lazy scoring skipped feature evaluation for " << stats.GetNumHyposNotScored() << " hypotheses" << endl);
+  }
   IFVERBOSE(2) {
     m_manager.GetSentenceStats().SetTimeTotal( clock()-m_start );
   }
@@ -125,7 +146,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
 
   // no limit of reordering: only check for overlap
   if (maxDistortion < 0) {
-    const WordsBitmap hypoBitmap	= hypothesis.GetWordsBitmap();
+    const WordsBitmap &hypoBitmap	= hypothesis.GetWordsBitmap();
     const size_t hypoFirstGapPos	= hypoBitmap.GetFirstGapPos()
                                     , sourceSize			= m_source.GetSize();
 
@@ -155,7 +176,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
 
   // if there are reordering limits, make sure it is not violated
   // the coverage bitmap is handy here (and the position of the first gap)
-  const WordsBitmap hypoBitmap = hypothesis.GetWordsBitmap();
+  const WordsBitmap &hypoBitmap = hypothesis.GetWordsBitmap();
   const size_t	hypoFirstGapPos	= hypoBitmap.GetFirstGapPos()
                                   , sourceSize			= m_source.GetSize();
 
@@ -265,14 +286,20 @@ void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t star
     expectedScore = hypothesis.GetScore();
 
     // add new future score estimate
-    expectedScore += m_transOptColl.GetFutureScore().CalcFutureScore( hypothesis.GetWordsBitmap(), startPos, endPos );
+    const SquareMatrix &futureScore = m_transOptColl.GetFutureScore();
+    if (hypothesis.GetPrevHypo() != NULL) {
+      expectedScore += futureScore.CalcFutureScore( hypothesis.GetGapFutureScores(), hypothesis.GetWordsBitmap(), startPos, endPos, NULL );
+    } else {
+      expectedScore += futureScore.CalcFutureScore( hypothesis.GetWordsBitmap(), startPos, endPos );
+    }
   }
 
-  // loop through all translation options
+  // loop through all translation options (the list is sorted, so a reduced
+  // limit keeps the most promising ones)
   const TranslationOptionList &transOptList = m_transOptColl.GetTranslationOptionList(WordsRange(startPos, endPos));
-  TranslationOptionList::const_iterator iter;
-  for (iter = transOptList.begin() ; iter != transOptList.end() ; ++iter) {
-    ExpandHypothesis(hypothesis, **iter, expectedScore);
+  const size_t numTransOpt = std::min(transOptList.size(), m_transOptLimit);
+  for (size_t i = 0 ; i < numTransOpt ; ++i) {
+    ExpandHypothesis(hypothesis, *transOptList.Get(i), expectedScore);
   }
 }
 
@@ -292,7 +319,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
   clock_t t=0; // used to track time for steps
 
   Hypothesis *newHypo;
-  if (! staticData.UseEarlyDiscarding()) {
+  if (! staticData.UseEarlyDiscarding() && ! staticData.GetSearchLazyScoring()) {
     // simple build, no questions asked
     IFVERBOSE(2) {
       t = clock();
@@ -304,7 +331,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
     if (newHypo==NULL) return;
     newHypo->CalcScore(m_transOptColl.GetFutureScore());
   } else
-    // early discarding: check if hypothesis is too bad to build
+    // early discarding / lazy scoring: check if hypothesis is too bad to build or score
   {
     // worst possible score may have changed -> recompute
     size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
@@ -314,18 +341,21 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
       float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
       allowedScore = std::min( allowedScore, allowedScoreForBitmap );
     }
-    allowedScore += staticData.GetEarlyDiscardingThreshold();
 
-    // add expected score of translation option
-    expectedScore += transOpt.GetFutureScore();
-    // TRACE_ERR("EXPECTED diff: " << (newHypo->GetTotalScore()-expectedScore) << " (pre " << (newHypo->GetTotalScore()-expectedScorePre) << ") " << hypothesis.GetTargetPhrase() << " ... " << transOpt.GetTargetPhrase() << " [" << expectedScorePre << "," << expectedScore << "," << newHypo->GetTotalScore() << "]" << endl);
+    if (staticData.UseEarlyDiscarding()) {
+      allowedScore += staticData.GetEarlyDiscardingThreshold();
+
+      // add expected score of translation option
+      expectedScore += transOpt.GetFutureScore();
+      // TRACE_ERR("EXPECTED diff: " << (newHypo->GetTotalScore()-expectedScore) << " (pre " << (newHypo->GetTotalScore()-expectedScorePre) << ") " << hypothesis.GetTargetPhrase() << " ... " << transOpt.GetTargetPhrase() << " [" << expectedScorePre << "," << expectedScore << "," << newHypo->GetTotalScore() << "]" << endl);
 
-    // check if transOpt score push it already below limit
-    if (expectedScore < allowedScore) {
-      IFVERBOSE(2) {
-        stats.AddNotBuilt();
+      // check if transOpt score push it already below limit
+      if (expectedScore < allowedScore) {
+        IFVERBOSE(2) {
+          stats.AddNotBuilt();
+        }
+        return;
       }
-      return;
     }
 
     // build the hypothesis without scoring
@@ -338,20 +368,21 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
       stats.AddTimeBuildHyp( clock()-t );
     }
 
-    // compute expected score (all but correct LM)
-    expectedScore = newHypo->CalcExpectedScore( m_transOptColl.GetFutureScore() );
-    // ... and check if that is below the limit
-    if (expectedScore < allowedScore) {
-      IFVERBOSE(2) {
-        stats.AddEarlyDiscarded();
+    if (! staticData.GetSearchLazyScoring()) {
+      newHypo->CalcScore(m_transOptColl.GetFutureScore());
+    } else {
+      // score everything but the features that can bound their score ...
+      float upperBound = newHypo->CalcExpectedScore( m_transOptColl.GetFutureScore() );
+      // ... and don't evaluate them if even the bound is below the limit
+      if (upperBound < allowedScore) {
+        stats.AddNotScored();
+        FREEHYPO( newHypo );
+        return;
       }
-      FREEHYPO( newHypo );
-      return;
-    }
-
-    // ok, all is good, compute remaining scores
-    newHypo->CalcRemainingScore();
 
+      // ok, all is good, compute remaining scores
+      newHypo->CalcRemainingScore();
+    }
   }
 
   // logging for the curious
@@ -25,6 +25,7 @@ protected:
   size_t interrupted_flag; /**< flag indicating that decoder ran out of time (see switch -time-out) */
   HypothesisStackNormal* actual_hypoStack; /**actual (full expanded) stack of hypotheses*/
   const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
+  size_t m_transOptLimit; /**< max translation options used per span, lowered when running out of latency budget */
 
   // functions for creating hypotheses
   void ProcessOneHypothesis(const Hypothesis &hypothesis);
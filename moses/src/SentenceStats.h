@@ -63,6 +63,7 @@ public:
     m_numHyposDiscarded = 0;
     m_numHyposEarlyDiscarded = 0;
     m_numHyposNotBuilt = 0;
+    m_numHyposNotScored = 0;
     m_timeCollectOpts = 0;
     m_timeBuildHyp = 0;
     m_timeEstimateScore = 0;
@@ -98,6 +99,9 @@ public:
   unsigned int GetNumHyposNotBuilt() const {
     return m_numHyposNotBuilt;
   }
+  unsigned int GetNumHyposNotScored() const {
+    return m_numHyposNotScored;
+  }
   float GetTimeCollectOpts() const {
     return m_timeCollectOpts/(float)CLOCKS_PER_SEC;
   }
@@ -151,6 +155,9 @@ public:
   void AddNotBuilt() {
     m_numHyposNotBuilt++;
   }
+  void AddNotScored() {
+    m_numHyposNotScored++;
+  }
   void AddDiscarded() {
     m_numHyposDiscarded++;
   }
@@ -191,6 +198,7 @@ protected:
   unsigned int m_numHyposDiscarded;
   unsigned int m_numHyposEarlyDiscarded;
   unsigned int m_numHyposNotBuilt;
+  unsigned int m_numHyposNotScored; /**< discarded by search-lazy-scoring before full feature evaluation */
   clock_t m_timeCollectOpts;
   clock_t m_timeBuildHyp;
   clock_t m_timeEstimateScore;
@@ -213,6 +221,7 @@ inline std::ostream& operator<<(std::ostream& os, const SentenceStats& ss)
   return os << "total hypotheses considered = " << ss.GetTotalHypos() << std::endl
          << "           number not built = " << ss.GetNumHyposNotBuilt() << std::endl
          << "     number discarded early = " << ss.GetNumHyposEarlyDiscarded() << std::endl
+         << "   number not scored (lazy) = " << ss.GetNumHyposNotScored() << std::endl
          << "           number discarded = " << ss.GetNumHyposDiscarded() << std::endl
          << "          number recombined = " << ss.GetNumHyposRecombined() << std::endl
          << "              number pruned = " << ss.GetNumHyposPruned() << std::endl
@@ -112,6 +112,89 @@ float SquareMatrix::CalcFutureScore( WordsBitmap const &bitmap, size_t startPos,
   return futureScore;
 }
 
+/**
+ * Calculate future score estimate for a given coverage bitmap
+ * and record the score of each of its gaps, so that the estimate
+ * of a coverage extending it can be derived with the function below.
+ *
+ * /param bitmap coverage bitmap
+ * /param gaps is set to the scores of the gaps of bitmap
+ */
+
+float SquareMatrix::CalcFutureScore( WordsBitmap const &bitmap, GapFutureScores &gaps ) const
+{
+  gaps.clear();
+  const size_t notInGap= numeric_limits<size_t>::max();
+  size_t startGap = notInGap;
+  float futureScore = 0.0f;
+  for(size_t currPos = 0 ; currPos < bitmap.GetSize() ; currPos++) {
+    // start of a new gap?
+    if(bitmap.GetValue(currPos) == false && startGap == notInGap) {
+      startGap = currPos;
+    }
+    // end of a gap?
+    else if(bitmap.GetValue(currPos) == true && startGap != notInGap) {
+      gaps.push_back(std::make_pair(startGap, GetScore(startGap, currPos - 1)));
+      futureScore += gaps.back().second;
+      startGap = notInGap;
+    }
+  }
+  // coverage ending with gap?
+  if (startGap != notInGap) {
+    gaps.push_back(std::make_pair(startGap, GetScore(startGap, bitmap.GetSize() - 1)));
+    futureScore += gaps.back().second;
+  }
+
+  return futureScore;
+}
+
+/**
+ * Calculate future score estimate for a coverage bitmap and an additional
+ * span, given the gap scores of the bitmap alone.  Only the gap that the
+ * span falls into changes: it is replaced by what is left of it on either
+ * side of the span.  The gap scores are summed left to right as in the
+ * full calculation, so the estimate only depends on the resulting coverage
+ * and is exactly 0 when nothing is left to translate.
+ *
+ * /param prevGaps gap scores of bitmap
+ * /param bitmap coverage bitmap
+ * /param startPos start of the span that is added to the coverage
+ * /param endPos end of the span that is added to the coverage
+ * /param gaps if not NULL, is set to the gap scores of the new coverage
+ */
+
+float SquareMatrix::CalcFutureScore( const GapFutureScores &prevGaps, WordsBitmap const &bitmap, size_t startPos, size_t endPos, GapFutureScores *gaps ) const
+{
+  const size_t gapStart = bitmap.GetEdgeToTheLeftOf(startPos);
+  const size_t gapEnd = bitmap.GetEdgeToTheRightOf(endPos);
+
+  if (gaps != NULL) {
+    gaps->clear();
+    gaps->reserve(prevGaps.size() + 1);
+  }
+  float futureScore = 0.0f;
+  GapFutureScores::const_iterator iter;
+  for (iter = prevGaps.begin() ; iter != prevGaps.end() ; ++iter) {
+    if (iter->first != gapStart) {
+      futureScore += iter->second;
+      if (gaps != NULL) gaps->push_back(*iter);
+      continue;
+    }
+    if (gapStart < startPos) {
+      const float score = GetScore(gapStart, startPos - 1);
+      futureScore += score;
+      if (gaps != NULL) gaps->push_back(std::make_pair(gapStart, score));
+    }
+    if (endPos < gapEnd) {
+      const float score = GetScore(endPos + 1, gapEnd);
+      futureScore += score;
+      if (gaps != NULL) gaps->push_back(std::make_pair(endPos + 1, score));
+    }
+  }
+
+  return futureScore;
+}
+
 TO_STRING_BODY(SquareMatrix);
 
 }
@@ -23,6 +23,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_SquareMatrix_h
 
 #include <iostream>
+#include <utility>
+#include <vector>
 #include "TypeDef.h"
 #include "Util.h"
 #include "WordsBitmap.h"
@@ -30,21 +32,30 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 namespace Moses
 {
 
-//! A square array of floats to store future costs
+//! future cost of each gap of a coverage bitmap as (first position, score), left to right
+typedef std::vector< std::pair<size_t, float> > GapFutureScores;
+
+//! A square array of floats to store future costs.
+//! Only spans (startPos <= endPos) are meaningful, so only the upper triangle is stored.
 class SquareMatrix
 {
   friend std::ostream& operator<<(std::ostream &out, const SquareMatrix &matrix);
 protected:
   const size_t m_size; /**< length of the square (sentence length) */
-  float *m_array; /**< two-dimensional array to store floats */
+  float *m_array; /**< upper triangle, row by row */
 
   SquareMatrix(); // not implemented
   SquareMatrix(const SquareMatrix &copy); // not implemented
 
+  //! position of span (startPos, endPos) in m_array
+  inline size_t GetIndex(size_t startPos, size_t endPos) const {
+    return startPos * m_size - (startPos * (startPos - 1)) / 2 + (endPos - startPos);
+  }
+
 public:
   SquareMatrix(size_t size)
     :m_size(size) {
-    m_array = (float*) malloc(sizeof(float) * size * size);
+    m_array = (float*) malloc(sizeof(float) * (size * (size + 1)) / 2);
   }
   ~SquareMatrix() {
     free(m_array);
@@ -55,14 +66,16 @@ public:
   }
   /** Get a future cost score for a span */
   inline float GetScore(size_t startPos, size_t endPos) const {
-    return m_array[startPos * m_size + endPos];
+    return m_array[GetIndex(startPos, endPos)];
   }
   /** Set a future cost score for a span */
   inline void SetScore(size_t startPos, size_t endPos, float value) {
-    m_array[startPos * m_size + endPos] = value;
+    m_array[GetIndex(startPos, endPos)] = value;
   }
   float CalcFutureScore( WordsBitmap const& ) const;
   float CalcFutureScore( WordsBitmap const&, size_t startPos, size_t endPos ) const;
+  float CalcFutureScore( WordsBitmap const&, GapFutureScores &gaps ) const;
+  float CalcFutureScore( const GapFutureScores &prevGaps, WordsBitmap const&, size_t startPos, size_t endPos, GapFutureScores *gaps ) const;
 
   TO_STRING();
 };
@@ -70,7 +83,7 @@ public:
 inline std::ostream& operator<<(std::ostream &out, const SquareMatrix &matrix)
 {
   for (size_t endPos = 0 ; endPos < matrix.GetSize() ; endPos++) {
-    for (size_t startPos = 0 ; startPos < matrix.GetSize() ; startPos++)
+    for (size_t startPos = 0 ; startPos <= endPos ; startPos++)
       out << matrix.GetScore(startPos, endPos) << " ";
     out << std::endl;
   }
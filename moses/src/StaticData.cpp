@@ -40,6 +40,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TranslationOption.h"
 #include "DecodeGraph.h"
 #include "InputFileStream.h"
+#include "ThreadPool.h"
 
 #ifdef HAVE_SYNLM
 #include "SyntacticLanguageModel.h"
@@ -91,6 +92,10 @@ StaticData::StaticData()
   m_xmlBrackets.first="<";
   m_xmlBrackets.second=">";
 
+#ifdef WITH_THREADS
+  m_transOptThreadPool = NULL;
+#endif
+
   // memory pools
   Phrase::InitializeMemPool();
 }
@@ -248,8 +253,17 @@ bool StaticData::LoadData(Parameter *parameter)
   //
   if (m_inputType == SentenceInput) {
     SetBooleanParameter( &m_useTransOptCache, "use-persistent-cache", true );
-    m_transOptCacheMaxSize = (m_parameter->GetParam("persistent-cache-size").size() > 0)
-                             ? Scan<size_t>(m_parameter->GetParam("persistent-cache-size")[0]) : DEFAULT_MAX_TRANS_OPT_CACHE_SIZE;
+    // a memory limit replaces the default limit on the number of entries
+    size_t transOptCacheMaxSize = DEFAULT_MAX_TRANS_OPT_CACHE_SIZE;
+    size_t transOptCacheMaxBytes = 0;
+    if (m_parameter->GetParam("persistent-cache-memory").size() > 0) {
+      transOptCacheMaxBytes = Scan<size_t>(m_parameter->GetParam("persistent-cache-memory")[0]) << 20;
+      transOptCacheMaxSize = std::numeric_limits<size_t>::max();
+    }
+    if (m_parameter->GetParam("persistent-cache-size").size() > 0) {
+      transOptCacheMaxSize = Scan<size_t>(m_parameter->GetParam("persistent-cache-size")[0]);
+    }
+    m_transOptCache.SetLimits(transOptCacheMaxSize, transOptCacheMaxBytes);
   } else {
     m_useTransOptCache = false;
   }
@@ -355,6 +369,12 @@ bool StaticData::LoadData(Parameter *parameter)
                            ? Scan<size_t>(m_parameter->GetParam("cube-pruning-diversity")[0]) : DEFAULT_CUBE_PRUNING_DIVERSITY;
 
   SetBooleanParameter(&m_cubePruningLazyScoring, "cube-pruning-lazy-scoring", false);
+  SetBooleanParameter(&m_cubePruningEarlyDiscarding, "cube-pruning-early-discarding", false);
+  SetBooleanParameter(&m_searchLazyScoring, "search-lazy-scoring", false);
+  if (m_cubePruningEarlyDiscarding && !m_cubePruningLazyScoring) {
+    UserMessage::Add("cube-pruning-early-discarding requires cube-pruning-lazy-scoring");
+    return false;
+  }
 
   // unknown word processing
   SetBooleanParameter( &m_dropUnknown, "drop-unknown", false );
@@ -401,6 +421,9 @@ bool StaticData::LoadData(Parameter *parameter)
                         Scan<size_t>(m_parameter->GetParam("time-out")[0]) : -1;
   m_timeout = (GetTimeoutThreshold() == (size_t)-1) ? false : true;
 
+  m_latencyBudget = (m_parameter->GetParam("latency-budget").size() > 0) ?
+                    Scan<size_t>(m_parameter->GetParam("latency-budget")[0]) : 0;
+
 
   m_lmcache_cleanup_threshold = (m_parameter->GetParam("clean-lm-cache").size() > 0) ?
                                 Scan<size_t>(m_parameter->GetParam("clean-lm-cache")[0]) : 1;
@@ -434,6 +457,38 @@ bool StaticData::LoadData(Parameter *parameter)
     }
   }
 
+  m_transOptThreadCount = (m_parameter->GetParam("translation-option-threads").size() > 0) ?
+                         Scan<size_t>(m_parameter->GetParam("translation-option-threads")[0]) : 1;
+  if (m_transOptThreadCount < 1) {
+    UserMessage::Add("Specify at least one translation option thread.");
+    return false;
+  }
+#ifndef WITH_THREADS
+  if (m_transOptThreadCount > 1) {
+    UserMessage::Add("Error: translation-option-threads is greater than 1 but moses not built with thread support");
+    return false;
+  }
+#endif
+#ifdef WITH_THREADS
+  if (m_transOptThreadCount > 1 && m_threadCount > 1) {
+    // the sentence threads keep the cores busy already
+    VERBOSE(1, "Ignoring translation-option-threads as sentences are translated by " << m_threadCount << " threads" << endl);
+    m_transOptThreadCount = 1;
+  }
+  if (m_transOptThreadCount > 1) {
+    m_transOptThreadPool = new ThreadPool(m_transOptThreadCount);
+  }
+#endif
+
+  m_perSentenceGrammarPrefetch = (m_parameter->GetParam("per-sentence-grammar-prefetch").size() > 0) ?
+                                 Scan<size_t>(m_parameter->GetParam("per-sentence-grammar-prefetch")[0]) : 0;
+#ifndef WITH_THREADS
+  if (m_perSentenceGrammarPrefetch > 0) {
+    UserMessage::Add("Error: per-sentence-grammar-prefetch is set but moses not built with thread support");
+    return false;
+  }
+#endif
+
   m_startTranslationId = (m_parameter->GetParam("start-translation-id").size() > 0) ?
           Scan<long>(m_parameter->GetParam("start-translation-id")[0]) : 0;
 
@@ -621,6 +676,10 @@ void StaticData::SetBooleanParameter( bool *parameter, string parameterName, boo
 
 StaticData::~StaticData()
 {
+#ifdef WITH_THREADS
+  delete m_transOptThreadPool;
+#endif
+
   RemoveAllInColl(m_phraseDictionary);
   RemoveAllInColl(m_generationDictionary);
   RemoveAllInColl(m_reorderModels);
@@ -909,7 +968,7 @@ bool StaticData::LoadGenerationTables()
       numFeatures = Scan<size_t>(token[2]);
       filePath = token[3];
 
-      if (!FileExists(filePath) && FileExists(filePath + ".gz")) {
+      if (!FileExists(filePath) && !FileExists(filePath + ".bingen") && FileExists(filePath + ".gz")) {
         filePath += ".gz";
       }
 
@@ -1273,66 +1332,18 @@ void StaticData::SetWeightsForScoreProducer(const ScoreProducer* sp, const std::
     m_allWeights[i] = *weightIter++;
 }
 
-const TranslationOptionList* StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
+TransOptCache::ListPtr StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
 {
-  std::pair<size_t, Phrase> key(decodeGraph.GetPosition(), sourcePhrase);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter
-  = m_transOptCache.find(key);
-  if (iter == m_transOptCache.end())
-    return NULL;
-  iter->second.second = clock(); // update last used time
-  return iter->second.first;
-}
-
-void StaticData::ReduceTransOptCache() const
-{
-  if (m_transOptCache.size() <= m_transOptCacheMaxSize) return; // not full
-  clock_t t = clock();
-
-  // find cutoff for last used time
-  priority_queue< clock_t > lastUsedTimes;
-  std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter;
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    lastUsedTimes.push( iter->second.second );
-    iter++;
-  }
-  for( size_t i=0; i < lastUsedTimes.size()-m_transOptCacheMaxSize/2; i++ )
-    lastUsedTimes.pop();
-  clock_t cutoffLastUsedTime = lastUsedTimes.top();
-
-  // remove all old entries
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    if (iter->second.second < cutoffLastUsedTime) {
-      std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iterRemove = iter++;
-      delete iterRemove->second.first;
-      m_transOptCache.erase(iterRemove);
-    } else iter++;
-  }
-  VERBOSE(2,"Reduced persistent translation option cache in " << ((clock()-t)/(float)CLOCKS_PER_SEC) << " seconds." << std::endl);
+  return m_transOptCache.Find(decodeGraph.GetPosition(), sourcePhrase);
 }
 
 void StaticData::AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList) const
 {
-  if (m_transOptCacheMaxSize == 0) return;
-  std::pair<size_t, Phrase> key(decodeGraph.GetPosition(), sourcePhrase);
-  TranslationOptionList* storedTransOptList = new TranslationOptionList(transOptList);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  m_transOptCache[key] = make_pair( storedTransOptList, clock() );
-  ReduceTransOptCache();
+  m_transOptCache.Add(decodeGraph.GetPosition(), sourcePhrase, transOptList);
 }
+
 void StaticData::ClearTransOptionCache() const {
-  map<std::pair<size_t, Phrase>, std::pair< TranslationOptionList*, clock_t > >::iterator iterCache;
-  for (iterCache = m_transOptCache.begin() ; iterCache != m_transOptCache.end() ; ++iterCache) {
-    TranslationOptionList *transOptList = iterCache->second.first;
-    delete transOptList;
-  }
+  m_transOptCache.Clear();
 }
 
 }
@@ -46,6 +46,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "DecodeGraph.h"
 #include "TranslationOptionList.h"
 #include "TranslationSystem.h"
+#include "TransOptCache.h"
 
 #if HAVE_CONFIG_H
 #include "config.h"
@@ -67,6 +68,9 @@ class UnknownWordPenaltyProducer;
 class SyntacticLanguageModel;
 #endif
 class TranslationSystem;
+#ifdef WITH_THREADS
+class ThreadPool;
+#endif
 
 typedef std::pair<std::string, float> UnknownLHSEntry;
 typedef std::vector<UnknownLHSEntry>  UnknownLHSList;
@@ -177,15 +181,10 @@ protected:
 
   bool m_timeout; //! use timeout
   size_t m_timeout_threshold; //! seconds after which time out is activated
+  size_t m_latencyBudget; //! milliseconds per sentence before pruning is tightened, 0 = no limit
 
   bool m_useTransOptCache; //! flag indicating, if the persistent translation option cache should be used
-  mutable std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> > m_transOptCache; //! persistent translation option cache
-  size_t m_transOptCacheMaxSize; //! maximum size for persistent translation option cache
-  //FIXME: Single lock for cache not most efficient. However using a
-  //reader-writer for LRU cache is tricky - how to record last used time?
-#ifdef WITH_THREADS
-  mutable boost::mutex m_transOptCacheMutex;
-#endif
+  mutable TransOptCache m_transOptCache; //! persistent translation option cache
   bool m_isAlwaysCreateDirectTranslationOption;
   //! constructor. only the 1 static variable can be created
 
@@ -200,6 +199,8 @@ protected:
   size_t m_cubePruningPopLimit;
   size_t m_cubePruningDiversity;
   bool m_cubePruningLazyScoring;
+  bool m_cubePruningEarlyDiscarding;
+  bool m_searchLazyScoring; //! bound stateful feature scores before evaluating them (normal search)
   size_t m_ruleLimit;
 
 
@@ -211,6 +212,11 @@ protected:
   WordAlignmentSort m_wordAlignmentSort;
 
   int m_threadCount;
+  size_t m_transOptThreadCount; //! worker threads used to collect the translation options of one sentence
+#ifdef WITH_THREADS
+  ThreadPool *m_transOptThreadPool; //! those workers, shared by all sentences; NULL if there is only one
+#endif
+  size_t m_perSentenceGrammarPrefetch; //! per-sentence grammars loaded ahead of the decoder
   long m_startTranslationId;
   
   StaticData();
@@ -235,7 +241,6 @@ protected:
   bool LoadDecodeGraphs();
   bool LoadLexicalReorderingModel();
   bool LoadGlobalLexicalModel();
-  void ReduceTransOptCache() const;
   bool m_continuePartialTranslation;
 
 public:
@@ -324,6 +329,12 @@ public:
   bool GetCubePruningLazyScoring() const {
     return m_cubePruningLazyScoring;
   }
+  bool GetCubePruningEarlyDiscarding() const {
+    return m_cubePruningEarlyDiscarding;
+  }
+  bool GetSearchLazyScoring() const {
+    return m_searchLazyScoring;
+  }
   size_t IsPathRecoveryEnabled() const {
     return m_recoverPath;
   }
@@ -530,6 +541,9 @@ public:
   size_t GetTimeoutThreshold() const {
     return m_timeout_threshold;
   }
+  size_t GetLatencyBudget() const {
+    return m_latencyBudget;
+  }
 
   size_t GetLMCacheCleanupThreshold() const {
     return m_lmcache_cleanup_threshold;
@@ -574,7 +588,7 @@ public:
   void ClearTransOptionCache() const;
 
 
-  const TranslationOptionList* FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
+  TransOptCache::ListPtr FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
 
   bool PrintAllDerivations() const {
     return m_printAllDerivations;
@@ -616,6 +630,19 @@ public:
   int ThreadCount() const {
     return m_threadCount;
   }
+
+  size_t GetTranslationOptionThreadCount() const {
+    return m_transOptThreadCount;
+  }
+#ifdef WITH_THREADS
+  ThreadPool *GetTranslationOptionThreadPool() const {
+    return m_transOptThreadPool;
+  }
+#endif
+
+  size_t GetPerSentenceGrammarPrefetch() const {
+    return m_perSentenceGrammarPrefetch;
+  }
   
   long GetStartTranslationId() const
   { return m_startTranslationId; }
@@ -107,6 +107,11 @@ public:
   // used when creating translations of unknown words:
   void ResetScore();
   void SetWeights(const ScoreProducer*, const std::vector<float> &weightT);
+  //! replace the weighted translation model score, the rest of the future score is kept
+  void SetTranslationScore(float transScore) {
+    m_fullScore += transScore - m_transScore;
+    m_transScore = transScore;
+  }
 
   TargetPhrase *MergeNext(const TargetPhrase &targetPhrase) const;
   // used for translation step
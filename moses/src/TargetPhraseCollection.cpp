@@ -20,26 +20,64 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <algorithm>
+#include "util/check.hh"
 #include "TargetPhraseCollection.h"
 
 using namespace std;
 
 namespace Moses
 {
-// helper for sort
+// helper for sort.
+// Ranking is done on a contiguous copy of the future scores, so comparisons
+// don't have to dereference a target phrase each time.
+typedef std::pair<float, size_t> ScoredTargetPhrase;
+
 struct CompareTargetPhrase {
-  bool operator() (const TargetPhrase *a, const TargetPhrase *b) {
-    return a->GetFutureScore() > b->GetFutureScore();
+  bool operator() (const ScoredTargetPhrase &a, const ScoredTargetPhrase &b) const {
+    return a.first > b.first;
   }
 };
 
+void TargetPhraseCollection::GetScoredTargetPhrases(vector<ScoredTargetPhrase> &scored) const
+{
+  scored.resize(m_collection.size());
+  for (size_t i = 0; i < m_collection.size(); ++i) {
+    scored[i] = ScoredTargetPhrase(m_collection[i]->GetFutureScore(), i);
+  }
+}
+
+void TargetPhraseCollection::Reorder(const vector<ScoredTargetPhrase> &scored)
+{
+  const size_t size = m_collection.size();
+  vector<TargetPhrase*> collection(size);
+  for (size_t i = 0; i < size; ++i) {
+    collection[i] = m_collection[scored[i].second];
+  }
+  m_collection.swap(collection);
+
+  // keep the score matrix in step with the target phrases
+  if (!m_scoreMatrix.empty()) {
+    vector<float> scoreMatrix(m_scoreMatrix.size());
+    for (size_t offset = 0; offset < m_scoreMatrix.size(); offset += size) {
+      for (size_t i = 0; i < size; ++i) {
+        scoreMatrix[offset + i] = m_scoreMatrix[offset + scored[i].second];
+      }
+    }
+    m_scoreMatrix.swap(scoreMatrix);
+  }
+}
+
 void TargetPhraseCollection::NthElement(size_t tableLimit)
 {
-  vector<TargetPhrase*>::iterator
-  iterMiddle = (tableLimit == 0 || m_collection.size() < tableLimit) ?m_collection.end() : m_collection.begin() + tableLimit;
+  if (tableLimit == 0 || m_collection.size() < tableLimit) {
+    return;
+  }
 
-  //std::sort(m_collection.begin(), m_collection.end(), CompareTargetPhrase());
-  std::nth_element(m_collection.begin(), iterMiddle, m_collection.end(), CompareTargetPhrase());
+  vector<ScoredTargetPhrase> scored;
+  GetScoredTargetPhrases(scored);
+  //std::sort(scored.begin(), scored.end(), CompareTargetPhrase());
+  std::nth_element(scored.begin(), scored.begin() + tableLimit, scored.end(), CompareTargetPhrase());
+  Reorder(scored);
 }
 
 void TargetPhraseCollection::Prune(bool adhereTableLimit, size_t tableLimit)
@@ -52,18 +90,23 @@ void TargetPhraseCollection::Prune(bool adhereTableLimit, size_t tableLimit)
       delete targetPhrase;
     }
     m_collection.erase(m_collection.begin() + tableLimit, m_collection.end());
+    ClearScoreMatrix();
   }
 }
 
 void TargetPhraseCollection::Sort(bool adhereTableLimit, size_t tableLimit)
 {
-  std::vector<TargetPhrase*>::iterator iterMiddle;
-  iterMiddle = (tableLimit == 0 || m_collection.size() < tableLimit)
-             ? m_collection.end()
-             : m_collection.begin()+tableLimit;
+  vector<ScoredTargetPhrase> scored;
+  GetScoredTargetPhrases(scored);
 
-  std::partial_sort(m_collection.begin(), iterMiddle, m_collection.end(),
+  vector<ScoredTargetPhrase>::iterator iterMiddle;
+  iterMiddle = (tableLimit == 0 || scored.size() < tableLimit)
+             ? scored.end()
+             : scored.begin()+tableLimit;
+
+  std::partial_sort(scored.begin(), iterMiddle, scored.end(),
                     CompareTargetPhrase());
+  Reorder(scored);
 
   if (adhereTableLimit && m_collection.size() > tableLimit) {
     for (size_t i = tableLimit; i < m_collection.size(); ++i) {
@@ -71,6 +114,49 @@ void TargetPhraseCollection::Sort(bool adhereTableLimit, size_t tableLimit)
       delete targetPhrase;
     }
     m_collection.erase(m_collection.begin()+tableLimit, m_collection.end());
+    ClearScoreMatrix();
+  }
+}
+
+void TargetPhraseCollection::BuildScoreMatrix(const ScoreProducer* translationScoreProducer, size_t numScoreComponents)
+{
+  const size_t size = m_collection.size();
+  m_scoreMatrix.resize(numScoreComponents * size);
+  for (size_t i = 0; i < size; ++i) {
+    const ScoreComponentCollection &scoreBreakdown = m_collection[i]->GetScoreBreakdown();
+    const size_t beginIndex = scoreBreakdown.GetBeginIndex(translationScoreProducer);
+    for (size_t j = 0; j < numScoreComponents; ++j) {
+      m_scoreMatrix[j * size + i] = scoreBreakdown[beginIndex + j];
+    }
+  }
+  m_scoreMatrixProducer = translationScoreProducer;
+}
+
+void TargetPhraseCollection::SetWeights(const ScoreProducer* translationScoreProducer, const vector<float> &weightT)
+{
+  const size_t size = m_collection.size();
+  if (size == 0) {
+    return;
+  }
+  CHECK(weightT.size() == translationScoreProducer->GetNumScoreComponents());
+
+  if (m_scoreMatrixProducer != translationScoreProducer || m_scoreMatrix.size() != weightT.size() * size) {
+    BuildScoreMatrix(translationScoreProducer, weightT.size());
+  }
+
+  // accumulate one weighted column at a time, the inner loop runs over
+  // contiguous memory and can be vectorised by the compiler
+  vector<float> transScores(size, 0.0f);
+  for (size_t j = 0; j < weightT.size(); ++j) {
+    const float weight = weightT[j];
+    const float *column = &m_scoreMatrix[j * size];
+    for (size_t i = 0; i < size; ++i) {
+      transScores[i] += weight * column[i];
+    }
+  }
+
+  for (size_t i = 0; i < size; ++i) {
+    m_collection[i]->SetTranslationScore(transScores[i]);
   }
 }
 
@@ -35,6 +35,21 @@ class TargetPhraseCollection
 protected:
   std::vector<TargetPhrase*> m_collection;
 
+  /*! translation model scores of all target phrases, stored column by column:
+   *  score component j of phrase i is at m_scoreMatrix[j * size + i].
+   *  Built on the first re-weighting, reordered along with the target phrases
+   *  and dropped when phrases are added or removed */
+  std::vector<float> m_scoreMatrix;
+  const ScoreProducer *m_scoreMatrixProducer;
+
+  void GetScoredTargetPhrases(std::vector<std::pair<float, size_t> > &scored) const;
+  void Reorder(const std::vector<std::pair<float, size_t> > &scored);
+  void BuildScoreMatrix(const ScoreProducer* translationScoreProducer, size_t numScoreComponents);
+  void ClearScoreMatrix() {
+    m_scoreMatrix.clear();
+    m_scoreMatrixProducer = NULL;
+  }
+
 public:
   // iters
   typedef std::vector<TargetPhrase*>::iterator iterator;
@@ -53,6 +68,10 @@ public:
     return m_collection.end();
   }
 
+  TargetPhraseCollection()
+    :m_scoreMatrixProducer(NULL)
+  {}
+
   ~TargetPhraseCollection() {
     RemoveAllInColl(m_collection);
   }
@@ -73,11 +92,15 @@ public:
   //! add a new entry into collection
   void Add(TargetPhrase *targetPhrase) {
     m_collection.push_back(targetPhrase);
+    ClearScoreMatrix();
   }
 
   void Prune(bool adhereTableLimit, size_t tableLimit);
   void Sort(bool adhereTableLimit, size_t tableLimit);
 
+  //! re-weight the translation model scores of all target phrases as one matrix-vector product
+  void SetWeights(const ScoreProducer* translationScoreProducer, const std::vector<float> &weightT);
+
 };
 
 }
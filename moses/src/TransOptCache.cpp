@@ -0,0 +1,146 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2012 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "TransOptCache.h"
+
+#include <limits>
+
+#include <boost/functional/hash.hpp>
+
+#include "TranslationOption.h"
+
+namespace Moses
+{
+
+size_t TransOptCache::KeyHasher::operator()(const Key &key) const
+{
+  size_t seed = key.first;
+  const Phrase &phrase = key.second;
+  for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+    const Word &word = phrase.GetWord(pos);
+    boost::hash_combine(seed, word.IsNonTerminal());
+    // Word::Compare() ignores NULL factors, so they mustn't change the hash
+    for (size_t factorType = 0; factorType < MAX_NUM_FACTORS; ++factorType) {
+      const Factor *factor = word[factorType];
+      if (factor == NULL)
+        continue;
+      boost::hash_combine(seed, factorType);
+      boost::hash_combine(seed, factor);
+    }
+  }
+  return seed;
+}
+
+TransOptCache::TransOptCache()
+  : m_maxEntriesPerShard(std::numeric_limits<size_t>::max())
+  , m_maxBytesPerShard(0)
+{
+}
+
+void TransOptCache::SetLimits(size_t maxEntries, size_t maxBytes)
+{
+  m_maxEntriesPerShard = (maxEntries == std::numeric_limits<size_t>::max())
+                         ? maxEntries : (maxEntries + NUM_SHARDS - 1) / NUM_SHARDS;
+  m_maxBytesPerShard = (maxBytes + NUM_SHARDS - 1) / NUM_SHARDS;
+}
+
+TransOptCache::ListPtr TransOptCache::Find(size_t decodeGraphPos, const Phrase &sourcePhrase)
+{
+  const Key key(decodeGraphPos, sourcePhrase);
+  Shard &shard = m_shards[KeyHasher()(key) % NUM_SHARDS];
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+  Map::iterator iter = shard.map.find(key);
+  if (iter == shard.map.end()) {
+    return ListPtr();
+  }
+  // move to front of the LRU list
+  shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+  return iter->second->list;
+}
+
+void TransOptCache::Add(size_t decodeGraphPos, const Phrase &sourcePhrase,
+                        const TranslationOptionList &transOptList)
+{
+  if (m_maxEntriesPerShard == 0) return;
+
+  const Key key(decodeGraphPos, sourcePhrase);
+  const size_t bytes = EstimateSize(key, transOptList);
+  if (m_maxBytesPerShard > 0 && bytes > m_maxBytesPerShard) return;
+
+  // copy outside the lock
+  ListPtr list(new TranslationOptionList(transOptList));
+
+  Shard &shard = m_shards[KeyHasher()(key) % NUM_SHARDS];
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+  Map::iterator iter = shard.map.find(key);
+  if (iter != shard.map.end()) {
+    // another thread got there first
+    shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+    return;
+  }
+  shard.lru.push_front(Entry(key, list, bytes));
+  shard.map[key] = shard.lru.begin();
+  shard.bytes += bytes;
+  Reduce(shard);
+}
+
+void TransOptCache::Reduce(Shard &shard)
+{
+  while (!shard.lru.empty() &&
+         (shard.map.size() > m_maxEntriesPerShard ||
+          (m_maxBytesPerShard > 0 && shard.bytes > m_maxBytesPerShard))) {
+    const Entry &oldest = shard.lru.back();
+    shard.bytes -= oldest.bytes;
+    shard.map.erase(oldest.key);
+    shard.lru.pop_back();
+  }
+}
+
+void TransOptCache::Clear()
+{
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    Shard &shard = m_shards[i];
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+    shard.map.clear();
+    shard.lru.clear();
+    shard.bytes = 0;
+  }
+}
+
+size_t TransOptCache::EstimateSize(const Key &key, const TranslationOptionList &transOptList)
+{
+  size_t ret = sizeof(Entry) + sizeof(Map::value_type) + 2 * key.second.GetSize() * sizeof(Word)
+               + sizeof(TranslationOptionList) + transOptList.size() * sizeof(TranslationOption*);
+  TranslationOptionList::const_iterator iter;
+  for (iter = transOptList.begin(); iter != transOptList.end(); ++iter) {
+    const TranslationOption &transOpt = **iter;
+    ret += sizeof(TranslationOption)
+           + transOpt.GetTargetPhrase().GetSize() * sizeof(Word)
+           + transOpt.GetScoreBreakdown().size() * sizeof(float);
+  }
+  return ret;
+}
+
+}
@@ -0,0 +1,112 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2012 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <list>
+#include <utility>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "Phrase.h"
+#include "TranslationOptionList.h"
+
+namespace Moses
+{
+
+/** Persistent cache of translation options, keyed on decode graph and
+ *  source phrase, shared by all decoding threads.
+ *
+ *  Entries are spread over a fixed number of shards by hash, each with its
+ *  own lock and its own least-recently-used list, so a lookup or insertion
+ *  only ever locks one shard and eviction is O(1) per entry.  Lists are
+ *  handed out as shared pointers, so an entry that is evicted while another
+ *  thread is still reading it stays alive until that thread is done.
+ */
+class TransOptCache
+{
+public:
+  typedef boost::shared_ptr<const TranslationOptionList> ListPtr;
+
+  TransOptCache();
+
+  /** maxEntries == 0 disables the cache; maxBytes == 0 means no memory limit.
+   *  Both limits are split evenly between the shards. */
+  void SetLimits(size_t maxEntries, size_t maxBytes);
+
+  //! returns an empty pointer if the phrase isn't cached
+  ListPtr Find(size_t decodeGraphPos, const Phrase &sourcePhrase);
+
+  //! stores a copy of transOptList
+  void Add(size_t decodeGraphPos, const Phrase &sourcePhrase,
+           const TranslationOptionList &transOptList);
+
+  void Clear();
+
+private:
+  typedef std::pair<size_t, Phrase> Key;
+
+  class KeyHasher
+  {
+  public:
+    size_t operator()(const Key &key) const;
+  };
+
+  struct Entry {
+    Entry(const Key &k, const ListPtr &l, size_t b) : key(k), list(l), bytes(b) {}
+    Key key;
+    ListPtr list;
+    size_t bytes; /**< approximate memory used by this entry */
+  };
+
+  // most recently used first
+  typedef std::list<Entry> LRUList;
+  typedef boost::unordered_map<Key, LRUList::iterator, KeyHasher> Map;
+
+  struct Shard {
+    Shard() : bytes(0) {}
+#ifdef WITH_THREADS
+    boost::mutex mutex;
+#endif
+    LRUList lru;
+    Map map;
+    size_t bytes;
+  };
+
+  static const size_t NUM_SHARDS = 16;
+
+  TransOptCache(const TransOptCache &); // not implemented
+  TransOptCache &operator=(const TransOptCache &); // not implemented
+
+  static size_t EstimateSize(const Key &, const TranslationOptionList &);
+
+  //! drop least recently used entries until shard is within limits
+  void Reduce(Shard &shard);
+
+  Shard m_shards[NUM_SHARDS];
+  size_t m_maxEntriesPerShard;
+  size_t m_maxBytesPerShard;
+};
+
+}
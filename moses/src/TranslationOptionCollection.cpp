@@ -33,11 +33,72 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "StaticData.h"
 #include "DecodeStepTranslation.h"
 #include "DecodeGraph.h"
+#include "PhraseDictionary.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
 namespace Moses
 {
+#ifdef WITH_THREADS
+/** counts down the tasks of one sentence, so that the decoding thread can
+ *  wait for them on the shared pool */
+class TaskCounter
+{
+public:
+  TaskCounter(size_t count) : m_count(count) {}
+
+  void Done() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (--m_count == 0) {
+      m_finished.notify_all();
+    }
+  }
+
+  void Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_count > 0) {
+      m_finished.wait(lock);
+    }
+  }
+
+private:
+  size_t m_count;
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+};
+
+/** creates the translation options of every numBatches-th span, starting at
+ *  span batch, on a worker thread */
+class TranslationOptionsForSpansTask : public Task
+{
+public:
+  typedef std::vector< std::pair<size_t, size_t> > Spans;
+
+  TranslationOptionsForSpansTask(TranslationOptionCollection &collection, const Spans &spans
+                                 , size_t batch, size_t numBatches, TaskCounter &counter)
+    :m_collection(collection)
+    ,m_spans(spans)
+    ,m_batch(batch)
+    ,m_numBatches(numBatches)
+    ,m_counter(counter)
+  {}
+
+  void Run() {
+    for (size_t i = m_batch ; i < m_spans.size() ; i += m_numBatches) {
+      m_collection.CreateTranslationOptionsForSpan(m_spans[i].first, m_spans[i].second);
+    }
+    m_counter.Done();
+  }
+
+private:
+  TranslationOptionCollection &m_collection;
+  const Spans &m_spans;
+  size_t m_batch, m_numBatches;
+  TaskCounter &m_counter;
+};
+#endif
+
 /** helper for pruning */
 bool CompareTranslationOption(const TranslationOption *a, const TranslationOption *b)
 {
@@ -359,39 +420,39 @@ void TranslationOptionCollection::CreateTranslationOptions()
   // table loaded on initialization), generate TranslationOption objects
   // for all phrases
 
-  // there may be multiple decoding graphs (factorizations of decoding)
-  const vector <DecodeGraph*> &decodeGraphList = m_system->GetDecodeGraphs();
-  const vector <size_t> &decodeGraphBackoff = m_system->GetDecodeGraphBackoff();
-
   // length of the sentence
   size_t size = m_source.GetSize();
+  size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
 
-  // loop over all decoding graphs, each generates translation options
-  for (size_t graph = 0 ; graph < decodeGraphList.size() ; graph++) {
-    if (decodeGraphList.size() > 1) {
-      VERBOSE(3,"Creating translation options from decoding graph " << graph << endl);
+#ifdef WITH_THREADS
+  // spans are independent of each other, so they can be handed to the
+  // worker pool if every phrase table can be shared between threads.  Each
+  // worker gets one batch of spans; interleaving them spreads the long spans
+  if (CanCreateTranslationOptionsInParallel()) {
+    TranslationOptionsForSpansTask::Spans spans;
+    for (size_t startPos = 0 ; startPos < size; startPos++) {
+      size_t maxSize = std::min(size - startPos, maxSizePhrase);
+      for (size_t endPos = startPos ; endPos < startPos + maxSize ; endPos++) {
+        spans.push_back(std::make_pair(startPos, endPos));
+      }
     }
-
-    const DecodeGraph &decodeGraph = *decodeGraphList[graph];
+    ThreadPool &pool = *StaticData::Instance().GetTranslationOptionThreadPool();
+    const size_t numBatches = std::min(spans.size(), StaticData::Instance().GetTranslationOptionThreadCount());
+    TaskCounter counter(numBatches);
+    for (size_t batch = 0 ; batch < numBatches ; ++batch) {
+      pool.Submit(new TranslationOptionsForSpansTask(*this, spans, batch, numBatches, counter));
+    }
+    counter.Wait();
+  } else
+#endif
+  {
     // generate phrases that start at startPos ...
     for (size_t startPos = 0 ; startPos < size; startPos++) {
-      size_t maxSize = size - startPos; // don't go over end of sentence
-      size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
-      maxSize = std::min(maxSize, maxSizePhrase);
+      size_t maxSize = std::min(size - startPos, maxSizePhrase); // don't go over end of sentence
 
       // ... and that end at endPos
       for (size_t endPos = startPos ; endPos < startPos + maxSize ; endPos++) {
-        if (graph > 0 && // only skip subsequent graphs
-            decodeGraphBackoff[graph] != 0 && // use of backoff specified
-            (endPos-startPos+1 >= decodeGraphBackoff[graph] || // size exceeds backoff limit or ...
-             m_collection[startPos][endPos-startPos].size() > 0)) { // no phrases found so far
-          VERBOSE(3,"No backoff to graph " << graph << " for span [" << startPos << ";" << endPos << "]" << endl);
-          // do not create more options
-          continue;
-        }
-
-        // create translation options for that range
-        CreateTranslationOptionsForRange( decodeGraph, startPos, endPos, true);
+        CreateTranslationOptionsForSpan(startPos, endPos);
       }
     }
   }
@@ -412,6 +473,59 @@ void TranslationOptionCollection::CreateTranslationOptions()
   CacheLexReordering();
 }
 
+/** create the translation options of one span from all decoding graphs,
+ * backing off to subsequent graphs where specified.
+ * Only touches the option list of this span, so different spans may be processed concurrently.
+ * \param startPos first position in input sentence
+ * \param endPos last position in input sentence
+ */
+void TranslationOptionCollection::CreateTranslationOptionsForSpan(size_t startPos, size_t endPos)
+{
+  // there may be multiple decoding graphs (factorizations of decoding)
+  const vector <DecodeGraph*> &decodeGraphList = m_system->GetDecodeGraphs();
+  const vector <size_t> &decodeGraphBackoff = m_system->GetDecodeGraphBackoff();
+
+  // loop over all decoding graphs, each generates translation options
+  for (size_t graph = 0 ; graph < decodeGraphList.size() ; graph++) {
+    if (graph > 0 && // only skip subsequent graphs
+        decodeGraphBackoff[graph] != 0 && // use of backoff specified
+        (endPos-startPos+1 >= decodeGraphBackoff[graph] || // size exceeds backoff limit or ...
+         m_collection[startPos][endPos-startPos].size() > 0)) { // no phrases found so far
+      VERBOSE(3,"No backoff to graph " << graph << " for span [" << startPos << ";" << endPos << "]" << endl);
+      // do not create more options
+      continue;
+    }
+
+    if (decodeGraphList.size() > 1) {
+      VERBOSE(3,"Creating translation options from decoding graph " << graph << " for span [" << startPos << ";" << endPos << "]" << endl);
+    }
+
+    // create translation options for that range
+    CreateTranslationOptionsForRange(*decodeGraphList[graph], startPos, endPos, true);
+  }
+}
+
+#ifdef WITH_THREADS
+/** Spans can only be processed on worker threads if no phrase table is kept in thread-specific storage,
+ * since those tables are initialised for the current sentence on the decoding thread only.
+ */
+bool TranslationOptionCollection::CanCreateTranslationOptionsInParallel() const
+{
+  if (StaticData::Instance().GetTranslationOptionThreadPool() == NULL) {
+    return false;
+  }
+
+  const vector<PhraseDictionaryFeature*> &dictionaries = m_system->GetPhraseDictionaries();
+  for (size_t i = 0; i < dictionaries.size(); ++i) {
+    if (!dictionaries[i]->IsThreadSafe()) {
+      VERBOSE(3,"Phrase table " << i << " is not thread-safe, creating translation options serially" << endl);
+      return false;
+    }
+  }
+  return true;
+}
+#endif
+
 void TranslationOptionCollection::Sort()
 {
   size_t size = m_source.GetSize();
@@ -452,9 +566,9 @@ void TranslationOptionCollection::CreateTranslationOptionsForRange(
       const WordsRange wordsRange(startPos, endPos);
       sourcePhrase = new Phrase(m_source.GetSubString(wordsRange));
 
-      const TranslationOptionList *transOptList = StaticData::Instance().FindTransOptListInCache(decodeGraph, *sourcePhrase);
+      TransOptCache::ListPtr transOptList = StaticData::Instance().FindTransOptListInCache(decodeGraph, *sourcePhrase);
       // is phrase in cache?
-      if (transOptList != NULL) {
+      if (transOptList) {
         skipTransOptCreation = true;
         TranslationOptionList::const_iterator iterTransOpt;
         for (iterTransOpt = transOptList->begin() ; iterTransOpt != transOptList->end() ; ++iterTransOpt) {
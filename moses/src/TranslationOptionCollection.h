@@ -63,6 +63,7 @@ class TranslationOptionCollection
 {
   friend std::ostream& operator<<(std::ostream& out, const TranslationOptionCollection& coll);
   TranslationOptionCollection(const TranslationOptionCollection&); /*< no copy constructor */
+  friend class TranslationOptionsForSpansTask;
 protected:
   const TranslationSystem* m_system;
   std::vector< std::vector< TranslationOptionList > >	m_collection; /*< contains translation options */
@@ -78,6 +79,13 @@ protected:
 
   void CalcFutureScore();
 
+  //! create the translation options of one span from all decoding graphs
+  void CreateTranslationOptionsForSpan(size_t startPos, size_t endPos);
+#ifdef WITH_THREADS
+  //! whether spans can be handed to a pool of worker threads
+  bool CanCreateTranslationOptionsInParallel() const;
+#endif
+
   //! Force a creation of a translation option where there are none for a particular source position.
   void ProcessUnknownWord();
   //! special handling of ONE unknown words.
@@ -17,26 +17,42 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
-#include "ChartTrellisDetour.h"
+#include "TrellisDetour.h"
 
-#include "ChartHypothesis.h"
-#include "ChartTrellisNode.h"
-#include "ChartTrellisPath.h"
+#include "Hypothesis.h"
+#include "TrellisPath.h"
 
 namespace Moses
 {
 
-ChartTrellisDetour::ChartTrellisDetour(
-    boost::shared_ptr<const ChartTrellisPath> basePath,
-    const ChartTrellisNode &substitutedNode,
-    const ChartHypothesis &replacementHypo)
+TrellisDetour::TrellisDetour(
+    const TrellisPath *basePath,
+    size_t edgeIndex,
+    const std::vector<const Hypothesis*> &alternatives,
+    size_t rank)
   : m_basePath(basePath)
-  , m_substitutedNode(substitutedNode)
-  , m_replacementHypo(replacementHypo)
+  , m_edgeIndex(edgeIndex)
+  , m_alternatives(&alternatives)
+  , m_rank(rank)
 {
-  float diff = replacementHypo.GetTotalScore()
-             - substitutedNode.GetHypothesis().GetTotalScore();
-  m_totalScore = basePath->GetTotalScore() + diff;
+  const Hypothesis &replacementHypo = GetReplacementHypo();
+  if (basePath == NULL) {
+    m_totalScore = replacementHypo.GetTotalScore();
+  } else {
+    // the replaced edge is always a winning hypothesis, so only the
+    // difference to the arc that takes its place changes
+    float diff = replacementHypo.GetTotalScore()
+               - basePath->GetEdges()[edgeIndex]->GetTotalScore();
+    m_totalScore = basePath->GetTotalScore() + diff;
+  }
+}
+
+TrellisPath *TrellisDetour::CreatePath() const
+{
+  if (m_basePath == NULL) {
+    return new TrellisPath(&GetReplacementHypo());
+  }
+  return new TrellisPath(*m_basePath, m_edgeIndex, &GetReplacementHypo());
 }
 
 }  // namespace Moses
@@ -0,0 +1,77 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+ 
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+ 
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ 
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Moses
+{
+class Hypothesis;
+class TrellisPath;
+
+/** A candidate for the phrase-based n-best list that has not been built yet:
+ *  the base path with one edge replaced by an alternative hypothesis.
+ *  Alternatives for an edge are sorted by score, so the next best candidate
+ *  for the same edge is the next sibling in that list. Detours are cheap
+ *  values, the path itself is only created by CreatePath() once the detour
+ *  is popped from the queue.
+ */
+class TrellisDetour
+{
+public:
+  //! a pure path ending in alternatives[rank], or basePath deviating at edgeIndex to alternatives[rank]
+  TrellisDetour(const TrellisPath *basePath, size_t edgeIndex,
+                const std::vector<const Hypothesis*> &alternatives, size_t rank);
+
+  const TrellisPath *GetBasePath() const {
+    return m_basePath;
+  }
+  const Hypothesis &GetReplacementHypo() const {
+    return *(*m_alternatives)[m_rank];
+  }
+  float GetTotalScore() const {
+    return m_totalScore;
+  }
+
+  bool HasNextSibling() const {
+    return m_rank + 1 < m_alternatives->size();
+  }
+  TrellisDetour GetNextSibling() const {
+    return TrellisDetour(m_basePath, m_edgeIndex, *m_alternatives, m_rank + 1);
+  }
+
+  //! build the full path. The caller is responsible for deleting it
+  TrellisPath *CreatePath() const;
+
+  bool operator<(const TrellisDetour &other) const {
+    // for std::priority_queue, which keeps the largest item on top
+    return m_totalScore < other.m_totalScore;
+  }
+
+private:
+  const TrellisPath *m_basePath;
+  size_t m_edgeIndex;
+  const std::vector<const Hypothesis*> *m_alternatives;
+  size_t m_rank;
+  float m_totalScore;
+};
+
+}
@@ -206,6 +206,23 @@ Phrase TrellisPath::GetSurfacePhrase() const
   return ret;
 }
 
+void TrellisPath::GetSurfaceFactors(std::vector<const Factor*> &factors) const
+{
+  const std::vector<FactorType> &outputFactor = StaticData::Instance().GetOutputFactorOrder();
+  factors.clear();
+
+  for (int node = (int) m_path.size() - 2 ; node >= 0 ; --node) {
+    const Phrase &currTargetPhrase = m_path[node]->GetCurrTargetPhrase();
+    for (size_t pos = 0 ; pos < currTargetPhrase.GetSize() ; ++pos) {
+      for (size_t i = 0 ; i < outputFactor.size() ; i++) {
+        const Factor *factor = currTargetPhrase.GetFactor(pos, outputFactor[i]);
+        CHECK(factor);
+        factors.push_back(factor);
+      }
+    }
+  }
+}
+
 WordsRange TrellisPath::GetTargetWordsRange(const Hypothesis &hypo) const
 {
   size_t startPos = 0;
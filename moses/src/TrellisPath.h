@@ -97,6 +97,11 @@ public:
   Phrase GetTargetPhrase() const;
   Phrase GetSurfacePhrase() const;
 
+  /** output factors of every target word, in output factor order, without building a Phrase.
+   *  Cheap key for checking whether two paths give the same translation
+   */
+  void GetSurfaceFactors(std::vector<const Factor*> &factors) const;
+
   TO_STRING();
 
 };
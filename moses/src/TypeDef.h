@@ -144,6 +144,7 @@ enum PhraseTableImplementation {
   ,SuffixArray	= 8
   ,Hiero        = 9
   ,ALSuffixArray = 10
+  ,CompactBinary = 11
 };
 
 enum InputTypeEnum {
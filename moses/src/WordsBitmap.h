@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <cstring>
 #include <cmath>
 #include <cstdlib>
+#include <boost/functional/hash.hpp>
 #include "TypeDef.h"
 #include "WordsRange.h"
 
@@ -35,73 +36,106 @@ namespace Moses
 {
 typedef unsigned long WordsBitmapID;
 
-/** vector of boolean used to represent whether a word has been translated or not
+/** vector of boolean used to represent whether a word has been translated or not.
+ *  Stored as a packed array of 64-bit blocks, which for sentences of up to
+ *  INLINE_SIZE words lives inside the object itself.  Bits past the end of
+ *  the sentence are always 0.
 */
 class WordsBitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitmap);
 protected:
+  typedef uint64_t Block;
+  static const size_t BLOCK_SIZE = 64; /**< bits per block */
+  static const size_t INLINE_BLOCKS = 4;
+
   const size_t m_size; /**< number of words in sentence */
-  bool	*m_bitmap;	/**< ticks of words that have been done */
+  const size_t m_numBlocks;
+  Block	m_inline[INLINE_BLOCKS]; /**< storage for short sentences */
+  Block	*m_bitmap;	/**< ticks of words that have been done */
 
   WordsBitmap(); // not implemented
+  WordsBitmap &operator=(const WordsBitmap &); // not implemented
+
+  static size_t GetNumBlocks(size_t size) {
+    return (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  }
+
+  //! bits [from, to] of a block, inclusive, 0 <= from <= to < BLOCK_SIZE
+  static Block GetMask(size_t from, size_t to) {
+    const Block upTo = (to + 1 == BLOCK_SIZE) ? ~Block(0) : ((Block(1) << (to + 1)) - 1);
+    return upTo & (~Block(0) << from);
+  }
+
+  //! mask of the bits of block i that correspond to words of the sentence
+  Block GetValidMask(size_t i) const {
+    return (i + 1 < m_numBlocks) ? ~Block(0) : GetMask(0, (m_size - 1) % BLOCK_SIZE);
+  }
+
+  void Allocate() {
+    m_bitmap = (m_numBlocks <= INLINE_BLOCKS)
+               ? m_inline : (Block*) malloc(sizeof(Block) * m_numBlocks);
+  }
 
   //! set all elements to false
   void Initialize() {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      m_bitmap[pos] = false;
-    }
+    std::memset(m_bitmap, 0, sizeof(Block) * m_numBlocks);
   }
 
   //sets elements by vector
-  void Initialize(std::vector<bool> vector) {
+  void Initialize(const std::vector<bool> &vector) {
+    Initialize();
     size_t vector_size = vector.size();
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (pos < vector_size && vector[pos] == true) m_bitmap[pos] = true;
-      else m_bitmap[pos] = false;
+    for (size_t pos = 0 ; pos < m_size && pos < vector_size ; pos++) {
+      if (vector[pos]) SetValue(pos, true);
     }
   }
 
 
 public:
+  //! sentences up to this length don't need heap allocation
+  static const size_t INLINE_SIZE = INLINE_BLOCKS * BLOCK_SIZE;
+
   //! create WordsBitmap of length size and initialise with vector
-  WordsBitmap(size_t size, std::vector<bool> initialize_vector)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+  WordsBitmap(size_t size, const std::vector<bool> &initialize_vector)
+    :m_size	(size)
+    ,m_numBlocks(GetNumBlocks(size)) {
+    Allocate();
     Initialize(initialize_vector);
   }
   //! create WordsBitmap of length size and initialise
   WordsBitmap(size_t size)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+    :m_size	(size)
+    ,m_numBlocks(GetNumBlocks(size)) {
+    Allocate();
     Initialize();
   }
   //! deep copy
   WordsBitmap(const WordsBitmap &copy)
-    :m_size	(copy.m_size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * m_size);
-    for (size_t pos = 0 ; pos < copy.m_size ; pos++) {
-      m_bitmap[pos] = copy.GetValue(pos);
-    }
+    :m_size	(copy.m_size)
+    ,m_numBlocks(copy.m_numBlocks) {
+    Allocate();
+    std::memcpy(m_bitmap, copy.m_bitmap, sizeof(Block) * m_numBlocks);
   }
   ~WordsBitmap() {
-    free(m_bitmap);
+    if (m_bitmap != m_inline)
+      free(m_bitmap);
   }
   //! count of words translated
   size_t GetNumWordsCovered() const {
     size_t count = 0;
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (m_bitmap[pos])
-        count++;
+    for (size_t i = 0 ; i < m_numBlocks ; i++) {
+      count += __builtin_popcountll(m_bitmap[i]);
     }
     return count;
   }
 
   //! position of 1st word not yet translated, or NOT_FOUND if everything already translated
   size_t GetFirstGapPos() const {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t i = 0 ; i < m_numBlocks ; i++) {
+      const Block gaps = ~m_bitmap[i] & GetValidMask(i);
+      if (gaps) {
+        return i * BLOCK_SIZE + __builtin_ctzll(gaps);
       }
     }
     // no starting pos
@@ -111,9 +145,10 @@ public:
 
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t i = m_numBlocks ; i > 0 ; i--) {
+      const Block gaps = ~m_bitmap[i-1] & GetValidMask(i-1);
+      if (gaps) {
+        return i * BLOCK_SIZE - 1 - __builtin_clzll(gaps);
       }
     }
     // no starting pos
@@ -123,9 +158,9 @@ public:
 
   //! position of last translated word
   size_t GetLastPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (m_bitmap[pos]) {
-        return pos;
+    for (size_t i = m_numBlocks ; i > 0 ; i--) {
+      if (m_bitmap[i-1]) {
+        return i * BLOCK_SIZE - 1 - __builtin_clzll(m_bitmap[i-1]);
       }
     }
     // no starting pos
@@ -134,26 +169,39 @@ public:
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
-    return m_bitmap[pos];
+    return (m_bitmap[pos / BLOCK_SIZE] >> (pos % BLOCK_SIZE)) & 1;
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    m_bitmap[pos] = value;
+    const Block bit = Block(1) << (pos % BLOCK_SIZE);
+    if (value)
+      m_bitmap[pos / BLOCK_SIZE] |= bit;
+    else
+      m_bitmap[pos / BLOCK_SIZE] &= ~bit;
   }
   //! set value between 2 positions, inclusive
   void SetValue( size_t startPos, size_t endPos, bool value ) {
-    for(size_t pos = startPos ; pos <= endPos ; pos++) {
-      m_bitmap[pos] = value;
+    for (size_t i = startPos / BLOCK_SIZE ; i <= endPos / BLOCK_SIZE ; i++) {
+      const size_t from = (i == startPos / BLOCK_SIZE) ? startPos % BLOCK_SIZE : 0;
+      const size_t to = (i == endPos / BLOCK_SIZE) ? endPos % BLOCK_SIZE : BLOCK_SIZE - 1;
+      if (value)
+        m_bitmap[i] |= GetMask(from, to);
+      else
+        m_bitmap[i] &= ~GetMask(from, to);
     }
   }
   //! whether every word has been translated
   bool IsComplete() const {
-    return GetSize() == GetNumWordsCovered();
+    return GetFirstGapPos() == NOT_FOUND;
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const WordsRange &compare) const {
-    for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
-      if (m_bitmap[pos])
+    const size_t startPos = compare.GetStartPos()
+                            , endPos = compare.GetEndPos();
+    for (size_t i = startPos / BLOCK_SIZE ; i <= endPos / BLOCK_SIZE ; i++) {
+      const size_t from = (i == startPos / BLOCK_SIZE) ? startPos % BLOCK_SIZE : 0;
+      const size_t to = (i == endPos / BLOCK_SIZE) ? endPos % BLOCK_SIZE : BLOCK_SIZE - 1;
+      if (m_bitmap[i] & GetMask(from, to))
         return true;
     }
     return false;
@@ -175,27 +223,56 @@ public:
     if (thisSize != compareSize) {
       return (thisSize < compareSize) ? -1 : 1;
     }
-    return std::memcmp(m_bitmap, compare.m_bitmap, thisSize * sizeof(bool));
+    // position order, as a byte-wise comparison of one bool per position:
+    // the first position where the bitmaps differ decides, covered > uncovered
+    for (size_t i = 0 ; i < m_numBlocks ; i++) {
+      const Block diff = m_bitmap[i] ^ compare.m_bitmap[i];
+      if (diff) {
+        return (m_bitmap[i] & (diff & (~diff + 1))) ? 1 : -1;
+      }
+    }
+    return 0;
   }
 
   bool operator< (const WordsBitmap &compare) const {
     return Compare(compare) < 0;
   }
 
+  bool operator== (const WordsBitmap &compare) const {
+    return Compare(compare) == 0;
+  }
+
+  //! hash of the coverage pattern, consistent with operator==
+  size_t GetHash() const {
+    size_t seed = m_size;
+    boost::hash_range(seed, m_bitmap, m_bitmap + m_numBlocks);
+    return seed;
+  }
+
+  //! first position of the gap ending at l-1, or l if position l-1 is covered
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
-    while (l && !m_bitmap[l-1]) {
-      --l;
+    // look for the last covered position before l
+    size_t i = (l - 1) / BLOCK_SIZE;
+    Block covered = m_bitmap[i] & GetMask(0, (l - 1) % BLOCK_SIZE);
+    while (!covered && i > 0) {
+      covered = m_bitmap[--i];
     }
-    return l;
+    if (!covered) return 0;
+    return i * BLOCK_SIZE + (BLOCK_SIZE - __builtin_clzll(covered));
   }
 
+  //! last position of the gap starting at r+1, or r if position r+1 is covered
   inline size_t GetEdgeToTheRightOf(size_t r) const {
     if (r+1 == m_size) return r;
-    while (r+1 < m_size && !m_bitmap[r+1]) {
-      ++r;
+    // look for the first covered position after r
+    size_t i = (r + 1) / BLOCK_SIZE;
+    Block covered = m_bitmap[i] & (~Block(0) << ((r + 1) % BLOCK_SIZE));
+    while (!covered && i + 1 < m_numBlocks) {
+      covered = m_bitmap[++i];
     }
-    return r;
+    if (!covered) return m_size - 1;
+    return i * BLOCK_SIZE + __builtin_ctzll(covered) - 1;
   }
 
 
@@ -246,10 +323,15 @@ public:
   TO_STRING();
 };
 
+inline size_t hash_value(const WordsBitmap &wordsBitmap)
+{
+  return wordsBitmap.GetHash();
+}
+
 // friend
 inline std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitmap)
 {
-  for (size_t i = 0 ; i < wordsBitmap.m_size ; i++) {
+  for (size_t i = 0 ; i < wordsBitmap.GetSize() ; i++) {
     out << (wordsBitmap.GetValue(i) ? 1 : 0);
   }
   return out;
@@ -78,17 +78,36 @@ sub get_nbestlist
   my ($moses_ini) = @_;
   my $nbestfile = undef;
   my $nbestsize = undef;
+  my $nbestdistinct = 0;
 
   open MI, "<$moses_ini" or die "Couldn't read $moses_ini";
   while (my $l = <MI>) {
     if ($l =~ /\[n-best-list\]/i){
       chomp($nbestfile = <MI>);
       chomp($nbestsize = <MI>);
+      my $distinct = <MI>;
+      $nbestdistinct = 1 if (defined($distinct) && $distinct =~ /^distinct\s*$/);
     }
   }
   close MI;
 
-  return ($nbestfile,$nbestsize);
+  return ($nbestfile,$nbestsize,$nbestdistinct);
+}
+
+sub get_searchgraph
+{
+  my ($moses_ini) = @_;
+  my $searchgraphfile = undef;
+
+  open MI, "<$moses_ini" or die "Couldn't read $moses_ini";
+  while (my $l = <MI>) {
+    if ($l =~ /\[output-search-graph\]/i){
+      chomp($searchgraphfile = <MI>);
+    }
+  }
+  close MI;
+
+  return $searchgraphfile;
 }
 
 
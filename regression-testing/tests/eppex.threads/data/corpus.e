@@ -0,0 +1,80 @@
+W38 W30 W40 W37 W4 W38
+W33 W24 W47 W0 W42 W49 W4 W10 W48
+W27 W49 W40 W54
+W20 W34 W57 W36 W36 W6 W45
+W26 W57
+W48
+W6 W38 W34 W2 W12 W26 W18
+W17 W27 W40 W46 W45 W15 W59 W19 W27 W16
+W20 W11 W23 W11 W20 W48 W23 W54 W38 W16 W19 W50 W24
+W51 W53 W53 W36 W11 W55 W17 W21 W51 W52
+W48 W42 W47 W33 W18 W34 W21 W56 W14
+W19 W15 W42 W1 W33 W34 W26 W3 W58
+W55
+W49 W52
+W30
+W19 W23 W16 W12 W21 W27 W7 W8
+W17 W44 W37 W4 W51 W27 W14 W27
+W6 W51
+W11 W52 W1 W21 W53
+W35 W3
+W15 W59 W26 W53 W47 W10 W26 W44 W36 W48 W37
+W13 W19 W1 W17 W30 W51 W24 W12 W11 W36 W23 W15 W20 W30
+W15
+W2 W57 W59 W16 W10
+W58
+W47 W31 W25 W8 W34 W20 W7 W56 W17 W4 W42
+W11 W41 W41 W46 W40 W9 W11 W23 W56 W58
+W48
+W3 W55
+W7 W9 W17 W37 W6 W43 W7 W36 W49 W58 W46 W7 W11 W44
+W43 W45 W19 W57 W55 W42 W30
+W59 W3 W1 W23 W39 W14 W32 W4 W31 W34 W1 W59
+W10 W25 W31 W30 W44 W4 W34 W54
+W54 W29 W34 W12 W10 W13
+W31 W1 W58 W56 W14
+W5 W3 W43 W27 W5 W37 W39
+W7 W32 W24 W35 W21 W34 W43 W49 W59
+W45
+W38
+W57 W55
+W21 W36 W19 W7
+W32 W49 W58
+W52 W53 W43 W39 W6 W41 W31 W48
+W53 W3 W21 W15 W27 W28 W5 W16 W13
+W1 W46 W9 W18 W32 W33 W3 W40 W30 W2
+W18 W24 W51 W56
+W29 W23 W56 W22
+W23 W35 W2 W31 W11 W15 W0
+W48 W53 W50 W26 W32
+W3 W57
+W23 W33 W40 W10 W18 W11 W4 W43 W8 W53
+W45 W48 W58 W17 W6 W27 W42 W4 W23 W2
+W5 W31 W14 W12
+W3 W11 W15 W31 W10 W9 W9 W57 W45
+W24 W22 W58
+W47 W54 W50 W28 W36 W26 W29 W34 W34 W19
+W7 W50 W25 W36 W43 W23 W33 W44 W49
+W32 W14 W46 W21 W46 W41 W15 W18 W27 W17
+W27 W46 W55 W24 W45 W35 W23 W0
+W20 W27 W18 W12
+W35 W12 W7 W52 W11 W38 W56 W5
+W47 W20 W4
+W41 W25 W5 W3 W41 W33 W1 W57 W59
+W47 W33 W13 W28 W3 W46
+W24 W56 W54 W43 W53 W46
+W44 W13 W13 W51 W42
+W50 W34 W55 W29 W31 W1 W37 W11 W17
+W54 W19 W30 W40 W34
+W43 W35 W47 W48 W22 W27 W30 W23 W36 W11 W15
+W6 W35 W34
+W30 W23 W27 W9 W16
+W48 W5 W14 W29 W21 W7
+W9 W2 W2 W10 W27 W40 W0 W13
+W9 W7
+W42 W39 W28 W16 W11 W44 W52 W0 W4 W18
+W20 W36 W7 W34
+W48 W38 W24 W42 W57
+W7 W4 W31 W4 W30 W51 W15 W47 W59
+W25 W33 W47 W49 W46
+W1 W20 W19 W30 W47 W40 W16 W50
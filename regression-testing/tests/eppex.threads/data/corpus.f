@@ -0,0 +1,80 @@
+w34 w8 w23 w58
+w40 w55 w9 w14 w40 w9 w55 w59
+w2 w8 w31 w13 w16 w43
+w42 w44 w10 w44 w55
+w51 w4
+w38 w39
+w15 w2 w19 w0 w4
+w41 w55 w38 w43 w35 w6 w39 w51 w32
+w1 w37 w3 w43 w1 w23 w16 w40 w29 w19 w37 w38
+w56 w36 w28 w17 w14 w50 w7 w2 w33 w12 w20
+w59 w45 w14 w2 w47 w29 w53
+w3 w0 w30 w47 w7 w10 w32
+w31 w40 w36
+w20
+w7 w3 w4
+w10 w20 w4 w22 w24 w41 w24 w37
+w26 w44 w26 w29 w1 w15 w13 w34
+w36 w34
+w33 w5 w36 w6 w42 w56 w24
+w35 w47 w6 w59
+w16 w23 w38 w25 w22 w35 w26 w5 w24 w32
+w49 w18 w42 w45 w54 w26 w38 w54 w37 w37 w17 w56
+w54 w16
+w45 w43 w54
+w16 w53
+w0 w1 w21 w21 w27 w24 w31 w4 w13 w41 w37
+w22 w3 w45 w18 w43 w46 w36 w47
+w45 w11
+w17 w24
+w22 w56 w21 w25 w28 w34 w51 w49 w4 w22 w31 w54
+w35 w57 w37 w19 w40 w31 w33
+w7 w36 w18 w42 w57 w9 w8 w29 w50 w5 w39
+w6 w50 w2 w26 w4 w54 w12 w45
+w0 w51 w13 w16 w50 w23 w9
+w45 w45 w3 w15 w25 w2 w25
+w35 w17 w1 w52 w21 w40 w22 w20
+w24 w19 w48 w38 w40 w25 w5 w18 w11 w54 w26
+w10
+w20 w15
+w29
+w4 w12 w25 w50 w58 w6
+w54 w35 w32 w26
+w54 w6 w12 w57 w16 w5 w6 w29 w25 w14
+w27 w50 w41 w4 w38 w33 w13 w15 w22
+w58 w2 w18 w59 w1 w11 w57 w6
+w48 w51 w44
+w54 w18 w18 w1
+w10 w3 w0 w13 w49 w50 w29 w22 w50
+w15 w8 w47
+w41
+w42 w48 w59 w55 w52 w38 w32 w26
+w1 w20 w36 w38 w35 w7 w31 w8 w17 w50
+w16 w26 w57
+w18 w44 w4 w27 w17 w30 w29 w17 w18 w34 w35
+w8 w7 w9 w18 w8
+w6 w45 w54 w20 w30 w1 w47 w22 w33
+w55 w11 w7 w36 w0 w10 w55
+w55 w44 w53 w21 w18 w19 w17 w11 w7 w38
+w13 w3 w35 w31 w56 w7
+w39 w0 w8 w56 w5 w13
+w32 w56 w59 w24 w14 w30 w8 w56 w19 w18
+w56 w48
+w52 w42 w21 w41 w26 w56 w37 w14 w56 w20 w12
+w49 w55 w58 w37 w54 w46
+w20 w11 w48 w2 w20 w31 w15
+w10 w15 w30
+w11 w40 w19 w28 w23 w3 w5
+w37 w20 w6 w22 w33 w9
+w34 w20 w26 w53 w59 w47 w41 w18 w59 w0 w27
+w32 w42 w10 w7
+w14 w16 w7 w13 w7
+w57 w6 w6 w55 w45 w8
+w16 w18 w34 w17 w37 w57 w24
+w31 w27 w47 w18
+w6 w0 w44 w5 w40 w50 w33 w25 w45 w29 w35
+w25 w6 w25
+w12 w29 w36 w32 w16 w40
+w28 w33 w8 w19 w33 w10 w14 w23 w33 w18
+w7 w43 w12 w15 w5 w10 w47
+w50 w25 w27 w29 w21 w38
@@ -0,0 +1,33 @@
+#!/usr/bin/perl
+
+BEGIN { use Cwd qw/ abs_path /; use File::Basename; $script_dir = dirname(abs_path($0)); push @INC, "$script_dir/../perllib"; }
+use RegTestUtils;
+
+# every hypothesis covering the whole sentence must have a future cost of exactly 0
+$x=0;
+$complete=0;
+$nonzero=0;
+$coverage="";
+while (<>) {
+  chomp;
+
+  if (/^creating hypothesis /) {
+    $coverage = "";
+  }
+  if (/^\tcoverage ([01]+)$/) {
+    $coverage = $1;
+  }
+  if (/^\tscore .* \+ future cost (\S+) = /) {
+    my $future = $1;
+    if ($coverage =~ /^1+$/) {
+      $complete++;
+      $nonzero++ if $future ne "0.000";
+    }
+  }
+  next unless /^BEST TRANSLATION:/;
+  my $pscore = RegTestUtils::readHypoScore($_);
+  print "SCORE_$x = $pscore\n";
+  $x++;
+}
+print "COMPLETE_HYPOTHESES = $complete\n";
+print "COMPLETE_WITH_FUTURE_COST = $nonzero\n";
@@ -0,0 +1,20 @@
+#!/usr/bin/perl
+
+BEGIN { use Cwd qw/ abs_path /; use File::Basename; $script_dir = dirname(abs_path($0)); push @INC, "$script_dir/../perllib"; }
+use RegTestUtils;
+
+$x=0;
+$degraded=0;
+$completed=0;
+while (<>) {
+  chomp;
+
+  $degraded++ if /^Pruning was tightened to meet the latency budget/;
+  $completed++ if /^No complete translation was found/;
+  next unless /^BEST TRANSLATION:/;
+  my $pscore = RegTestUtils::readHypoScore($_);
+  print "SCORE_$x = $pscore\n";
+  $x++;
+}
+print "DEGRADED_SENTENCES = $degraded\n";
+print "COMPLETED_MONOTONICALLY = $completed\n";
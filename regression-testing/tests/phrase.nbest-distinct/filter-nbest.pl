@@ -0,0 +1,12 @@
+#!/usr/bin/perl
+# n-best entries with their feature scores and total score
+$x=0;
+$oldcode = "";
+while (<>) {
+  chomp;
+  ($code,$trans,$featscores,$globscores) = split(/[\s]*\|\|\|[\s]*/,$_);
+  $x = 0 if $oldcode ne $code;
+  $x++;
+  print "TRANSLATION_${code}_NBEST_${x}=$trans ||| $featscores ||| $globscores\n";
+  $oldcode = $code;
+}
@@ -0,0 +1,12 @@
+#!/usr/bin/perl
+# every hypothesis of the search graph with its back pointer, recombination and scores
+$x=0;
+$oldcode = "";
+while (<>) {
+  chomp;
+  ($code,$hyp) = split(/ /,$_,2);
+  $x = 0 if $oldcode ne $code;
+  $x++;
+  print "SEARCH_GRAPH_${code}_${x}=$hyp\n";
+  $oldcode = $code;
+}
@@ -6,7 +6,6 @@
 #include <cstdio>
 #include <sstream>
 #include <string>
-#include "zlib.h"
 
 #include "reordering_classes.h"
 
@@ -62,6 +61,16 @@ void ModelScore::add_example(const string& previous, string& next)
   count_f_next[getType(next)]++;
 }
 
+void ModelScore::add_counts(const unsigned int* previous, const unsigned int* next)
+{
+  for(int i=MONO; i<=NOMONO; ++i) {
+    count_fe_prev[i] += previous[i];
+    count_f_prev[i] += previous[i];
+    count_fe_next[i] += next[i];
+    count_f_next[i] += next[i];
+  }
+}
+
 const vector<double>& ModelScore::get_scores_fe_prev() const
 {
   return count_fe_prev;
@@ -271,7 +280,10 @@ void Model::score_fe(const string& f, const string& e)
 {
   if (!fe)    //Make sure we do not do anything if it is not a fe model
     return;
-  fprintf(file,"%s ||| %s ||| ",f.c_str(),e.c_str());
+  write(f);
+  write(" ||| ");
+  write(e);
+  write(" ||| ");
   //condition on the previous phrase
   if (previous) {
     vector<double> scores;
@@ -282,7 +294,7 @@ void Model::score_fe(const string& f, const string& e)
       sum += scores[i];
     }
     for(int i=0; i<scores.size(); ++i) {
-      fprintf(file,"%f ",scores[i]/sum);
+      write_score(scores[i]/sum);
     }
     //fprintf(file, "||| ");
   }
@@ -296,17 +308,18 @@ void Model::score_fe(const string& f, const string& e)
       sum += scores[i];
     }
     for(int i=0; i<scores.size(); ++i) {
-      fprintf(file, "%f ", scores[i]/sum);
+      write_score(scores[i]/sum);
     }
   }
-  fprintf(file,"\n");
+  write("\n");
 }
 
 void Model::score_f(const string& f)
 {
   if (fe)      //Make sure we do not do anything if it is not a f model
     return;
-  fprintf(file, "%s ||| ", f.c_str());
+  write(f);
+  write(" ||| ");
   //condition on the previous phrase
   if (previous) {
     vector<double> scores;
@@ -317,7 +330,7 @@ void Model::score_f(const string& f)
       sum += scores[i];
     }
     for(int i=0; i<scores.size(); ++i) {
-      fprintf(file, "%f ", scores[i]/sum);
+      write_score(scores[i]/sum);
     }
     //fprintf(file, "||| ");
   }
@@ -331,20 +344,46 @@ void Model::score_f(const string& f)
       sum += scores[i];
     }
     for(int i=0; i<scores.size(); ++i) {
-      fprintf(file, "%f ", scores[i]/sum);
+      write_score(scores[i]/sum);
     }
   }
-  fprintf(file, "\n");
+  write("\n");
 }
 
-Model::Model(ModelScore* ms, Scorer* sc, const string& dir, const string& lang, const string& fn)
-  : modelscore(ms), scorer(sc), filename(fn)
+void Model::write(const string& s)
 {
+  if (pipe) {
+    fwrite(s.data(), 1, s.size(), pipe);
+  } else {
+    gzwrite(gzfile, s.data(), s.size());
+  }
+}
 
-  file = fopen(filename.c_str(),"w");
-  if (!file) {
-    cerr << "Could not open the model output file: " << filename << endl;
-    exit(1);
+void Model::write_score(double score)
+{
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%f ", score);
+  write(buffer);
+}
+
+Model::Model(ModelScore* ms, Scorer* sc, const string& dir, const string& lang, const string& fn,
+             const string& binarizer)
+  : modelscore(ms), scorer(sc), gzfile(NULL), pipe(NULL), filename(fn)
+{
+
+  if (!binarizer.empty()) {
+    string command = binarizer + " -out " + filename;
+    pipe = popen(command.c_str(), "w");
+    if (!pipe) {
+      cerr << "Could not run the binarizer: " << command << endl;
+      exit(1);
+    }
+  } else {
+    gzfile = gzopen((filename+".gz").c_str(), "wb");
+    if (!gzfile) {
+      cerr << "Could not open the model output file: " << filename << ".gz" << endl;
+      exit(1);
+    }
   }
 
   fe = false;
@@ -367,26 +406,24 @@ Model::Model(ModelScore* ms, Scorer* sc, const string& dir, const string& lang,
 
 Model::~Model()
 {
-  fclose(file);
+  close();
   delete modelscore;
   delete scorer;
 }
 
-void Model::zipFile()
+void Model::close()
 {
-  fclose(file);
-  file = fopen(filename.c_str(), "rb");
-  FILE* gzfile = (FILE*) gzopen((filename+".gz").c_str(),"wb");
-  char inbuffer[128];
-  int num_read;
-  while ((num_read = fread(inbuffer, 1, sizeof(inbuffer), file)) > 0) {
-    gzwrite(gzfile, inbuffer, num_read);
+  if (pipe) {
+    if (pclose(pipe) != 0) {
+      cerr << "The binarizer of " << filename << " failed" << endl;
+      exit(1);
+    }
+    pipe = NULL;
+  }
+  if (gzfile) {
+    gzclose(gzfile);
+    gzfile = NULL;
   }
-  fclose(file);
-  gzclose(gzfile);
-
-  //Remove the unzipped file
-  remove(filename.c_str());
 }
 
 void Model::split_config(const string& config, string& dir, string& lang, string& orient)
@@ -399,20 +436,21 @@ void Model::split_config(const string& config, string& dir, string& lang, string
   getline(is, lang, '-');
 }
 
-Model* Model::createModel(ModelScore* modelscore, const string& config, const string& filepath)
+Model* Model::createModel(ModelScore* modelscore, const string& config, const string& filepath,
+                          const string& binarizer)
 {
   string dir, lang, orient, filename;
   split_config(config,dir,lang,orient);
 
   filename = filepath + config;
   if (orient.compare("mslr") == 0) {
-    return new Model(modelscore, new ScorerMSLR(), dir, lang, filename);
+    return new Model(modelscore, new ScorerMSLR(), dir, lang, filename, binarizer);
   } else if (orient.compare("msd") == 0) {
-    return new Model(modelscore, new ScorerMSD(), dir, lang, filename);
+    return new Model(modelscore, new ScorerMSD(), dir, lang, filename, binarizer);
   } else if (orient.compare("monotonicity") == 0) {
-    return new Model(modelscore, new ScorerMonotonicity(), dir, lang, filename);
+    return new Model(modelscore, new ScorerMonotonicity(), dir, lang, filename, binarizer);
   } else if (orient.compare("leftright") == 0) {
-    return new Model(modelscore, new ScorerLR(), dir, lang, filename);
+    return new Model(modelscore, new ScorerLR(), dir, lang, filename, binarizer);
   } else {
     cerr << "Illegal orientation type of reordering model: " << orient
          << "\n allowed types: mslr, msd, monotonicity, leftright\n";
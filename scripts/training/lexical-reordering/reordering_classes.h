@@ -11,9 +11,11 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include "zlib.h"
 
 
 enum ORIENTATION {MONO, SWAP, DRIGHT, DLEFT, OTHER, NOMONO};
+const int NUM_ORIENTATIONS = NOMONO+1;
 
 
 //Keeps the counts for the different reordering types
@@ -32,6 +34,11 @@ protected:
 public:
   ModelScore();
   void add_example(const std::string& previous, std::string& next);
+  //adds the counts of a phrase pair, indexed by orientation
+  void add_counts(const unsigned int* previous, const unsigned int* next);
+  ORIENTATION get_orientation(const std::string& s) {
+    return getType(s);
+  }
   void reset_fe();
   void reset_f();
   const std::vector<double>& get_scores_fe_prev() const;
@@ -119,7 +126,8 @@ private:
   ModelScore* modelscore;
   Scorer* scorer;
 
-  std::FILE* file;
+  gzFile gzfile;
+  std::FILE* pipe;
   std::string filename;
 
   bool fe;
@@ -131,15 +139,23 @@ private:
 
   static void split_config(const std::string& config, std::string& dir,
                            std::string& lang, std::string& orient);
+
+  void write(const std::string& s);
+  void write_score(double score);
+
 public:
+  //with a binarizer (processLexicalTable), the table is piped into it,
+  //otherwise it is written to filename.gz
   Model(ModelScore* ms, Scorer* sc, const std::string& dir,
-        const std::string& lang, const std::string& fn);
+        const std::string& lang, const std::string& fn,
+        const std::string& binarizer);
   ~Model();
-  static Model* createModel(ModelScore*, const std::string&, const std::string&);
+  static Model* createModel(ModelScore*, const std::string&, const std::string&,
+                            const std::string& binarizer = "");
   void createSmoothing(double w);
   void createConstSmoothing(double w);
   void score_fe(const std::string& f, const std::string& e);
   void score_f(const std::string& f);
-  void zipFile();
+  void close();
 };
 
@@ -13,7 +13,17 @@
 #include <sstream>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <queue>
 
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#include "SentenceBatchQueue.h"
+#endif
+
+#include "InputFileStream.h"
 #include "reordering_classes.h"
 
 using namespace std;
@@ -21,6 +31,77 @@ using namespace std;
 void split_line(const string& line, string& foreign, string& english, string& wbe, string& phrase, string& hier);
 void get_orientations(const string& pair, string& previous, string& next);
 
+//orientation counts of a phrase pair, per model score: NUM_ORIENTATIONS counts
+//of the previous, then NUM_ORIENTATIONS counts of the next orientation.
+//the key is the line prefix "f ||| e ||| ", which sorts like the whole line
+typedef boost::unordered_map<string, vector<unsigned int> > CountTable;
+
+//a model score, and which field of the extract it is estimated from
+struct CountedModel {
+  string name;
+  ModelScore* modelScore;
+};
+
+void count_lines(const vector<string>& lines, const vector<CountedModel>& counted, CountTable& counts);
+void score_counts(vector<CountTable>& shards, int threads, bool smoothWithCounts, double smoothingValue,
+                  const vector<CountedModel>& counted, const map<string,ModelScore*>& modelScores,
+                  const vector<Model*>& models);
+
+#ifdef WITH_THREADS
+//lines of the extract, handed from the reading thread to a counting worker
+struct LineBatch {
+  vector<string> lines;
+};
+
+typedef Moses::BatchQueue<LineBatch> LineBatchQueue;
+
+//counts batches of lines, and adds the counts to the shared tables.
+//each phrase pair belongs to the shard chosen by the hash of its key
+class CountWorker
+{
+public:
+  CountWorker(LineBatchQueue& queue, const vector<CountedModel>& counted,
+              vector<CountTable>& shards, vector<boost::mutex*>& locks)
+    : m_queue(queue), m_counted(counted), m_shards(shards), m_locks(locks) {}
+
+  void operator()() {
+    const size_t numShards = m_shards.size();
+    boost::hash<string> hasher;
+    LineBatch* batch;
+    while ((batch = m_queue.Pop()) != NULL) {
+      CountTable counts;
+      count_lines(batch->lines, m_counted, counts);
+      delete batch;
+
+      vector<vector<const CountTable::value_type*> > byShard(numShards);
+      for (CountTable::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+        byShard[hasher(it->first) % numShards].push_back(&*it);
+      }
+      for (size_t s=0; s<numShards; ++s) {
+        boost::mutex::scoped_lock lock(*m_locks[s]);
+        for (size_t k=0; k<byShard[s].size(); ++k) {
+          vector<unsigned int>& total = m_shards[s][byShard[s][k]->first];
+          const vector<unsigned int>& pairCounts = byShard[s][k]->second;
+          if (total.empty()) {
+            total = pairCounts;
+          } else {
+            for (size_t c=0; c<total.size(); ++c) {
+              total[c] += pairCounts[c];
+            }
+          }
+        }
+      }
+    }
+  }
+
+private:
+  LineBatchQueue& m_queue;
+  const vector<CountedModel>& m_counted;
+  vector<CountTable>& m_shards;
+  vector<boost::mutex*>& m_locks;
+};
+#endif
+
 
 int main(int argc, char* argv[])
 {
@@ -29,7 +110,7 @@ int main(int argc, char* argv[])
        << "scores lexical reordering models of several types (hierarchical, phrase-based and word-based-extraction\n";
 
   if (argc < 3) {
-    cerr << "syntax: score_reordering extractFile smoothingValue filepath (--model \"type max-orientation (specification-strings)\" )+\n";
+    cerr << "syntax: score_reordering extractFile smoothingValue filepath (--model \"type max-orientation (specification-strings)\" )+ [--SmoothWithCounts] [--Threads num] [--BinaryTable processLexicalTable]\n";
     exit(1);
   }
 
@@ -37,15 +118,12 @@ int main(int argc, char* argv[])
   double smoothingValue = atof(argv[2]);
   string filepath = argv[3];
 
-  ifstream eFile(extractFileName);
-  if (!eFile) {
-    cerr << "Could not open the extract file " << extractFileName <<"for scoring of lexical reordering models\n";
-    exit(1);
-  }
-
   bool smoothWithCounts = false;
+  int threads = 0;
+  string binarizer;
   map<string,ModelScore*> modelScores;
   vector<Model*> models;
+  vector<string> modelSpecs;
   bool hier = false;
   bool phrase = false;
   bool wbe = false;
@@ -57,34 +135,34 @@ int main(int argc, char* argv[])
   while (i<argc) {
     if (strcmp(argv[i],"--SmoothWithCounts") == 0) {
       smoothWithCounts = true;
-    } else if (strcmp(argv[i],"--model") == 0) {
+    } else if (strcmp(argv[i],"--Threads") == 0) {
       if (i+1 >= argc) {
-        cerr << "score: syntax error, no model information provided to the option" << argv[i] << endl;
+        cerr << "score: syntax error, no number of threads provided to the option" << argv[i] << endl;
         exit(1);
       }
-      istringstream is(argv[++i]);
-      string m,t;
-      is >> m >> t;
-      modelScores[m] = ModelScore::createModelScore(t);
-      if (m.compare("hier") == 0) {
-        hier = true;
-      } else if (m.compare("phrase") == 0) {
-        phrase = true;
+      threads = atoi(argv[++i]);
+      if (threads < 1) {
+        cerr << "score: the number of threads has to be at least 1\n";
+        exit(1);
       }
-      if (m.compare("wbe") == 0) {
-        wbe = true;
+#ifndef WITH_THREADS
+      if (threads > 1) {
+        cerr << "score: compiled without threading support, counting on a single thread\n";
+        threads = 1;
       }
-
-      if (!hier && !phrase && !wbe) {
-        cerr << "WARNING: No models specified for lexical reordering. No lexical reordering table will be trained.\n";
-        return 0;
+#endif
+    } else if (strcmp(argv[i],"--BinaryTable") == 0) {
+      if (i+1 >= argc) {
+        cerr << "score: syntax error, no binarizer provided to the option" << argv[i] << endl;
+        exit(1);
       }
-
-      string config;
-      //Store all models
-      while (is >> config) {
-        models.push_back(Model::createModel(modelScores[m],config,filepath));
+      binarizer = argv[++i];
+    } else if (strcmp(argv[i],"--model") == 0) {
+      if (i+1 >= argc) {
+        cerr << "score: syntax error, no model information provided to the option" << argv[i] << endl;
+        exit(1);
       }
+      modelSpecs.push_back(argv[++i]);
     } else {
       cerr << "illegal option given to lexical reordering model score\n";
       exit(1);
@@ -92,6 +170,105 @@ int main(int argc, char* argv[])
     i++;
   }
 
+  //create the models once the output options are known
+  vector<CountedModel> counted;
+  for (size_t j=0; j<modelSpecs.size(); ++j) {
+    istringstream is(modelSpecs[j]);
+    string m,t;
+    is >> m >> t;
+    modelScores[m] = ModelScore::createModelScore(t);
+    if (m.compare("hier") == 0) {
+      hier = true;
+    } else if (m.compare("phrase") == 0) {
+      phrase = true;
+    }
+    if (m.compare("wbe") == 0) {
+      wbe = true;
+    }
+
+    if (!hier && !phrase && !wbe) {
+      cerr << "WARNING: No models specified for lexical reordering. No lexical reordering table will be trained.\n";
+      return 0;
+    }
+
+    CountedModel model;
+    model.name = m;
+    model.modelScore = modelScores[m];
+    counted.push_back(model);
+
+    string config;
+    //Store all models
+    while (is >> config) {
+      models.push_back(Model::createModel(modelScores[m],config,filepath,binarizer));
+    }
+  }
+
+  ////////////////////////////////////
+  //unsorted extract: aggregate the counts in hash tables, and score
+  //them in sorted order without sorting the extract
+  if (threads > 0) {
+    Moses::InputFileStream extractFile(extractFileName);
+    if (extractFile.fail()) {
+      cerr << "Could not open the extract file " << extractFileName <<"for scoring of lexical reordering models\n";
+      exit(1);
+    }
+    vector<CountTable> shards(threads);
+    const size_t batchSize = 10000;
+#ifdef WITH_THREADS
+    if (threads > 1) {
+      LineBatchQueue queue(threads * 2);
+      vector<boost::mutex*> locks;
+      boost::thread_group workers;
+      for (int t=0; t<threads; ++t) {
+        locks.push_back(new boost::mutex());
+      }
+      for (int t=0; t<threads; ++t) {
+        workers.create_thread(CountWorker(queue, counted, shards, locks));
+      }
+      LineBatch* batch = new LineBatch();
+      string line;
+      while (getline(extractFile, line)) {
+        batch->lines.push_back(line);
+        if (batch->lines.size() == batchSize) {
+          queue.Push(batch);
+          batch = new LineBatch();
+        }
+      }
+      queue.Push(batch);
+      queue.Close();
+      workers.join_all();
+      for (int t=0; t<threads; ++t) {
+        delete locks[t];
+      }
+    } else
+#endif
+    {
+      vector<string> lines;
+      string line;
+      while (getline(extractFile, line)) {
+        lines.push_back(line);
+        if (lines.size() == batchSize) {
+          count_lines(lines, counted, shards[0]);
+          lines.clear();
+        }
+      }
+      count_lines(lines, counted, shards[0]);
+    }
+    extractFile.Close();
+
+    score_counts(shards, threads, smoothWithCounts, smoothingValue, counted, modelScores, models);
+    for (size_t j=0; j<models.size(); ++j) {
+      models[j]->close();
+    }
+    return 0;
+  }
+
+  ifstream eFile(extractFileName);
+  if (!eFile) {
+    cerr << "Could not open the extract file " << extractFileName <<"for scoring of lexical reordering models\n";
+    exit(1);
+  }
+
   ////////////////////////////////////
   //calculate smoothing
   if (smoothWithCounts) {
@@ -116,6 +293,10 @@ int main(int argc, char* argv[])
     for (int i=0; i<models.size(); ++i) {
       models[i]->createSmoothing(smoothingValue);
     }
+    for(map<string,ModelScore*>::const_iterator it = modelScores.begin(); it != modelScores.end(); ++it) {
+      it->second->reset_fe();
+      it->second->reset_f();
+    }
 
     //reopen eFile
     eFile.close();
@@ -184,9 +365,9 @@ int main(int argc, char* argv[])
     models[i]->score_f(f);
   }
 
-  //Zip all files
+  //close all tables
   for (int i=0; i<models.size(); ++i) {
-    models[i]->zipFile();
+    models[i]->close();
   }
 
   return 0;
@@ -219,6 +400,173 @@ void split_line(const string& line, string& foreign, string& english, string& wb
 
 void get_orientations(const string& pair, string& previous, string& next)
 {
-  istringstream is(pair);
-  is >> previous >> next;
+  const char* whitespace = " \t";
+  size_t begin = pair.find_first_not_of(whitespace);
+  size_t end = pair.find_first_of(whitespace, begin);
+  previous = (begin == string::npos) ? "" : pair.substr(begin, end - begin);
+  begin = pair.find_first_not_of(whitespace, end);
+  end = pair.find_first_of(whitespace, begin);
+  next = (begin == string::npos) ? "" : pair.substr(begin, end - begin);
+}
+
+void count_lines(const vector<string>& lines, const vector<CountedModel>& counted, CountTable& counts)
+{
+  string f,e,w,p,h;
+  string prev, next;
+  const size_t width = 2*NUM_ORIENTATIONS;
+  for (size_t i=0; i<lines.size(); ++i) {
+    const string& line = lines[i];
+    split_line(line,f,e,w,p,h);
+    vector<unsigned int>& pairCounts = counts[line.substr(0, f.size() + e.size() + 10)];
+    if (pairCounts.empty()) {
+      pairCounts.resize(counted.size() * width, 0);
+    }
+    for (size_t m=0; m<counted.size(); ++m) {
+      const string& name = counted[m].name;
+      get_orientations(name == "hier" ? h : (name == "phrase" ? p : w), prev, next);
+      pairCounts[m*width + counted[m].modelScore->get_orientation(prev)]++;
+      pairCounts[m*width + NUM_ORIENTATIONS + counted[m].modelScore->get_orientation(next)]++;
+    }
+  }
+}
+
+namespace
+{
+
+typedef vector<const CountTable::value_type*> SortedCounts;
+
+bool key_less(const CountTable::value_type* a, const CountTable::value_type* b)
+{
+  return a->first < b->first;
+}
+
+void sort_shard(const CountTable& shard, SortedCounts& sorted)
+{
+  sorted.reserve(shard.size());
+  for (CountTable::const_iterator it = shard.begin(); it != shard.end(); ++it) {
+    sorted.push_back(&*it);
+  }
+  sort(sorted.begin(), sorted.end(), key_less);
+}
+
+//position in a sorted shard, for the merge of all shards
+struct ShardCursor {
+  const SortedCounts* sorted;
+  size_t pos;
+  const CountTable::value_type& get() const {
+    return *(*sorted)[pos];
+  }
+  //smallest key on top of the priority queue
+  bool operator<(const ShardCursor& other) const {
+    return other.get().first < get().first;
+  }
+};
+
+void add_counts(const vector<unsigned int>& pairCounts, const vector<CountedModel>& counted)
+{
+  const size_t width = 2*NUM_ORIENTATIONS;
+  for (size_t m=0; m<counted.size(); ++m) {
+    counted[m].modelScore->add_counts(&pairCounts[m*width], &pairCounts[m*width + NUM_ORIENTATIONS]);
+  }
+}
+
+#ifdef WITH_THREADS
+struct SortShard {
+  const CountTable* shard;
+  SortedCounts* sorted;
+  void operator()() {
+    sort_shard(*shard, *sorted);
+  }
+};
+#endif
+
+}
+
+void score_counts(vector<CountTable>& shards, int threads, bool smoothWithCounts, double smoothingValue,
+                  const vector<CountedModel>& counted, const map<string,ModelScore*>& modelScores,
+                  const vector<Model*>& models)
+{
+  if (smoothWithCounts) {
+    for (size_t s=0; s<shards.size(); ++s) {
+      for (CountTable::const_iterator it = shards[s].begin(); it != shards[s].end(); ++it) {
+        add_counts(it->second, counted);
+      }
+    }
+    for (size_t i=0; i<models.size(); ++i) {
+      models[i]->createSmoothing(smoothingValue);
+    }
+    for(map<string,ModelScore*>::const_iterator it = modelScores.begin(); it != modelScores.end(); ++it) {
+      it->second->reset_fe();
+      it->second->reset_f();
+    }
+  } else {
+    for (size_t i=0; i<models.size(); ++i) {
+      models[i]->createConstSmoothing(smoothingValue);
+    }
+  }
+
+  //sort the keys of each shard
+  vector<SortedCounts> sorted(shards.size());
+#ifdef WITH_THREADS
+  if (threads > 1) {
+    boost::thread_group sorters;
+    for (size_t s=0; s<shards.size(); ++s) {
+      SortShard sorter = { &shards[s], &sorted[s] };
+      sorters.create_thread(sorter);
+    }
+    sorters.join_all();
+  } else
+#endif
+  {
+    for (size_t s=0; s<shards.size(); ++s) {
+      sort_shard(shards[s], sorted[s]);
+    }
+  }
+
+  //merge the shards, and score each phrase pair and each source phrase
+  priority_queue<ShardCursor> cursors;
+  for (size_t s=0; s<sorted.size(); ++s) {
+    if (!sorted[s].empty()) {
+      ShardCursor cursor = { &sorted[s], 0 };
+      cursors.push(cursor);
+    }
+  }
+  string f_current;
+  bool first = true;
+  while (!cursors.empty()) {
+    ShardCursor cursor = cursors.top();
+    cursors.pop();
+    const string& key = cursor.get().first;
+    size_t fEnd = key.find(" ||| ");
+    string f = key.substr(0, fEnd);
+    string e = key.substr(fEnd + 5, key.size() - fEnd - 10);
+
+    if (!first && f.compare(f_current) != 0) {
+      for (size_t i=0; i<models.size(); ++i) {
+        models[i]->score_f(f_current);
+      }
+      for(map<string,ModelScore*>::const_iterator it = modelScores.begin(); it != modelScores.end(); ++it) {
+        it->second->reset_f();
+      }
+    }
+    first = false;
+    f_current = f;
+
+    add_counts(cursor.get().second, counted);
+    for (size_t i=0; i<models.size(); ++i) {
+      models[i]->score_fe(f,e);
+    }
+    for(map<string,ModelScore*>::const_iterator it = modelScores.begin(); it != modelScores.end(); ++it) {
+      it->second->reset_fe();
+    }
+
+    if (++cursor.pos < cursor.sorted->size()) {
+      cursors.push(cursor);
+    }
+  }
+  if (!first) {
+    for (size_t i=0; i<models.size(); ++i) {
+      models[i]->score_f(f_current);
+    }
+  }
 }
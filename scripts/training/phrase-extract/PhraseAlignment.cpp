@@ -15,9 +15,6 @@
 
 using namespace std;
 
-extern Vocabulary vcbT;
-extern Vocabulary vcbS;
-
 extern bool hierarchicalFlag;
 
 //! convert string to variable of type T. Used to reading floats, int etc from files
@@ -74,10 +71,12 @@ inline void Tokenize( std::vector<T> &output
 }
 
 // read in a phrase pair and store it
-void PhraseAlignment::create( char line[], int lineID )
+void PhraseAlignment::create( const char line[], int lineID
+                              , LayeredVocabulary &vcbS, LayeredVocabulary &vcbT )
 {
   assert(phraseS.empty());
   assert(phraseT.empty());
+  m_vcbT = &vcbT;
 
   //cerr << "processing " << line;
   vector< string > token = tokenize( line );
@@ -188,7 +187,7 @@ bool PhraseAlignment::match( const PhraseAlignment& other )
 
   // loop over all words (note: 0 = left hand side of rule)
   for(int i=0; i<phraseT.size()-1; i++) {
-    if (isNonTerminal( vcbT.getWord( phraseT[i] ) )) {
+    if (isNonTerminal( m_vcbT->getWord( phraseT[i] ) )) {
       if (alignedToT[i].size() != 1 ||
           other.alignedToT[i].size() != 1 ||
           *(alignedToT[i].begin()) != *(other.alignedToT[i].begin()))
@@ -214,7 +213,7 @@ int PhraseAlignment::Compare(const PhraseAlignment &other) const
 
   // loop over all words (note: 0 = left hand side of rule)
   for(int i=0; i<phraseT.size()-1; i++) {
-    if (isNonTerminal( vcbT.getWord( phraseT[i] ) )) {
+    if (isNonTerminal( m_vcbT->getWord( phraseT[i] ) )) {
       size_t thisAlign = *(alignedToT[i].begin());
       size_t otherAlign = *(other.alignedToT[i].begin());
 
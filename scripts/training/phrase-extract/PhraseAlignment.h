@@ -19,6 +19,7 @@ class PhraseAlignment
 protected:
   PHRASE phraseS;
   PHRASE phraseT;
+  LayeredVocabulary *m_vcbT;
 
   std::map<size_t, std::pair<size_t, size_t> > m_ntLengths;
   
@@ -29,7 +30,9 @@ public:
   std::vector< std::set<size_t> > alignedToT;
   std::vector< std::set<size_t> > alignedToS;
 
-  void create( char*, int );
+  PhraseAlignment() : m_vcbT( NULL ), count( 0 ) {}
+
+  void create( const char*, int, LayeredVocabulary &vcbS, LayeredVocabulary &vcbT );
   void clear();
   bool equals( const PhraseAlignment& );
   bool match( const PhraseAlignment& );
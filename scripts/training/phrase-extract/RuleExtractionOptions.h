@@ -46,6 +46,8 @@ public:
   bool duplicateRules;
   bool fractionalCounting;
   bool outputNTLengths;
+  int threads;
+  int shardSize;
 
   RuleExtractionOptions()
     : maxSpan(10)
@@ -74,6 +76,8 @@ public:
     , duplicateRules(true)
     , fractionalCounting(true)
     , outputNTLengths(false)
+    , threads(1)
+    , shardSize(1000000)
   {}
 };
 
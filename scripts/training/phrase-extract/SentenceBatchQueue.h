@@ -0,0 +1,101 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2012 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+#ifndef SENTENCE_BATCH_QUEUE_H_INCLUDED_
+#define SENTENCE_BATCH_QUEUE_H_INCLUDED_
+
+#ifdef WITH_THREADS
+
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace Moses
+{
+
+/** Input lines of consecutive sentences, handed from the thread that reads
+ * the corpus to an extraction worker.
+ */
+struct SentenceBatch {
+  size_t firstLineNum;
+  std::vector<std::string> targetLines;
+  std::vector<std::string> sourceLines;
+  std::vector<std::string> alignmentLines;
+};
+
+/** Queue of batches between the thread that reads the input and the workers.
+ * The reader blocks while the queue is full, so that memory use is bounded.
+ */
+template <class Batch>
+class BatchQueue
+{
+public:
+  explicit BatchQueue(size_t limit) : m_limit(limit), m_closed(false) {}
+
+  void Push(Batch *batch) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_batches.size() >= m_limit) {
+      m_notFull.wait(lock);
+    }
+    m_batches.push(batch);
+    m_notEmpty.notify_one();
+  }
+
+  //! no more batches will be pushed
+  void Close() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_closed = true;
+    m_notEmpty.notify_all();
+  }
+
+  //! NULL once the queue is closed and empty
+  Batch *Pop() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_batches.empty() && !m_closed) {
+      m_notEmpty.wait(lock);
+    }
+    if (m_batches.empty()) {
+      return NULL;
+    }
+    Batch *batch = m_batches.front();
+    m_batches.pop();
+    m_notFull.notify_one();
+    return batch;
+  }
+
+private:
+  std::queue<Batch *> m_batches;
+  size_t m_limit;
+  bool m_closed;
+  boost::mutex m_mutex;
+  boost::condition_variable m_notEmpty;
+  boost::condition_variable m_notFull;
+};
+
+typedef BatchQueue<SentenceBatch> SentenceBatchQueue;
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,115 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2012 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "SortedShards.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "InputFileStream.h"
+
+namespace Moses
+{
+
+bool SortedShardSet::Write(std::vector<std::string> &lines)
+{
+  std::sort(lines.begin(), lines.end());
+
+  std::string fileName;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    std::ostringstream name;
+    name << m_baseName << ".shard" << m_fileNames.size();
+    fileName = name.str();
+    m_fileNames.push_back(fileName);
+  }
+
+  std::ofstream out(fileName.c_str());
+  for (std::vector<std::string>::const_iterator p = lines.begin(); p != lines.end(); ++p) {
+    out << *p << '\n';
+  }
+  out.close();
+  lines.clear();
+  if (!out) {
+    std::cerr << "ERROR: could not write shard " << fileName << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void SortedShardWriter::AddLines(const std::string &text)
+{
+  std::string::size_type begin = 0;
+  while (begin < text.size()) {
+    std::string::size_type end = text.find('\n', begin);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    Add(text.substr(begin, end - begin));
+    begin = end + 1;
+  }
+}
+
+SortedShardReader::SortedShardReader(const std::vector<std::string> &fileNames)
+  : m_fail(false)
+{
+  for (size_t i = 0; i < fileNames.size(); ++i) {
+    InputFileStream *file = new InputFileStream(fileNames[i]);
+    m_files.push_back(file);
+    if (file->fail()) {
+      std::cerr << "ERROR: could not open extract file " << fileNames[i] << std::endl;
+      m_fail = true;
+      continue;
+    }
+    ReadNext(i);
+  }
+}
+
+SortedShardReader::~SortedShardReader()
+{
+  for (size_t i = 0; i < m_files.size(); ++i) {
+    delete m_files[i];
+  }
+}
+
+void SortedShardReader::ReadNext(size_t file)
+{
+  std::string line;
+  if (std::getline(*m_files[file], line)) {
+    m_next.push(Entry(line, file));
+  }
+}
+
+bool SortedShardReader::GetLine(std::string &line)
+{
+  if (m_next.empty()) {
+    return false;
+  }
+  const size_t file = m_next.top().second;
+  line = m_next.top().first;
+  m_next.pop();
+  ReadNext(file);
+  return true;
+}
+
+}
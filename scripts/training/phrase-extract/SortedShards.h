@@ -0,0 +1,128 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2012 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+#ifndef SORTED_SHARDS_H_INCLUDED_
+#define SORTED_SHARDS_H_INCLUDED_
+
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+class InputFileStream;
+
+/** A set of extract files that are each sorted in byte order (as by
+ * LC_ALL=C sort), named <base>.shard<n>.  Shards may be written by several
+ * threads at once.
+ */
+class SortedShardSet
+{
+public:
+  explicit SortedShardSet(const std::string &baseName) : m_baseName(baseName) {}
+
+  //! sort lines and write them to a new shard, lines is cleared
+  bool Write(std::vector<std::string> &lines);
+
+  const std::vector<std::string> &GetFileNames() const {
+    return m_fileNames;
+  }
+
+private:
+  std::string m_baseName;
+  std::vector<std::string> m_fileNames;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+};
+
+/** Buffers the lines of one thread and writes them to a SortedShardSet when
+ * the buffer is full, so that each shard holds at most maxLines lines.
+ */
+class SortedShardWriter
+{
+public:
+  SortedShardWriter(SortedShardSet &shards, size_t maxLines)
+    : m_shards(shards), m_maxLines(maxLines), m_ok(true) {}
+
+  void Add(const std::string &line) {
+    m_lines.push_back(line);
+    if (m_lines.size() >= m_maxLines) {
+      Flush();
+    }
+  }
+
+  //! add every line of text
+  void AddLines(const std::string &text);
+
+  void Flush() {
+    if (!m_lines.empty()) {
+      m_ok = m_shards.Write(m_lines) && m_ok;
+    }
+  }
+
+  bool Good() const {
+    return m_ok;
+  }
+
+private:
+  SortedShardSet &m_shards;
+  size_t m_maxLines;
+  std::vector<std::string> m_lines;
+  bool m_ok;
+};
+
+/** Reads the lines of several sorted extract files in byte order, merging
+ * them on the fly, so that they need not be concatenated and sorted again.
+ */
+class SortedShardReader
+{
+public:
+  explicit SortedShardReader(const std::vector<std::string> &fileNames);
+  ~SortedShardReader();
+
+  //! true if one of the files could not be opened
+  bool Fail() const {
+    return m_fail;
+  }
+
+  //! next line of all files, false after the last one
+  bool GetLine(std::string &line);
+
+private:
+  typedef std::pair<std::string, size_t> Entry;
+
+  void ReadNext(size_t file);
+
+  std::vector<InputFileStream*> m_files;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > m_next;
+  bool m_fail;
+};
+
+}
+
+#endif
@@ -28,6 +28,7 @@
 #include "tables-core.h"
 #include "SafeGetline.h"
 #include "InputFileStream.h"
+#include "SortedShards.h"
 
 #define LINE_MAX_LENGTH 10000
 
@@ -46,8 +47,9 @@ inline float maybeLogProb( float a ) { return logProbFlag ? log(a) : a; }
 char line[LINE_MAX_LENGTH];
 void processFiles( char*, char*, char*, char* );
 void loadCountOfCounts( char* );
-bool getLine( istream &fileP, vector< string > &item );
-vector< string > splitLine();
+vector< string > splitFileNames( const char* );
+bool getLine( Moses::SortedShardReader &file, vector< string > &item );
+void splitLine( const string &, vector< string > &item );
 
 int main(int argc, char* argv[])
 {
@@ -55,7 +57,9 @@ int main(int argc, char* argv[])
        << "consolidating direct and indirect rule tables\n";
 
   if (argc < 4) {
-    cerr << "syntax: consolidate phrase-table.direct phrase-table.indirect phrase-table.consolidated [--Hierarchical] [--OnlyDirect] [--OutputNTLengths] \n";
+    cerr << "syntax: consolidate phrase-table.direct phrase-table.indirect[,shard...] phrase-table.consolidated [--Hierarchical] [--OnlyDirect] [--OutputNTLengths] \n"
+         << "the indirect table may be given as the sorted shards written by score --SortedShards,\n"
+         << "and the consolidated table may be '-' to pipe it into processPhraseTable\n";
     exit(1);
   }
   char* &fileNameDirect = argv[1];
@@ -158,29 +162,31 @@ void processFiles( char* fileNameDirect, char* fileNameIndirect, char* fileNameC
   if (goodTuringFlag || kneserNeyFlag)
     loadCountOfCounts( fileNameCountOfCounts );
 
-  // open input files
-  Moses::InputFileStream fileDirect(fileNameDirect);
-  Moses::InputFileStream fileIndirect(fileNameIndirect);
+  // open input files, the indirect table may be split into sorted shards
+  Moses::SortedShardReader fileDirect(splitFileNames(fileNameDirect));
+  Moses::SortedShardReader fileIndirect(splitFileNames(fileNameIndirect));
 
-  if (fileDirect.fail()) {
+  if (fileDirect.Fail()) {
     cerr << "ERROR: could not open phrase table file " << fileNameDirect << endl;
     exit(1);
   }
-  istream &fileDirectP = fileDirect;
 
-  if (fileIndirect.fail()) {
+  if (fileIndirect.Fail()) {
     cerr << "ERROR: could not open phrase table file " << fileNameIndirect << endl;
     exit(1);
   }
-  istream &fileIndirectP = fileIndirect;
 
   // open output file: consolidated phrase table
-  ofstream fileConsolidated;
-  fileConsolidated.open(fileNameConsolidated);
-  if (fileConsolidated.fail()) {
-    cerr << "ERROR: could not open output file " << fileNameConsolidated << endl;
-    exit(1);
+  ofstream fileConsolidatedFile;
+  bool toStdout = (strcmp(fileNameConsolidated, "-") == 0);
+  if (!toStdout) {
+    fileConsolidatedFile.open(fileNameConsolidated);
+    if (fileConsolidatedFile.fail()) {
+      cerr << "ERROR: could not open output file " << fileNameConsolidated << endl;
+      exit(1);
+    }
   }
+  ostream &fileConsolidated = toStdout ? cout : fileConsolidatedFile;
 
   // loop through all extracted phrase translations
   int i=0;
@@ -189,8 +195,8 @@ void processFiles( char* fileNameDirect, char* fileNameIndirect, char* fileNameC
     if (i%100000 == 0) cerr << "." << flush;
 
     vector< string > itemDirect, itemIndirect;
-    if (! getLine(fileIndirectP,itemIndirect) ||
-        ! getLine(fileDirectP,  itemDirect  ))
+    if (! getLine(fileIndirect,itemIndirect) ||
+        ! getLine(fileDirect,  itemDirect  ))
       break;
 
     // direct: target source alignment probabilities
@@ -279,47 +285,47 @@ void processFiles( char* fileNameDirect, char* fileNameIndirect, char* fileNameC
       fileConsolidated << " ||| " << itemDirect[5];
     }
     
-    fileConsolidated << endl;
+    fileConsolidated << "\n";
   }
-  fileDirect.Close();
-  fileIndirect.Close();
-  fileConsolidated.close();
+  fileConsolidated.flush();
+  if (!toStdout)
+    fileConsolidatedFile.close();
 }
 
-
-bool getLine( istream &fileP, vector< string > &item )
+vector< string > splitFileNames( const char* fileNames )
 {
-  if (fileP.eof())
-    return false;
+  vector< string > fileName;
+  string list( fileNames );
+  for(size_t start = 0, comma = 0; comma != string::npos; start = comma+1) {
+    comma = list.find( ',', start );
+    fileName.push_back( list.substr( start, comma == string::npos ? string::npos : comma-start ) );
+  }
+  return fileName;
+}
+
 
-  SAFE_GETLINE((fileP), line, LINE_MAX_LENGTH, '\n', __FILE__);
-  if (fileP.eof())
+bool getLine( Moses::SortedShardReader &file, vector< string > &item )
+{
+  string fileLine;
+  if (! file.GetLine( fileLine ))
     return false;
 
-  item = splitLine();
+  splitLine( fileLine, item );
 
   return true;
 }
 
-vector< string > splitLine()
+void splitLine( const string &fileLine, vector< string > &item )
 {
-  vector< string > item;
-  bool betweenWords = true;
-  int start=0;
-  int i=0;
-  for(; line[i] != '\0'; i++) {
-    if (line[i] == ' ' &&
-        line[i+1] == '|' &&
-        line[i+2] == '|' &&
-        line[i+3] == '|' &&
-        line[i+4] == ' ') {
-      if (start > i) start = i; // empty item
-      item.push_back( string( line+start, i-start ) );
-      start = i+5;
-      i += 3;
-    }
+  item.clear();
+  size_t start = 0;
+  size_t end = 0;
+  // the blank after a separator may begin the next one
+  while ((end = fileLine.find( " ||| ", end )) != string::npos) {
+    if (start > end) start = end; // empty item
+    item.push_back( fileLine.substr( start, end-start ) );
+    start = end+5;
+    end += 4;
   }
-  item.push_back( string( line+start, i-start ) );
-
-  return item;
+  item.push_back( fileLine.substr( start ) );
 }
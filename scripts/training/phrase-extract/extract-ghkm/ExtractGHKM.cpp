@@ -27,16 +27,23 @@
 #include "ParseTree.h"
 #include "ScfgRule.h"
 #include "ScfgRuleWriter.h"
+#include "SentenceBatchQueue.h"
+#include "SortedShards.h"
 #include "Span.h"
 #include "XmlTreeParser.h"
 
 #include <boost/program_options.hpp>
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
 
 #include <cassert>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <queue>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -64,8 +71,10 @@ int ExtractGHKM::Main(int argc, char *argv[])
   std::ofstream glueGrammarStream;
   std::ofstream unknownWordStream;
   std::string invExtractFileName = options.extractFile + std::string(".inv");
-  OpenOutputFileOrDie(options.extractFile, extractStream);
-  OpenOutputFileOrDie(invExtractFileName, invExtractStream);
+  if (options.threads <= 1) {
+    OpenOutputFileOrDie(options.extractFile, extractStream);
+    OpenOutputFileOrDie(invExtractFileName, invExtractStream);
+  }
   if (!options.glueGrammarFile.empty()) {
     OpenOutputFileOrDie(options.glueGrammarFile, glueGrammarStream);
   }
@@ -73,116 +82,279 @@ int ExtractGHKM::Main(int argc, char *argv[])
     OpenOutputFileOrDie(options.unknownWordFile, unknownWordStream);
   }
 
-  // Target label sets for producing glue grammar.
-  std::set<std::string> labelSet;
-  std::set<std::string> topLabelSet;
+  // Target label sets for producing glue grammar and word count statistics
+  // for producing unknown word labels.
+  LabelStats stats;
+
+  if (options.threads > 1) {
+    ExtractInParallel(targetStream, sourceStream, alignmentStream, options,
+                      stats);
+  } else {
+    std::string targetLine;
+    std::string sourceLine;
+    std::string alignmentLine;
+    ScfgRuleWriter writer(extractStream, invExtractStream, options);
+    size_t lineNum = 0;
+    while (ReadLines(targetStream, sourceStream, alignmentStream,
+                     targetLine, sourceLine, alignmentLine)) {
+      ++lineNum;
+      ProcessSentence(targetLine, sourceLine, alignmentLine, lineNum, options,
+                      writer, stats);
+    }
+  }
 
-  // Word count statistics for producing unknown word labels.
-  std::map<std::string, int> wordCount;
-  std::map<std::string, std::string> wordLabel;
+  if (!options.glueGrammarFile.empty()) {
+    WriteGlueGrammar(stats.labelSet, stats.topLabelSet, glueGrammarStream);
+  }
 
-  std::string targetLine;
-  std::string sourceLine;
-  std::string alignmentLine;
-  ScfgRuleWriter writer(extractStream, invExtractStream, options);
-  size_t lineNum = 0;
-  while (true) {
-    std::getline(targetStream, targetLine);
-    std::getline(sourceStream, sourceLine);
-    std::getline(alignmentStream, alignmentLine);
+  if (!options.unknownWordFile.empty()) {
+    WriteUnknownWordLabel(stats.wordCount, stats.wordLabel, unknownWordStream);
+  }
 
-    if (targetStream.eof() && sourceStream.eof() && alignmentStream.eof()) {
-      break;
-    }
+  return 0;
+}
 
-    if (targetStream.eof() || sourceStream.eof() || alignmentStream.eof()) {
-      Error("Files must contain same number of lines");
-    }
+bool ExtractGHKM::ReadLines(std::istream &targetStream,
+                            std::istream &sourceStream,
+                            std::istream &alignmentStream,
+                            std::string &targetLine,
+                            std::string &sourceLine,
+                            std::string &alignmentLine)
+{
+  std::getline(targetStream, targetLine);
+  std::getline(sourceStream, sourceLine);
+  std::getline(alignmentStream, alignmentLine);
 
-    ++lineNum;
+  if (targetStream.eof() && sourceStream.eof() && alignmentStream.eof()) {
+    return false;
+  }
 
-    // Parse target tree.
-    std::auto_ptr<ParseTree> t(ParseXmlTree(targetLine));
-    if (!t.get()) {
-      std::ostringstream s;
-      s << "Failed to parse XML tree at line " << lineNum;
-      Error(s.str());
-    }
+  if (targetStream.eof() || sourceStream.eof() || alignmentStream.eof()) {
+    Error("Files must contain same number of lines");
+  }
+  return true;
+}
 
-    // Read source tokens.
-    std::vector<std::string> sourceTokens(ReadTokens(sourceLine));
-
-    // Read word alignments.
-    Alignment alignment;
-    try {
-      alignment = ReadAlignment(alignmentLine);
-    } catch (const Exception &e) {
-      std::ostringstream s;
-      s << "Failed to read alignment at line " << lineNum << ": ";
-      s << e.GetMsg();
-      Error(s.str());
-    }
+void ExtractGHKM::ProcessSentence(const std::string &targetLine,
+                                  const std::string &sourceLine,
+                                  const std::string &alignmentLine,
+                                  size_t lineNum,
+                                  const Options &options,
+                                  ScfgRuleWriter &writer,
+                                  LabelStats &stats)
+{
+  // Parse target tree.
+  std::auto_ptr<ParseTree> t(ParseXmlTree(targetLine));
+  if (!t.get()) {
+    std::ostringstream s;
+    s << "Failed to parse XML tree at line " << lineNum;
+    Error(s.str());
+  }
+
+  // Read source tokens.
+  std::vector<std::string> sourceTokens(ReadTokens(sourceLine));
 
-    // Record tree labels for use in glue grammar.
-    if (!options.glueGrammarFile.empty()) {
-      // Record labels that cover the full sentence to topLabelSet.
-      ParseTree *p = t.get();
-      topLabelSet.insert(p->GetLabel());
-      while (p->GetChildren().size() == 1) {
-        p = p->GetChildren()[0];
-        if (p->IsLeaf()) {
-          break;
-        }
-        topLabelSet.insert(p->GetLabel());
+  // Read word alignments.
+  Alignment alignment;
+  try {
+    alignment = ReadAlignment(alignmentLine);
+  } catch (const Exception &e) {
+    std::ostringstream s;
+    s << "Failed to read alignment at line " << lineNum << ": ";
+    s << e.GetMsg();
+    Error(s.str());
+  }
+
+  // Record tree labels for use in glue grammar.
+  if (!options.glueGrammarFile.empty()) {
+    // Record labels that cover the full sentence to topLabelSet.
+    ParseTree *p = t.get();
+    stats.topLabelSet.insert(p->GetLabel());
+    while (p->GetChildren().size() == 1) {
+      p = p->GetChildren()[0];
+      if (p->IsLeaf()) {
+        break;
       }
-      // Record all labels to labelSet.
-      RecordTreeLabels(*t, labelSet);
+      stats.topLabelSet.insert(p->GetLabel());
     }
+    // Record all labels to labelSet.
+    RecordTreeLabels(*t, stats.labelSet);
+  }
 
-    // Record word counts.
-    if (!options.unknownWordFile.empty()) {
-      CollectWordLabelCounts(*t, wordCount, wordLabel);
-    }
+  // Record word counts.
+  if (!options.unknownWordFile.empty()) {
+    CollectWordLabelCounts(*t, stats.wordCount, stats.wordLabel);
+  }
 
-    // Form an alignment graph from the target tree, source words, and
-    // alignment.
-    AlignmentGraph graph(t.get(), sourceTokens, alignment);
+  // Form an alignment graph from the target tree, source words, and
+  // alignment.
+  AlignmentGraph graph(t.get(), sourceTokens, alignment);
 
-    // Extract minimal rules, adding each rule to its root node's rule set.
-    graph.ExtractMinimalRules(options);
+  // Extract minimal rules, adding each rule to its root node's rule set.
+  graph.ExtractMinimalRules(options);
 
-    // Extract composed rules.
-    if (!options.minimal) {
-      graph.ExtractComposedRules(options);
+  // Extract composed rules.
+  if (!options.minimal) {
+    graph.ExtractComposedRules(options);
+  }
+
+  // Write the rules, subject to scope pruning.
+  const std::vector<Node *> &targetNodes = graph.GetTargetNodes();
+  for (std::vector<Node *>::const_iterator p = targetNodes.begin();
+       p != targetNodes.end(); ++p) {
+    const std::vector<const Subgraph *> &rules = (*p)->GetRules();
+    for (std::vector<const Subgraph *>::const_iterator q = rules.begin();
+         q != rules.end(); ++q) {
+      ScfgRule r(**q);
+      // TODO Can scope pruning be done earlier?
+      if (r.Scope() <= options.maxScope) {
+        writer.Write(r);
+      }
     }
+  }
+}
+
+void ExtractGHKM::LabelStats::Merge(const LabelStats &other)
+{
+  labelSet.insert(other.labelSet.begin(), other.labelSet.end());
+  topLabelSet.insert(other.topLabelSet.begin(), other.topLabelSet.end());
+  for (std::map<std::string, int>::const_iterator p = other.wordCount.begin();
+       p != other.wordCount.end(); ++p) {
+    wordCount[p->first] += p->second;
+  }
+  // Only the labels of singletons are used, so it does not matter which
+  // occurrence a label comes from.
+  for (std::map<std::string, std::string>::const_iterator p =
+         other.wordLabel.begin(); p != other.wordLabel.end(); ++p) {
+    wordLabel[p->first] = p->second;
+  }
+}
 
-    // Write the rules, subject to scope pruning.
-    const std::vector<Node *> &targetNodes = graph.GetTargetNodes();
-    for (std::vector<Node *>::const_iterator p = targetNodes.begin();
-         p != targetNodes.end(); ++p) {
-      const std::vector<const Subgraph *> &rules = (*p)->GetRules();
-      for (std::vector<const Subgraph *>::const_iterator q = rules.begin();
-           q != rules.end(); ++q) {
-        ScfgRule r(**q);
-        // TODO Can scope pruning be done earlier?
-        if (r.Scope() <= options.maxScope) {
-          writer.Write(r);
-        }
+#ifdef WITH_THREADS
+
+namespace {
+
+const size_t kSentenceBatchSize = 1000;
+
+}  // namespace
+
+// Extracts the rules of the batches in the queue into sorted shards.
+class ExtractGHKM::Worker
+{
+ public:
+  Worker(ExtractGHKM &extractor, SentenceBatchQueue &queue,
+         const Options &options, SortedShardSet &fwdShards,
+         SortedShardSet &invShards)
+      : m_extractor(extractor)
+      , m_queue(queue)
+      , m_options(options)
+      , m_fwdWriter(fwdShards, options.shardSize)
+      , m_invWriter(invShards, options.shardSize) {}
+
+  void Run() {
+    while (SentenceBatch *batch = m_queue.Pop()) {
+      for (size_t i = 0; i < batch->targetLines.size(); ++i) {
+        std::ostringstream fwd;
+        std::ostringstream inv;
+        ScfgRuleWriter writer(fwd, inv, m_options);
+        m_extractor.ProcessSentence(batch->targetLines[i],
+                                    batch->sourceLines[i],
+                                    batch->alignmentLines[i],
+                                    batch->firstLineNum + i, m_options,
+                                    writer, m_stats);
+        m_fwdWriter.AddLines(fwd.str());
+        m_invWriter.AddLines(inv.str());
       }
+      delete batch;
     }
+    m_fwdWriter.Flush();
+    m_invWriter.Flush();
   }
 
-  if (!options.glueGrammarFile.empty()) {
-    WriteGlueGrammar(labelSet, topLabelSet, glueGrammarStream);
+  bool Good() const { return m_fwdWriter.Good() && m_invWriter.Good(); }
+  const LabelStats &GetStats() const { return m_stats; }
+
+ private:
+  ExtractGHKM &m_extractor;
+  SentenceBatchQueue &m_queue;
+  const Options &m_options;
+  SortedShardWriter m_fwdWriter;
+  SortedShardWriter m_invWriter;
+  LabelStats m_stats;
+};
+
+void ExtractGHKM::ExtractInParallel(std::istream &targetStream,
+                                    std::istream &sourceStream,
+                                    std::istream &alignmentStream,
+                                    const Options &options,
+                                    LabelStats &stats)
+{
+  SortedShardSet fwdShards(options.extractFile);
+  SortedShardSet invShards(options.extractFile + std::string(".inv"));
+  SentenceBatchQueue queue(2 * options.threads);
+
+  std::vector<Worker *> workers;
+  boost::thread_group threads;
+  for (int i = 0; i < options.threads; ++i) {
+    workers.push_back(new Worker(*this, queue, options, fwdShards, invShards));
+    threads.create_thread(boost::bind(&Worker::Run, workers.back()));
   }
 
-  if (!options.unknownWordFile.empty()) {
-    WriteUnknownWordLabel(wordCount, wordLabel, unknownWordStream);
+  // Read the input on this thread, in batches of consecutive sentences.
+  size_t lineNum = 0;
+  SentenceBatch *batch = NULL;
+  std::string targetLine;
+  std::string sourceLine;
+  std::string alignmentLine;
+  while (ReadLines(targetStream, sourceStream, alignmentStream,
+                   targetLine, sourceLine, alignmentLine)) {
+    ++lineNum;
+    if (!batch) {
+      batch = new SentenceBatch();
+      batch->firstLineNum = lineNum;
+    }
+    batch->targetLines.push_back(targetLine);
+    batch->sourceLines.push_back(sourceLine);
+    batch->alignmentLines.push_back(alignmentLine);
+    if (batch->targetLines.size() == kSentenceBatchSize) {
+      queue.Push(batch);
+      batch = NULL;
+    }
+  }
+  if (batch) {
+    queue.Push(batch);
+  }
+  queue.Close();
+  threads.join_all();
+
+  bool good = true;
+  for (std::vector<Worker *>::const_iterator p = workers.begin();
+       p != workers.end(); ++p) {
+    good = good && (*p)->Good();
+    stats.Merge((*p)->GetStats());
+    delete *p;
+  }
+  if (!good) {
+    Error("failed to write extract shards");
   }
 
-  return 0;
+  std::cerr << GetName() << ": wrote " << fwdShards.GetFileNames().size()
+            << " sorted shards of " << options.extractFile << " and "
+            << invShards.GetFileNames().size() << " of " << options.extractFile
+            << ".inv" << std::endl;
+}
+
+#else
+
+void ExtractGHKM::ExtractInParallel(std::istream &, std::istream &,
+                                    std::istream &, const Options &,
+                                    LabelStats &)
+{
+  Error("multithreading is not supported by this build");
 }
 
+#endif  // WITH_THREADS
+
 void ExtractGHKM::OpenInputFileOrDie(const std::string &filename,
                                      std::ifstream &stream)
 {
@@ -233,6 +405,8 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
               << "\n"
               << "Unless the --AllowUnary option is given, unary rules containing no lexical\nsource items are eliminated using the method described in Chung et al. (2011).\nThe parsing algorithm used in Moses is unable to handle such rules.\n"
               << "\n"
+              << "With --Threads greater than 1, sentences are read in batches and processed\nby the given number of threads.  Instead of EXTRACT and EXTRACT.inv, each thread\nwrites files EXTRACT.shard<n> and EXTRACT.inv.shard<n> of at most --ShardSize\nrules, sorted as by 'LC_ALL=C sort'.  score accepts the shards of a file as a\ncomma-separated list and merges them, so no further sorting is required.\n"
+              << "\n"
               << "References:\n"
               << "Galley, M., Hopkins, M., Knight, K., and Marcu, D. (2004)\n"
               << "\"What's in a Translation Rule?\", In Proceedings of HLT/NAACL 2004.\n"
@@ -269,6 +443,12 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
         "set maximum allowed scope")
     ("Minimal",
         "extract minimal rules only")
+    ("ShardSize",
+        po::value(&options.shardSize)->default_value(options.shardSize),
+        "set maximum number of rules per sorted shard when using threads")
+    ("Threads",
+        po::value(&options.threads)->default_value(options.threads),
+        "extract with the given number of threads, see below")
     ("UnknownWordLabel",
         po::value(&options.unknownWordFile),
         "write unknown word labels to named file")
@@ -345,6 +525,9 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
   if (vm.count("UnpairedExtractFormat")) {
     options.unpairedExtractFormat = true;
   }
+  if (options.threads < 1 || options.shardSize < 1) {
+    Error("--Threads and --ShardSize must be positive");
+  }
 }
 
 void ExtractGHKM::Error(const std::string &msg) const
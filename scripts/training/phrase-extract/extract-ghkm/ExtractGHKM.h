@@ -21,6 +21,7 @@
 #ifndef EXTRACT_GHKM_EXTRACT_GHKM_H_
 #define EXTRACT_GHKM_EXTRACT_GHKM_H_
 
+#include <istream>
 #include <map>
 #include <ostream>
 #include <set>
@@ -32,6 +33,7 @@ namespace GHKM {
 
 class Options;
 class ParseTree;
+class ScfgRuleWriter;
 
 class ExtractGHKM
 {
@@ -40,6 +42,17 @@ class ExtractGHKM
   const std::string &GetName() const { return m_name; }
   int Main(int argc, char *argv[]);
  private:
+  // Tree labels and word counts, for the glue grammar and unknown word labels.
+  struct LabelStats {
+    std::set<std::string> labelSet;
+    std::set<std::string> topLabelSet;
+    std::map<std::string, int> wordCount;
+    std::map<std::string, std::string> wordLabel;
+    void Merge(const LabelStats &);
+  };
+
+  class Worker;
+
   void Error(const std::string &) const;
   void OpenInputFileOrDie(const std::string &, std::ifstream &);
   void OpenOutputFileOrDie(const std::string &, std::ofstream &);
@@ -55,6 +68,13 @@ class ExtractGHKM
                         const std::set<std::string> &,
                         std::ostream &);
   std::vector<std::string> ReadTokens(const std::string &);
+  bool ReadLines(std::istream &, std::istream &, std::istream &,
+                 std::string &, std::string &, std::string &);
+  void ProcessSentence(const std::string &, const std::string &,
+                       const std::string &, size_t, const Options &,
+                       ScfgRuleWriter &, LabelStats &);
+  void ExtractInParallel(std::istream &, std::istream &, std::istream &,
+                         const Options &, LabelStats &);
   
   void ProcessOptions(int, char *[], Options &) const;
 
@@ -35,6 +35,8 @@ struct Options {
       , maxRuleSize(3)
       , maxScope(3)
       , minimal(false)
+      , shardSize(1000000)
+      , threads(1)
       , unpairedExtractFormat(false) {}
 
   // Positional options
@@ -51,6 +53,8 @@ struct Options {
   int maxRuleSize;
   int maxScope;
   bool minimal;
+  int shardSize;
+  int threads;
   bool unpairedExtractFormat;
   std::string unknownWordFile;
 };
@@ -22,6 +22,7 @@
 #include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <list>
 #include <map>
@@ -46,6 +47,13 @@
 #include "XmlTree.h"
 #include "InputFileStream.h"
 
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include "SentenceBatchQueue.h"
+#include "SortedShards.h"
+#endif
+
 #define LINE_MAX_LENGTH 500000
 
 using namespace std;
@@ -53,20 +61,38 @@ using namespace std;
 typedef vector< int > LabelIndex;
 typedef map< int, int > WordIndex;
 
-vector< ExtractedRule > extractedRules;
+// extracts the rules of one sentence pair
+class ExtractTask
+{
+public:
+  void extractRules(SentenceAlignmentWithSyntax & );
+  void consolidateRules();
+  void writeRulesToFile(ostream &extractFile, ostream &extractFileInv) const;
+
+  const vector< ExtractedRule > &GetRules() const {
+    return m_extractedRules;
+  }
+
+private:
+  vector< ExtractedRule > m_extractedRules;
+
+  void addRuleToCollection(ExtractedRule &rule);
+  void addRule( SentenceAlignmentWithSyntax &, int, int, int, int
+                , RuleExist &ruleExist);
+  void addHieroRule( SentenceAlignmentWithSyntax &sentence, int startT, int endT, int startS, int endS
+                     , RuleExist &ruleExist, const HoleCollection &holeColl, int numHoles, int initStartF, int wordCountT, int wordCountS);
+  void printHieroPhrase( SentenceAlignmentWithSyntax &sentence, int startT, int endT, int startS, int endS
+                         , HoleCollection &holeColl, LabelIndex &labelIndex);
+  void printAllHieroPhrases( SentenceAlignmentWithSyntax &sentence
+                             , int startT, int endT, int startS, int endS
+                             , HoleCollection &holeColl);
+};
 
-void extractRules(SentenceAlignmentWithSyntax & );
-void addRuleToCollection(ExtractedRule &rule);
-void consolidateRules();
-void writeRulesToFile();
 void writeGlueGrammar(const string &);
-void collectWordLabelCounts(SentenceAlignmentWithSyntax &sentence );
+void collectWordLabelCounts(SentenceAlignmentWithSyntax &sentence
+                            , map<string,int> &wordCount, map<string,string> &wordLabel);
 void writeUnknownWordLabel(const string &);
-
-void addRule( SentenceAlignmentWithSyntax &, int, int, int, int
-              , RuleExist &ruleExist);
-void addHieroRule( SentenceAlignmentWithSyntax &sentence, int startT, int endT, int startS, int endS
-                   , RuleExist &ruleExist, const HoleCollection &holeColl, int numHoles, int initStartF, int wordCountT, int wordCountS);
+void extractInParallel(istream &, istream &, istream &, const string &);
 
 inline string IntToString( int i )
 {
@@ -79,6 +105,8 @@ ofstream extractFile;
 ofstream extractFileInv;
 set< string > targetLabelCollection, sourceLabelCollection;
 map< string, int > targetTopLabelCollection, sourceTopLabelCollection;
+map< string, int > wordCount;
+map< string, string > wordLabel;
 
 RuleExtractionOptions options;
 
@@ -102,7 +130,12 @@ int main(int argc, char* argv[])
          << " | --MaxNonTerm[" << options.maxNonTerm << "]"
          << " | --MaxScope[" << options.maxScope << "]"
          << " | --SourceSyntax | --TargetSyntax"
-         << " | --AllowOnlyUnalignedWords | --DisallowNonTermConsecTarget |--NonTermConsecSource |  --NoNonTermFirstWord | --NoFractionalCounting ]\n";
+         << " | --AllowOnlyUnalignedWords | --DisallowNonTermConsecTarget |--NonTermConsecSource |  --NoNonTermFirstWord | --NoFractionalCounting"
+         << " | --Threads[" << options.threads << "]"
+         << " | --ShardSize[" << options.shardSize << "] ]\n"
+         << "with --Threads N greater than 1, the rules are written to the sorted files\n"
+         << "extract.shard<n> and extract.inv.shard<n> of at most --ShardSize distinct rules,\n"
+         << "with the counts of identical rules summed; score accepts them as a comma-separated list\n";
     exit(1);
   }
   char* &fileNameT = argv[1];
@@ -218,12 +251,35 @@ int main(int argc, char* argv[])
       options.fractionalCounting = false;
     } else if (strcmp(argv[i],"--OutputNTLengths") == 0) {
       options.outputNTLengths = true;
+    } else if (strcmp(argv[i],"--Threads") == 0) {
+      options.threads = atoi(argv[++i]);
+      if (options.threads < 1) {
+        cerr << "extract error: --Threads should be at least 1" << endl;
+        exit(1);
+      }
+#ifndef WITH_THREADS
+      if (options.threads > 1) {
+        cerr << "extract error: this build of extract-rules does not support --Threads" << endl;
+        exit(1);
+      }
+#endif
+    } else if (strcmp(argv[i],"--ShardSize") == 0) {
+      options.shardSize = atoi(argv[++i]);
+      if (options.shardSize < 1) {
+        cerr << "extract error: --ShardSize should be at least 1" << endl;
+        exit(1);
+      }
     } else {
       cerr << "extract: syntax error, unknown option '" << string(argv[i]) << "'\n";
       exit(1);
     }
   }
 
+  if (options.threads > 1 && options.onlyOutputSpanInfo) {
+    cerr << "extract error: --OnlyOutputSpanInfo cannot be used with --Threads" << endl;
+    exit(1);
+  }
+
   cerr << "extracting hierarchical rules" << endl;
 
   // open input files
@@ -235,56 +291,60 @@ int main(int argc, char* argv[])
   istream *sFileP = &sFile;
   istream *aFileP = &aFile;
 
-  // open output files
-  string fileNameExtractInv = fileNameExtract + ".inv";
-  extractFile.open(fileNameExtract.c_str());
-  if (!options.onlyDirectFlag)
-    extractFileInv.open(fileNameExtractInv.c_str());
+  if (options.threads > 1) {
+    extractInParallel(*tFileP, *sFileP, *aFileP, fileNameExtract);
+  } else {
+    // open output files
+    string fileNameExtractInv = fileNameExtract + ".inv";
+    extractFile.open(fileNameExtract.c_str());
+    if (!options.onlyDirectFlag)
+      extractFileInv.open(fileNameExtractInv.c_str());
+
+    // loop through all sentence pairs
+    int i=0;
+    while(true) {
+      i++;
+      if (i%1000 == 0) cerr << "." << flush;
+      if (i%10000 == 0) cerr << ":" << flush;
+      if (i%100000 == 0) cerr << "!" << flush;
+      char targetString[LINE_MAX_LENGTH];
+      char sourceString[LINE_MAX_LENGTH];
+      char alignmentString[LINE_MAX_LENGTH];
+      SAFE_GETLINE((*tFileP), targetString, LINE_MAX_LENGTH, '\n', __FILE__);
+      if (tFileP->eof()) break;
+      SAFE_GETLINE((*sFileP), sourceString, LINE_MAX_LENGTH, '\n', __FILE__);
+      SAFE_GETLINE((*aFileP), alignmentString, LINE_MAX_LENGTH, '\n', __FILE__);
+      SentenceAlignmentWithSyntax sentence(targetLabelCollection,
+                                           sourceLabelCollection,
+                                           targetTopLabelCollection,
+                                           sourceTopLabelCollection,
+                                           options);
+      //az: output src, tgt, and alingment line
+      if (options.onlyOutputSpanInfo) {
+        cout << "LOG: SRC: " << sourceString << endl;
+        cout << "LOG: TGT: " << targetString << endl;
+        cout << "LOG: ALT: " << alignmentString << endl;
+        cout << "LOG: PHRASES_BEGIN:" << endl;
+      }
 
-  // loop through all sentence pairs
-  int i=0;
-  while(true) {
-    i++;
-    if (i%1000 == 0) cerr << "." << flush;
-    if (i%10000 == 0) cerr << ":" << flush;
-    if (i%100000 == 0) cerr << "!" << flush;
-    char targetString[LINE_MAX_LENGTH];
-    char sourceString[LINE_MAX_LENGTH];
-    char alignmentString[LINE_MAX_LENGTH];
-    SAFE_GETLINE((*tFileP), targetString, LINE_MAX_LENGTH, '\n', __FILE__);
-    if (tFileP->eof()) break;
-    SAFE_GETLINE((*sFileP), sourceString, LINE_MAX_LENGTH, '\n', __FILE__);
-    SAFE_GETLINE((*aFileP), alignmentString, LINE_MAX_LENGTH, '\n', __FILE__);
-    SentenceAlignmentWithSyntax sentence(targetLabelCollection,
-                                         sourceLabelCollection,
-                                         targetTopLabelCollection,
-                                         sourceTopLabelCollection,
-                                         options);
-    //az: output src, tgt, and alingment line
-    if (options.onlyOutputSpanInfo) {
-      cout << "LOG: SRC: " << sourceString << endl;
-      cout << "LOG: TGT: " << targetString << endl;
-      cout << "LOG: ALT: " << alignmentString << endl;
-      cout << "LOG: PHRASES_BEGIN:" << endl;
-    }
-
-    if (sentence.create(targetString, sourceString, alignmentString, i)) {
-      if (options.unknownWordLabelFlag) {
-        collectWordLabelCounts(sentence);
+      if (sentence.create(targetString, sourceString, alignmentString, i)) {
+        if (options.unknownWordLabelFlag) {
+          collectWordLabelCounts(sentence, wordCount, wordLabel);
+        }
+        ExtractTask task;
+        task.extractRules(sentence);
+        task.consolidateRules();
+        task.writeRulesToFile(extractFile, extractFileInv);
       }
-      extractRules(sentence);
-      consolidateRules();
-      writeRulesToFile();
-      extractedRules.clear();
+      if (options.onlyOutputSpanInfo) cout << "LOG: PHRASES_END:" << endl; //az: mark end of phrases
     }
-    if (options.onlyOutputSpanInfo) cout << "LOG: PHRASES_END:" << endl; //az: mark end of phrases
   }
 
   tFile.Close();
   sFile.Close();
   aFile.Close();
   // only close if we actually opened it
-  if (!options.onlyOutputSpanInfo) {
+  if (!options.onlyOutputSpanInfo && options.threads == 1) {
     extractFile.close();
     if (!options.onlyDirectFlag) extractFileInv.close();
   }
@@ -296,7 +356,7 @@ int main(int argc, char* argv[])
     writeUnknownWordLabel(fileNameUnknownWordLabel);
 }
 
-void extractRules( SentenceAlignmentWithSyntax &sentence )
+void ExtractTask::extractRules( SentenceAlignmentWithSyntax &sentence )
 {
   int countT = sentence.target.size();
   int countS = sentence.source.size();
@@ -561,8 +621,8 @@ void printHieroAlignment(SentenceAlignmentWithSyntax &sentence
   }
 }
 
-void printHieroPhrase( SentenceAlignmentWithSyntax &sentence, int startT, int endT, int startS, int endS
-                       , HoleCollection &holeColl, LabelIndex &labelIndex)
+void ExtractTask::printHieroPhrase( SentenceAlignmentWithSyntax &sentence, int startT, int endT, int startS, int endS
+                                    , HoleCollection &holeColl, LabelIndex &labelIndex)
 {
   WordIndex indexS, indexT; // to keep track of word positions in rule
 
@@ -593,9 +653,9 @@ void printHieroPhrase( SentenceAlignmentWithSyntax &sentence, int startT, int en
   addRuleToCollection( rule );
 }
 
-void printAllHieroPhrases( SentenceAlignmentWithSyntax &sentence
-                           , int startT, int endT, int startS, int endS
-                           , HoleCollection &holeColl)
+void ExtractTask::printAllHieroPhrases( SentenceAlignmentWithSyntax &sentence
+                                        , int startT, int endT, int startS, int endS
+                                        , HoleCollection &holeColl)
 {
   LabelIndex labelIndex,labelCount;
 
@@ -646,10 +706,10 @@ void printAllHieroPhrases( SentenceAlignmentWithSyntax &sentence
 
 // this function is called recursively
 // it pokes a new hole into the phrase pair, and then calls itself for more holes
-void addHieroRule( SentenceAlignmentWithSyntax &sentence
-                   , int startT, int endT, int startS, int endS
-                   , RuleExist &ruleExist, const HoleCollection &holeColl
-                   , int numHoles, int initStartT, int wordCountT, int wordCountS)
+void ExtractTask::addHieroRule( SentenceAlignmentWithSyntax &sentence
+                                , int startT, int endT, int startS, int endS
+                                , RuleExist &ruleExist, const HoleCollection &holeColl
+                                , int numHoles, int initStartT, int wordCountT, int wordCountS)
 {
   // done, if already the maximum number of non-terminals in phrase pair
   if (numHoles >= options.maxNonTerm)
@@ -771,8 +831,8 @@ void addHieroRule( SentenceAlignmentWithSyntax &sentence
   }
 }
 
-void addRule( SentenceAlignmentWithSyntax &sentence, int startT, int endT, int startS, int endS
-              , RuleExist &ruleExist)
+void ExtractTask::addRule( SentenceAlignmentWithSyntax &sentence, int startT, int endT, int startS, int endS
+                           , RuleExist &ruleExist)
 {
   // source
 
@@ -821,13 +881,13 @@ void addRule( SentenceAlignmentWithSyntax &sentence, int startT, int endT, int s
   addRuleToCollection( rule );
 }
 
-void addRuleToCollection( ExtractedRule &newRule )
+void ExtractTask::addRuleToCollection( ExtractedRule &newRule )
 {
 
   // no double-counting of identical rules from overlapping spans
   if (!options.duplicateRules) {
     vector<ExtractedRule>::const_iterator rule;
-    for(rule = extractedRules.begin(); rule != extractedRules.end(); rule++ ) {
+    for(rule = m_extractedRules.begin(); rule != m_extractedRules.end(); rule++ ) {
       if (rule->source.compare( newRule.source ) == 0 &&
           rule->target.compare( newRule.target ) == 0 &&
           !(rule->endT < newRule.startT || rule->startT > newRule.endT)) { // overlapping
@@ -835,31 +895,31 @@ void addRuleToCollection( ExtractedRule &newRule )
       }
     }
   }
-  extractedRules.push_back( newRule );
+  m_extractedRules.push_back( newRule );
 }
 
-void consolidateRules()
+void ExtractTask::consolidateRules()
 {
   typedef vector<ExtractedRule>::iterator R;
   map<int, map<int, map<int, map<int,int> > > > spanCount;
 
   // compute number of rules per span
   if (options.fractionalCounting) {
-    for(R rule = extractedRules.begin(); rule != extractedRules.end(); rule++ ) {
+    for(R rule = m_extractedRules.begin(); rule != m_extractedRules.end(); rule++ ) {
       spanCount[ rule->startT ][ rule->endT ][ rule->startS ][ rule->endS ]++;
     }
   }
 
   // compute fractional counts
-  for(R rule = extractedRules.begin(); rule != extractedRules.end(); rule++ ) {
+  for(R rule = m_extractedRules.begin(); rule != m_extractedRules.end(); rule++ ) {
     rule->count =    1.0/(float) (options.fractionalCounting ? spanCount[ rule->startT ][ rule->endT ][ rule->startS ][ rule->endS ] : 1.0 );
   }
 
   // consolidate counts
-  for(R rule = extractedRules.begin(); rule != extractedRules.end(); rule++ ) {
+  for(R rule = m_extractedRules.begin(); rule != m_extractedRules.end(); rule++ ) {
     if (rule->count == 0)
       continue;
-    for(R r2 = rule+1; r2 != extractedRules.end(); r2++ ) {
+    for(R r2 = rule+1; r2 != m_extractedRules.end(); r2++ ) {
       if (rule->source.compare( r2->source ) == 0 &&
           rule->target.compare( r2->target ) == 0 &&
           rule->alignment.compare( r2->alignment ) == 0) {
@@ -870,10 +930,10 @@ void consolidateRules()
   }
 }
 
-void writeRulesToFile()
+void ExtractTask::writeRulesToFile(ostream &extractFile, ostream &extractFileInv) const
 {
   vector<ExtractedRule>::const_iterator rule;
-  for(rule = extractedRules.begin(); rule != extractedRules.end(); rule++ ) {
+  for(rule = m_extractedRules.begin(); rule != m_extractedRules.end(); rule++ ) {
     if (rule->count == 0)
       continue;
 
@@ -937,9 +997,8 @@ void writeGlueGrammar( const string & fileName )
 // ( labels of singleton words are used to estimate
 //   distribution oflabels for unknown words )
 
-map<string,int> wordCount;
-map<string,string> wordLabel;
-void collectWordLabelCounts( SentenceAlignmentWithSyntax &sentence )
+void collectWordLabelCounts( SentenceAlignmentWithSyntax &sentence
+                             , map<string,int> &wordCount, map<string,string> &wordLabel )
 {
   int countT = sentence.target.size();
   for(int ti=0; ti < countT; ti++) {
@@ -976,3 +1035,247 @@ void writeUnknownWordLabel(const string & fileName)
 
   outFile.close();
 }
+
+#ifdef WITH_THREADS
+
+namespace
+{
+
+const size_t kSentenceBatchSize = 1000;
+
+// sums the counts of identical rules until maxRules distinct rules are
+// held, then writes them to a new sorted shard
+class RuleCountBuffer
+{
+public:
+  RuleCountBuffer(Moses::SortedShardSet &shards, size_t maxRules)
+    : m_shards(shards), m_maxRules(maxRules), m_ok(true) {}
+
+  void Add(const string &rule, double count) {
+    m_counts[rule] += count;
+    if (m_counts.size() + m_lines.size() >= m_maxRules)
+      Flush();
+  }
+
+  // add a line that is not merged with any other
+  void AddLine(const string &line) {
+    m_lines.push_back(line);
+    if (m_counts.size() + m_lines.size() >= m_maxRules)
+      Flush();
+  }
+
+  void Flush() {
+    if (m_counts.empty() && m_lines.empty())
+      return;
+    ostringstream line;
+    line << fixed << setprecision(6);
+    for(map<string,double>::const_iterator rule = m_counts.begin(); rule != m_counts.end(); rule++) {
+      line.str("");
+      line << rule->first << " ||| ";
+      // summed counts may be large, print them in full
+      if (rule->second == static_cast<long long>(rule->second))
+        line << static_cast<long long>(rule->second);
+      else
+        line << rule->second;
+      m_lines.push_back(line.str());
+    }
+    m_counts.clear();
+    m_ok = m_shards.Write(m_lines) && m_ok;
+  }
+
+  bool Good() const {
+    return m_ok;
+  }
+
+private:
+  Moses::SortedShardSet &m_shards;
+  size_t m_maxRules;
+  map<string,double> m_counts;
+  vector<string> m_lines;
+  bool m_ok;
+};
+
+// extracts the rules of the sentence batches in the queue into sorted shards,
+// collecting its own labels and word counts
+class ExtractWorker
+{
+public:
+  ExtractWorker(Moses::SentenceBatchQueue &queue,
+                Moses::SortedShardSet &fwdShards, Moses::SortedShardSet &invShards)
+    : m_queue(queue)
+    , m_fwdRules(fwdShards, options.shardSize)
+    , m_invRules(invShards, options.shardSize) {}
+
+  void Run();
+
+  bool Good() const {
+    return m_fwdRules.Good() && m_invRules.Good();
+  }
+
+  // adds the labels and word counts of this worker to the global ones
+  void MergeLabels() const;
+
+private:
+  void addRules(const ExtractTask &task);
+
+  Moses::SentenceBatchQueue &m_queue;
+  set< string > m_targetLabelCollection, m_sourceLabelCollection;
+  map< string, int > m_targetTopLabelCollection, m_sourceTopLabelCollection;
+  map< string, int > m_wordCount;
+  map< string, string > m_wordLabel;
+  RuleCountBuffer m_fwdRules;
+  RuleCountBuffer m_invRules;
+};
+
+void ExtractWorker::Run()
+{
+  while (Moses::SentenceBatch *batch = m_queue.Pop()) {
+    for(size_t i=0; i<batch->targetLines.size(); i++) {
+      // SentenceAlignment::create() takes modifiable strings
+      vector<char> targetString(batch->targetLines[i].begin(), batch->targetLines[i].end());
+      vector<char> sourceString(batch->sourceLines[i].begin(), batch->sourceLines[i].end());
+      vector<char> alignmentString(batch->alignmentLines[i].begin(), batch->alignmentLines[i].end());
+      targetString.push_back('\0');
+      sourceString.push_back('\0');
+      alignmentString.push_back('\0');
+
+      SentenceAlignmentWithSyntax sentence(m_targetLabelCollection,
+                                           m_sourceLabelCollection,
+                                           m_targetTopLabelCollection,
+                                           m_sourceTopLabelCollection,
+                                           options);
+      if (sentence.create(&targetString[0], &sourceString[0], &alignmentString[0],
+                          batch->firstLineNum + i)) {
+        if (options.unknownWordLabelFlag) {
+          collectWordLabelCounts(sentence, m_wordCount, m_wordLabel);
+        }
+        ExtractTask task;
+        task.extractRules(sentence);
+        task.consolidateRules();
+        addRules(task);
+      }
+    }
+    delete batch;
+  }
+  m_fwdRules.Flush();
+  m_invRules.Flush();
+}
+
+void ExtractWorker::MergeLabels() const
+{
+  targetLabelCollection.insert(m_targetLabelCollection.begin(), m_targetLabelCollection.end());
+  sourceLabelCollection.insert(m_sourceLabelCollection.begin(), m_sourceLabelCollection.end());
+  typedef map<string,int>::const_iterator I;
+  for(I p = m_targetTopLabelCollection.begin(); p != m_targetTopLabelCollection.end(); p++)
+    targetTopLabelCollection[ p->first ] += p->second;
+  for(I p = m_sourceTopLabelCollection.begin(); p != m_sourceTopLabelCollection.end(); p++)
+    sourceTopLabelCollection[ p->first ] += p->second;
+  for(I p = m_wordCount.begin(); p != m_wordCount.end(); p++)
+    wordCount[ p->first ] += p->second;
+  for(map<string,string>::const_iterator p = m_wordLabel.begin(); p != m_wordLabel.end(); p++)
+    wordLabel[ p->first ] = p->second;
+}
+
+void ExtractWorker::addRules(const ExtractTask &task)
+{
+  vector<ExtractedRule>::const_iterator rule;
+  for(rule = task.GetRules().begin(); rule != task.GetRules().end(); rule++ ) {
+    if (rule->count == 0)
+      continue;
+
+    const string fwd = rule->source + " ||| " + rule->target + " ||| " + rule->alignment;
+    if (options.outputNTLengths) {
+      // the lengths differ between occurrences, so the rule is written as is
+      ostringstream line;
+      line << fwd << " ||| " << rule->count << " ||| ";
+      rule->OutputNTLengths(line);
+      m_fwdRules.AddLine(line.str());
+    } else {
+      m_fwdRules.Add(fwd, rule->count);
+    }
+
+    if (!options.onlyDirectFlag) {
+      m_invRules.Add(rule->target + " ||| " + rule->source + " ||| " + rule->alignmentInv, rule->count);
+    }
+  }
+}
+
+}
+
+void extractInParallel(istream &tFile, istream &sFile, istream &aFile, const string &fileNameExtract)
+{
+  Moses::SortedShardSet fwdShards(fileNameExtract);
+  Moses::SortedShardSet invShards(fileNameExtract + ".inv");
+  Moses::SentenceBatchQueue queue(2 * options.threads);
+
+  vector<ExtractWorker*> workers;
+  boost::thread_group threads;
+  for(int i=0; i<options.threads; i++) {
+    workers.push_back(new ExtractWorker(queue, fwdShards, invShards));
+    threads.create_thread(boost::bind(&ExtractWorker::Run, workers.back()));
+  }
+
+  // read the corpus on this thread, in batches of consecutive sentences
+  int i=0;
+  bool lineCountsMatch = true;
+  Moses::SentenceBatch *batch = NULL;
+  string targetString, sourceString, alignmentString;
+  while(getline(tFile, targetString)) {
+    i++;
+    if (i%1000 == 0) cerr << "." << flush;
+    if (i%10000 == 0) cerr << ":" << flush;
+    if (i%100000 == 0) cerr << "!" << flush;
+    if (!getline(sFile, sourceString) || !getline(aFile, alignmentString)) {
+      lineCountsMatch = false;
+      break;
+    }
+    if (batch == NULL) {
+      batch = new Moses::SentenceBatch();
+      batch->firstLineNum = i;
+    }
+    batch->targetLines.push_back(targetString);
+    batch->sourceLines.push_back(sourceString);
+    batch->alignmentLines.push_back(alignmentString);
+    if (batch->targetLines.size() == kSentenceBatchSize) {
+      queue.Push(batch);
+      batch = NULL;
+    }
+  }
+  if (lineCountsMatch && (getline(sFile, sourceString) || getline(aFile, alignmentString)))
+    lineCountsMatch = false;
+  if (batch != NULL)
+    queue.Push(batch);
+  queue.Close();
+  threads.join_all();
+
+  if (!lineCountsMatch) {
+    cerr << "extract error: target, source and alignment files have different numbers of lines (at line " << i << ")" << endl;
+    exit(1);
+  }
+
+  // merge the labels and word counts of the workers
+  bool good = true;
+  for(vector<ExtractWorker*>::const_iterator w = workers.begin(); w != workers.end(); w++) {
+    const ExtractWorker &worker = **w;
+    good = good && worker.Good();
+    worker.MergeLabels();
+    delete *w;
+  }
+  if (!good) {
+    cerr << "extract error: could not write the sorted shards of " << fileNameExtract << endl;
+    exit(1);
+  }
+
+  cerr << endl << "wrote " << fwdShards.GetFileNames().size() << " sorted shards of " << fileNameExtract
+       << " and " << invShards.GetFileNames().size() << " of " << fileNameExtract << ".inv" << endl;
+}
+
+#else
+
+void extractInParallel(istream &, istream &, istream &, const string &)
+{
+  cerr << "extract error: this build of extract-rules does not support --Threads" << endl;
+  exit(1);
+}
+
+#endif
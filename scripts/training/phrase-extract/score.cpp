@@ -32,49 +32,88 @@
 #include "PhraseAlignment.h"
 #include "score.h"
 #include "InputFileStream.h"
+#include "SortedShards.h"
+
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include "SentenceBatchQueue.h"
+#endif
 
 using namespace std;
 
 #define LINE_MAX_LENGTH 100000
+#define COC_MAX 10
 
+// words of the lexical table, shared by all threads
 Vocabulary vcbT;
 Vocabulary vcbS;
 
 class LexicalTable
 {
 public:
-  map< WORD_ID, map< WORD_ID, double > > ltable;
+  // one flat hash table, keyed by the source and target word id
+  boost::unordered_map< unsigned long long, double > ltable;
   void load( char[] );
-  double permissiveLookup( WORD_ID wordS, WORD_ID wordT ) {
-    // cout << endl << vcbS.getWord( wordS ) << "-" << vcbT.getWord( wordT ) << ":";
-    if (ltable.find( wordS ) == ltable.end()) return 1.0;
-    if (ltable[ wordS ].find( wordT ) == ltable[ wordS ].end()) return 1.0;
-    // cout << ltable[ wordS ][ wordT ];
-    return ltable[ wordS ][ wordT ];
+  double permissiveLookup( WORD_ID wordS, WORD_ID wordT ) const {
+    boost::unordered_map< unsigned long long, double >::const_iterator i = ltable.find( key( wordS, wordT ) );
+    if (i == ltable.end()) return 1.0;
+    return i->second;
+  }
+  static unsigned long long key( WORD_ID wordS, WORD_ID wordT ) {
+    return ((unsigned long long) wordS << 32) | wordT;
   }
 };
 
 vector<string> tokenize( const char [] );
 
+// scores the phrase pairs of a sorted extract file, one source phrase at a time
+class PhraseScorer
+{
+public:
+  PhraseScorer();
+
+  //! add a line of the extract file, the phrase pairs of the previous source phrase are written when the source phrase changes
+  void addLine( const string &extractLine, int lineID, ostream &phraseTableFile );
+  //! write the phrase pairs of the last source phrase
+  void flush( ostream &phraseTableFile );
+
+  //! add this scorer's count of count statistics
+  void addCountOfCounts( int countOfCounts[], int &totalDistinct ) const;
+
+private:
+  LayeredVocabulary vcbS;
+  LayeredVocabulary vcbT;
+  vector< PhraseAlignment > phrasePairsWithSameF;
+  PhraseAlignment *lastPhrasePair;
+  string lastLine;
+  float lastCount;
+  int countOfCounts[COC_MAX+1];
+  int totalDistinct;
+
+  void processPhrasePairs( vector< PhraseAlignment > & , ostream &phraseTableFile);
+  void outputPhrasePair( vector< PhraseAlignment * > &, float, int, ostream &phraseTableFile );
+  double computeLexicalTranslation( const PHRASE &, const PHRASE &, PhraseAlignment * );
+  double computeUnalignedFWPenalty( const PHRASE &, const PHRASE &, PhraseAlignment * );
+};
+
 void writeCountOfCounts( const char* fileNameCountOfCounts );
-void processPhrasePairs( vector< PhraseAlignment > & , ostream &phraseTableFile);
 PhraseAlignment* findBestAlignment( vector< PhraseAlignment* > & );
-void outputPhrasePair( vector< PhraseAlignment * > &, float, int, ostream &phraseTableFile );
-double computeLexicalTranslation( const PHRASE &, const PHRASE &, PhraseAlignment * );
 double computeUnalignedPenalty( const PHRASE &, const PHRASE &, PhraseAlignment * );
 set<string> functionWordList;
 void loadFunctionWords( const char* fileNameFunctionWords );
-double computeUnalignedFWPenalty( const PHRASE &, const PHRASE &, PhraseAlignment * );
 void calcNTLengthProb(const vector< PhraseAlignment* > &phrasePairs
                       , map<size_t, map<size_t, float> > &sourceProb
                       , map<size_t, map<size_t, float> > &targetProb);
+void scoreInParallel( Moses::SortedShardReader &extractFile, ostream *phraseTableFile, Moses::SortedShardSet *phraseTableShards );
 LexicalTable lexTable;
 bool inverseFlag = false;
 bool hierarchicalFlag = false;
 bool wordAlignmentFlag = false;
 bool goodTuringFlag = false;
 bool kneserNeyFlag = false;
-#define COC_MAX 10
 bool logProbFlag = false;
 int negLogProb = 1;
 bool lexFlag = true;
@@ -84,6 +123,9 @@ bool outputNTLengths = false;
 int countOfCounts[COC_MAX+1];
 int totalDistinct = 0;
 float minCountHierarchical = 0;
+int threads = 1;
+bool sortedShardsFlag = false;
+int shardSize = 1000000;
 
 int main(int argc, char* argv[])
 {
@@ -91,7 +133,7 @@ int main(int argc, char* argv[])
        << "scoring methods for extracted rules\n";
 
   if (argc < 4) {
-    cerr << "syntax: score extract lex phrase-table [--Inverse] [--Hierarchical] [--LogProb] [--NegLogProb] [--NoLex] [--GoodTuring coc-file] [--KneserNey coc-file] [--WordAlignment] [--UnalignedPenalty] [--UnalignedFunctionWordPenalty function-word-file] [--MinCountHierarchical count] [--OutputNTLengths] \n";
+    cerr << "syntax: score extract[,extract...] lex phrase-table [--Inverse] [--Hierarchical] [--LogProb] [--NegLogProb] [--NoLex] [--GoodTuring coc-file] [--KneserNey coc-file] [--WordAlignment] [--UnalignedPenalty] [--UnalignedFunctionWordPenalty function-word-file] [--MinCountHierarchical count] [--OutputNTLengths] [--Threads count] [--SortedShards] [--ShardSize lines] \n";
     exit(1);
   }
   char* fileNameExtract = argv[1];
@@ -153,6 +195,28 @@ int main(int argc, char* argv[])
       minCountHierarchical -= 0.00001; // account for rounding
     } else if (strcmp(argv[i],"--OutputNTLengths") == 0) {
       outputNTLengths = true;
+    } else if (strcmp(argv[i],"--Threads") == 0) {
+      threads = atoi(argv[++i]);
+      if (threads < 1) {
+        cerr << "ERROR: --Threads should be at least 1\n";
+        exit(1);
+      }
+#ifndef WITH_THREADS
+      if (threads > 1) {
+        cerr << "ERROR: this build of score does not support --Threads\n";
+        exit(1);
+      }
+#endif
+      cerr << "scoring with " << threads << " threads\n";
+    } else if (strcmp(argv[i],"--SortedShards") == 0) {
+      sortedShardsFlag = true;
+      cerr << "writing sorted shards of the phrase table\n";
+    } else if (strcmp(argv[i],"--ShardSize") == 0) {
+      shardSize = atoi(argv[++i]);
+      if (shardSize < 1) {
+        cerr << "ERROR: --ShardSize should be at least 1\n";
+        exit(1);
+      }
     } else {
       cerr << "ERROR: unknown option " << argv[i] << endl;
       exit(1);
@@ -172,82 +236,82 @@ int main(int argc, char* argv[])
     for(int i=1; i<=COC_MAX; i++) countOfCounts[i] = 0;
   }
 
-  // sorted phrase extraction file
-  Moses::InputFileStream extractFile(fileNameExtract);
+  // sorted phrase extraction file, or sorted shards of it separated by commas
+  vector<string> extractShards;
+  string extractShardList( fileNameExtract );
+  for(size_t start = 0, comma = 0; comma != string::npos; start = comma+1) {
+    comma = extractShardList.find( ',', start );
+    extractShards.push_back( extractShardList.substr( start, comma == string::npos ? string::npos : comma-start ) );
+  }
+  Moses::SortedShardReader extractFile( extractShards );
 
-  if (extractFile.fail()) {
-    cerr << "ERROR: could not open extract file " << fileNameExtract << endl;
+  if (extractFile.Fail()) {
     exit(1);
   }
-  istream &extractFileP = extractFile;
-
-  // output file: phrase translation table
-	ostream *phraseTableFile;
-
-	if (strcmp(fileNamePhraseTable, "-") == 0) {
-		phraseTableFile = &cout;
-	}
-	else {
-		ofstream *outputFile = new ofstream();
-		outputFile->open(fileNamePhraseTable);
-		if (outputFile->fail()) {
-			cerr << "ERROR: could not open file phrase table file "
-					 << fileNamePhraseTable << endl;
-			exit(1);
-		}
-		phraseTableFile = outputFile;
-	}
-	
-  // loop through all extracted phrase translations
-  float lastCount = 0.0f;
-  vector< PhraseAlignment > phrasePairsWithSameF;
-  int i=0;
-  char line[LINE_MAX_LENGTH],lastLine[LINE_MAX_LENGTH];
-  lastLine[0] = '\0';
-  PhraseAlignment *lastPhrasePair = NULL;
-  while(true) {
-    if (extractFileP.eof()) break;
-    if (++i % 100000 == 0) cerr << "." << flush;
-    SAFE_GETLINE((extractFileP), line, LINE_MAX_LENGTH, '\n', __FILE__);
-    if (extractFileP.eof())	break;
 
-    // identical to last line? just add count
-    if (strcmp(line,lastLine) == 0) {
-      lastPhrasePair->count += lastCount;
-      continue;
+  // output file: phrase translation table, or sorted shards of it
+  // (so that the inverse table needs no sort before consolidation)
+  ostream *phraseTableFile = NULL;
+  Moses::SortedShardSet *phraseTableShards = NULL;
+
+  if (sortedShardsFlag) {
+    phraseTableShards = new Moses::SortedShardSet( fileNamePhraseTable );
+  } else if (strcmp(fileNamePhraseTable, "-") == 0) {
+    phraseTableFile = &cout;
+  } else {
+    ofstream *outputFile = new ofstream();
+    outputFile->open(fileNamePhraseTable);
+    if (outputFile->fail()) {
+      cerr << "ERROR: could not open file phrase table file "
+           << fileNamePhraseTable << endl;
+      exit(1);
     }
-    strcpy( lastLine, line );
-
-    // create new phrase pair
-    PhraseAlignment phrasePair;
-    phrasePair.create( line, i );
-    lastCount = phrasePair.count;
-
-    // only differs in count? just add count
-    if (lastPhrasePair != NULL && lastPhrasePair->equals( phrasePair )) {
-      lastPhrasePair->count += phrasePair.count;
-      continue;
+    phraseTableFile = outputFile;
+  }
+
+  if (threads > 1) {
+    scoreInParallel( extractFile, phraseTableFile, phraseTableShards );
+  } else {
+    // loop through all extracted phrase translations
+    PhraseScorer scorer;
+    Moses::SortedShardWriter *shardWriter = NULL;
+    ostringstream shardBuffer;
+    if (phraseTableShards)
+      shardWriter = new Moses::SortedShardWriter( *phraseTableShards, shardSize );
+    ostream &out = shardWriter ? shardBuffer : *phraseTableFile;
+
+    int i=0;
+    string extractLine;
+    while(extractFile.GetLine( extractLine )) {
+      if (++i % 100000 == 0) cerr << "." << flush;
+      scorer.addLine( extractLine, i, out );
+      if (shardWriter && shardBuffer.tellp() > 1000000) {
+        shardWriter->AddLines( shardBuffer.str() );
+        shardBuffer.str( "" );
+      }
     }
+    scorer.flush( out );
+    scorer.addCountOfCounts( countOfCounts, totalDistinct );
 
-    // if new source phrase, process last batch
-    if (lastPhrasePair != NULL &&
-        lastPhrasePair->GetSource() != phrasePair.GetSource()) {
-      processPhrasePairs( phrasePairsWithSameF, *phraseTableFile );
-      phrasePairsWithSameF.clear();
-      lastPhrasePair = NULL;
+    if (shardWriter) {
+      shardWriter->AddLines( shardBuffer.str() );
+      shardWriter->Flush();
+      if (!shardWriter->Good())
+        exit(1);
+      delete shardWriter;
     }
+  }
 
-    // add phrase pairs to list, it's now the last one
-    phrasePairsWithSameF.push_back( phrasePair );
-    lastPhrasePair = &phrasePairsWithSameF.back();
+  if (phraseTableShards) {
+    cerr << "wrote " << phraseTableShards->GetFileNames().size() << " sorted shards of " << fileNamePhraseTable << endl;
+    delete phraseTableShards;
+  } else {
+    phraseTableFile->flush();
+    if (phraseTableFile != &cout) {
+      (dynamic_cast<ofstream*>(phraseTableFile))->close();
+      delete phraseTableFile;
+    }
   }
-  processPhrasePairs( phrasePairsWithSameF, *phraseTableFile );
-	
-	phraseTableFile->flush();
-	if (phraseTableFile != &cout) {
-		(dynamic_cast<ofstream*>(phraseTableFile))->close();
-		delete phraseTableFile;
-	}
 
   // output count of count statistics
   if (goodTuringFlag || kneserNeyFlag) {
@@ -276,7 +340,63 @@ void writeCountOfCounts( const char* fileNameCountOfCounts )
 	countOfCountsFile.close();
 }
 
-void processPhrasePairs( vector< PhraseAlignment > &phrasePair, ostream &phraseTableFile )
+PhraseScorer::PhraseScorer()
+  : vcbS( ::vcbS )
+  , vcbT( ::vcbT )
+  , lastPhrasePair( NULL )
+  , lastCount( 0.0f )
+  , totalDistinct( 0 )
+{
+  for(int i=0; i<=COC_MAX; i++) countOfCounts[i] = 0;
+}
+
+void PhraseScorer::addLine( const string &extractLine, int lineID, ostream &phraseTableFile )
+{
+  // identical to last line? just add count
+  if (lastPhrasePair != NULL && extractLine == lastLine) {
+    lastPhrasePair->count += lastCount;
+    return;
+  }
+  lastLine = extractLine;
+
+  // create new phrase pair
+  PhraseAlignment phrasePair;
+  phrasePair.create( extractLine.c_str(), lineID, vcbS, vcbT );
+  lastCount = phrasePair.count;
+
+  // only differs in count? just add count
+  if (lastPhrasePair != NULL && lastPhrasePair->equals( phrasePair )) {
+    lastPhrasePair->count += phrasePair.count;
+    return;
+  }
+
+  // if new source phrase, process last batch
+  if (lastPhrasePair != NULL &&
+      lastPhrasePair->GetSource() != phrasePair.GetSource()) {
+    processPhrasePairs( phrasePairsWithSameF, phraseTableFile );
+    phrasePairsWithSameF.clear();
+    lastPhrasePair = NULL;
+  }
+
+  // add phrase pairs to list, it's now the last one
+  phrasePairsWithSameF.push_back( phrasePair );
+  lastPhrasePair = &phrasePairsWithSameF.back();
+}
+
+void PhraseScorer::flush( ostream &phraseTableFile )
+{
+  processPhrasePairs( phrasePairsWithSameF, phraseTableFile );
+  phrasePairsWithSameF.clear();
+  lastPhrasePair = NULL;
+}
+
+void PhraseScorer::addCountOfCounts( int allCountOfCounts[], int &allTotalDistinct ) const
+{
+  for(int i=1; i<=COC_MAX; i++) allCountOfCounts[i] += countOfCounts[i];
+  allTotalDistinct += totalDistinct;
+}
+
+void PhraseScorer::processPhrasePairs( vector< PhraseAlignment > &phrasePair, ostream &phraseTableFile )
 {
   if (phrasePair.size() == 0) return;
 
@@ -417,7 +537,7 @@ void outputNTLengthProbs(ostream &phraseTableFile, const map<size_t, map<size_t,
 
 }
 
-void outputPhrasePair( vector< PhraseAlignment* > &phrasePair, float totalCount, int distinctCount, ostream &phraseTableFile )
+void PhraseScorer::outputPhrasePair( vector< PhraseAlignment* > &phrasePair, float totalCount, int distinctCount, ostream &phraseTableFile )
 {
   if (phrasePair.size() == 0) return;
 
@@ -561,7 +681,7 @@ double computeUnalignedPenalty( const PHRASE &phraseS, const PHRASE &phraseT, Ph
   return unaligned;
 }
 
-double computeUnalignedFWPenalty( const PHRASE &phraseS, const PHRASE &phraseT, PhraseAlignment *alignment )
+double PhraseScorer::computeUnalignedFWPenalty( const PHRASE &phraseS, const PHRASE &phraseT, PhraseAlignment *alignment )
 {
   // unaligned word counter
   double unaligned = 1.0;
@@ -600,7 +720,7 @@ void loadFunctionWords( const char *fileName )
   inFile.close();
 }
 
-double computeLexicalTranslation( const PHRASE &phraseS, const PHRASE &phraseT, PhraseAlignment *alignment )
+double PhraseScorer::computeLexicalTranslation( const PHRASE &phraseS, const PHRASE &phraseT, PhraseAlignment *alignment )
 {
   // lexical translation probability
   double lexScore = 1.0;
@@ -654,7 +774,171 @@ void LexicalTable::load( char *fileName )
     double prob = atof( token[2].c_str() );
     WORD_ID wordT = vcbT.storeIfNew( token[0] );
     WORD_ID wordS = vcbS.storeIfNew( token[1] );
-    ltable[ wordS ][ wordT ] = prob;
+    ltable[ key( wordS, wordT ) ] = prob;
   }
   cerr << endl;
 }
+
+#ifdef WITH_THREADS
+
+namespace
+{
+
+const size_t kExtractBatchSize = 10000;
+
+// consecutive lines of the sorted extract file, which hold all phrase
+// pairs of their source phrases
+struct ExtractBatch {
+  size_t id;
+  int firstLineID;
+  vector< string > lines;
+};
+
+// writes the scored batches in the order of the extract file.  A worker
+// waits while its batch is too far ahead, so that memory use is bounded.
+class OrderedOutput
+{
+public:
+  OrderedOutput( ostream &out, size_t limit ) : m_out( out ), m_limit( limit ), m_next( 0 ) {}
+
+  void Write( size_t id, string &text ) {
+    boost::mutex::scoped_lock lock( m_mutex );
+    while (id - m_next >= m_limit) {
+      m_written.wait( lock );
+    }
+    m_pending[ id ].swap( text );
+    map< size_t, string >::iterator next;
+    while ((next = m_pending.find( m_next )) != m_pending.end()) {
+      m_out << next->second;
+      m_pending.erase( next );
+      m_next++;
+      m_written.notify_all();
+    }
+  }
+
+private:
+  ostream &m_out;
+  size_t m_limit;
+  size_t m_next;
+  map< size_t, string > m_pending;
+  boost::mutex m_mutex;
+  boost::condition_variable m_written;
+};
+
+// scores the batches in the queue, either into the ordered output or into
+// sorted shards
+class ScoreWorker
+{
+public:
+  ScoreWorker( Moses::BatchQueue< ExtractBatch > &queue, OrderedOutput *output, Moses::SortedShardSet *shards )
+    : m_queue( queue )
+    , m_output( output )
+    , m_shardWriter( shards ? new Moses::SortedShardWriter( *shards, shardSize ) : NULL ) {}
+
+  ~ScoreWorker() {
+    delete m_shardWriter;
+  }
+
+  void Run() {
+    while (ExtractBatch *batch = m_queue.Pop()) {
+      ostringstream out;
+      for(size_t i=0; i<batch->lines.size(); i++) {
+        m_scorer.addLine( batch->lines[i], batch->firstLineID + i, out );
+      }
+      m_scorer.flush( out );
+      string text = out.str();
+      if (m_shardWriter)
+        m_shardWriter->AddLines( text );
+      else
+        m_output->Write( batch->id, text );
+      delete batch;
+    }
+    if (m_shardWriter)
+      m_shardWriter->Flush();
+  }
+
+  bool Good() const {
+    return m_shardWriter == NULL || m_shardWriter->Good();
+  }
+
+  const PhraseScorer &GetScorer() const {
+    return m_scorer;
+  }
+
+private:
+  Moses::BatchQueue< ExtractBatch > &m_queue;
+  OrderedOutput *m_output;
+  Moses::SortedShardWriter *m_shardWriter;
+  PhraseScorer m_scorer;
+};
+
+// source phrase of a line of the extract file
+inline string getSourcePhrase( const string &line )
+{
+  return line.substr( 0, line.find( " ||| " ) );
+}
+
+}
+
+void scoreInParallel( Moses::SortedShardReader &extractFile, ostream *phraseTableFile, Moses::SortedShardSet *phraseTableShards )
+{
+  Moses::BatchQueue< ExtractBatch > queue( 2 * threads );
+  OrderedOutput *output = phraseTableFile ? new OrderedOutput( *phraseTableFile, 4 * threads ) : NULL;
+
+  vector< ScoreWorker* > workers;
+  boost::thread_group threadGroup;
+  for(int i=0; i<threads; i++) {
+    workers.push_back( new ScoreWorker( queue, output, phraseTableShards ) );
+    threadGroup.create_thread( boost::bind( &ScoreWorker::Run, workers.back() ) );
+  }
+
+  // read the extract file on this thread and cut it into ranges of whole
+  // source phrases
+  int i=0;
+  size_t batchId=0;
+  ExtractBatch *batch = NULL;
+  string extractLine, lastSource;
+  while(extractFile.GetLine( extractLine )) {
+    if (++i % 100000 == 0) cerr << "." << flush;
+    if (batch != NULL && batch->lines.size() >= kExtractBatchSize) {
+      string source = getSourcePhrase( extractLine );
+      if (source != lastSource) {
+        queue.Push( batch );
+        batch = NULL;
+      }
+      lastSource.swap( source );
+    } else if (batch != NULL && batch->lines.size() + 1 == kExtractBatchSize) {
+      lastSource = getSourcePhrase( extractLine );
+    }
+    if (batch == NULL) {
+      batch = new ExtractBatch();
+      batch->id = batchId++;
+      batch->firstLineID = i;
+    }
+    batch->lines.push_back( extractLine );
+  }
+  if (batch != NULL)
+    queue.Push( batch );
+  queue.Close();
+  threadGroup.join_all();
+
+  bool good = true;
+  for(vector< ScoreWorker* >::iterator w = workers.begin(); w != workers.end(); w++) {
+    good = good && (*w)->Good();
+    (*w)->GetScorer().addCountOfCounts( countOfCounts, totalDistinct );
+    delete *w;
+  }
+  delete output;
+  if (!good)
+    exit(1);
+}
+
+#else
+
+void scoreInParallel( Moses::SortedShardReader &, ostream *, Moses::SortedShardSet * )
+{
+  cerr << "ERROR: this build of score does not support --Threads\n";
+  exit(1);
+}
+
+#endif
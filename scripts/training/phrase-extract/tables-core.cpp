@@ -54,6 +54,25 @@ WORD_ID Vocabulary::getWordID( const WORD& word )
   return i->second;
 }
 
+WORD_ID LayeredVocabulary::storeIfNew( const WORD& word )
+{
+  map<WORD, WORD_ID>::const_iterator i = m_base.lookup.find( word );
+  if( i != m_base.lookup.end() )
+    return i->second;
+  return m_base.vocab.size() + m_own.storeIfNew( word );
+}
+
+WORD_ID LayeredVocabulary::getWordID( const WORD& word )
+{
+  map<WORD, WORD_ID>::const_iterator i = m_base.lookup.find( word );
+  if( i != m_base.lookup.end() )
+    return i->second;
+  i = m_own.lookup.find( word );
+  if( i == m_own.lookup.end() )
+    return 0;
+  return m_base.vocab.size() + i->second;
+}
+
 PHRASE_ID PhraseTable::storeIfNew( const PHRASE& phrase )
 {
   map< PHRASE, PHRASE_ID >::iterator i = lookup.find( phrase );
@@ -31,6 +31,23 @@ public:
   }
 };
 
+// vocabulary on top of a shared vocabulary that is no longer modified:
+// known words keep their ids, new words are added to this vocabulary only,
+// so that several threads may each use their own
+class LayeredVocabulary
+{
+public:
+  explicit LayeredVocabulary( Vocabulary &base ) : m_base( base ) {}
+  WORD_ID storeIfNew( const WORD& );
+  WORD_ID getWordID( const WORD& );
+  inline WORD &getWord( WORD_ID id ) {
+    return id < m_base.vocab.size() ? m_base.vocab[ id ] : m_own.vocab[ id - m_base.vocab.size() ];
+  }
+private:
+  Vocabulary &m_base;
+  Vocabulary m_own;
+};
+
 typedef vector< WORD_ID > PHRASE;
 typedef unsigned int PHRASE_ID;
 
@@ -11,13 +11,17 @@
 #include <set>
 #include <algorithm>
 #include <cstring>
+#include <cstdio>
+#include <map>
+#include <stdint.h>
 #include "cmd.h"
 
-using namespace std;
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#include "SentenceBatchQueue.h"
+#endif
 
-#define MAX_WORD 10000 // maximum lengthsource/target strings 
-#define MAX_M 400      // maximum length of source strings
-#define MAX_N 400      // maximum length of target strings 
+using namespace std;
 
 #define UNION                      1
 #define INTERSECT                  2
@@ -57,331 +61,490 @@ static Enum_T BoolEnum [] = {
 
 // global variables and constants
 
-int* fa; //counters of covered foreign positions
-int* ea; //counters of covered english positions
-int** A; //alignment matrix with information symmetric/direct/inverse alignments
-
 int verbose=0;
 
-//read an alignment pair from the input stream.
+//sentence pairs are symmetrized in batches, on several threads if
+//available; the output keeps the order of the input
+#define BATCH_SIZE 10000
 
-int lc = 0;
+//a sentence pair of the .bal input: a[j] is the target position aligned
+//to source position j by the direct alignment, b[i] the source position
+//aligned to target position i by the inverse alignment (0 = unaligned)
+
+struct alpair {
+  int m,n;
+  vector<int> a,b;
+};
 
-int getals(fstream& inp,int& m, int *a,int& n, int *b)
+//reads the .bal input in large blocks, token by token
+
+class balreader
 {
-  char w[MAX_WORD], dummy[10];
-  int i,j,freq;
-  if (inp >> freq) {
+public:
+  balreader(FILE* f) : file(f), buf(1<<22), pos(0), end(0), eof(false), lc(0) {}
+
+  //read an alignment pair from the input stream.
+  int getals(alpair& p) {
+    const char* tok;
+    size_t len;
+    if (!next(tok,len)) return 0;
     ++lc;
     //target sentence
-    inp >> n;
-    assert(n<MAX_N);
-    for (i=1; i<=n; i++) {
-      inp >> setw(MAX_WORD) >> w;
-      if (strlen(w)>=MAX_WORD-1) {
-        cerr << lc << ": target len=" << strlen(w) << " is not less than MAX_WORD-1="
-             << MAX_WORD-1 << endl;
-        assert(strlen(w)<MAX_WORD-1);
-      }
-    }
-
-    inp >> dummy; //# separator
+    p.n=getint("target length");
+    for (int i=1; i<=p.n; i++) word();
+    word(); //# separator
     // inverse alignment
-    for (i=1; i<=n; i++) inp >> b[i];
+    p.b.resize(p.n+1);
+    for (int i=1; i<=p.n; i++) p.b[i]=getint("inverse alignment");
 
     //source sentence
-    inp >> m;
-    assert(m<MAX_M);
-    for (j=1; j<=m; j++) {
-      inp >> setw(MAX_WORD) >> w;
-      if (strlen(w)>=MAX_WORD-1) {
-        cerr << lc << ": source len=" << strlen(w) << " is not less than MAX_WORD-1="
-             << MAX_WORD-1 << endl;
-        assert(strlen(w)<MAX_WORD-1);
-      }
-    }
-
-    inp >> dummy; //# separator
+    p.m=getint("source length");
+    for (int j=1; j<=p.m; j++) word();
+    word(); //# separator
 
     // direct alignment
-    for (j=1; j<=m; j++) {
-      inp >> a[j];
-      assert(0<=a[j] && a[j]<=n);
+    p.a.resize(p.m+1);
+    for (int j=1; j<=p.m; j++) {
+      p.a[j]=getint("direct alignment");
+      check(0<=p.a[j] && p.a[j]<=p.n,"direct alignment out of range");
     }
 
     //check inverse alignemnt
-    for (i=1; i<=n; i++)
-      assert(0<=b[i] && b[i]<=m);
+    for (int i=1; i<=p.n; i++)
+      check(0<=p.b[i] && p.b[i]<=p.m,"inverse alignment out of range");
 
     return 1;
+  }
 
-  } else
-    return 0;
-};
+private:
+  FILE* file;
+  vector<char> buf;
+  size_t pos,end;
+  bool eof;
+  int lc;
 
+  static bool space(char c) {
+    return c==' ' || c=='\n' || c=='\t' || c=='\r';
+  }
 
-//compute union alignment
-int prunionalignment(fstream& out,int m,int *a,int n,int* b)
-{
+  //move the unread bytes to the front and fill up the buffer
+  void fill() {
+    if (pos>0) {
+      memmove(&buf[0],&buf[pos],end-pos);
+      end-=pos;
+      pos=0;
+    }
+    if (end==buf.size()) buf.resize(2*buf.size());
+    size_t r=fread(&buf[end],1,buf.size()-end,file);
+    if (r==0) eof=true;
+    end+=r;
+  }
 
-  ostringstream sout;
+  //next whitespace separated token, entirely in the buffer
+  bool next(const char*& tok,size_t& len) {
+    for (;;) {
+      while (pos<end && space(buf[pos])) pos++;
+      if (pos<end) break;
+      if (eof) return false;
+      fill();
+    }
+    size_t e=pos;
+    for (;;) {
+      while (e<end && !space(buf[e])) e++;
+      if (e<end || eof) break;
+      e-=pos;
+      fill();
+      e+=pos;
+    }
+    tok=&buf[pos];
+    len=e-pos;
+    pos=e;
+    return true;
+  }
 
-  for (int j=1; j<=m; j++)
-    if (a[j])
-      sout << j-1 << "-" << a[j]-1 << " ";
+  void word() {
+    const char* tok;
+    size_t len;
+    check(next(tok,len),"unexpected end of input");
+  }
+
+  int getint(const char* what) {
+    const char* tok;
+    size_t len;
+    check(next(tok,len),"unexpected end of input");
+    int v=0;
+    for (size_t k=0; k<len; k++) {
+      if (tok[k]<'0' || tok[k]>'9') {
+        cerr << lc << ": " << what << " is not a number: " << string(tok,len) << endl;
+        exit(1);
+      }
+      v=v*10+(tok[k]-'0');
+    }
+    check(len>0,what);
+    return v;
+  }
 
-  for (int i=1; i<=n; i++)
-    if (b[i] && a[b[i]]!=i)
-      sout << b[i]-1 <<  "-" << i-1 << " ";
+  void check(bool ok,const char* msg) {
+    if (!ok) {
+      cerr << lc << ": " << msg << endl;
+      exit(1);
+    }
+  }
+};
 
-  //fix the last " "
-  string str = sout.str();
-  if (str.length() == 0)
-    str = "\n";
-  else
-    str.replace(str.length()-1,1,"\n");
 
-  out << str;
-  out.flush();
+//position of the lowest set bit of a non-zero word
 
-  return 1;
+inline int lowestbit(uint64_t word)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(word);
+#else
+  int k=0;
+  while (!((word>>k) & 1)) k++;
+  return k;
+#endif
 }
 
 
-//Compute intersection alignment
+//rows of bits, one bit per position
 
-int printersect(fstream& out,int m,int *a,int n,int* b)
+class bitmatrix
 {
+public:
+  void reset(int rows,int cols) {
+    stride=(cols>>6)+1;
+    bits.assign((size_t)(rows+1)*stride,0);
+  }
+  bool get(int i,int j) const {
+    return (bits[(size_t)i*stride+(j>>6)] >> (j&63)) & 1;
+  }
+  void set(int i,int j) {
+    bits[(size_t)i*stride+(j>>6)] |= (uint64_t)1 << (j&63);
+  }
+  void clear(int i,int j) {
+    bits[(size_t)i*stride+(j>>6)] &= ~((uint64_t)1 << (j&63));
+  }
+  //first set position at or after (i,j) in row-major order, false if none
+  bool next(int& i,int& j) const {
+    size_t w=(size_t)i*stride+(j>>6);
+    uint64_t word=bits.size()>w ? bits[w] & (~(uint64_t)0 << (j&63)) : 0;
+    while (!word) {
+      if (++w>=bits.size()) return false;
+      word=bits[w];
+    }
+    i=w/stride;
+    j=(w%stride)*64+lowestbit(word);
+    return true;
+  }
 
-  ostringstream sout;
-
-  for (int j=1; j<=m; j++)
-    if (a[j] && b[a[j]]==j)
-      sout << j-1 << "-" << a[j]-1 << " ";
+private:
+  int stride;
+  vector<uint64_t> bits;
+};
 
-  //fix the last " "
-  string str = sout.str();
-  if (str.length() == 0)
-    str = "\n";
-  else
-    str.replace(str.length()-1,1,"\n");
 
-  out << str;
-  out.flush();
+//append the point "j-i " to the output
 
-  return 1;
+inline void prpoint(string& out,int j,int i)
+{
+  char tmp[32];
+  int len=sprintf(tmp,"%d-%d ",j,i);
+  out.append(tmp,len);
 }
 
-//Compute target-to-source alignment
+//fix the last " "
 
-int printtgttosrc(fstream& out,int m,int *a,int n,int* b)
+inline void endline(string& out,size_t start)
 {
-
-  ostringstream sout;
-
-  for (int i=1; i<=n; i++)
-    if (b[i])
-      sout << b[i]-1 << "-" << i-1 << " ";
-
-  //fix the last " "
-  string str = sout.str();
-  if (str.length() == 0)
-    str = "\n";
+  if (out.size()==start)
+    out+='\n';
   else
-    str.replace(str.length()-1,1,"\n");
-
-  out << str;
-  out.flush();
-
-  return 1;
+    out[out.size()-1]='\n';
 }
 
-//Compute source-to-target alignment
 
-int printsrctotgt(fstream& out,int m,int *a,int n,int* b)
+//compute union alignment
+void prunionalignment(string& out,const alpair& p)
 {
+  size_t start=out.size();
 
-  ostringstream sout;
+  for (int j=1; j<=p.m; j++)
+    if (p.a[j])
+      prpoint(out,j-1,p.a[j]-1);
 
-  for (int j=1; j<=m; j++)
-    if (a[j])
-      sout << j-1 << "-" << a[j]-1 << " ";
-
-  //fix the last " "
-  string str = sout.str();
-  if (str.length() == 0)
-    str = "\n";
-  else
-    str.replace(str.length()-1,1,"\n");
+  for (int i=1; i<=p.n; i++)
+    if (p.b[i] && p.a[p.b[i]]!=i)
+      prpoint(out,p.b[i]-1,i-1);
 
-  out << str;
-  out.flush();
-
-  return 1;
+  endline(out,start);
 }
 
-//Compute Grow Diagonal Alignment
-//Nice property: you will never introduce more points
-//than the unionalignment alignemt. Hence, you will always be able
-//to represent the grow alignment as the unionalignment of a
-//directed and inverted alignment
 
-int printgrow(fstream& out,int m,int *a,int n,int* b, bool diagonal=false,bool final=false,bool bothuncovered=false)
-{
+//Compute intersection alignment
 
-  ostringstream sout;
+void printersect(string& out,const alpair& p)
+{
+  size_t start=out.size();
 
-  vector <pair <int,int> > neighbors; //neighbors
+  for (int j=1; j<=p.m; j++)
+    if (p.a[j] && p.b[p.a[j]]==j)
+      prpoint(out,j-1,p.a[j]-1);
 
-  pair <int,int> entry;
+  endline(out,start);
+}
 
-  neighbors.push_back(make_pair(-1,-0));
-  neighbors.push_back(make_pair(0,-1));
-  neighbors.push_back(make_pair(1,0));
-  neighbors.push_back(make_pair(0,1));
+//Compute target-to-source alignment
 
+void printtgttosrc(string& out,const alpair& p)
+{
+  size_t start=out.size();
 
-  if (diagonal) {
-    neighbors.push_back(make_pair(-1,-1));
-    neighbors.push_back(make_pair(-1,1));
-    neighbors.push_back(make_pair(1,-1));
-    neighbors.push_back(make_pair(1,1));
-  }
+  for (int i=1; i<=p.n; i++)
+    if (p.b[i])
+      prpoint(out,p.b[i]-1,i-1);
 
+  endline(out,start);
+}
 
-  int i,j,o;
+//Compute source-to-target alignment
 
+void printsrctotgt(string& out,const alpair& p)
+{
+  size_t start=out.size();
 
-  //covered foreign and english positions
+  for (int j=1; j<=p.m; j++)
+    if (p.a[j])
+      prpoint(out,j-1,p.a[j]-1);
 
-  memset(fa,0,(m+1)*sizeof(int));
-  memset(ea,0,(n+1)*sizeof(int));
+  endline(out,start);
+}
 
-  //matrix to quickly check if one point is in the symmetric
-  //alignment (value=2), direct alignment (=1) and inverse alignment
+//Compute Grow Diagonal Alignment
+//Nice property: you will never introduce more points
+//than the unionalignment alignemt. Hence, you will always be able
+//to represent the grow alignment as the unionalignment of a
+//directed and inverted alignment
 
-  for (int i=1; i<=n; i++) memset(A[i],0,(m+1)*sizeof(int));
+//bit matrices indexed [target][source], reused across sentences
+struct growstate {
+  bitmatrix current; //symmetric alignment
+  bitmatrix direct;  //direct alignment only, not yet in the symmetric one
+  bitmatrix inverse; //inverse alignment only, not yet in the symmetric one
+  bitmatrix fa;      //covered foreign positions (single row)
+  bitmatrix ea;      //covered english positions (single row)
+};
 
-  set <pair <int,int> > currentpoints; //symmetric alignment
-  set <pair <int,int> > unionalignment; //union alignment
+void printgrow(string& out,const alpair& p,growstate& g, bool diagonal=false,bool final=false,bool bothuncovered=false)
+{
+  static const int neighbors[8][2]= {{-1,0},{0,-1},{1,0},{0,1},
+    {-1,-1},{-1,1},{1,-1},{1,1}
+  };
+  const int numneighbors = diagonal ? 8 : 4;
+
+  const int m=p.m, n=p.n;
+  const vector<int>& a=p.a;
+  const vector<int>& b=p.b;
+  int i,j,o;
 
-  pair <int,int> point; //variable to store points
-  set<pair <int,int> >::const_iterator k; //iterator over sets
+  g.current.reset(n,m);
+  g.direct.reset(n,m);
+  g.inverse.reset(n,m);
+  g.fa.reset(0,m);
+  g.ea.reset(0,n);
 
   //fill in the alignments
   for (j=1; j<=m; j++) {
     if (a[j]) {
-      unionalignment.insert(make_pair(a[j],j));
       if (b[a[j]]==j) {
-        fa[j]=1;
-        ea[a[j]]=1;
-        A[a[j]][j]=2;
-        currentpoints.insert(make_pair(a[j],j));
+        g.fa.set(0,j);
+        g.ea.set(0,a[j]);
+        g.current.set(a[j],j);
       } else
-        A[a[j]][j]=-1;
+        g.direct.set(a[j],j);
     }
   }
 
   for (i=1; i<=n; i++)
-    if (b[i] && a[b[i]]!=i) { //not intersection
-      unionalignment.insert(make_pair(i,b[i]));
-      A[i][b[i]]=1;
-    }
-
+    if (b[i] && a[b[i]]!=i) //not intersection
+      g.inverse.set(i,b[i]);
 
+  //scan the current alignment in order; points added behind the scan
+  //position are visited in the same pass
   int added=1;
 
   while (added) {
     added=0;
-    ///scan the current alignment
-    for (k=currentpoints.begin(); k!=currentpoints.end(); k++) {
-      //cout << "{"<< (k->second)-1 << "-" << (k->first)-1 << "}";
-      for (o=0; o<neighbors.size(); o++) {
-        //cout << "go over check all neighbors\n";
-        point.first=k->first+neighbors[o].first;
-        point.second=k->second+neighbors[o].second;
-        //cout << point.second-1 << " " << point.first-1 << "\n";
+    int ci=0, cj=0;
+    while (g.current.next(ci,cj)) {
+      for (o=0; o<numneighbors; o++) {
+        int pi=ci+neighbors[o][0];
+        int pj=cj+neighbors[o][1];
         //check if neighbor is inside 'matrix'
-        if (point.first>0 && point.first <=n && point.second>0 && point.second<=m)
+        if (pi>0 && pi<=n && pj>0 && pj<=m)
           //check if neighbor is in the unionalignment alignment
-          if (b[point.first]==point.second || a[point.second]==point.first) {
-            //cout << "In unionalignment ";cout.flush();
+          if (b[pi]==pj || a[pj]==pi) {
             //check if it connects at least one uncovered word
-            if (!(ea[point.first] && fa[point.second])) {
-              //insert point in currentpoints!
-              currentpoints.insert(point);
-              A[point.first][point.second]=2;
-              ea[point.first]=1;
-              fa[point.second]=1;
+            if (!(g.ea.get(0,pi) && g.fa.get(0,pj))) {
+              g.current.set(pi,pj);
+              g.direct.clear(pi,pj);
+              g.inverse.clear(pi,pj);
+              g.ea.set(0,pi);
+              g.fa.set(0,pj);
               added=1;
-              //cout << "added grow: " << point.second-1 << "-" << point.first-1 << "\n";cout.flush();
             }
           }
       }
+      ++cj;
     }
   }
 
   if (final) {
-    for (k=unionalignment.begin(); k!=unionalignment.end(); k++)
-      if (A[k->first][k->second]==1) {
-        point.first=k->first;
-        point.second=k->second;
+    //inverse alignment points first, then direct alignment points
+    bitmatrix* passes[2]= {&g.inverse,&g.direct};
+    for (int pass=0; pass<2; pass++) {
+      bitmatrix& candidates=*passes[pass];
+      int ci=0, cj=0;
+      while (candidates.next(ci,cj)) {
         //one of the two words is not covered yet
-        //cout << "{" << point.second-1 << "-" << point.first-1 << "} ";
-        if ((bothuncovered &&  !ea[point.first] && !fa[point.second]) ||
-            (!bothuncovered && !(ea[point.first] && fa[point.second]))) {
+        bool ecov=g.ea.get(0,ci), fcov=g.fa.get(0,cj);
+        if ((bothuncovered && !ecov && !fcov) ||
+            (!bothuncovered && !(ecov && fcov))) {
           //add it!
-          currentpoints.insert(point);
-          A[point.first][point.second]=2;
+          g.current.set(ci,cj);
           //keep track of new covered positions
-          ea[point.first]=1;
-          fa[point.second]=1;
-
-          //added=1;
-          //cout << "added final: " << point.second-1 << "-" << point.first-1 << "\n";
+          g.ea.set(0,ci);
+          g.fa.set(0,cj);
         }
+        ++cj;
       }
+    }
+  }
 
-    for (k=unionalignment.begin(); k!=unionalignment.end(); k++)
-      if (A[k->first][k->second]==-1) {
-        point.first=k->first;
-        point.second=k->second;
-        //one of the two words is not covered yet
-        //cout << "{" << point.second-1 << "-" << point.first-1 << "} ";
-        if ((bothuncovered &&  !ea[point.first] && !fa[point.second]) ||
-            (!bothuncovered && !(ea[point.first] && fa[point.second]))) {
-          //add it!
-          currentpoints.insert(point);
-          A[point.first][point.second]=2;
-          //keep track of new covered positions
-          ea[point.first]=1;
-          fa[point.second]=1;
-
-          //added=1;
-          //cout << "added final: " << point.second-1 << "-" << point.first-1 << "\n";
-        }
-      }
+  size_t start=out.size();
+  int ci=0, cj=0;
+  while (g.current.next(ci,cj)) {
+    prpoint(out,cj-1,ci-1);
+    ++cj;
   }
 
+  endline(out,start);
+}
 
-  for (k=currentpoints.begin(); k!=currentpoints.end(); k++)
-    sout << k->second-1 << "-" << k->first-1 << " ";
 
+//symmetrizes the sentence pairs of a batch into its output
 
-  //fix the last " "
-  string str = sout.str();
-  if (str.length() == 0)
-    str = "\n";
-  else
-    str.replace(str.length()-1,1,"\n");
+struct symbatch {
+  size_t id;
+  vector<alpair> pairs;
+  size_t size;
+  string out;
+};
 
-  out << str;
-  out.flush();
-  return 1;
+struct symoptions {
+  int alignment;
+  int diagonal;
+  int final;
+  int bothuncovered;
+};
 
-  return 1;
+void symmetrize(symbatch& batch,const symoptions& opt,growstate& g)
+{
+  batch.out.clear();
+  for (size_t k=0; k<batch.size; k++) {
+    const alpair& p=batch.pairs[k];
+    switch (opt.alignment) {
+    case UNION:
+      prunionalignment(batch.out,p);
+      break;
+    case INTERSECT:
+      printersect(batch.out,p);
+      break;
+    case GROW:
+      printgrow(batch.out,p,g,opt.diagonal,opt.final,opt.bothuncovered);
+      break;
+    case TGTTOSRC:
+      printtgttosrc(batch.out,p);
+      break;
+    case SRCTOTGT:
+      printsrctotgt(batch.out,p);
+      break;
+    }
+  }
 }
 
+//fill a batch from the input, false if the input is exhausted
+bool readbatch(balreader& inp,symbatch& batch)
+{
+  if (batch.pairs.size()<BATCH_SIZE) batch.pairs.resize(BATCH_SIZE);
+  batch.size=0;
+  while (batch.size<BATCH_SIZE && inp.getals(batch.pairs[batch.size]))
+    batch.size++;
+  return batch.size>0;
+}
+
+#ifdef WITH_THREADS
+
+typedef Moses::BatchQueue<symbatch> symbatchqueue;
+
+//writes the batches in input order, whichever worker finishes first;
+//the reader waits while too many batches are pending
+
+class orderedoutput
+{
+public:
+  orderedoutput(FILE* f,size_t limit) : file(f), nextid(0), limit(limit) {}
+
+  //called by the reader before a batch is queued
+  void reserve(size_t id) {
+    boost::mutex::scoped_lock lock(mutex);
+    while (id>=nextid+limit) notfull.wait(lock);
+  }
+
+  void done(symbatch* batch) {
+    boost::mutex::scoped_lock lock(mutex);
+    pending[batch->id]=batch;
+    map<size_t,symbatch*>::iterator it;
+    while ((it=pending.find(nextid))!=pending.end()) {
+      fwrite(it->second->out.data(),1,it->second->out.size(),file);
+      delete it->second;
+      pending.erase(it);
+      nextid++;
+    }
+    notfull.notify_all();
+  }
+
+private:
+  FILE* file;
+  size_t nextid,limit;
+  map<size_t,symbatch*> pending;
+  boost::mutex mutex;
+  boost::condition_variable notfull;
+};
+
+class symworker
+{
+public:
+  symworker(symbatchqueue& q,orderedoutput& o,const symoptions& opt)
+    : queue(q), output(o), opt(opt) {}
+
+  void operator()() {
+    growstate g;
+    symbatch* batch;
+    while ((batch=queue.Pop())!=NULL) {
+      symmetrize(*batch,opt,g);
+      batch->pairs.clear();
+      output.done(batch);
+    }
+  }
+
+private:
+  symbatchqueue& queue;
+  orderedoutput& output;
+  symoptions opt;
+};
+
+#endif
 
 
 //Main file here
@@ -396,6 +559,7 @@ int main(int argc, char** argv)
   int diagonal=false;
   int final=false;
   int bothuncovered=false;
+  int threads=1;
 
 
   DeclareParams("a", CMDENUMTYPE,  &alignment, AlignEnum,
@@ -410,94 +574,109 @@ int main(int argc, char** argv)
                 "o", CMDSTRINGTYPE, &output,
                 "v", CMDENUMTYPE,  &verbose, BoolEnum,
                 "verbose", CMDENUMTYPE,  &verbose, BoolEnum,
+                "t", CMDINTTYPE,  &threads,
+                "threads", CMDINTTYPE,  &threads,
 
                 (char *)NULL);
 
   GetParams(&argc, &argv, (char*) NULL);
 
   if (alignment==0) {
-    cerr << "usage: symal [-i=<inputfile>] [-o=<outputfile>] -a=[u|i|g] -d=[yes|no] -b=[yes|no] -f=[yes|no] \n"
+    cerr << "usage: symal [-i=<inputfile>] [-o=<outputfile>] -a=[u|i|g] -d=[yes|no] -b=[yes|no] -f=[yes|no] [-t=<threads>]\n"
          << "Input file or std must be in .bal format (see script giza2bal.pl).\n";
 
     exit(1);
 
   }
 
-  fstream inp(input,ios::in);
-  fstream out(output,ios::out);
+  FILE* inpfile=fopen(input,"r");
+  FILE* out=fopen(output,"w");
 
-  if (!inp.is_open()) {
+  if (!inpfile) {
     cerr << "cannot open " << input << "\n";
     exit(1);
   }
 
-  if (!out.is_open()) {
+  if (!out) {
     cerr << "cannot open " << output << "\n";
     exit(1);
   }
 
+  vector<char> outbuf(1<<22);
+  setvbuf(out,&outbuf[0],_IOFBF,outbuf.size());
 
-  int a[MAX_M],b[MAX_N],m,n;
-  fa=new int[MAX_M+1];
-  ea=new int[MAX_N+1];
-
-
-  int sents = 0;
-  A=new int *[MAX_N+1];
-  for (int i=1; i<=MAX_N; i++) A[i]=new int[MAX_M+1];
+  balreader inp(inpfile);
 
   switch (alignment) {
   case UNION:
     cerr << "symal: computing union alignment\n";
-    while(getals(inp,m,a,n,b)) {
-      prunionalignment(out,m,a,n,b);
-      sents++;
-    }
-    cerr << "Sents: " << sents << endl;
     break;
   case INTERSECT:
     cerr << "symal: computing intersect alignment\n";
-    while(getals(inp,m,a,n,b)) {
-      printersect(out,m,a,n,b);
-      sents++;
-    }
-    cerr << "Sents: " << sents << endl;
     break;
   case GROW:
     cerr << "symal: computing grow alignment: diagonal ("
          << diagonal << ") final ("<< final << ")"
          <<  "both-uncovered (" << bothuncovered <<")\n";
-
-    while(getals(inp,m,a,n,b))
-      printgrow(out,m,a,n,b,diagonal,final,bothuncovered);
-
     break;
   case TGTTOSRC:
     cerr << "symal: computing target-to-source alignment\n";
-
-    while(getals(inp,m,a,n,b)) {
-      printtgttosrc(out,m,a,n,b);
-      sents++;
-    }
-    cerr << "Sents: " << sents << endl;
     break;
   case SRCTOTGT:
     cerr << "symal: computing source-to-target alignment\n";
-
-    while(getals(inp,m,a,n,b)) {
-      printsrctotgt(out,m,a,n,b);
-      sents++;
-    }
-    cerr << "Sents: " << sents << endl;
     break;
   default:
     exit(1);
   }
 
-  delete [] fa;
-  delete [] ea;
-  for (int i=1; i<=MAX_N; i++) delete [] A[i];
-  delete [] A;
+  symoptions opt;
+  opt.alignment=alignment;
+  opt.diagonal=diagonal;
+  opt.final=final;
+  opt.bothuncovered=bothuncovered;
+
+  size_t sents=0;
+
+#ifdef WITH_THREADS
+  if (threads>1) {
+    symbatchqueue queue(threads);
+    orderedoutput ordered(out,2*threads);
+    boost::thread_group workers;
+    for (int t=0; t<threads; t++)
+      workers.create_thread(symworker(queue,ordered,opt));
+
+    for (size_t id=0;; id++) {
+      symbatch* batch=new symbatch();
+      if (!readbatch(inp,*batch)) {
+        delete batch;
+        break;
+      }
+      batch->id=id;
+      sents+=batch->size;
+      ordered.reserve(id);
+      queue.Push(batch);
+    }
+    queue.Close();
+    workers.join_all();
+  } else
+#endif
+  {
+    if (threads>1)
+      cerr << "symal: compiled without threading support, using a single thread\n";
+    symbatch batch;
+    growstate g;
+    while (readbatch(inp,batch)) {
+      sents+=batch.size;
+      symmetrize(batch,opt,g);
+      fwrite(batch.out.data(),1,batch.out.size(),out);
+    }
+  }
+
+  if (alignment!=GROW)
+    cerr << "Sents: " << sents << endl;
+
+  fclose(inpfile);
+  fclose(out);
 
   exit(0);
 }